@@ -10,6 +10,10 @@ CREATE TABLE IF NOT EXISTS  _timescaledb_cache.cache_inval_hypertable();
 -- For notifying the scheduler of changes to the bgw_job table.
 CREATE TABLE IF NOT EXISTS  _timescaledb_cache.cache_inval_bgw_job();
 
+-- For notifying backends of new chunks, which invalidate the cached
+-- hypertable expansions but not the hypertable cache.
+CREATE TABLE IF NOT EXISTS  _timescaledb_cache.cache_inval_expansion();
+
 -- This is pretty subtle. We create this dummy cache_inval_extension table
 -- solely for the purpose of getting a relcache invalidation event when it is
 -- deleted on DROP extension. It has no related triggers. When the table is
@@ -22,6 +26,7 @@ CREATE TABLE IF NOT EXISTS  _timescaledb_cache.cache_inval_extension();
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_cache.cache_inval_hypertable', '');
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_cache.cache_inval_extension', '');
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_cache.cache_inval_bgw_job', '');
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_cache.cache_inval_expansion', '');
 
 GRANT SELECT ON ALL TABLES IN SCHEMA _timescaledb_cache TO PUBLIC;
 
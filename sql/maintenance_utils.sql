@@ -28,3 +28,15 @@ CREATE OR REPLACE FUNCTION decompress_chunk(
     uncompressed_chunk REGCLASS,
     if_compressed BOOLEAN = false
 ) RETURNS REGCLASS AS '@MODULE_PATHNAME@', 'ts_decompress_chunk' LANGUAGE C STRICT VOLATILE;
+
+-- Bloom filter checks of the timescaledb.compress_bloom segment metadata.
+-- Return false if a segment cannot contain the value (or any of the values).
+CREATE OR REPLACE FUNCTION _timescaledb_internal.segment_meta_bloom_contains(
+    bloom BYTEA,
+    value ANYELEMENT
+) RETURNS BOOLEAN AS '@MODULE_PATHNAME@', 'ts_segment_meta_bloom_contains' LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.segment_meta_bloom_contains_any(
+    bloom BYTEA,
+    vals ANYARRAY
+) RETURNS BOOLEAN AS '@MODULE_PATHNAME@', 'ts_segment_meta_bloom_contains_any' LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
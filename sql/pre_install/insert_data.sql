@@ -8,4 +8,9 @@ insert into _timescaledb_catalog.compression_algorithm( id, version, name, descr
 ( 1, 1, 'COMPRESSION_ALGORITHM_ARRAY', 'array'),
 ( 2, 1, 'COMPRESSION_ALGORITHM_DICTIONARY', 'dictionary'),
 ( 3, 1, 'COMPRESSION_ALGORITHM_GORILLA', 'gorilla'),
-( 4, 1, 'COMPRESSION_ALGORITHM_DELTADELTA', 'deltadelta');
+( 4, 1, 'COMPRESSION_ALGORITHM_DELTADELTA', 'deltadelta'),
+( 5, 1, 'COMPRESSION_ALGORITHM_PFOR', 'pfor'),
+( 6, 1, 'COMPRESSION_ALGORITHM_ALP', 'alp'),
+( 7, 1, 'COMPRESSION_ALGORITHM_ARRAY_LZ4', 'array_lz4'),
+( 8, 1, 'COMPRESSION_ALGORITHM_ARRAY_ZSTD', 'array_zstd'),
+( 9, 1, 'COMPRESSION_ALGORITHM_JSONB', 'jsonb');
@@ -321,6 +321,8 @@ CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable_compression (
 	orderby_column_index SMALLINT,
 	orderby_asc BOOLEAN,
 	orderby_nullsfirst BOOLEAN,
+	minmax_column_index SMALLINT,
+	bloom_column_index SMALLINT,
 	PRIMARY KEY (hypertable_id, attname),
     UNIQUE (hypertable_id, segmentby_column_index),
     UNIQUE (hypertable_id, orderby_column_index)
@@ -351,6 +353,16 @@ CREATE TABLE IF NOT EXISTS _timescaledb_config.bgw_policy_compress_chunks(
 
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_config.bgw_policy_compress_chunks', '');
 
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable_compression_settings (
+    hypertable_id   INTEGER     PRIMARY KEY REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    -- number of rows per compressed row, 0 for adaptive, NULL if not set
+    batch_size      INTEGER     CHECK (batch_size >= 0),
+    -- choose the algorithm of every compressed value by trial encoding
+    adaptive_algorithms BOOLEAN NOT NULL DEFAULT false
+);
+
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.hypertable_compression_settings', '');
+
 
 -- Set table permissions
 -- We need to grant SELECT to PUBLIC for all tables even those not
@@ -1 +1,22 @@
 DROP VIEW IF EXISTS timescaledb_information.continuous_aggregates;
+
+ALTER TABLE _timescaledb_catalog.hypertable_compression ADD COLUMN minmax_column_index SMALLINT;
+ALTER TABLE _timescaledb_catalog.hypertable_compression ADD COLUMN bloom_column_index SMALLINT;
+
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable_compression_settings (
+    hypertable_id   INTEGER     PRIMARY KEY REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    -- number of rows per compressed row, 0 for adaptive, NULL if not set
+    batch_size      INTEGER     CHECK (batch_size >= 0),
+    -- choose the algorithm of every compressed value by trial encoding
+    adaptive_algorithms BOOLEAN NOT NULL DEFAULT false
+);
+
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.hypertable_compression_settings', '');
+GRANT SELECT ON _timescaledb_catalog.hypertable_compression_settings TO PUBLIC;
+
+INSERT INTO _timescaledb_catalog.compression_algorithm( id, version, name, description) VALUES
+( 5, 1, 'COMPRESSION_ALGORITHM_PFOR', 'pfor'),
+( 6, 1, 'COMPRESSION_ALGORITHM_ALP', 'alp'),
+( 7, 1, 'COMPRESSION_ALGORITHM_ARRAY_LZ4', 'array_lz4'),
+( 8, 1, 'COMPRESSION_ALGORITHM_ARRAY_ZSTD', 'array_zstd'),
+( 9, 1, 'COMPRESSION_ALGORITHM_JSONB', 'jsonb');
@@ -219,5 +219,25 @@ AS
  where map.chunk_id = srcch.id and srcht.id = srcch.hypertable_id
  group by srcht.id;
 
+CREATE OR REPLACE FUNCTION _timescaledb_internal.planner_stats(
+    OUT phase TEXT,
+    OUT calls BIGINT,
+    OUT total_time DOUBLE PRECISION,
+    OUT chunks BIGINT
+) RETURNS SETOF RECORD AS '@MODULE_PATHNAME@', 'ts_planner_stats' LANGUAGE C VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.planner_stats_reset() RETURNS VOID
+AS '@MODULE_PATHNAME@', 'ts_planner_stats_reset' LANGUAGE C VOLATILE STRICT;
+
+-- Planner statistics of the current session, collected when
+-- timescaledb.enable_planner_instrumentation is on. Times are in
+-- milliseconds and chunks is the number of chunks added by hypertable
+-- expansion.
+CREATE OR REPLACE VIEW timescaledb_information.planner_stats AS
+  SELECT phase, calls, total_time,
+    CASE WHEN calls > 0 THEN total_time / calls END AS mean_time,
+    chunks
+  FROM _timescaledb_internal.planner_stats();
+
 GRANT USAGE ON SCHEMA timescaledb_information TO PUBLIC;
 GRANT SELECT ON ALL TABLES IN SCHEMA timescaledb_information TO PUBLIC;
@@ -15,6 +15,7 @@
 #include "compat.h"
 #include "extension.h"
 #include "hypertable_cache.h"
+#include "plan_expand_cache.h"
 
 #include "bgw/scheduler.h"
 
@@ -53,6 +54,7 @@ static void
 cache_invalidate_all(void)
 {
 	ts_hypertable_cache_invalidate_callback();
+	ts_plan_expand_cache_invalidate();
 }
 
 /*
@@ -76,7 +78,19 @@ cache_invalidate_callback(Datum arg, Oid relid)
 	catalog = ts_catalog_get();
 
 	if (relid == ts_catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE))
+	{
 		ts_hypertable_cache_invalidate_callback();
+		ts_plan_expand_cache_invalidate();
+	}
+	else if (relid == ts_catalog_get_cache_proxy_id(catalog, CACHE_TYPE_EXPANSION) ||
+			 !OidIsValid(relid))
+	{
+		/*
+		 * A chunk was created, or all relcache entries were invalidated and
+		 * the signal of a new chunk might have been lost
+		 */
+		ts_plan_expand_cache_invalidate();
+	}
 
 	if (relid == ts_catalog_get_cache_proxy_id(catalog, CACHE_TYPE_BGW_JOB))
 		ts_bgw_job_cache_invalidate_callback();
@@ -110,6 +110,10 @@ static const TableInfoDef catalog_table_names[_MAX_CATALOG_TABLES + 1] = {
 		.schema_name = CONFIG_SCHEMA_NAME,
 		.table_name = BGW_POLICY_COMPRESS_CHUNKS_TABLE_NAME,
 	},
+	[HYPERTABLE_COMPRESSION_SETTINGS] = {
+		.schema_name = CATALOG_SCHEMA_NAME,
+		.table_name = HYPERTABLE_COMPRESSION_SETTINGS_TABLE_NAME,
+	},
 	[_MAX_CATALOG_TABLES] = {
 		.schema_name = "invalid schema",
 		.table_name = "invalid table",
@@ -259,6 +263,12 @@ static const TableIndexDef catalog_table_index_definitions[_MAX_CATALOG_TABLES]
 			[BGW_POLICY_COMPRESS_CHUNKS_HYPERTABLE_ID_KEY] = "bgw_policy_compress_chunks_hypertable_id_key",
 		},
 	},
+	[HYPERTABLE_COMPRESSION_SETTINGS] = {
+		.length = _MAX_HYPERTABLE_COMPRESSION_SETTINGS_INDEX,
+		.names = (char *[]) {
+			[HYPERTABLE_COMPRESSION_SETTINGS_PKEY] = "hypertable_compression_settings_pkey",
+		},
+	},
 };
 
 static const char *catalog_table_serial_id_names[_MAX_CATALOG_TABLES] = {
@@ -280,6 +290,7 @@ static const char *catalog_table_serial_id_names[_MAX_CATALOG_TABLES] = {
 	[HYPERTABLE_COMPRESSION] = NULL,
 	[COMPRESSION_CHUNK_SIZE] = NULL,
 	[BGW_POLICY_COMPRESS_CHUNKS] = NULL,
+	[HYPERTABLE_COMPRESSION_SETTINGS] = NULL,
 };
 
 typedef struct InternalFunctionDef
@@ -304,6 +315,7 @@ const static InternalFunctionDef internal_function_definitions[_MAX_INTERNAL_FUN
 static const char *cache_proxy_table_names[_MAX_CACHE_TYPES] = {
 	[CACHE_TYPE_HYPERTABLE] = "cache_inval_hypertable",
 	[CACHE_TYPE_BGW_JOB] = "cache_inval_bgw_job",
+	[CACHE_TYPE_EXPANSION] = "cache_inval_expansion",
 };
 
 /* Catalog information for the current database. */
@@ -702,6 +714,14 @@ ts_catalog_invalidate_cache(Oid catalog_relid, CmdType operation)
 				relid = ts_catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE);
 				CacheInvalidateRelcacheByRelid(relid);
 			}
+			else if (table == CHUNK)
+			{
+				/* a new chunk only affects the cached hypertable expansions */
+				relid = ts_catalog_get_cache_proxy_id(catalog, CACHE_TYPE_EXPANSION);
+
+				if (OidIsValid(relid))
+					CacheInvalidateRelcacheByRelid(relid);
+			}
 			break;
 		case HYPERTABLE:
 		case DIMENSION:
@@ -55,6 +55,7 @@ typedef enum CatalogTable
 	HYPERTABLE_COMPRESSION,
 	COMPRESSION_CHUNK_SIZE,
 	BGW_POLICY_COMPRESS_CHUNKS,
+	HYPERTABLE_COMPRESSION_SETTINGS,
 	_MAX_CATALOG_TABLES,
 } CatalogTable;
 
@@ -1073,6 +1074,8 @@ typedef enum Anum_hypertable_compression
 	Anum_hypertable_compression_orderby_column_index,
 	Anum_hypertable_compression_orderby_asc,
 	Anum_hypertable_compression_orderby_nullsfirst,
+	Anum_hypertable_compression_minmax_column_index,
+	Anum_hypertable_compression_bloom_column_index,
 	_Anum_hypertable_compression_max,
 } Anum_hypertable_compression;
 
@@ -1087,6 +1090,8 @@ typedef struct FormData_hypertable_compression
 	int16 orderby_column_index;
 	bool orderby_asc;
 	bool orderby_nullsfirst;
+	int16 minmax_column_index;
+	int16 bloom_column_index;
 } FormData_hypertable_compression;
 
 typedef FormData_hypertable_compression *Form_hypertable_compression;
@@ -1193,6 +1198,40 @@ typedef enum Anum_bgw_policy_compress_chunks_pkey
 
 #define Natts_bgw_policy_compress_chunks_pkey (_Anum_bgw_policy_compress_chunks_pkey_max - 1)
 
+#define HYPERTABLE_COMPRESSION_SETTINGS_TABLE_NAME "hypertable_compression_settings"
+typedef enum Anum_hypertable_compression_settings
+{
+	Anum_hypertable_compression_settings_hypertable_id = 1,
+	Anum_hypertable_compression_settings_batch_size,
+	Anum_hypertable_compression_settings_adaptive_algorithms,
+	_Anum_hypertable_compression_settings_max,
+} Anum_hypertable_compression_settings;
+
+#define Natts_hypertable_compression_settings (_Anum_hypertable_compression_settings_max - 1)
+
+typedef struct FormData_hypertable_compression_settings
+{
+	int32 hypertable_id;
+	int32 batch_size;
+	bool adaptive_algorithms;
+} FormData_hypertable_compression_settings;
+
+typedef FormData_hypertable_compression_settings *Form_hypertable_compression_settings;
+
+enum
+{
+	HYPERTABLE_COMPRESSION_SETTINGS_PKEY = 0,
+	_MAX_HYPERTABLE_COMPRESSION_SETTINGS_INDEX,
+};
+typedef enum Anum_hypertable_compression_settings_pkey
+{
+	Anum_hypertable_compression_settings_pkey_hypertable_id = 1,
+	_Anum_hypertable_compression_settings_pkey_max,
+} Anum_hypertable_compression_settings_pkey;
+
+#define Natts_hypertable_compression_settings_pkey                                                 \
+	(_Anum_hypertable_compression_settings_pkey_max - 1)
+
 /*
  * The maximum number of indexes a catalog table can have.
  * This needs to be bumped in case of new catalog tables that have more indexes.
@@ -1203,6 +1242,7 @@ typedef enum CacheType
 {
 	CACHE_TYPE_HYPERTABLE,
 	CACHE_TYPE_BGW_JOB,
+	CACHE_TYPE_EXPANSION,
 	_MAX_CACHE_TYPES
 } CacheType;
 
@@ -17,11 +17,11 @@
 #include "chunk_append/chunk_append.h"
 #include "chunk_append/planner.h"
 #include "compat.h"
-#include "func_cache.h"
+#include "sort_transform.h"
 #include "guc.h"
 
-static bool contain_param_exec(Node *node);
-static bool contain_param_exec_walker(Node *node, void *context);
+static bool contain_param_kind(Node *node, ParamKind kind);
+static bool contain_param_kind_walker(Node *node, ParamKind *kind);
 static Var *find_equality_join_var(Var *sort_var, Index ht_relid, Oid eq_opr,
 								   List *join_conditions);
 
@@ -94,10 +94,17 @@ ts_chunk_append_path_create(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht,
 	{
 		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
 
-		if (contain_mutable_functions((Node *) rinfo->clause))
+		/*
+		 * External params have a fixed value for the duration of an
+		 * execution, so clauses referencing them, e.g. "device_id = ANY($1)"
+		 * in a generic plan, can be used for startup exclusion
+		 */
+		if (contain_mutable_functions((Node *) rinfo->clause) ||
+			contain_param_kind((Node *) rinfo->clause, PARAM_EXTERN))
 			path->startup_exclusion = true;
 
-		if (ts_guc_enable_runtime_exclusion && contain_param_exec((Node *) rinfo->clause))
+		if (ts_guc_enable_runtime_exclusion &&
+			contain_param_kind((Node *) rinfo->clause, PARAM_EXEC))
 		{
 			ListCell *lc_var;
 
@@ -280,6 +287,7 @@ ts_ordered_append_should_optimize(PlannerInfo *root, RelOptInfo *rel, Hypertable
 	TargetEntry *tle = get_sortgroupref_tle(sort->tleSortGroupRef, root->parse->targetList);
 	RangeTblEntry *rte = root->simple_rte_array[rel->relid];
 	TypeCacheEntry *tce;
+	TypeCacheEntry *sort_tce;
 	char *column;
 	Index ht_relid = rel->relid;
 	Index sort_relid;
@@ -301,10 +309,11 @@ ts_ordered_append_should_optimize(PlannerInfo *root, RelOptInfo *rel, Hypertable
 		/* direct column reference */
 		sort_var = castNode(Var, tle->expr);
 	}
-	else if (IsA(tle->expr, FuncExpr) && list_length(root->parse->sortClause) == 1)
+	else if (list_length(root->parse->sortClause) == 1)
 	{
 		/*
-		 * check for bucketing functions
+		 * check for bucketing functions and other order preserving
+		 * expressions
 		 *
 		 * If ORDER BY clause only has 1 expression and the expression is a
 		 * bucketing function we can still do Ordered Append, the 1 expression
@@ -332,13 +341,7 @@ ts_ordered_append_should_optimize(PlannerInfo *root, RelOptInfo *rel, Hypertable
 		 * The order of the device_ids is wrong so we cannot safely remove the MergeAppend
 		 * unless we eliminate the possibility that a bucket spans multiple chunks.
 		 */
-		FuncInfo *info = ts_func_cache_get_bucketing_func(castNode(FuncExpr, tle->expr)->funcid);
-		Expr *transformed;
-
-		if (info == NULL)
-			return false;
-
-		transformed = info->sort_transform(castNode(FuncExpr, tle->expr));
+		Expr *transformed = ts_sort_transform_expr(tle->expr);
 
 		if (!IsA(transformed, Var))
 			return false;
@@ -356,8 +359,18 @@ ts_ordered_append_should_optimize(PlannerInfo *root, RelOptInfo *rel, Hypertable
 	tce = lookup_type_cache(sort_var->vartype,
 							TYPECACHE_EQ_OPR | TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
 
+	/*
+	 * The ORDER BY expression might have a different type than the column
+	 * it was transformed to, e.g., date_part('epoch', time), so check the
+	 * sort operator against the type of the expression.
+	 */
+	sort_tce = tce;
+	if (exprType((Node *) tle->expr) != sort_var->vartype)
+		sort_tce = lookup_type_cache(exprType((Node *) tle->expr),
+									 TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+
 	/* check sort operation is either less than or greater than */
-	if (sort->sortop != tce->lt_opr && sort->sortop != tce->gt_opr)
+	if (sort->sortop != sort_tce->lt_opr && sort->sortop != sort_tce->gt_opr)
 		return false;
 
 	/*
@@ -392,27 +405,27 @@ ts_ordered_append_should_optimize(PlannerInfo *root, RelOptInfo *rel, Hypertable
 
 	Assert(order_attno != NULL && reverse != NULL);
 	*order_attno = ht_var->varattno;
-	*reverse = sort->sortop == tce->lt_opr ? false : true;
+	*reverse = sort->sortop == sort_tce->lt_opr ? false : true;
 
 	return true;
 }
 
 static bool
-contain_param_exec(Node *node)
+contain_param_kind(Node *node, ParamKind kind)
 {
-	return contain_param_exec_walker(node, NULL);
+	return contain_param_kind_walker(node, &kind);
 }
 
 static bool
-contain_param_exec_walker(Node *node, void *context)
+contain_param_kind_walker(Node *node, ParamKind *kind)
 {
 	if (node == NULL)
 		return false;
 
 	if (IsA(node, Param))
-		return castNode(Param, node)->paramkind == PARAM_EXEC;
+		return castNode(Param, node)->paramkind == *kind;
 
-	return expression_tree_walker(node, contain_param_exec_walker, context);
+	return expression_tree_walker(node, contain_param_kind_walker, kind);
 }
 
 /*
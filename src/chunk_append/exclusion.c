@@ -0,0 +1,837 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+#include <postgres.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_type.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include "compat-msvc-enter.h"
+#include <optimizer/cost.h>
+#include "compat-msvc-exit.h"
+#include <optimizer/predtest.h>
+#include <optimizer/prep.h>
+#include <parser/parsetree.h>
+#include <rewrite/rewriteManip.h>
+#include <utils/array.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/typcache.h>
+
+#include "chunk_append/exclusion.h"
+#include "chunk.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "hypercube.h"
+#include "partitioning.h"
+#include "planner.h"
+#include "utils.h"
+#include "compat.h"
+
+/*
+ * Chunk exclusion based on dimension slices.
+ *
+ * Chunks are excluded during executor startup and at runtime by comparing
+ * the constified restriction clauses directly against the dimension slice
+ * ranges of the chunk. This avoids opening every chunk to fetch its CHECK
+ * constraints and running them through predicate_refuted_by for every
+ * execution, which is the dominant cost for prepared statements executed
+ * over and over.
+ *
+ * The general constraint refutation is only used as a fallback when a
+ * clause could not be interpreted as a restriction on a dimension or when
+ * the chunk has CHECK constraints that are not dimension constraints.
+ * Constraints for the fallback are loaded lazily and are kept for
+ * subsequent rescans.
+ */
+
+static Const *
+make_int64_const(int64 value)
+{
+	return makeConst(INT8OID,
+					 -1,
+					 InvalidOid,
+					 sizeof(int64),
+					 Int64GetDatum(value),
+					 false,
+					 FLOAT8PASSBYVAL);
+}
+
+/*
+ * Check whether the chunk has valid CHECK constraints besides the constraints
+ * of its dimension slices.
+ *
+ * Slices with infinite bounds on both ends have no CHECK constraint, so the
+ * number of dimension constraints does not tell us how many of the CHECK
+ * constraints on the relation are dimension constraints. Instead, the
+ * constraints are matched by name against the dimension constraints of the
+ * chunk.
+ */
+static bool
+chunk_has_non_dimension_check_constraints(Chunk *chunk)
+{
+	Relation relation = heap_open(chunk->table_id, NoLock);
+	TupleConstr *constr = relation->rd_att->constr;
+	bool found = false;
+	int i, j;
+
+	if (constr != NULL)
+	{
+		for (i = 0; i < constr->num_check && !found; i++)
+		{
+			if (!constr->check[i].ccvalid)
+				continue;
+
+			found = true;
+
+			for (j = 0; j < chunk->constraints->num_constraints; j++)
+			{
+				ChunkConstraint *cc = &chunk->constraints->constraints[j];
+
+				if (is_dimension_constraint(cc) &&
+					namestrcmp(&cc->fd.constraint_name, constr->check[i].ccname) == 0)
+				{
+					found = false;
+					break;
+				}
+			}
+		}
+	}
+
+	heap_close(relation, NoLock);
+
+	return found;
+}
+
+/*
+ * Serialize the dimension slice ranges of the chunk scanned by scanrelid so
+ * they can be stored in the custom_private of a plan node.
+ *
+ * The result is a two element list. The first element is an integer list
+ * with a flag indicating whether the chunk has non-dimension CHECK
+ * constraints followed by the attribute number of every dimension column in
+ * the chunk. The second element is a list of int8 Consts with the start and
+ * end of the slice for every dimension. NIL is returned if the relation is
+ * not a chunk of the hypertable.
+ */
+List *
+ts_chunk_exclusion_info_serialize(PlannerInfo *root, Hypertable *ht, Index scanrelid)
+{
+	RangeTblEntry *rte = planner_rt_fetch(scanrelid, root);
+	RelOptInfo *rel = root->simple_rel_array[scanrelid];
+	List *attnos = NIL;
+	List *ranges = NIL;
+	Chunk *chunk;
+	int i;
+
+	if (rte->rtekind != RTE_RELATION || rte->relkind != RELKIND_RELATION || rte->inh ||
+		rel == NULL)
+		return NIL;
+
+	/* reuse the chunk found during hypertable expansion if there is one */
+	chunk = ts_planner_chunk_fetch(root, rel);
+
+	if (chunk == NULL || chunk->cube == NULL || chunk->fd.hypertable_id != ht->fd.id)
+		return NIL;
+
+	for (i = 0; i < ht->space->num_dimensions; i++)
+	{
+		Dimension *dim = &ht->space->dimensions[i];
+		DimensionSlice *slice = ts_hypercube_get_slice_by_dimension_id(chunk->cube, dim->fd.id);
+
+		if (slice == NULL)
+			return NIL;
+
+		attnos = lappend_int(attnos, get_attnum(rte->relid, NameStr(dim->fd.column_name)));
+		ranges = lappend(ranges, make_int64_const(slice->fd.range_start));
+		ranges = lappend(ranges, make_int64_const(slice->fd.range_end));
+	}
+
+	attnos = lcons_int(chunk_has_non_dimension_check_constraints(chunk), attnos);
+
+	return list_make2(attnos, ranges);
+}
+
+/*
+ * Create the executor representation of the exclusion information. If
+ * serialized is NIL only constraint refutation will be used for this chunk.
+ */
+ChunkExclusionInfo *
+ts_chunk_exclusion_info_create(Oid relid, Index scanrelid, List *serialized)
+{
+	ChunkExclusionInfo *info = palloc0(sizeof(ChunkExclusionInfo));
+
+	info->relid = relid;
+	info->scanrelid = scanrelid;
+	info->mcxt = CurrentMemoryContext;
+	info->has_check_constraints = true;
+
+	if (serialized != NIL)
+	{
+		List *attnos = linitial(serialized);
+		List *ranges = lsecond(serialized);
+		ListCell *lc_attno;
+		ListCell *lc_range;
+		int i = 0;
+
+		Assert(list_length(ranges) == 2 * (list_length(attnos) - 1));
+
+		info->has_check_constraints = (bool) linitial_int(attnos);
+		info->num_dimensions = list_length(attnos) - 1;
+		info->attnos = palloc(sizeof(AttrNumber) * info->num_dimensions);
+		info->range_start = palloc(sizeof(int64) * info->num_dimensions);
+		info->range_end = palloc(sizeof(int64) * info->num_dimensions);
+
+		lc_range = list_head(ranges);
+		for_each_cell (lc_attno, lnext(list_head(attnos)))
+		{
+			info->attnos[i] = lfirst_int(lc_attno);
+			info->range_start[i] = DatumGetInt64(lfirst_node(Const, lc_range)->constvalue);
+			lc_range = lnext(lc_range);
+			info->range_end[i] = DatumGetInt64(lfirst_node(Const, lc_range)->constvalue);
+			lc_range = lnext(lc_range);
+			i++;
+		}
+	}
+
+	return info;
+}
+
+/*
+ * stripped down version of postgres get_relation_constraints
+ */
+static List *
+ca_get_relation_constraints(Oid relationObjectId, Index varno, bool include_notnull)
+{
+	List *result = NIL;
+	Relation relation;
+	TupleConstr *constr;
+
+	/*
+	 * We assume the relation has already been safely locked.
+	 */
+	relation = heap_open(relationObjectId, NoLock);
+
+	constr = relation->rd_att->constr;
+	if (constr != NULL)
+	{
+		int num_check = constr->num_check;
+		int i;
+
+		for (i = 0; i < num_check; i++)
+		{
+			Node *cexpr;
+
+			/*
+			 * If this constraint hasn't been fully validated yet, we must
+			 * ignore it here.
+			 */
+			if (!constr->check[i].ccvalid)
+				continue;
+
+			cexpr = stringToNode(constr->check[i].ccbin);
+
+			/*
+			 * Run each expression through const-simplification and
+			 * canonicalization.  This is not just an optimization, but is
+			 * necessary, because we will be comparing it to
+			 * similarly-processed qual clauses, and may fail to detect valid
+			 * matches without this.  This must match the processing done to
+			 * qual clauses in preprocess_expression()!  (We can skip the
+			 * stuff involving subqueries, however, since we don't allow any
+			 * in check constraints.)
+			 */
+			cexpr = eval_const_expressions(NULL, cexpr);
+
+#if (PG96 && PG_VERSION_NUM < 90609) || (PG10 && PG_VERSION_NUM < 100004)
+			cexpr = (Node *) canonicalize_qual((Expr *) cexpr);
+#elif PG96 || PG10
+			cexpr = (Node *) canonicalize_qual_ext((Expr *) cexpr, true);
+#else
+			cexpr = (Node *) canonicalize_qual((Expr *) cexpr, true);
+#endif
+
+			/* Fix Vars to have the desired varno */
+			if (varno != 1)
+				ChangeVarNodes(cexpr, 1, varno, 0);
+
+			/*
+			 * Finally, convert to implicit-AND format (that is, a List) and
+			 * append the resulting item(s) to our output list.
+			 */
+			result = list_concat(result, make_ands_implicit((Expr *) cexpr));
+		}
+
+		/* Add NOT NULL constraints in expression form, if requested */
+		if (include_notnull && constr->has_not_null)
+		{
+			int natts = relation->rd_att->natts;
+
+			for (i = 1; i <= natts; i++)
+			{
+				Form_pg_attribute att = TupleDescAttr(relation->rd_att, i - 1);
+
+				if (att->attnotnull && !att->attisdropped)
+				{
+					NullTest *ntest = makeNode(NullTest);
+
+					ntest->arg = (Expr *)
+						makeVar(varno, i, att->atttypid, att->atttypmod, att->attcollation, 0);
+					ntest->nulltesttype = IS_NOT_NULL;
+
+					/*
+					 * argisrow=false is correct even for a composite column,
+					 * because attnotnull does not represent a SQL-spec IS NOT
+					 * NULL test in such a case, just IS DISTINCT FROM NULL.
+					 */
+					ntest->argisrow = false;
+					ntest->location = -1;
+					result = lappend(result, ntest);
+				}
+			}
+		}
+	}
+
+	heap_close(relation, NoLock);
+
+	return result;
+}
+
+static List *
+chunk_exclusion_info_get_constraints(ChunkExclusionInfo *info)
+{
+	if (!info->constraints_loaded)
+	{
+		MemoryContext old = MemoryContextSwitchTo(info->mcxt);
+
+		info->constraints = ca_get_relation_constraints(info->relid, info->scanrelid, true);
+		info->constraints_loaded = true;
+		MemoryContextSwitchTo(old);
+	}
+
+	return info->constraints;
+}
+
+/*
+ * Check whether value lies outside of the half-open slice range
+ * [range_start, range_end) given the comparison strategy, i.e., whether
+ * "column <strategy> value" cannot be true for any row in the chunk.
+ */
+static bool
+dimension_range_excludes(int64 range_start, int64 range_end, StrategyNumber strategy, int64 value)
+{
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			return range_start >= value;
+		case BTLessEqualStrategyNumber:
+			return range_start > value;
+		case BTEqualStrategyNumber:
+			return value < range_start || value >= range_end;
+		case BTGreaterEqualStrategyNumber:
+			return range_end <= value;
+		case BTGreaterStrategyNumber:
+			return range_end - 1 <= value;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Get the dimension index for a Var referencing the chunk, or -1 if the Var
+ * is not a dimension column.
+ */
+static int
+chunk_exclusion_info_get_dimension(ChunkExclusionInfo *info, Var *var)
+{
+	int i;
+
+	if (var->varno != info->scanrelid || var->varlevelsup != 0 || var->varattno <= 0)
+		return -1;
+
+	for (i = 0; i < info->num_dimensions; i++)
+	{
+		if (info->attnos[i] == var->varattno)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Check whether values of valuetype can be compared against the dimension
+ * slices of dim, using the given strategy, after transforming them with
+ * dimension_value_transform.
+ */
+static bool
+dimension_value_supported(Dimension *dim, Oid vartype, Oid valuetype, StrategyNumber strategy)
+{
+	switch (dim->type)
+	{
+		case DIMENSION_TYPE_OPEN:
+			/*
+			 * Open dimensions with a custom partitioning function are not
+			 * guaranteed to preserve ordering. Cross-type comparisons other
+			 * than between integers might not agree with the internal time
+			 * representation (e.g., timestamptz compared to date depends on
+			 * the session timezone) so we leave those to constraint
+			 * refutation.
+			 */
+			if (dim->partitioning != NULL || !IS_VALID_OPEN_DIM_TYPE(vartype))
+				return false;
+
+			return valuetype == vartype || (IS_INTEGER_TYPE(valuetype) && IS_INTEGER_TYPE(vartype));
+		case DIMENSION_TYPE_CLOSED:
+			return strategy == BTEqualStrategyNumber && dim->partitioning != NULL &&
+				   valuetype == vartype;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Transform a value to the representation used by the dimension slices,
+ * i.e., internal time for open dimensions and the hash value for closed
+ * dimensions.
+ */
+static int64
+dimension_value_transform(Dimension *dim, Datum value, Oid valuetype)
+{
+	if (dim->type == DIMENSION_TYPE_CLOSED)
+		return DatumGetInt32(ts_partitioning_func_apply(dim->partitioning, value));
+
+	return ts_time_value_to_internal_or_infinite(value, valuetype, NULL);
+}
+
+/*
+ * Get the btree strategy of an operator comparing values of the dimension
+ * column, or InvalidStrategy if the operator is not a btree comparison.
+ */
+static StrategyNumber
+dimension_op_strategy(Oid opno, Oid vartype)
+{
+	TypeCacheEntry *tce = lookup_type_cache(vartype, TYPECACHE_BTREE_OPFAMILY);
+	int strategy;
+	Oid lefttype, righttype;
+
+	if (!OidIsValid(tce->btree_opf) || !op_in_opfamily(opno, tce->btree_opf))
+		return InvalidStrategy;
+
+	get_op_opfamily_properties(opno, tce->btree_opf, false, &strategy, &lefttype, &righttype);
+
+	return strategy;
+}
+
+/*
+ * Try to exclude the chunk based on a "Var op Const" clause on a dimension
+ * column. Sets handled to true if the clause could be fully interpreted as a
+ * range restriction on the dimension. In that case the return value is
+ * authoritative with respect to the dimension constraints of the chunk.
+ */
+static bool
+dimension_opexpr_excludes(ChunkExclusionInfo *info, Hyperspace *space, OpExpr *op, bool *handled)
+{
+	Expr *left, *right;
+	Var *var;
+	Const *value;
+	Oid opno = op->opno;
+	Dimension *dim;
+	StrategyNumber strategy;
+	int dimidx;
+
+	if (list_length(op->args) != 2)
+		return false;
+
+	left = linitial(op->args);
+	right = lsecond(op->args);
+
+	if (IsA(left, RelabelType))
+		left = castNode(RelabelType, left)->arg;
+	if (IsA(right, RelabelType))
+		right = castNode(RelabelType, right)->arg;
+
+	if (IsA(left, Var) && IsA(right, Const))
+	{
+		var = castNode(Var, left);
+		value = castNode(Const, right);
+	}
+	else if (IsA(right, Var) && IsA(left, Const))
+	{
+		var = castNode(Var, right);
+		value = castNode(Const, left);
+		opno = get_commutator(opno);
+
+		if (!OidIsValid(opno))
+			return false;
+	}
+	else
+		return false;
+
+	dimidx = chunk_exclusion_info_get_dimension(info, var);
+
+	if (dimidx < 0)
+		return false;
+
+	dim = &space->dimensions[dimidx];
+
+	/* a strict operator with a NULL argument will never return true */
+	if (value->constisnull)
+	{
+		if (!op_strict(opno))
+			return false;
+
+		*handled = true;
+		return true;
+	}
+
+	strategy = dimension_op_strategy(opno, var->vartype);
+
+	if (strategy == InvalidStrategy ||
+		!dimension_value_supported(dim, var->vartype, value->consttype, strategy))
+		return false;
+
+	*handled = true;
+
+	return dimension_range_excludes(info->range_start[dimidx],
+									info->range_end[dimidx],
+									strategy,
+									dimension_value_transform(dim,
+															  value->constvalue,
+															  value->consttype));
+}
+
+/*
+ * Transformed elements of an array restriction on a dimension.
+ */
+typedef struct DimensionArrayValues
+{
+	int32 dimension_id;
+	Oid elemtype;
+	Datum array;
+	int num_values;
+	int64 *values; /* sorted */
+	bool has_nulls;
+} DimensionArrayValues;
+
+/* Number of distinct arrays to remember before the cache is reset */
+#define ARRAY_CACHE_MAX_ENTRIES 16
+
+ChunkExclusionArrayCache *
+ts_chunk_exclusion_array_cache_create(MemoryContext parent)
+{
+	ChunkExclusionArrayCache *cache = MemoryContextAllocZero(parent, sizeof(*cache));
+
+	cache->mcxt = AllocSetContextCreate(parent,
+										"Chunk exclusion array cache",
+										ALLOCSET_DEFAULT_SIZES);
+
+	return cache;
+}
+
+static int
+int64_cmp(const void *a, const void *b)
+{
+	int64 v1 = *((const int64 *) a);
+	int64 v2 = *((const int64 *) b);
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+static DimensionArrayValues *
+dimension_array_values_create(Dimension *dim, Oid elemtype, Datum array, MemoryContext mcxt)
+{
+	ArrayType *arr = DatumGetArrayTypeP(array);
+	DimensionArrayValues *dav;
+	MemoryContext old;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	Datum *elems;
+	bool *nulls;
+	int nelems;
+	int i;
+
+	get_typlenbyvalalign(elemtype, &typlen, &typbyval, &typalign);
+	deconstruct_array(arr, elemtype, typlen, typbyval, typalign, &elems, &nulls, &nelems);
+
+	old = MemoryContextSwitchTo(mcxt);
+	dav = palloc0(sizeof(DimensionArrayValues));
+	dav->dimension_id = dim->fd.id;
+	dav->elemtype = elemtype;
+	dav->array = datumCopy(array, false, -1);
+	dav->values = palloc(sizeof(int64) * Max(nelems, 1));
+	MemoryContextSwitchTo(old);
+
+	for (i = 0; i < nelems; i++)
+	{
+		if (nulls[i])
+			dav->has_nulls = true;
+		else
+			dav->values[dav->num_values++] = dimension_value_transform(dim, elems[i], elemtype);
+	}
+
+	qsort(dav->values, dav->num_values, sizeof(int64), int64_cmp);
+
+	return dav;
+}
+
+static DimensionArrayValues *
+dimension_array_values_get(ChunkExclusionInfo *info, Dimension *dim, Oid elemtype, Datum array)
+{
+	ChunkExclusionArrayCache *cache = info->array_cache;
+	DimensionArrayValues *dav;
+	MemoryContext old;
+	ListCell *lc;
+
+	if (cache == NULL)
+		return dimension_array_values_create(dim, elemtype, array, CurrentMemoryContext);
+
+	foreach (lc, cache->entries)
+	{
+		dav = lfirst(lc);
+
+		if (dav->dimension_id == dim->fd.id && dav->elemtype == elemtype &&
+			datumIsEqual(dav->array, array, false, -1))
+			return dav;
+	}
+
+	if (list_length(cache->entries) >= ARRAY_CACHE_MAX_ENTRIES)
+	{
+		MemoryContextReset(cache->mcxt);
+		cache->entries = NIL;
+	}
+
+	dav = dimension_array_values_create(dim, elemtype, array, cache->mcxt);
+	old = MemoryContextSwitchTo(cache->mcxt);
+	cache->entries = lappend(cache->entries, dav);
+	MemoryContextSwitchTo(old);
+
+	return dav;
+}
+
+/*
+ * Check whether "column <strategy> ANY/ALL(values)" cannot be true for any
+ * row in the slice range [range_start, range_end). NULL elements are ignored
+ * for ANY since they never make the expression true, the caller handles NULL
+ * elements for ALL.
+ */
+static bool
+dimension_range_excludes_array(int64 range_start, int64 range_end, StrategyNumber strategy,
+							   bool use_or, DimensionArrayValues *dav)
+{
+	int64 min, max;
+
+	/* "x = ANY('{}')" is false and "x = ALL('{}')" is true */
+	if (dav->num_values == 0)
+		return use_or;
+
+	min = dav->values[0];
+	max = dav->values[dav->num_values - 1];
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+		case BTLessEqualStrategyNumber:
+			return dimension_range_excludes(range_start, range_end, strategy, use_or ? max : min);
+		case BTGreaterEqualStrategyNumber:
+		case BTGreaterStrategyNumber:
+			return dimension_range_excludes(range_start, range_end, strategy, use_or ? min : max);
+		case BTEqualStrategyNumber:
+			if (use_or)
+			{
+				/* binary search for the first value >= range_start */
+				int low = 0;
+				int high = dav->num_values;
+
+				while (low < high)
+				{
+					int mid = low + (high - low) / 2;
+
+					if (dav->values[mid] < range_start)
+						low = mid + 1;
+					else
+						high = mid;
+				}
+
+				return low == dav->num_values || dav->values[low] >= range_end;
+			}
+
+			return min < range_start || max >= range_end;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Try to exclude the chunk based on a "Var op ANY/ALL(Const array)" clause
+ * on a dimension column, e.g., "device_id = ANY($1)" after the parameter
+ * has been replaced by its value.
+ */
+static bool
+dimension_saop_excludes(ChunkExclusionInfo *info, Hyperspace *space, ScalarArrayOpExpr *saop,
+						bool *handled)
+{
+	Expr *left, *right;
+	Var *var;
+	Const *array;
+	Dimension *dim;
+	DimensionArrayValues *dav;
+	StrategyNumber strategy;
+	Oid elemtype;
+	int dimidx;
+
+	if (list_length(saop->args) != 2)
+		return false;
+
+	left = linitial(saop->args);
+	right = lsecond(saop->args);
+
+	if (IsA(left, RelabelType))
+		left = castNode(RelabelType, left)->arg;
+
+	if (!IsA(left, Var) || !IsA(right, Const))
+		return false;
+
+	var = castNode(Var, left);
+	array = castNode(Const, right);
+	dimidx = chunk_exclusion_info_get_dimension(info, var);
+
+	if (dimidx < 0)
+		return false;
+
+	dim = &space->dimensions[dimidx];
+
+	/* a strict operator with a NULL array will never return true */
+	if (array->constisnull)
+	{
+		if (!op_strict(saop->opno))
+			return false;
+
+		*handled = true;
+		return true;
+	}
+
+	elemtype = get_element_type(array->consttype);
+	strategy = dimension_op_strategy(saop->opno, var->vartype);
+
+	if (!OidIsValid(elemtype) || strategy == InvalidStrategy ||
+		!dimension_value_supported(dim, var->vartype, elemtype, strategy))
+		return false;
+
+	dav = dimension_array_values_get(info, dim, elemtype, array->constvalue);
+
+	if (dav->has_nulls)
+	{
+		if (!op_strict(saop->opno))
+			return false;
+
+		/* a NULL element means "x op ALL(...)" is never true */
+		if (!saop->useOr)
+		{
+			*handled = true;
+			return true;
+		}
+	}
+
+	*handled = true;
+
+	return dimension_range_excludes_array(info->range_start[dimidx],
+										  info->range_end[dimidx],
+										  strategy,
+										  saop->useOr,
+										  dav);
+}
+
+static bool
+dimension_clause_excludes(ChunkExclusionInfo *info, Hyperspace *space, Expr *clause,
+						  bool *handled)
+{
+	*handled = false;
+
+	if (info->num_dimensions == 0 || space == NULL ||
+		info->num_dimensions != space->num_dimensions)
+		return false;
+
+	switch (nodeTag(clause))
+	{
+		case T_OpExpr:
+			return dimension_opexpr_excludes(info, space, castNode(OpExpr, clause), handled);
+		case T_ScalarArrayOpExpr:
+			return dimension_saop_excludes(info,
+										   space,
+										   castNode(ScalarArrayOpExpr, clause),
+										   handled);
+		default:
+			return false;
+	}
+}
+
+/*
+ * Exclude child relations (chunks) at execution time.
+ *
+ * restrictinfos is the list of RestrictInfos with constified clauses that
+ * reference the chunk.
+ */
+bool
+ts_chunk_exclusion_can_exclude(ChunkExclusionInfo *info, Hyperspace *space, List *restrictinfos)
+{
+	bool need_refutation = info->has_check_constraints;
+	ListCell *lc;
+
+	/*
+	 * Regardless of the setting of constraint_exclusion, detect
+	 * constant-FALSE-or-NULL restriction clauses.  Because const-folding will
+	 * reduce "anything AND FALSE" to just "FALSE", any such case should
+	 * result in exactly one baserestrictinfo entry.
+	 */
+	if (list_length(restrictinfos) == 1)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) linitial(restrictinfos);
+		Expr *clause = rinfo->clause;
+
+		if (clause && IsA(clause, Const) &&
+			(((Const *) clause)->constisnull || !DatumGetBool(((Const *) clause)->constvalue)))
+			return true;
+	}
+
+	foreach (lc, restrictinfos)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+		bool handled;
+
+		if (dimension_clause_excludes(info, space, rinfo->clause, &handled))
+			return true;
+
+		if (!handled)
+			need_refutation = true;
+	}
+
+	/*
+	 * Like relation_excluded_by_constraints, do not look at the CHECK
+	 * constraints of the chunk when constraint_exclusion is off. The
+	 * dimension slices are used regardless of the setting, same as when the
+	 * hypertable is expanded during planning.
+	 */
+	if (!need_refutation || constraint_exclusion == CONSTRAINT_EXCLUSION_OFF)
+		return false;
+
+	/*
+	 * The constraints are effectively ANDed together, so we can just try to
+	 * refute the entire collection at once.  This may allow us to make proofs
+	 * that would fail if we took them individually.
+	 *
+	 * We need strong refutation because we have to prove that the constraints
+	 * would yield false, not just NULL.
+	 */
+#if PG96
+	return predicate_refuted_by(chunk_exclusion_info_get_constraints(info), restrictinfos);
+#else
+	return predicate_refuted_by(chunk_exclusion_info_get_constraints(info), restrictinfos, false);
+#endif
+}
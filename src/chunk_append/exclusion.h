@@ -0,0 +1,59 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#ifndef TIMESCALEDB_CHUNK_APPEND_EXCLUSION_H
+#define TIMESCALEDB_CHUNK_APPEND_EXCLUSION_H
+
+#include <postgres.h>
+#include <nodes/pg_list.h>
+#include <nodes/relation.h>
+
+#include "hypertable.h"
+
+/*
+ * Cache of the transformed (i.e., hashed or converted to internal time)
+ * elements of array restrictions like "device_id = ANY($1)". The cache is
+ * shared by all chunks of a scan so that every element of an array is only
+ * transformed once per execution instead of once per chunk.
+ */
+typedef struct ChunkExclusionArrayCache
+{
+	List *entries;
+	MemoryContext mcxt;
+} ChunkExclusionArrayCache;
+
+/*
+ * Executor-side information used to exclude a chunk based on the dimension
+ * slices it covers. Dimension ranges are indexed like the dimensions of the
+ * hyperspace and are in the internal time (or hash) representation.
+ */
+typedef struct ChunkExclusionInfo
+{
+	Index scanrelid;
+	Oid relid;
+	int num_dimensions;
+	/* attribute number of the dimension column in the chunk, 0 if unknown */
+	AttrNumber *attnos;
+	int64 *range_start;
+	int64 *range_end;
+	/* chunk has CHECK constraints that are not dimension constraints */
+	bool has_check_constraints;
+	/* relation constraints are only loaded when refutation is required */
+	bool constraints_loaded;
+	List *constraints;
+	/* optional cache for array restrictions, shared between chunks */
+	ChunkExclusionArrayCache *array_cache;
+	MemoryContext mcxt;
+} ChunkExclusionInfo;
+
+extern ChunkExclusionArrayCache *ts_chunk_exclusion_array_cache_create(MemoryContext parent);
+
+extern List *ts_chunk_exclusion_info_serialize(PlannerInfo *root, Hypertable *ht, Index scanrelid);
+extern ChunkExclusionInfo *ts_chunk_exclusion_info_create(Oid relid, Index scanrelid,
+														  List *serialized);
+extern bool ts_chunk_exclusion_can_exclude(ChunkExclusionInfo *info, Hyperspace *space,
+										   List *restrictinfos);
+
+#endif /* TIMESCALEDB_CHUNK_APPEND_EXCLUSION_H */
@@ -16,7 +16,6 @@
 #include <optimizer/clauses.h>
 #include <optimizer/cost.h>
 #include <optimizer/plancat.h>
-#include <optimizer/predtest.h>
 #include <optimizer/prep.h>
 #include <optimizer/restrictinfo.h>
 #include <parser/parsetree.h>
@@ -27,9 +26,12 @@
 #include <math.h>
 
 #include "chunk_append/chunk_append.h"
+#include "chunk_append/exclusion.h"
 #include "chunk_append/exec.h"
 #include "chunk_append/explain.h"
 #include "chunk_append/planner.h"
+#include "cache.h"
+#include "hypertable_cache.h"
 #include "loader/lwlocks.h"
 #include "compat.h"
 
@@ -68,12 +70,14 @@ static void choose_next_subplan_for_leader(ChunkAppendState *state);
 static void choose_next_subplan_for_worker(ChunkAppendState *state);
 
 static List *constify_restrictinfos(PlannerInfo *root, List *restrictinfos);
-static bool can_exclude_chunk(List *constraints, List *restrictinfos);
+static bool can_exclude_chunk(ChunkAppendState *state, ChunkExclusionInfo *info,
+							  List *restrictinfos);
 static void do_startup_exclusion(ChunkAppendState *state);
 static Node *constify_param_mutator(Node *node, void *context);
 static List *constify_restrictinfo_params(PlannerInfo *root, EState *state, List *restrictinfos);
 
-static void initialize_constraints(ChunkAppendState *state, List *initial_rt_indexes);
+static void initialize_exclusion_info(ChunkAppendState *state, List *initial_rt_indexes,
+									  List *chunk_exclusion);
 static LWLock *chunk_append_get_lock_pointer(void);
 
 Node *
@@ -114,33 +118,34 @@ do_startup_exclusion(ChunkAppendState *state)
 {
 	List *filtered_children = NIL;
 	List *filtered_ri_clauses = NIL;
-	List *filtered_constraints = NIL;
+	List *filtered_exclusion_info = NIL;
 	ListCell *lc_plan;
 	ListCell *lc_clauses;
-	ListCell *lc_constraints;
+	ListCell *lc_exclusion_info;
 	int i = -1;
 	int filtered_first_partial_plan = state->first_partial_plan;
 
 	/*
-	 * create skeleton plannerinfo for estimate_expression_value
+	 * create skeleton plannerinfo for estimate_expression_value, external
+	 * params are bound at this point so we use their values for exclusion
 	 */
 	PlannerGlobal glob = {
-		.boundParams = NULL,
+		.boundParams = state->csstate.ss.ps.state->es_param_list_info,
 	};
 	PlannerInfo root = {
 		.glob = &glob,
 	};
 
 	/*
-	 * clauses and constraints should always have the same length as initial_subplans
+	 * clauses and exclusion info should always have the same length as initial_subplans
 	 */
 	Assert(list_length(state->initial_subplans) == list_length(state->initial_ri_clauses));
-	Assert(list_length(state->initial_subplans) == list_length(state->initial_constraints));
+	Assert(list_length(state->initial_subplans) == list_length(state->initial_exclusion_info));
 
 	forthree (lc_plan,
 			  state->initial_subplans,
-			  lc_constraints,
-			  state->initial_constraints,
+			  lc_exclusion_info,
+			  state->initial_exclusion_info,
 			  lc_clauses,
 			  state->initial_ri_clauses)
 	{
@@ -165,7 +170,7 @@ do_startup_exclusion(ChunkAppendState *state)
 			}
 			restrictinfos = constify_restrictinfos(&root, restrictinfos);
 
-			if (can_exclude_chunk(lfirst(lc_constraints), restrictinfos))
+			if (can_exclude_chunk(state, lfirst(lc_exclusion_info), restrictinfos))
 			{
 				if (i < state->first_partial_plan)
 					filtered_first_partial_plan--;
@@ -191,12 +196,12 @@ do_startup_exclusion(ChunkAppendState *state)
 
 		filtered_children = lappend(filtered_children, lfirst(lc_plan));
 		filtered_ri_clauses = lappend(filtered_ri_clauses, ri_clauses);
-		filtered_constraints = lappend(filtered_constraints, lfirst(lc_constraints));
+		filtered_exclusion_info = lappend(filtered_exclusion_info, lfirst(lc_exclusion_info));
 	}
 
 	state->filtered_subplans = filtered_children;
 	state->filtered_ri_clauses = filtered_ri_clauses;
-	state->filtered_constraints = filtered_constraints;
+	state->filtered_exclusion_info = filtered_exclusion_info;
 	state->filtered_first_partial_plan = filtered_first_partial_plan;
 }
 
@@ -213,7 +218,9 @@ chunk_append_begin(CustomScanState *node, EState *estate, int eflags)
 	ListCell *lc;
 	int i;
 
-	initialize_constraints(state, lthird(cscan->custom_private));
+	initialize_exclusion_info(state,
+							  lthird(cscan->custom_private),
+							  list_nth(cscan->custom_private, 4));
 
 	if (state->startup_exclusion)
 		do_startup_exclusion(state);
@@ -263,11 +270,11 @@ chunk_append_begin(CustomScanState *node, EState *estate, int eflags)
 static void
 initialize_runtime_exclusion(ChunkAppendState *state)
 {
-	ListCell *lc_clauses, *lc_constraints;
+	ListCell *lc_clauses, *lc_exclusion_info;
 	int i = 0;
 
 	PlannerGlobal glob = {
-		.boundParams = NULL,
+		.boundParams = state->csstate.ss.ps.state->es_param_list_info,
 	};
 	PlannerInfo root = {
 		.glob = &glob,
@@ -276,7 +283,7 @@ initialize_runtime_exclusion(ChunkAppendState *state)
 	Assert(state->num_subplans == list_length(state->filtered_ri_clauses));
 
 	lc_clauses = list_head(state->filtered_ri_clauses);
-	lc_constraints = list_head(state->filtered_constraints);
+	lc_exclusion_info = list_head(state->filtered_exclusion_info);
 
 	if (state->num_subplans == 0)
 	{
@@ -312,7 +319,7 @@ initialize_runtime_exclusion(ChunkAppendState *state)
 			}
 			restrictinfos = constify_restrictinfo_params(&root, ps->state, restrictinfos);
 
-			can_exclude = can_exclude_chunk(lfirst(lc_constraints), restrictinfos);
+			can_exclude = can_exclude_chunk(state, lfirst(lc_exclusion_info), restrictinfos);
 
 			MemoryContextReset(state->exclusion_ctx);
 			MemoryContextSwitchTo(old);
@@ -324,7 +331,7 @@ initialize_runtime_exclusion(ChunkAppendState *state)
 		}
 
 		lc_clauses = lnext(lc_clauses);
-		lc_constraints = lnext(lc_constraints);
+		lc_exclusion_info = lnext(lc_exclusion_info);
 	}
 
 	state->runtime_initialized = true;
@@ -548,6 +555,9 @@ chunk_append_end(CustomScanState *node)
 	{
 		ExecEndNode(state->subplanstates[i]);
 	}
+
+	if (state->hypertable_cache != NULL)
+		ts_cache_release(state->hypertable_cache);
 }
 
 /*
@@ -760,172 +770,51 @@ constify_param_mutator(Node *node, void *context)
 }
 
 /*
- * stripped down version of postgres get_relation_constraints
- */
-static List *
-ca_get_relation_constraints(Oid relationObjectId, Index varno, bool include_notnull)
-{
-	List *result = NIL;
-	Relation relation;
-	TupleConstr *constr;
-
-	/*
-	 * We assume the relation has already been safely locked.
-	 */
-	relation = heap_open(relationObjectId, NoLock);
-
-	constr = relation->rd_att->constr;
-	if (constr != NULL)
-	{
-		int num_check = constr->num_check;
-		int i;
-
-		for (i = 0; i < num_check; i++)
-		{
-			Node *cexpr;
-
-			/*
-			 * If this constraint hasn't been fully validated yet, we must
-			 * ignore it here.
-			 */
-			if (!constr->check[i].ccvalid)
-				continue;
-
-			cexpr = stringToNode(constr->check[i].ccbin);
-
-			/*
-			 * Run each expression through const-simplification and
-			 * canonicalization.  This is not just an optimization, but is
-			 * necessary, because we will be comparing it to
-			 * similarly-processed qual clauses, and may fail to detect valid
-			 * matches without this.  This must match the processing done to
-			 * qual clauses in preprocess_expression()!  (We can skip the
-			 * stuff involving subqueries, however, since we don't allow any
-			 * in check constraints.)
-			 */
-			cexpr = eval_const_expressions(NULL, cexpr);
-
-#if (PG96 && PG_VERSION_NUM < 90609) || (PG10 && PG_VERSION_NUM < 100004)
-			cexpr = (Node *) canonicalize_qual((Expr *) cexpr);
-#elif PG96 || PG10
-			cexpr = (Node *) canonicalize_qual_ext((Expr *) cexpr, true);
-#else
-			cexpr = (Node *) canonicalize_qual((Expr *) cexpr, true);
-#endif
-
-			/* Fix Vars to have the desired varno */
-			if (varno != 1)
-				ChangeVarNodes(cexpr, 1, varno, 0);
-
-			/*
-			 * Finally, convert to implicit-AND format (that is, a List) and
-			 * append the resulting item(s) to our output list.
-			 */
-			result = list_concat(result, make_ands_implicit((Expr *) cexpr));
-		}
-
-		/* Add NOT NULL constraints in expression form, if requested */
-		if (include_notnull && constr->has_not_null)
-		{
-			int natts = relation->rd_att->natts;
-
-			for (i = 1; i <= natts; i++)
-			{
-				Form_pg_attribute att = TupleDescAttr(relation->rd_att, i - 1);
-
-				if (att->attnotnull && !att->attisdropped)
-				{
-					NullTest *ntest = makeNode(NullTest);
-
-					ntest->arg = (Expr *)
-						makeVar(varno, i, att->atttypid, att->atttypmod, att->attcollation, 0);
-					ntest->nulltesttype = IS_NOT_NULL;
-
-					/*
-					 * argisrow=false is correct even for a composite column,
-					 * because attnotnull does not represent a SQL-spec IS NOT
-					 * NULL test in such a case, just IS DISTINCT FROM NULL.
-					 */
-					ntest->argisrow = false;
-					ntest->location = -1;
-					result = lappend(result, ntest);
-				}
-			}
-		}
-	}
-
-	heap_close(relation, NoLock);
-
-	return result;
-}
-
-/*
- * Exclude child relations (chunks) at execution time based on constraints.
- *
- * constraints is the list of constraint expressions of the relation
- * baserestrictinfo is the list of RestrictInfos
+ * Exclude child relations (chunks) at execution time based on the dimension
+ * slices of the chunk, falling back to constraint refutation if required.
  */
 static bool
-can_exclude_chunk(List *constraints, List *baserestrictinfo)
+can_exclude_chunk(ChunkAppendState *state, ChunkExclusionInfo *info, List *restrictinfos)
 {
-	/*
-	 * Regardless of the setting of constraint_exclusion, detect
-	 * constant-FALSE-or-NULL restriction clauses.  Because const-folding will
-	 * reduce "anything AND FALSE" to just "FALSE", any such case should
-	 * result in exactly one baserestrictinfo entry.  This doesn't fire very
-	 * often, but it seems cheap enough to be worth doing anyway.  (Without
-	 * this, we'd miss some optimizations that 9.5 and earlier found via much
-	 * more roundabout methods.)
-	 */
-	if (list_length(baserestrictinfo) == 1)
-	{
-		RestrictInfo *rinfo = (RestrictInfo *) linitial(baserestrictinfo);
-		Expr *clause = rinfo->clause;
-
-		if (clause && IsA(clause, Const) &&
-			(((Const *) clause)->constisnull || !DatumGetBool(((Const *) clause)->constvalue)))
-			return true;
-	}
-
-	/*
-	 * The constraints are effectively ANDed together, so we can just try to
-	 * refute the entire collection at once.  This may allow us to make proofs
-	 * that would fail if we took them individually.
-	 *
-	 * Note: we use rel->baserestrictinfo, not safe_restrictions as might seem
-	 * an obvious optimization.  Some of the clauses might be OR clauses that
-	 * have volatile and nonvolatile subclauses, and it's OK to make
-	 * deductions with the nonvolatile parts.
-	 *
-	 * We need strong refutation because we have to prove that the constraints
-	 * would yield false, not just NULL.
-	 */
-#if PG96
-	if (predicate_refuted_by(constraints, baserestrictinfo))
-#else
-	if (predicate_refuted_by(constraints, baserestrictinfo, false))
-#endif
-		return true;
+	Hyperspace *space = state->ht != NULL ? state->ht->space : NULL;
 
-	return false;
+	return ts_chunk_exclusion_can_exclude(info, space, restrictinfos);
 }
 
 /*
- * Fetch the constraints for a relation and adjust range table indexes
- * if necessary.
+ * Build the exclusion information for every subplan and adjust range table
+ * indexes if necessary. Relation constraints are not fetched here but only
+ * when exclusion based on the dimension slices is not sufficient.
  */
 static void
-initialize_constraints(ChunkAppendState *state, List *initial_rt_indexes)
+initialize_exclusion_info(ChunkAppendState *state, List *initial_rt_indexes,
+						  List *chunk_exclusion)
 {
-	ListCell *lc_clauses, *lc_plan, *lc_relid;
-	List *constraints = NIL;
+	ListCell *lc_clauses, *lc_plan, *lc_relid, *lc_exclusion;
+	List *exclusion_info = NIL;
 	EState *estate = state->csstate.ss.ps.state;
+	CustomScan *cscan = castNode(CustomScan, state->csstate.ss.ps.plan);
+	ChunkExclusionArrayCache *array_cache;
 
 	if (initial_rt_indexes == NIL)
 		return;
 
 	Assert(list_length(state->initial_subplans) == list_length(state->initial_ri_clauses));
 	Assert(list_length(state->initial_subplans) == list_length(initial_rt_indexes));
+	Assert(list_length(state->initial_subplans) == list_length(chunk_exclusion));
+
+	/*
+	 * The hypertable is kept pinned until the end of execution since the
+	 * partitioning functions of closed dimensions are used during runtime
+	 * exclusion.
+	 */
+	state->ht_reloid = rt_fetch(cscan->scan.scanrelid, estate->es_range_table)->relid;
+	state->ht = ts_hypertable_cache_get_cache_and_entry(state->ht_reloid,
+														true,
+														&state->hypertable_cache);
+
+	array_cache = ts_chunk_exclusion_array_cache_create(CurrentMemoryContext);
+	lc_exclusion = list_head(chunk_exclusion);
 
 	forthree (lc_plan,
 			  state->initial_subplans,
@@ -936,13 +825,15 @@ initialize_constraints(ChunkAppendState *state, List *initial_rt_indexes)
 	{
 		Scan *scan = ts_chunk_append_get_scan_plan(lfirst(lc_plan));
 		Index initial_index = lfirst_oid(lc_relid);
-		List *relation_constraints = NIL;
+		ChunkExclusionInfo *info = NULL;
 
 		if (scan != NULL && scan->scanrelid > 0)
 		{
 			Index rt_index = scan->scanrelid;
 			RangeTblEntry *rte = rt_fetch(rt_index, estate->es_range_table);
-			relation_constraints = ca_get_relation_constraints(rte->relid, rt_index, true);
+
+			info = ts_chunk_exclusion_info_create(rte->relid, rt_index, lfirst(lc_exclusion));
+			info->array_cache = array_cache;
 
 			/*
 			 * Adjust the RangeTableEntry indexes in the restrictinfo
@@ -952,8 +843,9 @@ initialize_constraints(ChunkAppendState *state, List *initial_rt_indexes)
 			if (rt_index != initial_index)
 				ChangeVarNodes(lfirst(lc_clauses), initial_index, scan->scanrelid, 0);
 		}
-		constraints = lappend(constraints, relation_constraints);
+		exclusion_info = lappend(exclusion_info, info);
+		lc_exclusion = lnext(lc_exclusion);
 	}
-	state->initial_constraints = constraints;
-	state->filtered_constraints = constraints;
+	state->initial_exclusion_info = exclusion_info;
+	state->filtered_exclusion_info = exclusion_info;
 }
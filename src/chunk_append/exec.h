@@ -11,6 +11,9 @@
 #include <nodes/extensible.h>
 #include <nodes/relation.h>
 
+#include "cache.h"
+#include "hypertable.h"
+
 typedef struct ParallelChunkAppendState
 {
 	int next_plan;
@@ -30,6 +33,8 @@ typedef struct ChunkAppendState
 	int current;
 
 	Oid ht_reloid;
+	Hypertable *ht;
+	Cache *hypertable_cache;
 	bool startup_exclusion;
 	bool runtime_exclusion;
 	bool runtime_initialized;
@@ -37,15 +42,15 @@ typedef struct ChunkAppendState
 
 	/* list of subplans after planning */
 	List *initial_subplans;
-	/* list of constraints indexed like initial_subplans */
-	List *initial_constraints;
+	/* list of ChunkExclusionInfo indexed like initial_subplans */
+	List *initial_exclusion_info;
 	/* list of restrictinfo clauses indexed like initial_subplans */
 	List *initial_ri_clauses;
 
 	/* list of subplans after startup exclusion */
 	List *filtered_subplans;
-	/* list of relation constraints after startup exclusion */
-	List *filtered_constraints;
+	/* list of ChunkExclusionInfo after startup exclusion */
+	List *filtered_exclusion_info;
 	/* list of restrictinfo clauses after startup exclusion */
 	List *filtered_ri_clauses;
 
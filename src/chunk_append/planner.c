@@ -21,12 +21,14 @@
 #include <parser/parsetree.h>
 
 #include "chunk_append/chunk_append.h"
+#include "chunk_append/exclusion.h"
 #include "chunk_append/planner.h"
 #include "chunk_append/exec.h"
 #include "chunk_append/transform.h"
 #include "planner_import.h"
 #include "compat.h"
 #include "guc.h"
+#include "hypertable_cache.h"
 
 static Sort *make_sort(Plan *lefttree, int numCols, AttrNumber *sortColIdx, Oid *sortOperators,
 					   Oid *collations, bool *nullsFirst);
@@ -86,6 +88,7 @@ ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path
 	ListCell *lc_child;
 	List *chunk_ri_clauses = NIL;
 	List *chunk_rt_indexes = NIL;
+	List *chunk_exclusion = NIL;
 	List *sort_options = NIL;
 	List *custom_private = NIL;
 	uint32 limit = 0;
@@ -229,6 +232,12 @@ ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path
 	 */
 	if (capath->startup_exclusion || capath->runtime_exclusion)
 	{
+		Cache *hcache;
+		Hypertable *ht =
+			ts_hypertable_cache_get_cache_and_entry(planner_rt_fetch(rel->relid, root)->relid,
+													true,
+													&hcache);
+
 		foreach (lc_child, cscan->custom_plans)
 		{
 			Scan *scan = ts_chunk_append_get_scan_plan(lfirst(lc_child));
@@ -237,6 +246,7 @@ ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path
 			{
 				chunk_ri_clauses = lappend(chunk_ri_clauses, NIL);
 				chunk_rt_indexes = lappend_oid(chunk_rt_indexes, 0);
+				chunk_exclusion = lappend(chunk_exclusion, NIL);
 			}
 			else
 			{
@@ -253,10 +263,24 @@ ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path
 				}
 				chunk_ri_clauses = lappend(chunk_ri_clauses, chunk_clauses);
 				chunk_rt_indexes = lappend_oid(chunk_rt_indexes, scan->scanrelid);
+
+				/*
+				 * Store the dimension slices of the chunk so the executor
+				 * can exclude chunks without constraint refutation.
+				 */
+				if (ht != NULL)
+					chunk_exclusion =
+						lappend(chunk_exclusion,
+								ts_chunk_exclusion_info_serialize(root, ht, scan->scanrelid));
+				else
+					chunk_exclusion = lappend(chunk_exclusion, NIL);
 			}
 		}
+		ts_cache_release(hcache);
+
 		Assert(list_length(cscan->custom_plans) == list_length(chunk_ri_clauses));
 		Assert(list_length(chunk_ri_clauses) == list_length(chunk_rt_indexes));
+		Assert(list_length(chunk_ri_clauses) == list_length(chunk_exclusion));
 	}
 
 	if (capath->pushdown_limit && capath->limit_tuples > 0)
@@ -269,6 +293,7 @@ ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path
 	custom_private = lappend(custom_private, chunk_ri_clauses);
 	custom_private = lappend(custom_private, chunk_rt_indexes);
 	custom_private = lappend(custom_private, sort_options);
+	custom_private = lappend(custom_private, chunk_exclusion);
 
 	cscan->custom_private = custom_private;
 
@@ -13,6 +13,7 @@
 #include <executor/tuptable.h>
 #include <nodes/execnodes.h>
 #include <nodes/nodes.h>
+#include <storage/shm_toc.h>
 
 #include "export.h"
 #include "planner_import.h"
@@ -133,6 +134,26 @@
 #define ConstraintRelidTypidNameIndexId ConstraintRelidIndexId
 #endif
 
+/*
+ * CreateParallelContext
+ *
+ * PG10 allows any library function to be used as the entry point of parallel
+ * workers, which 9.6 only allowed through a separate function. PG11 adds a
+ * flag for whether the parallel operation is safe under serializable
+ * isolation; we don't claim that it is.
+ */
+#if PG96
+#define CreateParallelContextCompat(library_name, function_name, nworkers)                         \
+	CreateParallelContextForExternalFunction((char *) (library_name),                              \
+											 (char *) (function_name),                             \
+											 nworkers)
+#elif PG10
+#define CreateParallelContextCompat CreateParallelContext
+#else
+#define CreateParallelContextCompat(library_name, function_name, nworkers)                         \
+	CreateParallelContext(library_name, function_name, nworkers, false)
+#endif
+
 /*
  * CreateTrigger
  *
@@ -443,6 +464,16 @@ get_attname_compat(Oid relid, AttrNumber attnum, bool missing_ok)
 				 NULL)
 #endif
 
+/*
+ * IndexRelationGetNumberOfKeyAttributes
+ *
+ * PG11 added INCLUDE columns to indexes, which are not part of the key. Before
+ * that, all the columns of an index are key columns.
+ */
+#if PG96 || PG10
+#define IndexRelationGetNumberOfKeyAttributes IndexRelationGetNumberOfAttributes
+#endif
+
 /* InitResultRelInfo */
 #if PG96
 #define InitResultRelInfoCompat(result_rel_info,                                                   \
@@ -507,6 +538,16 @@ get_attname_compat(Oid relid, AttrNumber attnum, bool missing_ok)
 	ExplainPropertyInteger(label, unit, value, es)
 #endif
 
+/*
+ * min_parallel_table_scan_size
+ *
+ * PG10 renamed min_parallel_relation_size when it added
+ * min_parallel_index_scan_size.
+ */
+#if PG96
+#define min_parallel_table_scan_size min_parallel_relation_size
+#endif
+
 /* ParseFuncOrColumn */
 #if PG96
 #define ParseFuncOrColumnCompat(pstate, funcname, fargs, fn, location)                             \
@@ -578,6 +619,26 @@ get_attname_compat(Oid relid, AttrNumber attnum, bool missing_ok)
 #define PreventInTransactionBlock PreventTransactionChain
 #endif
 
+/*
+ * shm_toc_lookup
+ *
+ * PG10 added a noError argument, before that NULL was returned for missing
+ * keys.
+ */
+#if PG96
+static inline void *
+shm_toc_lookup_compat(shm_toc *toc, uint64 key, bool noError)
+{
+	void *address = shm_toc_lookup(toc, key);
+
+	if (!noError && address == NULL)
+		elog(ERROR, "could not find key " UINT64_FORMAT " in shm TOC at %p", key, toc);
+	return address;
+}
+#else
+#define shm_toc_lookup_compat shm_toc_lookup
+#endif
+
 /*
  * TupleDescAttr
  *
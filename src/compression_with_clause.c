@@ -20,6 +20,7 @@
 #include "compat.h"
 
 #include "compression_with_clause.h"
+#include "hypertable_compression.h"
 
 static const WithClauseDefinition compress_hypertable_with_clause_def[] = {
 		[CompressEnabled] = {
@@ -35,6 +36,35 @@ static const WithClauseDefinition compress_hypertable_with_clause_def[] = {
 			 .arg_name = "compress_orderby",
 			 .type_id = TEXTOID,
 		},
+		[CompressMinMax] = {
+			 .arg_name = "compress_minmax",
+			 .type_id = TEXTOID,
+		},
+		[CompressBloom] = {
+			 .arg_name = "compress_bloom",
+			 .type_id = TEXTOID,
+		},
+		[CompressBatchSize] = {
+			 .arg_name = "compress_batch_size",
+			 .type_id = TEXTOID,
+		},
+		[CompressAdaptiveAlgorithms] = {
+			 .arg_name = "compress_adaptive_algorithms",
+			 .type_id = BOOLOID,
+			 .default_val = BoolGetDatum(false),
+		},
+		[CompressLz4] = {
+			 .arg_name = "compress_lz4",
+			 .type_id = TEXTOID,
+		},
+		[CompressZstd] = {
+			 .arg_name = "compress_zstd",
+			 .type_id = TEXTOID,
+		},
+		[CompressJsonb] = {
+			 .arg_name = "compress_jsonb",
+			 .type_id = TEXTOID,
+		},
 };
 
 WithClauseResult *
@@ -46,14 +76,13 @@ ts_compress_hypertable_set_clause_parse(const List *defelems)
 }
 
 static inline void
-throw_segment_by_error(char *segment_by)
+throw_column_list_error(const char *option, char *column_list)
 {
 	ereport(ERROR,
 			(errcode(ERRCODE_SYNTAX_ERROR),
-			 errmsg("unable to parse timescaledb.compress_segmentby option '%s'", segment_by),
-			 errhint("timescaledb.compress_segmentby option should be a comma separated list "
-					 "of column "
-					 "names.")));
+			 errmsg("unable to parse timescaledb.%s option '%s'", option, column_list),
+			 errhint("timescaledb.%s option should be a comma separated list of column names.",
+					 option)));
 }
 
 static bool
@@ -71,7 +100,7 @@ select_stmt_as_expected(SelectStmt *stmt)
 }
 
 static List *
-parse_segment_collist(char *inpstr, Hypertable *hypertable)
+parse_column_list(const char *option, char *inpstr, Hypertable *hypertable)
 {
 	StringInfoData buf;
 	List *parsed;
@@ -88,7 +117,7 @@ parse_segment_collist(char *inpstr, Hypertable *hypertable)
 
 	initStringInfo(&buf);
 
-	/* parse the segment by list exactly how you would a group by */
+	/* parse the column list exactly how you would a group by */
 	appendStringInfo(&buf,
 					 "SELECT FROM %s.%s GROUP BY %s",
 					 quote_identifier(hypertable->fd.schema_name.data),
@@ -101,32 +130,32 @@ parse_segment_collist(char *inpstr, Hypertable *hypertable)
 	}
 	PG_CATCH();
 	{
-		throw_segment_by_error(inpstr);
+		throw_column_list_error(option, inpstr);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
 
 	if (list_length(parsed) != 1)
-		throw_segment_by_error(inpstr);
+		throw_column_list_error(option, inpstr);
 #if PG96
 	if (!IsA(linitial(parsed), SelectStmt))
-		throw_segment_by_error(inpstr);
+		throw_column_list_error(option, inpstr);
 	select = linitial(parsed);
 #else
 	if (!IsA(linitial(parsed), RawStmt))
-		throw_segment_by_error(inpstr);
+		throw_column_list_error(option, inpstr);
 	raw = linitial(parsed);
 
 	if (!IsA(raw->stmt, SelectStmt))
-		throw_segment_by_error(inpstr);
+		throw_column_list_error(option, inpstr);
 	select = (SelectStmt *) raw->stmt;
 #endif
 
 	if (!select_stmt_as_expected(select))
-		throw_segment_by_error(inpstr);
+		throw_column_list_error(option, inpstr);
 
 	if (select->sortClause != NIL)
-		throw_segment_by_error(inpstr);
+		throw_column_list_error(option, inpstr);
 
 	foreach (lc, select->groupClause)
 	{
@@ -134,13 +163,13 @@ parse_segment_collist(char *inpstr, Hypertable *hypertable)
 		CompressedParsedCol *col = (CompressedParsedCol *) palloc(sizeof(*col));
 
 		if (!IsA(lfirst(lc), ColumnRef))
-			throw_segment_by_error(inpstr);
+			throw_column_list_error(option, inpstr);
 		cf = lfirst(lc);
 		if (list_length(cf->fields) != 1)
-			throw_segment_by_error(inpstr);
+			throw_column_list_error(option, inpstr);
 
 		if (!IsA(linitial(cf->fields), String))
-			throw_segment_by_error(inpstr);
+			throw_column_list_error(option, inpstr);
 
 		col->index = index;
 		index++;
@@ -265,19 +294,27 @@ parse_order_collist(char *inpstr, Hypertable *hypertable)
 	return collist;
 }
 
+/* parses a column list option, returns NIL if the option is not set */
+static List *
+parse_column_list_option(WithClauseResult *parsed_options, CompressHypertableOption option,
+						 const char *name, Hypertable *hypertable)
+{
+	if (parsed_options[option].is_default)
+		return NIL;
+
+	return parse_column_list(name, TextDatumGetCString(parsed_options[option].parsed), hypertable);
+}
+
 /* returns List of CompressedParsedCol
  * compress_segmentby = `col1,col2,col3`
  */
 List *
 ts_compress_hypertable_parse_segment_by(WithClauseResult *parsed_options, Hypertable *hypertable)
 {
-	if (parsed_options[CompressSegmentBy].is_default == false)
-	{
-		Datum textarg = parsed_options[CompressSegmentBy].parsed;
-		return parse_segment_collist(TextDatumGetCString(textarg), hypertable);
-	}
-	else
-		return NIL;
+	return parse_column_list_option(parsed_options,
+									CompressSegmentBy,
+									"compress_segmentby",
+									hypertable);
 }
 
 /* returns List of CompressedParsedCol
@@ -294,3 +331,87 @@ ts_compress_hypertable_parse_order_by(WithClauseResult *parsed_options, Hypertab
 	else
 		return NIL;
 }
+
+/* returns List of CompressedParsedCol
+ * compress_minmax = `col1,col2,col3`
+ */
+List *
+ts_compress_hypertable_parse_minmax(WithClauseResult *parsed_options, Hypertable *hypertable)
+{
+	return parse_column_list_option(parsed_options, CompressMinMax, "compress_minmax", hypertable);
+}
+
+/* returns List of CompressedParsedCol
+ * compress_bloom = `col1,col2,col3`
+ */
+List *
+ts_compress_hypertable_parse_bloom(WithClauseResult *parsed_options, Hypertable *hypertable)
+{
+	return parse_column_list_option(parsed_options, CompressBloom, "compress_bloom", hypertable);
+}
+
+/* returns List of CompressedParsedCol
+ * compress_lz4 = `col1,col2,col3`
+ */
+List *
+ts_compress_hypertable_parse_lz4(WithClauseResult *parsed_options, Hypertable *hypertable)
+{
+	return parse_column_list_option(parsed_options, CompressLz4, "compress_lz4", hypertable);
+}
+
+/* returns List of CompressedParsedCol
+ * compress_zstd = `col1,col2,col3`
+ */
+List *
+ts_compress_hypertable_parse_zstd(WithClauseResult *parsed_options, Hypertable *hypertable)
+{
+	return parse_column_list_option(parsed_options, CompressZstd, "compress_zstd", hypertable);
+}
+
+/* returns List of CompressedParsedCol
+ * compress_jsonb = `col1,col2,col3`
+ */
+List *
+ts_compress_hypertable_parse_jsonb(WithClauseResult *parsed_options, Hypertable *hypertable)
+{
+	return parse_column_list_option(parsed_options, CompressJsonb, "compress_jsonb", hypertable);
+}
+
+/* returns the number of rows per compressed row, -1 if the option is not set
+ * or HYPERTABLE_COMPRESSION_BATCH_SIZE_ADAPTIVE for
+ * timescaledb.compress_batch_size = 'adaptive'
+ */
+int32
+ts_compress_hypertable_parse_batch_size(WithClauseResult *parsed_options)
+{
+	char *batch_size;
+	char *endptr;
+	long value;
+
+	if (parsed_options[CompressBatchSize].is_default)
+		return -1;
+
+	batch_size = TextDatumGetCString(parsed_options[CompressBatchSize].parsed);
+	if (pg_strcasecmp(batch_size, "adaptive") == 0)
+		return HYPERTABLE_COMPRESSION_BATCH_SIZE_ADAPTIVE;
+
+	errno = 0;
+	value = strtol(batch_size, &endptr, 10);
+	if (errno != 0 || endptr == batch_size || *endptr != '\0' || value < 1 ||
+		value > COMPRESS_BATCH_SIZE_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for timescaledb.compress_batch_size '%s'", batch_size),
+				 errhint("timescaledb.compress_batch_size must be \"adaptive\" or an integer "
+						 "between 1 and %d.",
+						 COMPRESS_BATCH_SIZE_MAX)));
+
+	return (int32) value;
+}
+
+/* should the algorithm of every compressed value be chosen by trial encoding? */
+bool
+ts_compress_hypertable_parse_adaptive_algorithms(WithClauseResult *parsed_options)
+{
+	return DatumGetBool(parsed_options[CompressAdaptiveAlgorithms].parsed);
+}
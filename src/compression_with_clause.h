@@ -18,8 +18,18 @@ typedef enum CompressHypertableOption
 	CompressEnabled = 0,
 	CompressSegmentBy,
 	CompressOrderBy,
+	CompressMinMax,
+	CompressBloom,
+	CompressBatchSize,
+	CompressAdaptiveAlgorithms,
+	CompressLz4,
+	CompressZstd,
+	CompressJsonb,
 } CompressHypertableOption;
 
+/* largest number of rows per compressed row allowed for timescaledb.compress_batch_size */
+#define COMPRESS_BATCH_SIZE_MAX 100000
+
 typedef struct
 {
 	short index;
@@ -33,5 +43,18 @@ extern TSDLLEXPORT List *ts_compress_hypertable_parse_segment_by(WithClauseResul
 																 Hypertable *hypertable);
 extern TSDLLEXPORT List *ts_compress_hypertable_parse_order_by(WithClauseResult *parsed_options,
 															   Hypertable *hypertable);
+extern TSDLLEXPORT List *ts_compress_hypertable_parse_minmax(WithClauseResult *parsed_options,
+															 Hypertable *hypertable);
+extern TSDLLEXPORT List *ts_compress_hypertable_parse_bloom(WithClauseResult *parsed_options,
+															Hypertable *hypertable);
+extern TSDLLEXPORT List *ts_compress_hypertable_parse_lz4(WithClauseResult *parsed_options,
+														  Hypertable *hypertable);
+extern TSDLLEXPORT List *ts_compress_hypertable_parse_zstd(WithClauseResult *parsed_options,
+														   Hypertable *hypertable);
+extern TSDLLEXPORT List *ts_compress_hypertable_parse_jsonb(WithClauseResult *parsed_options,
+															Hypertable *hypertable);
+extern TSDLLEXPORT int32 ts_compress_hypertable_parse_batch_size(WithClauseResult *parsed_options);
+extern TSDLLEXPORT bool
+ts_compress_hypertable_parse_adaptive_algorithms(WithClauseResult *parsed_options);
 
 #endif
@@ -26,30 +26,11 @@
 
 #include "constraint_aware_append.h"
 #include "hypertable.h"
+#include "hypertable_cache.h"
+#include "chunk_append/exclusion.h"
 #include "chunk_append/transform.h"
 #include "compat.h"
 
-/*
- * Exclude child relations (chunks) at execution time based on constraints.
- *
- * This functions tries to reuse as much functionality as possible from standard
- * constraint exclusion in PostgreSQL that normally happens at planning
- * time. Therefore, we need to fake a number of planning-related data
- * structures.
- */
-static bool
-excluded_by_constraint(PlannerInfo *root, RangeTblEntry *rte, Index rt_index, List *restrictinfos)
-{
-	RelOptInfo rel = {
-		.type = T_RelOptInfo,
-		.relid = rt_index,
-		.reloptkind = RELOPT_OTHER_MEMBER_REL,
-		.baserestrictinfo = restrictinfos,
-	};
-
-	return relation_excluded_by_constraints(root, &rel, rte);
-}
-
 static Plan *
 get_plans_for_exclusion(Plan *plan)
 {
@@ -68,13 +49,25 @@ get_plans_for_exclusion(Plan *plan)
 	return plan;
 }
 
+/*
+ * Exclude child relations (chunks) at execution time based on the dimension
+ * slices of the chunk. Constraint refutation is only used as a fallback for
+ * clauses and constraints not covered by the dimension slices.
+ */
 static bool
-can_exclude_chunk(PlannerInfo *root, EState *estate, Index rt_index, List *restrictinfos)
+can_exclude_chunk(EState *estate, Hyperspace *space, Index rt_index, List *chunk_exclusion,
+				  ChunkExclusionArrayCache *array_cache, List *restrictinfos)
 {
 	RangeTblEntry *rte = rt_fetch(rt_index, estate->es_range_table);
+	ChunkExclusionInfo *info;
+
+	if (rte->rtekind != RTE_RELATION || rte->relkind != RELKIND_RELATION || rte->inh)
+		return false;
+
+	info = ts_chunk_exclusion_info_create(rte->relid, rt_index, chunk_exclusion);
+	info->array_cache = array_cache;
 
-	return rte->rtekind == RTE_RELATION && rte->relkind == RELKIND_RELATION && !rte->inh &&
-		   excluded_by_constraint(root, rte, rt_index, restrictinfos);
+	return ts_chunk_exclusion_can_exclude(info, space, restrictinfos);
 }
 
 /*
@@ -116,10 +109,15 @@ ca_append_begin(CustomScanState *node, EState *estate, int eflags)
 	Plan *subplan = copyObject(state->subplan);
 	List *chunk_ri_clauses = lsecond(cscan->custom_private);
 	List *chunk_relids = lthird(cscan->custom_private);
+	List *chunk_exclusion = lfourth(cscan->custom_private);
 	List **appendplans, *old_appendplans;
 	ListCell *lc_plan;
 	ListCell *lc_clauses;
 	ListCell *lc_relid;
+	ListCell *lc_exclusion;
+	ChunkExclusionArrayCache *array_cache;
+	Cache *hcache;
+	Hypertable *ht;
 
 	/*
 	 * create skeleton plannerinfo to reuse some PostgreSQL planner functions
@@ -174,6 +172,13 @@ ca_append_begin(CustomScanState *node, EState *estate, int eflags)
 	 */
 	Assert(list_length(old_appendplans) == list_length(chunk_ri_clauses));
 	Assert(list_length(chunk_relids) == list_length(chunk_ri_clauses));
+	Assert(list_length(chunk_exclusion) == list_length(chunk_ri_clauses));
+
+	ht = ts_hypertable_cache_get_cache_and_entry(linitial_oid(linitial(cscan->custom_private)),
+												 true,
+												 &hcache);
+	array_cache = ts_chunk_exclusion_array_cache_create(CurrentMemoryContext);
+	lc_exclusion = list_head(chunk_exclusion);
 
 	forthree (lc_plan, old_appendplans, lc_clauses, chunk_ri_clauses, lc_relid, chunk_relids)
 	{
@@ -225,8 +230,16 @@ ca_append_begin(CustomScanState *node, EState *estate, int eflags)
 				}
 				restrictinfos = constify_restrictinfos(&root, restrictinfos);
 
-				if (can_exclude_chunk(&root, estate, scanrelid, restrictinfos))
+				if (can_exclude_chunk(estate,
+									  ht != NULL ? ht->space : NULL,
+									  scanrelid,
+									  lfirst(lc_exclusion),
+									  array_cache,
+									  restrictinfos))
+				{
+					lc_exclusion = lnext(lc_exclusion);
 					continue;
+				}
 
 				*appendplans = lappend(*appendplans, plan);
 				break;
@@ -235,8 +248,11 @@ ca_append_begin(CustomScanState *node, EState *estate, int eflags)
 				elog(ERROR, "invalid child of constraint-aware append: %u", nodeTag(plan));
 				break;
 		}
+		lc_exclusion = lnext(lc_exclusion);
 	}
 
+	ts_cache_release(hcache);
+
 	state->num_append_subplans = list_length(*appendplans);
 	if (state->num_append_subplans > 0)
 		node->custom_ps = list_make1(ExecInitNode(subplan, estate, eflags));
@@ -371,8 +387,11 @@ constraint_aware_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPa
 	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
 	List *chunk_ri_clauses = NIL;
 	List *chunk_relids = NIL;
+	List *chunk_exclusion = NIL;
 	List *children = NIL;
 	ListCell *lc_child;
+	Cache *hcache;
+	Hypertable *ht;
 
 	/*
 	 * Postgres will inject Result nodes above mergeappend when target lists don't match
@@ -418,6 +437,8 @@ constraint_aware_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPa
 			break;
 	}
 
+	ht = ts_hypertable_cache_get_cache_and_entry(rte->relid, true, &hcache);
+
 	/*
 	 * we only iterate over the child chunks of this node
 	 * so the list of metadata exactly matches the list of
@@ -458,6 +479,10 @@ constraint_aware_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPa
 				}
 				chunk_ri_clauses = lappend(chunk_ri_clauses, chunk_clauses);
 				chunk_relids = lappend_oid(chunk_relids, scanrelid);
+				chunk_exclusion =
+					lappend(chunk_exclusion,
+							ht != NULL ? ts_chunk_exclusion_info_serialize(root, ht, scanrelid) :
+										 NIL);
 				break;
 			}
 			default:
@@ -466,7 +491,10 @@ constraint_aware_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPa
 		}
 	}
 
-	cscan->custom_private = list_make3(list_make1_oid(rte->relid), chunk_ri_clauses, chunk_relids);
+	ts_cache_release(hcache);
+
+	cscan->custom_private =
+		list_make4(list_make1_oid(rte->relid), chunk_ri_clauses, chunk_relids, chunk_exclusion);
 	cscan->custom_scan_tlist = subplan->targetlist; /* Target list of tuples
 													 * we expect as input */
 	cscan->flags = path->flags;
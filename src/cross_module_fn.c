@@ -28,6 +28,8 @@ TS_FUNCTION_INFO_V1(ts_finalize_agg_ffunc);
 TS_FUNCTION_INFO_V1(ts_continuous_agg_invalidation_trigger);
 TS_FUNCTION_INFO_V1(ts_compress_chunk);
 TS_FUNCTION_INFO_V1(ts_decompress_chunk);
+TS_FUNCTION_INFO_V1(ts_segment_meta_bloom_contains);
+TS_FUNCTION_INFO_V1(ts_segment_meta_bloom_contains_any);
 TS_FUNCTION_INFO_V1(ts_compressed_data_decompress_forward);
 TS_FUNCTION_INFO_V1(ts_compressed_data_decompress_reverse);
 
@@ -126,6 +128,18 @@ ts_finalize_agg_ffunc(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(ts_cm_functions->finalize_agg_ffunc(fcinfo));
 }
 
+Datum
+ts_segment_meta_bloom_contains(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_DATUM(ts_cm_functions->segment_meta_bloom_contains(fcinfo));
+}
+
+Datum
+ts_segment_meta_bloom_contains_any(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_DATUM(ts_cm_functions->segment_meta_bloom_contains_any(fcinfo));
+}
+
 Datum
 ts_compressed_data_decompress_forward(PG_FUNCTION_ARGS)
 {
@@ -405,6 +419,8 @@ TSDLLEXPORT CrossModuleFunctions ts_cm_functions_default = {
 	.process_compress_table = process_compress_table_default,
 	.compress_chunk = error_no_default_fn_pg_community,
 	.decompress_chunk = error_no_default_fn_pg_community,
+	.segment_meta_bloom_contains = error_no_default_fn_pg_community,
+	.segment_meta_bloom_contains_any = error_no_default_fn_pg_community,
 	.compressed_data_decompress_forward = error_no_default_fn_pg_community,
 	.compressed_data_decompress_reverse = error_no_default_fn_pg_community,
 	.deltadelta_compressor_append = error_no_default_fn_pg_community,
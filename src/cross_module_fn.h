@@ -85,6 +85,8 @@ typedef struct CrossModuleFunctions
 								   WithClauseResult *with_clause_options);
 	PGFunction compress_chunk;
 	PGFunction decompress_chunk;
+	PGFunction segment_meta_bloom_contains;
+	PGFunction segment_meta_bloom_contains_any;
 	/* The compression functions below are not installed in SQL as part of create extension;
 	 *  They are installed and tested during testing scripts. They are exposed in cross-module
 	 *  functions because they may be very useful for debugging customer problems if the sql
@@ -19,6 +19,7 @@
 #include <utils/selfuncs.h>
 #include <utils/builtins.h>
 #include <utils/rel.h>
+#include <pgtime.h>
 
 #include "utils.h"
 #include "cache.h"
@@ -32,7 +33,8 @@
  * useful for TimescaleDB. The function info is used in various query
  * optimizations, for instance, we provide custom group estimate functions for
  * use when grouping on time buckets. We also provide functions that allow
- * sorting time buckets using an index on the non-bucketed expression/column.
+ * sorting time buckets, and other expressions that preserve the ordering of
+ * their argument, using an index on the non-bucketed expression/column.
  */
 
 static Expr *
@@ -91,6 +93,79 @@ time_bucket_sort_transform(FuncExpr *func)
 	return (Expr *) copyObject(second);
 }
 
+/*
+ * Extracting the epoch from a timestamp is order preserving, other fields
+ * are not.
+ *
+ * date_part('epoch', var) => var
+ */
+static Expr *
+date_part_sort_transform(FuncExpr *func)
+{
+	Const *field;
+
+	if (list_length(func->args) != 2 || !IsA(linitial(func->args), Const))
+		return (Expr *) func;
+
+	field = linitial_node(Const, func->args);
+
+	if (field->constisnull ||
+		pg_strcasecmp(text_to_cstring(DatumGetTextPP(field->constvalue)), "epoch") != 0)
+		return (Expr *) func;
+
+	return ts_sort_transform_func_arg(func, 1);
+}
+
+/*
+ * Shifting a timestamp by a constant offset is order preserving.
+ *
+ * timezone(const interval, var) => var
+ */
+static Expr *
+timezone_interval_sort_transform(FuncExpr *func)
+{
+	return ts_sort_transform_func_arg(func, 1);
+}
+
+/*
+ * Converting to a named time zone is only order preserving if the time zone
+ * has a fixed offset from UTC, i.e., it does not observe daylight saving
+ * time, since otherwise local time repeats when clocks are set back.
+ *
+ * timezone('UTC', var) => var
+ */
+static Expr *
+timezone_text_sort_transform(FuncExpr *func)
+{
+	Const *zone;
+	pg_tz *tz;
+	long gmtoff;
+
+	if (list_length(func->args) != 2 || !IsA(linitial(func->args), Const))
+		return (Expr *) func;
+
+	zone = linitial_node(Const, func->args);
+
+	if (zone->constisnull)
+		return (Expr *) func;
+
+	tz = pg_tzset(text_to_cstring(DatumGetTextPP(zone->constvalue)));
+
+	if (tz == NULL || !pg_get_timezone_offset(tz, &gmtoff))
+		return (Expr *) func;
+
+	return ts_sort_transform_func_arg(func, 1);
+}
+
+/*
+ * to_timestamp(var) => var
+ */
+static Expr *
+to_timestamp_sort_transform(FuncExpr *func)
+{
+	return ts_sort_transform_func_arg(func, 0);
+}
+
 /* For time_bucket this estimate currently works by seeing how many possible
  * buckets there will be if the data spans the entire hypertable. Note that
  * this is an overestimate.
@@ -284,6 +359,62 @@ static FuncInfo funcinfo[] = {
 		.group_estimate = date_trunc_group_estimate,
 		.sort_transform = date_trunc_sort_transform,
 	},
+	{
+		.is_timescaledb_func = false,
+		.is_bucketing_func = false,
+		.funcname = "date_part",
+		.nargs = 2,
+		.arg_types = { TEXTOID, TIMESTAMPOID },
+		.sort_transform = date_part_sort_transform,
+	},
+	{
+		.is_timescaledb_func = false,
+		.is_bucketing_func = false,
+		.funcname = "date_part",
+		.nargs = 2,
+		.arg_types = { TEXTOID, TIMESTAMPTZOID },
+		.sort_transform = date_part_sort_transform,
+	},
+	{
+		.is_timescaledb_func = false,
+		.is_bucketing_func = false,
+		.funcname = "timezone",
+		.nargs = 2,
+		.arg_types = { INTERVALOID, TIMESTAMPOID },
+		.sort_transform = timezone_interval_sort_transform,
+	},
+	{
+		.is_timescaledb_func = false,
+		.is_bucketing_func = false,
+		.funcname = "timezone",
+		.nargs = 2,
+		.arg_types = { INTERVALOID, TIMESTAMPTZOID },
+		.sort_transform = timezone_interval_sort_transform,
+	},
+	{
+		.is_timescaledb_func = false,
+		.is_bucketing_func = false,
+		.funcname = "timezone",
+		.nargs = 2,
+		.arg_types = { TEXTOID, TIMESTAMPOID },
+		.sort_transform = timezone_text_sort_transform,
+	},
+	{
+		.is_timescaledb_func = false,
+		.is_bucketing_func = false,
+		.funcname = "timezone",
+		.nargs = 2,
+		.arg_types = { TEXTOID, TIMESTAMPTZOID },
+		.sort_transform = timezone_text_sort_transform,
+	},
+	{
+		.is_timescaledb_func = false,
+		.is_bucketing_func = false,
+		.funcname = "to_timestamp",
+		.nargs = 1,
+		.arg_types = { FLOAT8OID },
+		.sort_transform = to_timestamp_sort_transform,
+	},
 };
 
 #define _MAX_CACHE_FUNCTIONS (sizeof(funcinfo) / sizeof(funcinfo[0]))
@@ -6,11 +6,18 @@
 #include <postgres.h>
 #include <utils/guc.h>
 #include <miscadmin.h>
+#include <utils/builtins.h>
+
+#include "compat.h"
+#if !PG96
+#include <utils/varlena.h>
+#endif
 
 #include "guc.h"
 #include "license_guc.h"
 #include "config.h"
 #include "hypertable_cache.h"
+#include "sort_transform.h"
 #include "telemetry/telemetry.h"
 
 typedef enum TelemetryLevel
@@ -43,12 +50,19 @@ bool ts_guc_enable_chunk_append = true;
 bool ts_guc_enable_parallel_chunk_append = true;
 bool ts_guc_enable_runtime_exclusion = true;
 bool ts_guc_enable_constraint_exclusion = true;
+bool ts_guc_enable_expansion_cache = true;
+bool ts_guc_enable_planner_instrumentation = false;
 bool ts_guc_enable_cagg_reorder_groupby = true;
 TSDLLEXPORT bool ts_guc_enable_transparent_decompression = true;
+TSDLLEXPORT bool ts_guc_enable_vectorized_decompression = true;
+TSDLLEXPORT bool ts_guc_enable_compressed_aggregation = true;
 int ts_guc_max_open_chunks_per_insert = 10;
 int ts_guc_max_cached_chunks_per_hypertable = 10;
+TSDLLEXPORT int ts_guc_max_parallel_compression_workers = 0;
 int ts_guc_telemetry_level = TELEMETRY_DEFAULT;
 
+char *ts_guc_monotonic_functions = NULL;
+
 TSDLLEXPORT char *ts_guc_license_key = TS_DEFAULT_LICENSE;
 char *ts_last_tune_time = NULL;
 char *ts_last_tune_version = NULL;
@@ -66,6 +80,29 @@ assign_max_cached_chunks_per_hypertable_hook(int newval, void *extra)
 	ts_hypertable_cache_invalidate_callback();
 }
 
+static bool
+check_monotonic_functions(char **newval, void **extra, GucSource source)
+{
+	char *rawstring = pstrdup(*newval);
+	List *namelist;
+	bool valid = SplitIdentifierString(rawstring, ',', &namelist);
+
+	if (!valid)
+		GUC_check_errdetail("List syntax is invalid.");
+
+	list_free(namelist);
+	pfree(rawstring);
+
+	return valid;
+}
+
+static void
+assign_monotonic_functions(const char *newval, void *extra)
+{
+	/* the function names are resolved again on next use */
+	ts_sort_transform_monotonic_funcs_invalidate();
+}
+
 void
 _guc_init(void)
 {
@@ -170,6 +207,30 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("timescaledb.enable_expansion_cache",
+							 "Enable hypertable expansion cache",
+							 "Cache the chunks found when expanding a hypertable so that "
+							 "planning the same restrictions again skips the catalog lookup",
+							 &ts_guc_enable_expansion_cache,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.enable_planner_instrumentation",
+							 "Enable planner instrumentation",
+							 "Time the planning phases of TimescaleDB, show the times in EXPLAIN "
+							 "and accumulate them in timescaledb_information.planner_stats",
+							 &ts_guc_enable_planner_instrumentation,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable("timescaledb.enable_transparent_decompression",
 							 "Enable transparent decompression",
 							 "Enable transparent decompression when querying hypertable",
@@ -181,6 +242,30 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("timescaledb.enable_vectorized_decompression",
+							 "Enable vectorized decompression",
+							 "Decompress whole batches of compressed rows at once and evaluate "
+							 "simple comparisons on them before forming tuples",
+							 &ts_guc_enable_vectorized_decompression,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.enable_compressed_aggregation",
+							 "Enable aggregation on compressed batches",
+							 "Compute partial aggregates in DecompressChunk from the compressed "
+							 "batches and their metadata instead of from decompressed tuples",
+							 &ts_guc_enable_compressed_aggregation,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable("timescaledb.enable_cagg_reorder_groupby",
 							 "Enable group by reordering",
 							 "Enable group by clause reordering for continuous aggregates",
@@ -192,6 +277,20 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomStringVariable("timescaledb.monotonic_functions",
+							   "Functions that preserve the ordering of their argument",
+							   "Comma-separated list of, optionally schema-qualified, immutable "
+							   "functions that are monotonically non-decreasing in their only "
+							   "non-constant argument, allowing ORDER BY and GROUP BY on such "
+							   "expressions to use the ordering of the underlying column",
+							   &ts_guc_monotonic_functions,
+							   "",
+							   PGC_USERSET,
+							   GUC_LIST_INPUT,
+							   check_monotonic_functions,
+							   assign_monotonic_functions,
+							   NULL);
+
 	DefineCustomIntVariable("timescaledb.max_open_chunks_per_insert",
 							"Maximum open chunks per insert",
 							"Maximum number of open chunk tables per insert",
@@ -224,6 +323,20 @@ _guc_init(void)
 							NULL,
 							assign_max_cached_chunks_per_hypertable_hook,
 							NULL);
+
+	DefineCustomIntVariable("timescaledb.max_parallel_compression_workers",
+							"Maximum parallel workers per chunk compression",
+							"Maximum number of parallel workers used to compress a chunk that has "
+							"segment by columns, 0 disables parallel compression",
+							&ts_guc_max_parallel_compression_workers,
+							0,
+							0,
+							1024,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
 	DefineCustomEnumVariable("timescaledb.telemetry_level",
 							 "Telemetry settings level",
 							 "Level used to determine which telemetry to send",
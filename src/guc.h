@@ -19,12 +19,18 @@ extern bool ts_guc_enable_chunk_append;
 extern bool ts_guc_enable_parallel_chunk_append;
 extern bool ts_guc_enable_runtime_exclusion;
 extern bool ts_guc_enable_constraint_exclusion;
+extern bool ts_guc_enable_expansion_cache;
+extern bool ts_guc_enable_planner_instrumentation;
 extern bool ts_guc_enable_cagg_reorder_groupby;
 extern TSDLLEXPORT bool ts_guc_enable_transparent_decompression;
+extern TSDLLEXPORT bool ts_guc_enable_vectorized_decompression;
+extern TSDLLEXPORT bool ts_guc_enable_compressed_aggregation;
 extern bool ts_guc_restoring;
 extern int ts_guc_max_open_chunks_per_insert;
 extern int ts_guc_max_cached_chunks_per_hypertable;
+extern TSDLLEXPORT int ts_guc_max_parallel_compression_workers;
 extern int ts_guc_telemetry_level;
+extern char *ts_guc_monotonic_functions;
 extern TSDLLEXPORT char *ts_guc_license_key;
 extern char *ts_last_tune_time;
 extern char *ts_last_tune_version;
@@ -52,6 +52,18 @@ hypertable_compression_fill_from_tuple(FormData_hypertable_compression *fd, Tupl
 		fd->orderby_nullsfirst = BoolGetDatum(
 			values[AttrNumberGetAttrOffset(Anum_hypertable_compression_orderby_nullsfirst)]);
 	}
+
+	if (isnulls[AttrNumberGetAttrOffset(Anum_hypertable_compression_minmax_column_index)])
+		fd->minmax_column_index = 0;
+	else
+		fd->minmax_column_index = DatumGetInt16(
+			values[AttrNumberGetAttrOffset(Anum_hypertable_compression_minmax_column_index)]);
+
+	if (isnulls[AttrNumberGetAttrOffset(Anum_hypertable_compression_bloom_column_index)])
+		fd->bloom_column_index = 0;
+	else
+		fd->bloom_column_index = DatumGetInt16(
+			values[AttrNumberGetAttrOffset(Anum_hypertable_compression_bloom_column_index)]);
 }
 
 TSDLLEXPORT void
@@ -90,6 +102,24 @@ ts_hypertable_compression_fill_tuple_values(FormData_hypertable_compression *fd,
 		nulls[AttrNumberGetAttrOffset(Anum_hypertable_compression_orderby_asc)] = true;
 		nulls[AttrNumberGetAttrOffset(Anum_hypertable_compression_orderby_nullsfirst)] = true;
 	}
+	if (fd->minmax_column_index > 0)
+	{
+		values[AttrNumberGetAttrOffset(Anum_hypertable_compression_minmax_column_index)] =
+			Int16GetDatum(fd->minmax_column_index);
+	}
+	else
+	{
+		nulls[AttrNumberGetAttrOffset(Anum_hypertable_compression_minmax_column_index)] = true;
+	}
+	if (fd->bloom_column_index > 0)
+	{
+		values[AttrNumberGetAttrOffset(Anum_hypertable_compression_bloom_column_index)] =
+			Int16GetDatum(fd->bloom_column_index);
+	}
+	else
+	{
+		nulls[AttrNumberGetAttrOffset(Anum_hypertable_compression_bloom_column_index)] = true;
+	}
 }
 
 /* returns length of list and fills passed in list with pointers
@@ -124,6 +154,34 @@ ts_hypertable_compression_get(int32 htid)
 	return fdlist;
 }
 
+static void
+init_scan_settings_by_hypertable_id(ScanIterator *iterator, int32 htid)
+{
+	iterator->ctx.index = catalog_get_index(ts_catalog_get(),
+											HYPERTABLE_COMPRESSION_SETTINGS,
+											HYPERTABLE_COMPRESSION_SETTINGS_PKEY);
+	ts_scan_iterator_scan_key_init(iterator,
+								   Anum_hypertable_compression_settings_pkey_hypertable_id,
+								   BTEqualStrategyNumber,
+								   F_INT4EQ,
+								   Int32GetDatum(htid));
+}
+
+static void
+hypertable_compression_settings_delete_by_hypertable_id(int32 htid)
+{
+	ScanIterator iterator = ts_scan_iterator_create(HYPERTABLE_COMPRESSION_SETTINGS,
+													RowExclusiveLock,
+													CurrentMemoryContext);
+	init_scan_settings_by_hypertable_id(&iterator, htid);
+
+	ts_scanner_foreach(&iterator)
+	{
+		TupleInfo *ti = ts_scan_iterator_tuple_info(&iterator);
+		ts_catalog_delete(ti->scanrel, ti->tuple);
+	}
+}
+
 TSDLLEXPORT bool
 ts_hypertable_compression_delete_by_hypertable_id(int32 htid)
 {
@@ -144,5 +202,70 @@ ts_hypertable_compression_delete_by_hypertable_id(int32 htid)
 		ts_catalog_delete(ti->scanrel, ti->tuple);
 		count++;
 	}
+
+	/* the settings only exist together with the column definitions */
+	hypertable_compression_settings_delete_by_hypertable_id(htid);
 	return count > 0;
 }
+
+/*
+ * Get a column of the compression settings of a hypertable. Returns false if
+ * there are no settings for the hypertable or the column is NULL.
+ */
+static bool
+hypertable_compression_settings_get(int32 htid, AttrNumber attnum, Datum *value)
+{
+	bool found = false;
+	ScanIterator iterator = ts_scan_iterator_create(HYPERTABLE_COMPRESSION_SETTINGS,
+													AccessShareLock,
+													CurrentMemoryContext);
+	init_scan_settings_by_hypertable_id(&iterator, htid);
+
+	ts_scanner_foreach(&iterator)
+	{
+		TupleInfo *ti = ts_scan_iterator_tuple_info(&iterator);
+		bool isnull;
+
+		*value = heap_getattr(ti->tuple, attnum, ti->desc, &isnull);
+		found = !isnull;
+	}
+	return found;
+}
+
+/*
+ * Get the batch size configured with timescaledb.compress_batch_size.
+ *
+ * Returns false if the option was not set for the hypertable. Otherwise the
+ * number of rows per compressed row is returned in batch_size, which is
+ * HYPERTABLE_COMPRESSION_BATCH_SIZE_ADAPTIVE if the batch size should be
+ * chosen during compression.
+ */
+TSDLLEXPORT bool
+ts_hypertable_compression_get_batch_size(int32 htid, int32 *batch_size)
+{
+	Datum value;
+
+	if (!hypertable_compression_settings_get(htid,
+											 Anum_hypertable_compression_settings_batch_size,
+											 &value))
+		return false;
+
+	*batch_size = DatumGetInt32(value);
+	return true;
+}
+
+/*
+ * Should the compression algorithms be chosen per compressed value
+ * (timescaledb.compress_adaptive_algorithms)?
+ */
+TSDLLEXPORT bool
+ts_hypertable_compression_get_adaptive_algorithms(int32 htid)
+{
+	AttrNumber attnum = Anum_hypertable_compression_settings_adaptive_algorithms;
+	Datum value;
+
+	if (!hypertable_compression_settings_get(htid, attnum, &value))
+		return false;
+
+	return DatumGetBool(value);
+}
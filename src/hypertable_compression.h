@@ -18,4 +18,11 @@ ts_hypertable_compression_fill_tuple_values(FormData_hypertable_compression *fd,
 
 extern TSDLLEXPORT bool ts_hypertable_compression_delete_by_hypertable_id(int32 htid);
 
+/* batch size stored in hypertable_compression_settings for timescaledb.compress_batch_size =
+ * 'adaptive' */
+#define HYPERTABLE_COMPRESSION_BATCH_SIZE_ADAPTIVE 0
+
+extern TSDLLEXPORT bool ts_hypertable_compression_get_batch_size(int32 htid, int32 *batch_size);
+extern TSDLLEXPORT bool ts_hypertable_compression_get_adaptive_algorithms(int32 htid);
+
 #endif
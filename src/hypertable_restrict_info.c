@@ -9,6 +9,7 @@
 #include <utils/lsyscache.h>
 #include <parser/parsetree.h>
 #include <utils/array.h>
+#include <lib/stringinfo.h>
 
 #include "hypertable_restrict_info.h"
 #include "dimension.h"
@@ -508,6 +509,103 @@ ts_hypertable_restrict_info_has_restrictions(HypertableRestrictInfo *hri)
 	return hri->num_base_restrictions > 0;
 }
 
+static int
+partition_cmp(const void *a, const void *b)
+{
+	return VALUE_CMP(*((const int32 *) a), *((const int32 *) b));
+}
+
+/*
+ * Serialize an open dimension restriction as the slices it matches.
+ *
+ * The bounds themselves are not part of the key: any two ranges that fall in
+ * the same slices (e.g., a now() relative range that moves a bit on every
+ * refresh) match the same chunks and should share a cache entry. Using the
+ * slice IDs, rather than bounds snapped to the slice boundaries, keeps the
+ * key exact even when slices of the dimension overlap.
+ */
+static void
+dimension_restrict_info_open_serialize(DimensionRestrictInfoOpen *dri, StringInfo buf)
+{
+	DimensionVec *dv;
+	int i;
+
+	if (dri->lower_strategy == InvalidStrategy && dri->upper_strategy == InvalidStrategy)
+	{
+		int32 num_slices = -1;
+
+		/* unrestricted, which matches all slices */
+		appendBinaryStringInfo(buf, (char *) &num_slices, sizeof(int32));
+		return;
+	}
+
+	dv = dimension_restrict_info_open_slices(dri);
+	appendBinaryStringInfo(buf, (char *) &dv->num_slices, sizeof(int32));
+
+	/* the slices are sorted on their range, so the order is canonical */
+	for (i = 0; i < dv->num_slices; i++)
+		appendBinaryStringInfo(buf, (char *) &dv->slices[i]->fd.id, sizeof(int32));
+}
+
+static void
+dimension_restrict_info_closed_serialize(DimensionRestrictInfoClosed *dri, StringInfo buf)
+{
+	int32 num_partitions = list_length(dri->partitions);
+
+	appendBinaryStringInfo(buf, (char *) &dri->strategy, sizeof(StrategyNumber));
+	appendBinaryStringInfo(buf, (char *) &num_partitions, sizeof(int32));
+
+	if (num_partitions > 0)
+	{
+		int32 *partitions = palloc(sizeof(int32) * num_partitions);
+		ListCell *lc;
+		int i = 0;
+
+		/* partitions are a set, so sort them to get a canonical form */
+		foreach (lc, dri->partitions)
+			partitions[i++] = lfirst_int(lc);
+
+		qsort(partitions, num_partitions, sizeof(int32), partition_cmp);
+		appendBinaryStringInfo(buf, (char *) partitions, sizeof(int32) * num_partitions);
+		pfree(partitions);
+	}
+}
+
+/*
+ * Serialize the restrictions into a canonical binary form.
+ *
+ * Two sets of restriction clauses that reduce to the same dimension slices
+ * serialize to identical bytes, which makes the result usable as a cache key
+ * for the chunks matching the restrictions. Open dimension restrictions are
+ * resolved to their slices with a catalog scan.
+ */
+void
+ts_hypertable_restrict_info_serialize(HypertableRestrictInfo *hri, StringInfo buf)
+{
+	int i;
+
+	appendBinaryStringInfo(buf, (char *) &hri->num_dimensions, sizeof(int));
+
+	for (i = 0; i < hri->num_dimensions; i++)
+	{
+		DimensionRestrictInfo *dri = hri->dimension_restriction[i];
+
+		appendBinaryStringInfo(buf, (char *) &dri->dimension->fd.id, sizeof(int32));
+
+		switch (dri->dimension->type)
+		{
+			case DIMENSION_TYPE_OPEN:
+				dimension_restrict_info_open_serialize((DimensionRestrictInfoOpen *) dri, buf);
+				break;
+			case DIMENSION_TYPE_CLOSED:
+				dimension_restrict_info_closed_serialize((DimensionRestrictInfoClosed *) dri, buf);
+				break;
+			default:
+				elog(ERROR, "unknown dimension type: %d", dri->dimension->type);
+		}
+	}
+}
+
 static List *
 gather_restriction_dimension_vectors(HypertableRestrictInfo *hri)
 {
@@ -540,26 +638,52 @@ gather_restriction_dimension_vectors(HypertableRestrictInfo *hri)
 	return dimension_vecs;
 }
 
-List *
-ts_hypertable_restrict_info_get_chunk_oids(HypertableRestrictInfo *hri, Hypertable *ht,
-										   LOCKMODE lockmode)
+static Chunk **
+hypertable_restrict_info_get_chunks(HypertableRestrictInfo *hri, Hypertable *ht, LOCKMODE lockmode,
+									unsigned int *num_chunks)
 {
 	List *dimension_vecs = gather_restriction_dimension_vectors(hri);
 
 	Assert(hri->num_dimensions == ht->space->num_dimensions);
 
-	return ts_chunk_find_all_oids(ht->space, dimension_vecs, lockmode);
+	return ts_chunk_find_all(ht->space, dimension_vecs, lockmode, num_chunks);
 }
 
-static Chunk **
-hypertable_restrict_info_get_chunks(HypertableRestrictInfo *hri, Hypertable *ht, LOCKMODE lockmode,
-									unsigned int *num_chunks)
+/*
+ * Get the oids of the chunks matching the restrictions.
+ *
+ * If chunks is not NULL, the Chunk objects built by the scan are returned in
+ * it, in the same order as the oids, so that the planner can reuse them
+ * instead of looking up every chunk again.
+ */
+List *
+ts_hypertable_restrict_info_get_chunk_oids(HypertableRestrictInfo *hri, Hypertable *ht,
+										   LOCKMODE lockmode, List **chunks)
 {
-	List *dimension_vecs = gather_restriction_dimension_vectors(hri);
+	List *dimension_vecs;
+	List *chunk_oids = NIL;
+	Chunk **found;
+	unsigned int num_chunks;
+	unsigned int i;
 
-	Assert(hri->num_dimensions == ht->space->num_dimensions);
+	if (NULL == chunks)
+	{
+		dimension_vecs = gather_restriction_dimension_vectors(hri);
 
-	return ts_chunk_find_all(ht->space, dimension_vecs, lockmode, num_chunks);
+		Assert(hri->num_dimensions == ht->space->num_dimensions);
+
+		return ts_chunk_find_all_oids(ht->space, dimension_vecs, lockmode);
+	}
+
+	found = hypertable_restrict_info_get_chunks(hri, ht, lockmode, &num_chunks);
+
+	for (i = 0; i < num_chunks; i++)
+	{
+		chunk_oids = lappend_oid(chunk_oids, found[i]->table_id);
+		*chunks = lappend(*chunks, found[i]);
+	}
+
+	return chunk_oids;
 }
 
 /*
@@ -596,11 +720,13 @@ chunk_cmp_reverse(const void *c1, const void *c2)
  * in the same list. In the list [[1,2,3],[4,5,6]] chunks 1, 2 and 3 are space partitions of
  * the same time slice and 4, 5 and 6 are space partitions of the next time slice.
  *
+ * If chunks is not NULL, the Chunk objects are returned in it in the same
+ * order as the oids.
  */
 List *
 ts_hypertable_restrict_info_get_chunk_oids_ordered(HypertableRestrictInfo *hri, Hypertable *ht,
 												   LOCKMODE lockmode, List **nested_oids,
-												   bool reverse)
+												   bool reverse, List **chunks)
 {
 	unsigned num_chunks;
 	Chunk **chunks = hypertable_restrict_info_get_chunks(hri, ht, lockmode, &num_chunks);
@@ -635,6 +761,10 @@ ts_hypertable_restrict_info_get_chunk_oids_ordered(HypertableRestrictInfo *hri,
 			slot_chunk_oids = lappend_oid(slot_chunk_oids, chunk->table_id);
 
 		chunk_oids = lappend_oid(chunk_oids, chunk->table_id);
+
+		if (NULL != chunks)
+			*chunks = lappend(*chunks, chunk);
+
 		slice = chunk->cube->slices[0];
 	}
 
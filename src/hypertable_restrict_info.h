@@ -6,6 +6,9 @@
 #ifndef TIMESCALEDB_HYPERTABLE_RESTRICT_INFO_H
 #define TIMESCALEDB_HYPERTABLE_RESTRICT_INFO_H
 
+#include <postgres.h>
+#include <lib/stringinfo.h>
+
 #include "hypertable.h"
 
 /* HypertableRestrictInfo represents restrictions on a hypertable. It uses
@@ -21,12 +24,16 @@ extern void ts_hypertable_restrict_info_add(HypertableRestrictInfo *hri, Planner
 /* Some restrictions were added */
 extern bool ts_hypertable_restrict_info_has_restrictions(HypertableRestrictInfo *hri);
 
+/* Serialize the restrictions into a canonical form, e.g., for use as a cache key */
+extern void ts_hypertable_restrict_info_serialize(HypertableRestrictInfo *hri, StringInfo buf);
+
 /* Get a list of chunk oids for chunks whose constraints match the restriction clauses */
 extern List *ts_hypertable_restrict_info_get_chunk_oids(HypertableRestrictInfo *hri, Hypertable *ht,
-														LOCKMODE lockmode);
+														LOCKMODE lockmode, List **chunks);
 
 extern List *ts_hypertable_restrict_info_get_chunk_oids_ordered(HypertableRestrictInfo *hri,
 																Hypertable *ht, LOCKMODE lockmode,
-																List **nested_oids, bool reverse);
+																List **nested_oids, bool reverse,
+																List **chunks);
 
 #endif /* TIMESCALEDB_HYPERTABLE_RESTRICT_INFO_H */
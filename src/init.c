@@ -37,6 +37,9 @@ extern void _cache_fini(void);
 extern void _planner_init(void);
 extern void _planner_fini(void);
 
+extern void _planner_instrumentation_init(void);
+extern void _planner_instrumentation_fini(void);
+
 extern void _process_utility_init(void);
 extern void _process_utility_fini(void);
 
@@ -78,6 +81,7 @@ _PG_init(void)
 	_hypertable_cache_init();
 	_cache_invalidate_init();
 	_planner_init();
+	_planner_instrumentation_init();
 	_constraint_aware_append_init();
 	_chunk_append_init();
 	_event_trigger_init();
@@ -109,6 +113,7 @@ _PG_fini(void)
 	_guc_fini();
 	_process_utility_fini();
 	_event_trigger_fini();
+	_planner_instrumentation_fini();
 	_planner_fini();
 	_cache_invalidate_fini();
 	_hypertable_cache_fini();
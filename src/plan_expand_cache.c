@@ -0,0 +1,298 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#include <postgres.h>
+#include <access/hash.h>
+#include <lib/stringinfo.h>
+#include <storage/lmgr.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+
+#include "plan_expand_cache.h"
+
+/*
+ * Backend-local cache of hypertable expansion results.
+ *
+ * Expanding a hypertable requires scanning the dimension slice and chunk
+ * constraint catalogs to find the chunks matching the restrictions in a
+ * query. When the same query shape is planned over and over again (e.g., a
+ * dashboard refreshing), the result of the expansion is the same as long as
+ * the restrictions reduce to the same dimension slices and no chunk was
+ * created or dropped in between.
+ *
+ * Entries are keyed on the hypertable, the canonical (serialized) form of the
+ * dimension restrictions, in which time ranges are resolved to the dimension
+ * slices they match, and the order in which the chunks are requested. An
+ * entry stores the resulting chunk OIDs.
+ *
+ * Entries are flushed through the relcache invalidation machinery:
+ *
+ * 1. Invalidation of the hypertable cache proxy table (any change to the
+ *    chunk, dimension slice or dimension catalogs) flushes all entries.
+ *
+ * 2. Chunk creation invalidates the expansion cache proxy table, which also
+ *    flushes all entries. Chunk creation does not otherwise invalidate the
+ *    hypertable cache, so this keeps the plans and relcache entries of the
+ *    hypertable valid.
+ *
+ * 3. A reset of the whole relcache flushes all entries since the signal of a
+ *    new chunk might have been lost.
+ *
+ * 4. Aborted (sub)transactions flush all entries.
+ *
+ * Every invalidation bumps a generation counter, which serves as the catalog
+ * version of a computed result: a result computed from the catalog is only
+ * stored if no invalidation was processed while it was computed. Relcache
+ * invalidations of other relations neither flush entries nor bump the
+ * generation.
+ */
+
+/* Upper bound on the number of entries before the cache is reset */
+#define EXPANSION_CACHE_MAX_ENTRIES 1024
+
+typedef struct ExpansionCacheHashKey
+{
+	Oid relid;
+	ExpansionOrder order;
+	int len;
+	char *data;
+} ExpansionCacheHashKey;
+
+typedef struct ExpansionCacheEntry
+{
+	ExpansionCacheHashKey key;
+	List *chunk_oids;
+	List *nested_oids;
+} ExpansionCacheEntry;
+
+struct ExpansionCacheKey
+{
+	ExpansionCacheHashKey hashkey;
+	uint64 generation;
+};
+
+static HTAB *expansion_cache = NULL;
+static MemoryContext expansion_cache_mcxt = NULL;
+static uint64 expansion_cache_generation = 0;
+static int64 expansion_cache_hits = 0;
+static int64 expansion_cache_misses = 0;
+
+static uint32
+expansion_cache_hash(const void *key, Size keysize)
+{
+	const ExpansionCacheHashKey *k = key;
+	uint32 hash = DatumGetUInt32(hash_any((const unsigned char *) k->data, k->len));
+
+	hash ^= DatumGetUInt32(hash_uint32((uint32) k->relid));
+	hash ^= (uint32) k->order;
+
+	return hash;
+}
+
+static int
+expansion_cache_match(const void *key1, const void *key2, Size keysize)
+{
+	const ExpansionCacheHashKey *k1 = key1;
+	const ExpansionCacheHashKey *k2 = key2;
+
+	if (k1->relid != k2->relid || k1->order != k2->order || k1->len != k2->len)
+		return 1;
+
+	return memcmp(k1->data, k2->data, k1->len);
+}
+
+static HTAB *
+expansion_cache_get(void)
+{
+	HASHCTL ctl;
+
+	if (expansion_cache != NULL)
+		return expansion_cache;
+
+	expansion_cache_mcxt =
+		AllocSetContextCreate(CacheMemoryContext, "Expansion cache", ALLOCSET_DEFAULT_SIZES);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(ExpansionCacheHashKey);
+	ctl.entrysize = sizeof(ExpansionCacheEntry);
+	ctl.hash = expansion_cache_hash;
+	ctl.match = expansion_cache_match;
+	ctl.hcxt = expansion_cache_mcxt;
+
+	expansion_cache = hash_create("Expansion cache",
+								  64,
+								  &ctl,
+								  HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+	return expansion_cache;
+}
+
+static void
+expansion_cache_reset(void)
+{
+	if (expansion_cache == NULL)
+		return;
+
+	/* the hash table is allocated in the cache memory context */
+	MemoryContextDelete(expansion_cache_mcxt);
+	expansion_cache = NULL;
+	expansion_cache_mcxt = NULL;
+}
+
+static void
+expansion_cache_entry_free(ExpansionCacheEntry *entry)
+{
+	ListCell *lc;
+
+	foreach (lc, entry->nested_oids)
+		list_free(lfirst(lc));
+
+	list_free(entry->nested_oids);
+	list_free(entry->chunk_oids);
+	pfree(entry->key.data);
+}
+
+static List *
+copy_nested_oids(List *nested_oids)
+{
+	List *copy = NIL;
+	ListCell *lc;
+
+	foreach (lc, nested_oids)
+		copy = lappend(copy, list_copy(lfirst(lc)));
+
+	return copy;
+}
+
+ExpansionCacheKey *
+ts_plan_expand_cache_key_create(Hypertable *ht, HypertableRestrictInfo *hri, ExpansionOrder order)
+{
+	ExpansionCacheKey *key = palloc(sizeof(ExpansionCacheKey));
+	StringInfoData buf;
+
+	/*
+	 * The serialized restrictions depend on the dimension slice catalog, so
+	 * take the generation before reading it.
+	 */
+	key->generation = expansion_cache_generation;
+	initStringInfo(&buf);
+	ts_hypertable_restrict_info_serialize(hri, &buf);
+
+	key->hashkey.relid = ht->main_table_relid;
+	key->hashkey.order = order;
+	key->hashkey.len = buf.len;
+	key->hashkey.data = buf.data;
+
+	return key;
+}
+
+/*
+ * Lookup the chunks for an expansion in the cache.
+ *
+ * On a hit the chunks are locked with the given lock mode, just like a
+ * catalog lookup would do. Acquiring the locks processes pending
+ * invalidations, so the entry is checked again once all chunks are locked to
+ * make sure no chunk was dropped or created concurrently.
+ */
+bool
+ts_plan_expand_cache_lookup(ExpansionCacheKey *key, LOCKMODE lockmode, List **chunk_oids,
+							List **nested_oids)
+{
+	ExpansionCacheEntry *entry;
+	List *oids;
+	ListCell *lc;
+
+	if (expansion_cache == NULL)
+	{
+		expansion_cache_misses++;
+		return false;
+	}
+
+	entry = hash_search(expansion_cache, &key->hashkey, HASH_FIND, NULL);
+
+	if (entry == NULL)
+	{
+		expansion_cache_misses++;
+		return false;
+	}
+
+	oids = list_copy(entry->chunk_oids);
+
+	if (nested_oids != NULL)
+		*nested_oids = copy_nested_oids(entry->nested_oids);
+
+	foreach (lc, oids)
+		LockRelationOid(lfirst_oid(lc), lockmode);
+
+	/* the entry might have been invalidated while taking the locks */
+	if (expansion_cache == NULL ||
+		hash_search(expansion_cache, &key->hashkey, HASH_FIND, NULL) == NULL)
+	{
+		if (nested_oids != NULL)
+			*nested_oids = NIL;
+
+		expansion_cache_misses++;
+		return false;
+	}
+
+	expansion_cache_hits++;
+	*chunk_oids = oids;
+
+	return true;
+}
+
+/*
+ * Store the result of an expansion in the cache.
+ *
+ * The result is discarded if an invalidation was processed after the key was
+ * created since the result might have been computed from stale catalog
+ * information.
+ */
+void
+ts_plan_expand_cache_store(ExpansionCacheKey *key, List *chunk_oids, List *nested_oids)
+{
+	HTAB *cache;
+	ExpansionCacheEntry *entry;
+	MemoryContext old;
+	bool found;
+
+	if (key->generation != expansion_cache_generation)
+		return;
+
+	if (expansion_cache != NULL &&
+		hash_get_num_entries(expansion_cache) >= EXPANSION_CACHE_MAX_ENTRIES)
+		expansion_cache_reset();
+
+	cache = expansion_cache_get();
+	old = MemoryContextSwitchTo(expansion_cache_mcxt);
+	entry = hash_search(cache, &key->hashkey, HASH_ENTER, &found);
+
+	if (found)
+		expansion_cache_entry_free(entry);
+
+	/* the hash key only references the key data, so make a copy we own */
+	entry->key.data = palloc(key->hashkey.len);
+	memcpy(entry->key.data, key->hashkey.data, key->hashkey.len);
+	entry->chunk_oids = list_copy(chunk_oids);
+	entry->nested_oids = copy_nested_oids(nested_oids);
+	MemoryContextSwitchTo(old);
+}
+
+/* Invalidate all cached expansions */
+void
+ts_plan_expand_cache_invalidate(void)
+{
+	expansion_cache_generation++;
+	expansion_cache_reset();
+}
+
+/* Get the number of entries, hits and misses of the cache for testing */
+void
+ts_plan_expand_cache_stats(int64 *entries, int64 *hits, int64 *misses)
+{
+	*entries = expansion_cache != NULL ? hash_get_num_entries(expansion_cache) : 0;
+	*hits = expansion_cache_hits;
+	*misses = expansion_cache_misses;
+}
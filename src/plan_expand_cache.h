@@ -0,0 +1,36 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#ifndef TIMESCALEDB_PLAN_EXPAND_CACHE_H
+#define TIMESCALEDB_PLAN_EXPAND_CACHE_H
+
+#include <postgres.h>
+#include <nodes/pg_list.h>
+#include <storage/lock.h>
+
+#include "hypertable.h"
+#include "hypertable_restrict_info.h"
+
+/* How the chunk list of a cached expansion is ordered */
+typedef enum ExpansionOrder
+{
+	EXPANSION_UNORDERED = 0,
+	EXPANSION_ORDERED,
+	EXPANSION_ORDERED_REVERSE,
+} ExpansionOrder;
+
+typedef struct ExpansionCacheKey ExpansionCacheKey;
+
+extern ExpansionCacheKey *ts_plan_expand_cache_key_create(Hypertable *ht,
+														  HypertableRestrictInfo *hri,
+														  ExpansionOrder order);
+extern bool ts_plan_expand_cache_lookup(ExpansionCacheKey *key, LOCKMODE lockmode,
+										List **chunk_oids, List **nested_oids);
+extern void ts_plan_expand_cache_store(ExpansionCacheKey *key, List *chunk_oids,
+									   List *nested_oids);
+extern void ts_plan_expand_cache_invalidate(void);
+extern void ts_plan_expand_cache_stats(int64 *entries, int64 *hits, int64 *misses);
+
+#endif /* TIMESCALEDB_PLAN_EXPAND_CACHE_H */
@@ -36,7 +36,9 @@
 #include "plan_expand_hypertable.h"
 #include "hypertable.h"
 #include "hypertable_restrict_info.h"
+#include "plan_expand_cache.h"
 #include "planner.h"
+#include "planner_instrumentation.h"
 #include "planner_import.h"
 #include "chunk_append/chunk_append.h"
 #include "guc.h"
@@ -592,8 +594,11 @@ collect_quals_walker(Node *node, CollectQualCtx *ctx)
 }
 
 static List *
-find_children_oids(HypertableRestrictInfo *hri, Hypertable *ht, LOCKMODE lockmode)
+find_children_oids(HypertableRestrictInfo *hri, Hypertable *ht, LOCKMODE lockmode, List **chunks)
 {
+	ExpansionCacheKey *key;
+	List *chunk_oids;
+
 	/*
 	 * Using the HRI only makes sense if we are not using all the chunks,
 	 * otherwise using the cached inheritance hierarchy is faster.
@@ -601,13 +606,57 @@ find_children_oids(HypertableRestrictInfo *hri, Hypertable *ht, LOCKMODE lockmod
 	if (!ts_hypertable_restrict_info_has_restrictions(hri))
 		return find_inheritance_children(ht->main_table_relid, lockmode);
 
+	if (!ts_guc_enable_expansion_cache)
+		return ts_hypertable_restrict_info_get_chunk_oids(hri, ht, lockmode, chunks);
+
+	key = ts_plan_expand_cache_key_create(ht, hri, EXPANSION_UNORDERED);
+
+	if (ts_plan_expand_cache_lookup(key, lockmode, &chunk_oids, NULL))
+		return chunk_oids;
+
 	/*
 	 * Unlike find_all_inheritors we do not include parent because if there
 	 * are restrictions the parent table cannot fulfill them and since we do
 	 * have a trigger blocking inserts on the parent table it cannot contain
 	 * any rows.
 	 */
-	return ts_hypertable_restrict_info_get_chunk_oids(hri, ht, lockmode);
+	chunk_oids = ts_hypertable_restrict_info_get_chunk_oids(hri, ht, lockmode, chunks);
+	ts_plan_expand_cache_store(key, chunk_oids, NIL);
+
+	return chunk_oids;
+}
+
+static List *
+get_chunk_oids_ordered(HypertableRestrictInfo *hri, Hypertable *ht, List **nested_oids,
+					   bool reverse, List **chunks)
+{
+	ExpansionCacheKey *key;
+	List *chunk_oids;
+
+	if (!ts_guc_enable_expansion_cache)
+		return ts_hypertable_restrict_info_get_chunk_oids_ordered(hri,
+																  ht,
+																  AccessShareLock,
+																  nested_oids,
+																  reverse,
+																  chunks);
+
+	key = ts_plan_expand_cache_key_create(ht,
+										  hri,
+										  reverse ? EXPANSION_ORDERED_REVERSE : EXPANSION_ORDERED);
+
+	if (ts_plan_expand_cache_lookup(key, AccessShareLock, &chunk_oids, nested_oids))
+		return chunk_oids;
+
+	chunk_oids = ts_hypertable_restrict_info_get_chunk_oids_ordered(hri,
+																	ht,
+																	AccessShareLock,
+																	nested_oids,
+																	reverse,
+																	chunks);
+	ts_plan_expand_cache_store(key, chunk_oids, nested_oids != NULL ? *nested_oids : NIL);
+
+	return chunk_oids;
 }
 
 static bool
@@ -705,9 +754,12 @@ get_explicit_chunk_oids(CollectQualCtx *ctx, Hypertable *ht)
  * is
  * If the hypertable uses space partitioning the nested oids are stored in nested_oids
  * on rel->fdw_private when appends are ordered.
+ * If the chunk catalog had to be scanned, the Chunk objects built by the scan
+ * are returned in chunks, in the same order as the oids.
  */
 static List *
-get_chunk_oids(CollectQualCtx *ctx, PlannerInfo *root, RelOptInfo *rel, Hypertable *ht)
+get_chunk_oids(CollectQualCtx *ctx, PlannerInfo *root, RelOptInfo *rel, Hypertable *ht,
+			   List **chunks)
 {
 	bool reverse;
 	int order_attno;
@@ -747,13 +799,9 @@ get_chunk_oids(CollectQualCtx *ctx, PlannerInfo *root, RelOptInfo *rel, Hypertab
 			if (ht->space->num_dimensions > 1)
 				nested_oids = &private->nested_oids;
 
-			return ts_hypertable_restrict_info_get_chunk_oids_ordered(hri,
-																	  ht,
-																	  AccessShareLock,
-																	  nested_oids,
-																	  reverse);
+			return get_chunk_oids_ordered(hri, ht, nested_oids, reverse, chunks);
 		}
-		return find_children_oids(hri, ht, AccessShareLock);
+		return find_children_oids(hri, ht, AccessShareLock, chunks);
 	}
 	else
 		return get_explicit_chunk_oids(ctx, ht);
@@ -877,7 +925,10 @@ ts_plan_expand_hypertable_chunks(Hypertable *ht, PlannerInfo *root, Oid parent_o
 {
 	RangeTblEntry *rte = rt_fetch(rel->relid, root->parse->rtable);
 	List *inh_oids;
+	List *chunks = NIL;
 	ListCell *l;
+	ListCell *lc_chunk;
+	Chunk **rel_chunks = NULL;
 	Relation oldrelation = heap_open(parent_oid, NoLock);
 	Query *parse = root->parse;
 	Index rti = rel->relid;
@@ -910,7 +961,8 @@ ts_plan_expand_hypertable_chunks(Hypertable *ht, PlannerInfo *root, Oid parent_o
 	if (ctx.propagate_conditions != NIL)
 		propagate_join_quals(root, rel, &ctx);
 
-	inh_oids = get_chunk_oids(&ctx, root, rel, ht);
+	inh_oids = get_chunk_oids(&ctx, root, rel, ht, &chunks);
+	ts_planner_instrumentation_count_expansion(list_length(inh_oids));
 
 	/*
 	 * the simple_*_array structures have already been set, we need to add the
@@ -922,6 +974,22 @@ ts_plan_expand_hypertable_chunks(Hypertable *ht, PlannerInfo *root, Oid parent_o
 	root->simple_rte_array =
 		repalloc(root->simple_rte_array, root->simple_rel_array_size * sizeof(RangeTblEntry *));
 
+	/*
+	 * Remember the chunks found during expansion, indexed by the range table
+	 * index of the child, so that later planning stages do not have to look
+	 * them up again.
+	 */
+	if (chunks != NIL && rel->fdw_private != NULL)
+	{
+		TimescaleDBPrivate *private = (TimescaleDBPrivate *) rel->fdw_private;
+
+		Assert(list_length(chunks) == list_length(inh_oids));
+		rel_chunks = palloc0(sizeof(Chunk *) * root->simple_rel_array_size);
+	  private
+		->chunks = rel_chunks;
+	}
+	lc_chunk = list_head(chunks);
+
 #if PG11_GE
 	/* Adding partition info will make PostgreSQL consider the inheritance
 	 * children as part of a partitioned relation. This will enable
@@ -972,6 +1040,13 @@ ts_plan_expand_hypertable_chunks(Hypertable *ht, PlannerInfo *root, Oid parent_o
 		root->simple_rte_array[child_rtindex] = childrte;
 		root->simple_rel_array[child_rtindex] = NULL;
 
+		if (rel_chunks != NULL)
+		{
+			rel_chunks[child_rtindex] = lfirst(lc_chunk);
+			Assert(rel_chunks[child_rtindex]->table_id == child_oid);
+			lc_chunk = lnext(lc_chunk);
+		}
+
 #if PG10_GE
 		Assert(childrte->relkind != RELKIND_PARTITIONED_TABLE);
 #endif
@@ -52,13 +52,14 @@
 #include "partitioning.h"
 #include "dimension_slice.h"
 #include "dimension_vector.h"
-#include "func_cache.h"
+#include "sort_transform.h"
 #include "chunk.h"
 #include "planner.h"
 #include "plan_expand_hypertable.h"
 #include "plan_add_hashagg.h"
 #include "plan_agg_bookend.h"
 #include "plan_partialize.h"
+#include "planner_instrumentation.h"
 
 void _planner_init(void);
 void _planner_fini(void);
@@ -144,7 +145,7 @@ timescaledb_query_walker(Node *node, TimescaledbWalkerState *cxt)
 }
 
 static PlannedStmt *
-timescaledb_planner(Query *parse, int cursor_opts, ParamListInfo bound_params)
+timescaledb_planner_internal(Query *parse, int cursor_opts, ParamListInfo bound_params)
 {
 	PlannedStmt *stmt;
 	ListCell *lc;
@@ -215,6 +216,31 @@ timescaledb_planner(Query *parse, int cursor_opts, ParamListInfo bound_params)
 	return stmt;
 }
 
+static PlannedStmt *
+timescaledb_planner(Query *parse, int cursor_opts, ParamListInfo bound_params)
+{
+	PlannedStmt *stmt;
+	instr_time start;
+
+	if (!ts_planner_instrumentation_begin(&start))
+		return timescaledb_planner_internal(parse, cursor_opts, bound_params);
+
+	PG_TRY();
+	{
+		stmt = timescaledb_planner_internal(parse, cursor_opts, bound_params);
+	}
+	PG_CATCH();
+	{
+		ts_planner_instrumentation_abort();
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	ts_planner_instrumentation_end(&start);
+
+	return stmt;
+}
+
 static inline bool
 should_optimize_query(Hypertable *ht)
 {
@@ -302,19 +328,13 @@ should_chunk_append(PlannerInfo *root, RelOptInfo *rel, Path *path, bool ordered
 						if (IsA(em->em_expr, Var) &&
 							castNode(Var, em->em_expr)->varattno == order_attno)
 							return true;
-						else if (IsA(em->em_expr, FuncExpr) && list_length(path->pathkeys) == 1)
+						else if (list_length(path->pathkeys) == 1)
 						{
-							FuncExpr *func = castNode(FuncExpr, em->em_expr);
-							FuncInfo *info = ts_func_cache_get_bucketing_func(func->funcid);
-							Expr *transformed;
-
-							if (info != NULL)
-							{
-								transformed = info->sort_transform(func);
-								if (IsA(transformed, Var) &&
-									castNode(Var, transformed)->varattno == order_attno)
-									return true;
-							}
+							Expr *transformed = ts_sort_transform_expr(em->em_expr);
+
+							if (IsA(transformed, Var) &&
+								castNode(Var, transformed)->varattno == order_attno)
+								return true;
 						}
 					}
 				}
@@ -466,16 +486,14 @@ timescaledb_set_rel_pathlist_query(PlannerInfo *root, RelOptInfo *rel, Index rti
 }
 
 static void
-timescaledb_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti, RangeTblEntry *rte)
+timescaledb_set_rel_pathlist_internal(PlannerInfo *root, RelOptInfo *rel, Index rti,
+									  RangeTblEntry *rte)
 {
 	Hypertable *ht;
 	Cache *hcache;
 	Oid ht_reloid = rte->relid;
 	bool is_htdml;
 
-	if (prev_set_rel_pathlist_hook != NULL)
-		(*prev_set_rel_pathlist_hook)(root, rel, rti, rte);
-
 	if (!ts_extension_is_loaded() || IS_DUMMY_REL(rel) || !OidIsValid(rte->relid))
 		return;
 
@@ -509,18 +527,74 @@ timescaledb_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti, Rang
 	ts_cache_release(hcache);
 }
 
+static void
+timescaledb_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti, RangeTblEntry *rte)
+{
+	instr_time start;
+
+	if (prev_set_rel_pathlist_hook != NULL)
+		(*prev_set_rel_pathlist_hook)(root, rel, rti, rte);
+
+	ts_planner_phase_start(&start);
+	timescaledb_set_rel_pathlist_internal(root, rel, rti, rte);
+	ts_planner_phase_stop(PLANNER_PHASE_SET_REL_PATHLIST, &start);
+}
+
+/*
+ * Get the chunk of a chunk relation that is part of an expanded hypertable.
+ *
+ * The chunks are normally found during hypertable expansion and stored on the
+ * parent relation, so we take it from there. Only if expansion did not build
+ * the chunk, e.g., because the chunk oids came from the expansion cache, is
+ * the chunk looked up in the catalog. Either way, the chunk is remembered on
+ * the relation so that later planning stages get it for free. Returns NULL if
+ * the relation is not a chunk.
+ */
+Chunk *
+ts_planner_chunk_fetch(PlannerInfo *root, RelOptInfo *rel)
+{
+	TimescaleDBPrivate *private;
+
+	if (rel->fdw_private == NULL)
+		rel->fdw_private = palloc0(sizeof(TimescaleDBPrivate));
+
+	private = (TimescaleDBPrivate *) rel->fdw_private;
+
+	if (private->chunk == NULL)
+	{
+		AppendRelInfo *appinfo = ts_get_appendrelinfo(root, rel->relid, true);
+
+		if (appinfo != NULL && root->simple_rel_array[appinfo->parent_relid] != NULL)
+		{
+			RelOptInfo *parent = root->simple_rel_array[appinfo->parent_relid];
+			TimescaleDBPrivate *parent_private = (TimescaleDBPrivate *) parent->fdw_private;
+
+			if (parent_private != NULL && parent_private->chunks != NULL)
+			  private
+			->chunk = parent_private->chunks[rel->relid];
+		}
+	}
+
+	if (private->chunk == NULL)
+	{
+		RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+
+	  private
+		->chunk = ts_chunk_get_by_relid(rte->relid, 0, false);
+	}
+
+	return private->chunk;
+}
+
 /* This hook is meant to editorialize about the information
  * the planner gets about a relation. We hijack it here
  * to also expand the append relation for hypertables. */
 static void
-timescaledb_get_relation_info_hook(PlannerInfo *root, Oid relation_objectid, bool inhparent,
-								   RelOptInfo *rel)
+timescaledb_get_relation_info(PlannerInfo *root, Oid relation_objectid, bool inhparent,
+							  RelOptInfo *rel)
 {
 	RangeTblEntry *rte;
 
-	if (prev_get_relation_info_hook != NULL)
-		prev_get_relation_info_hook(root, relation_objectid, inhparent, rel);
-
 	if (!ts_extension_is_loaded() || !ts_guc_enable_constraint_exclusion)
 		return;
 
@@ -541,11 +615,14 @@ timescaledb_get_relation_info_hook(PlannerInfo *root, Oid relation_objectid, boo
 	{
 		Cache *hcache;
 		Hypertable *ht = ts_hypertable_cache_get_cache_and_entry(rte->relid, false, &hcache);
+		instr_time start;
 
 		Assert(rel->fdw_private == NULL);
 		rel->fdw_private = palloc0(sizeof(TimescaleDBPrivate));
 
+		ts_planner_phase_start(&start);
 		ts_plan_expand_hypertable_chunks(ht, root, relation_objectid, inhparent, rel);
+		ts_planner_phase_stop(PLANNER_PHASE_EXPAND_HYPERTABLE, &start);
 
 		ts_cache_release(hcache);
 	}
@@ -558,12 +635,10 @@ timescaledb_get_relation_info_hook(PlannerInfo *root, Oid relation_objectid, boo
 
 		if (ht != NULL && ht_oid != rte->relid && TS_HYPERTABLE_HAS_COMPRESSION(ht))
 		{
-			Chunk *chunk = ts_chunk_get_by_relid(rte->relid, 0, true);
+			Chunk *chunk = ts_planner_chunk_fetch(root, rel);
 
-			if (chunk->fd.compressed_chunk_id > 0)
+			if (chunk != NULL && chunk->fd.compressed_chunk_id > 0)
 			{
-				Assert(rel->fdw_private == NULL);
-				rel->fdw_private = palloc0(sizeof(TimescaleDBPrivate));
 				((TimescaleDBPrivate *) rel->fdw_private)->compressed = true;
 
 				/* Planning indexes are expensive, and if this is a compressed chunk, we
@@ -579,6 +654,20 @@ timescaledb_get_relation_info_hook(PlannerInfo *root, Oid relation_objectid, boo
 	}
 }
 
+static void
+timescaledb_get_relation_info_hook(PlannerInfo *root, Oid relation_objectid, bool inhparent,
+								   RelOptInfo *rel)
+{
+	instr_time start;
+
+	if (prev_get_relation_info_hook != NULL)
+		prev_get_relation_info_hook(root, relation_objectid, inhparent, rel);
+
+	ts_planner_phase_start(&start);
+	timescaledb_get_relation_info(root, relation_objectid, inhparent, rel);
+	ts_planner_phase_stop(PLANNER_PHASE_GET_RELATION_INFO, &start);
+}
+
 static bool
 involves_ts_hypertable_relid(PlannerInfo *root, Index relid)
 {
@@ -710,26 +799,12 @@ replace_hypertable_insert_paths(PlannerInfo *root, List *pathlist)
 }
 
 static void
-#if PG11_LT
-timescale_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage, RelOptInfo *input_rel,
-								  RelOptInfo *output_rel)
-{
-	Query *parse = root->parse;
-	bool partials_found = false;
-
-	if (prev_create_upper_paths_hook != NULL)
-		prev_create_upper_paths_hook(root, stage, input_rel, output_rel);
-#else
-timescale_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage, RelOptInfo *input_rel,
-								  RelOptInfo *output_rel, void *extra)
+timescale_create_upper_paths(PlannerInfo *root, UpperRelationKind stage, RelOptInfo *input_rel,
+							 RelOptInfo *output_rel)
 {
 	Query *parse = root->parse;
 	bool partials_found = false;
 
-	if (prev_create_upper_paths_hook != NULL)
-		prev_create_upper_paths_hook(root, stage, input_rel, output_rel, extra);
-#endif
-
 	if (!ts_extension_is_loaded())
 		return;
 
@@ -765,6 +840,30 @@ timescale_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage, Re
 	}
 }
 
+static void
+#if PG11_LT
+timescale_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage, RelOptInfo *input_rel,
+								  RelOptInfo *output_rel)
+{
+	instr_time start;
+
+	if (prev_create_upper_paths_hook != NULL)
+		prev_create_upper_paths_hook(root, stage, input_rel, output_rel);
+#else
+timescale_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage, RelOptInfo *input_rel,
+								  RelOptInfo *output_rel, void *extra)
+{
+	instr_time start;
+
+	if (prev_create_upper_paths_hook != NULL)
+		prev_create_upper_paths_hook(root, stage, input_rel, output_rel, extra);
+#endif
+
+	ts_planner_phase_start(&start);
+	timescale_create_upper_paths(root, stage, input_rel, output_rel);
+	ts_planner_phase_stop(PLANNER_PHASE_CREATE_UPPER_PATHS, &start);
+}
+
 static bool
 contain_param_exec_walker(Node *node, void *context)
 {
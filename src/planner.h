@@ -6,6 +6,11 @@
 #ifndef TIMESCALEDB_PLANNER_H
 #define TIMESCALEDB_PLANNER_H
 
+#include <postgres.h>
+#include <nodes/relation.h>
+
+#include "chunk.h"
+
 typedef struct TimescaleDBPrivate
 {
 	bool appends_ordered;
@@ -13,6 +18,12 @@ typedef struct TimescaleDBPrivate
 	int order_attno;
 	List *nested_oids;
 	bool compressed;
+	/* chunks found during expansion of a hypertable, indexed by child rtindex */
+	Chunk **chunks;
+	/* the chunk of a chunk relation, see ts_planner_chunk_fetch() */
+	Chunk *chunk;
 } TimescaleDBPrivate;
 
+extern TSDLLEXPORT Chunk *ts_planner_chunk_fetch(PlannerInfo *root, RelOptInfo *rel);
+
 #endif /* TIMESCALEDB_PLANNER_H */
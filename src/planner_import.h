@@ -31,8 +31,8 @@ extern size_t ts_estimate_hashagg_tablesize(struct Path *path,
 											const struct AggClauseCosts *agg_costs,
 											double dNumGroups);
 
-extern struct PathTarget *ts_make_partial_grouping_target(struct PlannerInfo *root,
-														  PathTarget *grouping_target);
+extern TSDLLEXPORT struct PathTarget *ts_make_partial_grouping_target(struct PlannerInfo *root,
+																	  PathTarget *grouping_target);
 
 extern bool ts_get_variable_range(PlannerInfo *root, VariableStatData *vardata, Oid sortop,
 								  Datum *min, Datum *max);
@@ -0,0 +1,312 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <commands/explain.h>
+#include <funcapi.h>
+#include <tcop/tcopprot.h>
+#include <utils/builtins.h>
+
+#include "compat.h"
+#include "export.h"
+#include "guc.h"
+#include "planner_instrumentation.h"
+
+/*
+ * Planner instrumentation.
+ *
+ * When timescaledb.enable_planner_instrumentation is set, the time spent in
+ * each of our planner hooks is measured, together with the number of chunks
+ * added by hypertable expansion. The numbers of the last planned statement
+ * are shown in a TimescaleDB section of EXPLAIN in text format, and the
+ * numbers of all planned statements are accumulated in
+ * timescaledb_information.planner_stats.
+ *
+ * Phase times are inclusive: the planner phase covers the whole planning of
+ * a statement, and hypertable expansion happens as part of
+ * get_relation_info. The time spent in hooks of other extensions is not
+ * included in the hook phases.
+ *
+ * The statistics are local to the backend since the extension cannot
+ * allocate shared memory.
+ */
+
+void _planner_instrumentation_init(void);
+void _planner_instrumentation_fini(void);
+
+typedef struct PlannerPhaseInstrumentation
+{
+	int64 calls;
+	instr_time time;
+} PlannerPhaseInstrumentation;
+
+typedef struct PlannerInstrumentation
+{
+	PlannerPhaseInstrumentation phases[_PLANNER_PHASE_MAX];
+	/* number of chunks added by hypertable expansion */
+	int64 chunks_expanded;
+	/* number of statements planned */
+	int64 statements;
+} PlannerInstrumentation;
+
+typedef struct PlannerPhaseName
+{
+	const char *name;
+	const char *label;
+} PlannerPhaseName;
+
+static const PlannerPhaseName phase_names[_PLANNER_PHASE_MAX] = {
+	[PLANNER_PHASE_PLANNER] = { "planner", "Planner" },
+	[PLANNER_PHASE_SET_REL_PATHLIST] = { "set_rel_pathlist", "Set Rel Pathlist" },
+	[PLANNER_PHASE_GET_RELATION_INFO] = { "get_relation_info", "Get Relation Info" },
+	[PLANNER_PHASE_EXPAND_HYPERTABLE] = { "expand_hypertable", "Hypertable Expansion" },
+	[PLANNER_PHASE_CREATE_UPPER_PATHS] = { "create_upper_paths", "Create Upper Paths" },
+};
+
+/* Is the statement currently being planned instrumented? */
+static bool instrumentation_active = false;
+static PlannerInstrumentation current_instr;
+static PlannerInstrumentation last_instr;
+static PlannerInstrumentation total_instr;
+
+static ExplainOneQuery_hook_type prev_ExplainOneQuery_hook;
+
+/*
+ * Start instrumenting the planning of a statement.
+ *
+ * Returns true if this is the outermost planner invocation and
+ * instrumentation is enabled, in which case the caller must call
+ * ts_planner_instrumentation_end() or ts_planner_instrumentation_abort() once
+ * planning is done. Nested planner invocations (e.g., when planning needs to
+ * evaluate a SQL function) are accounted to the outermost statement.
+ */
+bool
+ts_planner_instrumentation_begin(instr_time *start)
+{
+	if (instrumentation_active || !ts_guc_enable_planner_instrumentation)
+		return false;
+
+	memset(&current_instr, 0, sizeof(current_instr));
+	instrumentation_active = true;
+	INSTR_TIME_SET_CURRENT(*start);
+
+	return true;
+}
+
+static void
+instrumentation_accum(PlannerInstrumentation *dst, const PlannerInstrumentation *src)
+{
+	int i;
+
+	for (i = 0; i < _PLANNER_PHASE_MAX; i++)
+	{
+		dst->phases[i].calls += src->phases[i].calls;
+		INSTR_TIME_ADD(dst->phases[i].time, src->phases[i].time);
+	}
+
+	dst->chunks_expanded += src->chunks_expanded;
+	dst->statements += src->statements;
+}
+
+void
+ts_planner_instrumentation_end(instr_time *start)
+{
+	Assert(instrumentation_active);
+
+	ts_planner_phase_stop(PLANNER_PHASE_PLANNER, start);
+	current_instr.statements = 1;
+	last_instr = current_instr;
+	instrumentation_accum(&total_instr, &current_instr);
+	instrumentation_active = false;
+}
+
+/* Planning failed, so discard the numbers of the current statement */
+void
+ts_planner_instrumentation_abort(void)
+{
+	instrumentation_active = false;
+}
+
+void
+ts_planner_phase_start(instr_time *start)
+{
+	if (instrumentation_active)
+		INSTR_TIME_SET_CURRENT(*start);
+}
+
+void
+ts_planner_phase_stop(PlannerPhase phase, instr_time *start)
+{
+	instr_time duration;
+
+	if (!instrumentation_active)
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, *start);
+	INSTR_TIME_ADD(current_instr.phases[phase].time, duration);
+	current_instr.phases[phase].calls++;
+}
+
+void
+ts_planner_instrumentation_count_expansion(int nchunks)
+{
+	if (instrumentation_active)
+		current_instr.chunks_expanded += nchunks;
+}
+
+static void
+explain_planner_instrumentation(const PlannerInstrumentation *instr, ExplainState *es)
+{
+	int i;
+
+	Assert(es->format == EXPLAIN_FORMAT_TEXT);
+
+	appendStringInfoSpaces(es->str, es->indent * 2);
+	appendStringInfoString(es->str, "TimescaleDB Planning:\n");
+
+	for (i = 0; i < _PLANNER_PHASE_MAX; i++)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2 + 2);
+		appendStringInfo(es->str,
+						 "%s: time=%.3f ms calls=" INT64_FORMAT "\n",
+						 phase_names[i].label,
+						 INSTR_TIME_GET_MILLISEC(instr->phases[i].time),
+						 instr->phases[i].calls);
+	}
+
+	appendStringInfoSpaces(es->str, es->indent * 2 + 2);
+	appendStringInfo(es->str, "Chunks Expanded: " INT64_FORMAT "\n", instr->chunks_expanded);
+}
+
+/*
+ * Plan and explain a query, just like ExplainOneQuery() does, and append the
+ * planner instrumentation of the query to the output.
+ */
+static void
+#if PG96
+timescaledb_explain_one_query(Query *query, IntoClause *into, ExplainState *es,
+							  const char *queryString, ParamListInfo params)
+#else
+timescaledb_explain_one_query(Query *query, int cursorOptions, IntoClause *into, ExplainState *es,
+							  const char *queryString, ParamListInfo params,
+							  QueryEnvironment *queryEnv)
+#endif
+{
+	int64 statements = total_instr.statements;
+
+	if (prev_ExplainOneQuery_hook != NULL)
+#if PG96
+		prev_ExplainOneQuery_hook(query, into, es, queryString, params);
+#else
+		prev_ExplainOneQuery_hook(query, cursorOptions, into, es, queryString, params, queryEnv);
+#endif
+	else
+	{
+		PlannedStmt *plan;
+		instr_time planstart, planduration;
+
+		INSTR_TIME_SET_CURRENT(planstart);
+#if PG96
+		plan = pg_plan_query(query, into ? 0 : CURSOR_OPT_PARALLEL_OK, params);
+#else
+		plan = pg_plan_query(query, cursorOptions, params);
+#endif
+		INSTR_TIME_SET_CURRENT(planduration);
+		INSTR_TIME_SUBTRACT(planduration, planstart);
+
+#if PG96
+		ExplainOnePlan(plan, into, es, queryString, params, &planduration);
+#else
+		ExplainOnePlan(plan, into, es, queryString, params, queryEnv, &planduration);
+#endif
+	}
+
+	/*
+	 * Only show the numbers if the query was planned with instrumentation.
+	 * ExplainOnePlan() has closed the group of the query in the structured
+	 * formats, so the section cannot be added to it there.
+	 */
+	if (es->format == EXPLAIN_FORMAT_TEXT && total_instr.statements != statements)
+		explain_planner_instrumentation(&last_instr, es);
+}
+
+TS_FUNCTION_INFO_V1(ts_planner_stats);
+TS_FUNCTION_INFO_V1(ts_planner_stats_reset);
+
+/*
+ * Return the cumulative planner statistics of the backend, one row per
+ * planner phase.
+ */
+Datum
+ts_planner_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+
+	if (funcctx->call_cntr < _PLANNER_PHASE_MAX)
+	{
+		PlannerPhase phase = funcctx->call_cntr;
+		const PlannerPhaseInstrumentation *instr = &total_instr.phases[phase];
+		Datum values[4];
+		bool nulls[4] = { false };
+		HeapTuple tuple;
+
+		values[0] = CStringGetTextDatum(phase_names[phase].name);
+		values[1] = Int64GetDatum(instr->calls);
+		values[2] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(instr->time));
+
+		if (phase == PLANNER_PHASE_EXPAND_HYPERTABLE)
+			values[3] = Int64GetDatum(total_instr.chunks_expanded);
+		else
+			nulls[3] = true;
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+Datum
+ts_planner_stats_reset(PG_FUNCTION_ARGS)
+{
+	memset(&total_instr, 0, sizeof(total_instr));
+	PG_RETURN_VOID();
+}
+
+void
+_planner_instrumentation_init(void)
+{
+	prev_ExplainOneQuery_hook = ExplainOneQuery_hook;
+	ExplainOneQuery_hook = timescaledb_explain_one_query;
+}
+
+void
+_planner_instrumentation_fini(void)
+{
+	ExplainOneQuery_hook = prev_ExplainOneQuery_hook;
+}
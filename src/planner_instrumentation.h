@@ -0,0 +1,30 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#ifndef TIMESCALEDB_PLANNER_INSTRUMENTATION_H
+#define TIMESCALEDB_PLANNER_INSTRUMENTATION_H
+
+#include <postgres.h>
+#include <portability/instr_time.h>
+
+/* Planner phases that are timed when planner instrumentation is enabled */
+typedef enum PlannerPhase
+{
+	PLANNER_PHASE_PLANNER = 0,
+	PLANNER_PHASE_SET_REL_PATHLIST,
+	PLANNER_PHASE_GET_RELATION_INFO,
+	PLANNER_PHASE_EXPAND_HYPERTABLE,
+	PLANNER_PHASE_CREATE_UPPER_PATHS,
+	_PLANNER_PHASE_MAX,
+} PlannerPhase;
+
+extern bool ts_planner_instrumentation_begin(instr_time *start);
+extern void ts_planner_instrumentation_end(instr_time *start);
+extern void ts_planner_instrumentation_abort(void);
+extern void ts_planner_phase_start(instr_time *start);
+extern void ts_planner_phase_stop(PlannerPhase phase, instr_time *start);
+extern void ts_planner_instrumentation_count_expansion(int nchunks);
+
+#endif /* TIMESCALEDB_PLANNER_INSTRUMENTATION_H */
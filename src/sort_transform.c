@@ -13,8 +13,22 @@
 #include <optimizer/planner.h>
 #include <optimizer/paths.h>
 #include <utils/lsyscache.h>
+#include <utils/builtins.h>
+#include <utils/typcache.h>
+#include <catalog/pg_proc.h>
+#include <catalog/namespace.h>
+#include <utils/catcache.h>
+#include <utils/inval.h>
+#include <utils/memutils.h>
+#include <utils/syscache.h>
+
+#include "compat.h"
+#if !PG96
+#include <utils/varlena.h>
+#endif
 
 #include "func_cache.h"
+#include "guc.h"
 #include "sort_transform.h"
 
 /* This optimizations allows GROUP BY clauses that transform time in
@@ -111,6 +125,25 @@ transform_time_op_const_interval(OpExpr *op)
 	return (Expr *) op;
 }
 
+static bool
+int_const_is_non_negative(Const *c)
+{
+	if (c->constisnull)
+		return false;
+
+	switch (c->consttype)
+	{
+		case INT2OID:
+			return DatumGetInt16(c->constvalue) >= 0;
+		case INT4OID:
+			return DatumGetInt32(c->constvalue) >= 0;
+		case INT8OID:
+			return DatumGetInt64(c->constvalue) >= 0;
+		default:
+			return false;
+	}
+}
+
 static inline Expr *
 transform_int_op_const(OpExpr *op)
 {
@@ -119,8 +152,10 @@ transform_int_op_const(OpExpr *op)
 	 * of  some_int + const fulfilled by sort of some_int same for the
 	 * following operator: + - / *
 	 *
-	 * Note that / is not commutative and const / var does NOT work (namely it
-	 * reverses sort order, which we don't handle yet)
+	 * Note that - and / are not commutative and const - var or const / var
+	 * does NOT work (namely it reverses sort order, which we don't handle
+	 * yet). The same holds for multiplication or division by a negative
+	 * constant.
 	 */
 	if (list_length(op->args) == 2 &&
 		(IsA(lsecond(op->args), Const) || IsA(linitial(op->args), Const)))
@@ -132,49 +167,216 @@ transform_int_op_const(OpExpr *op)
 			(left == INT2OID && right == INT2OID))
 		{
 			char *name = get_opname(op->opno);
+			bool const_first = IsA(linitial(op->args), Const);
+			Const *c = const_first ? linitial(op->args) : lsecond(op->args);
+			Expr *nonconst = const_first ? lsecond(op->args) : linitial(op->args);
 
 			if (name[1] == '\0')
 			{
 				switch (name[0])
 				{
-					case '-':
 					case '+':
+						break;
 					case '*':
-						/* commutative cases */
-						if (IsA(linitial(op->args), Const))
-						{
-							Expr *nonconst = ts_sort_transform_expr((Expr *) lsecond(op->args));
-
-							if (IsA(nonconst, Var))
-								return copyObject(nonconst);
-						}
-						else
-						{
-							Expr *nonconst = ts_sort_transform_expr((Expr *) linitial(op->args));
-
-							if (IsA(nonconst, Var))
-								return copyObject(nonconst);
-						}
+						/* commutative, but only order preserving for c >= 0 */
+						if (!int_const_is_non_negative(c))
+							return (Expr *) op;
 						break;
-					case '/':
+					case '-':
 						/* only if second arg is const */
-						if (IsA(lsecond(op->args), Const))
-						{
-							Expr *nonconst = ts_sort_transform_expr((Expr *) linitial(op->args));
-
-							if (IsA(nonconst, Var))
-								return copyObject(nonconst);
-						}
+						if (const_first)
+							return (Expr *) op;
+						break;
+					case '/':
+						/* only if second arg is a non-negative const */
+						if (const_first || !int_const_is_non_negative(c))
+							return (Expr *) op;
 						break;
+					default:
+						return (Expr *) op;
 				}
+
+				nonconst = ts_sort_transform_expr(nonconst);
+
+				if (IsA(nonconst, Var))
+					return copyObject(nonconst);
 			}
 		}
 	}
 	return (Expr *) op;
 }
 
+/*
+ * Transform a function that is monotonically non-decreasing in one of its
+ * arguments when all other arguments are constant.
+ *
+ * f(const, var) => var
+ *
+ * proof: f(c, time1) > f(c, time2) implies time1 > time2 for any function
+ * that is non-decreasing in its second argument
+ */
+Expr *
+ts_sort_transform_func_arg(FuncExpr *func, int argno)
+{
+	ListCell *lc;
+	Expr *transformed;
+	int i = 0;
+
+	if (argno < 0 || argno >= list_length(func->args))
+		return (Expr *) func;
+
+	foreach (lc, func->args)
+	{
+		if (i++ != argno && !IsA(lfirst(lc), Const))
+			return (Expr *) func;
+	}
+
+	transformed = ts_sort_transform_expr(list_nth(func->args, argno));
+
+	if (!IsA(transformed, Var))
+		return (Expr *) func;
+
+	return (Expr *) copyObject(transformed);
+}
+
+/*
+ * OIDs of the functions registered through the timescaledb.monotonic_functions
+ * setting. The setting is parsed and the names resolved on first use after
+ * the setting changed or pg_proc was modified, since the assign hook of the
+ * setting might run outside of a transaction.
+ */
+static List *monotonic_func_oids = NIL;
+static bool monotonic_func_oids_valid = false;
+static bool monotonic_func_callback_registered = false;
+
+void
+ts_sort_transform_monotonic_funcs_invalidate(void)
+{
+	monotonic_func_oids_valid = false;
+}
+
+static void
+monotonic_funcs_syscache_callback(Datum arg, int cacheid, uint32 hashvalue)
+{
+	ts_sort_transform_monotonic_funcs_invalidate();
+}
+
+/*
+ * Add the OIDs of all functions matching the name to the list. The name is
+ * either a plain function name, matching functions in any schema, or a
+ * schema-qualified function name. All overloads of the function match.
+ */
+static List *
+monotonic_func_oids_add(List *oids, char *name)
+{
+	char *funcname = strrchr(name, '.');
+	Oid namespace_oid = InvalidOid;
+	CatCList *catlist;
+	int i;
+
+	if (funcname != NULL)
+	{
+		*funcname++ = '\0';
+		namespace_oid = get_namespace_oid(name, true);
+
+		if (!OidIsValid(namespace_oid))
+			return oids;
+	}
+	else
+		funcname = name;
+
+	catlist = SearchSysCacheList1(PROCNAMEARGSNSP, CStringGetDatum(funcname));
+
+	for (i = 0; i < catlist->n_members; i++)
+	{
+		HeapTuple proctup = &catlist->members[i]->tuple;
+		Form_pg_proc procform = (Form_pg_proc) GETSTRUCT(proctup);
+
+		if (!OidIsValid(namespace_oid) || procform->pronamespace == namespace_oid)
+			oids = lappend_oid(oids, HeapTupleGetOid(proctup));
+	}
+
+	ReleaseSysCacheList(catlist);
+
+	return oids;
+}
+
+static List *
+monotonic_func_oids_get(void)
+{
+	char *rawstring;
+	List *namelist;
+	List *oids = NIL;
+	ListCell *lc;
+	MemoryContext old;
+
+	if (monotonic_func_oids_valid)
+		return monotonic_func_oids;
+
+	if (!monotonic_func_callback_registered)
+	{
+		CacheRegisterSyscacheCallback(PROCOID, monotonic_funcs_syscache_callback, (Datum) 0);
+		monotonic_func_callback_registered = true;
+	}
+
+	list_free(monotonic_func_oids);
+	monotonic_func_oids = NIL;
+
+	if (ts_guc_monotonic_functions != NULL && ts_guc_monotonic_functions[0] != '\0')
+	{
+		rawstring = pstrdup(ts_guc_monotonic_functions);
+
+		/* syntax was validated when the setting was assigned */
+		if (SplitIdentifierString(rawstring, ',', &namelist))
+		{
+			foreach (lc, namelist)
+				oids = monotonic_func_oids_add(oids, lfirst(lc));
+		}
+
+		old = MemoryContextSwitchTo(CacheMemoryContext);
+		monotonic_func_oids = list_copy(oids);
+		MemoryContextSwitchTo(old);
+	}
+
+	monotonic_func_oids_valid = true;
+
+	return monotonic_func_oids;
+}
+
+static Expr *
+transform_registered_monotonic_func(FuncExpr *func)
+{
+	/*
+	 * User-registered functions are monotonically non-decreasing in their
+	 * only non-constant argument. We only trust this for immutable strict
+	 * functions so that NULLs sort like they do for the argument.
+	 */
+	ListCell *lc;
+	int argno = -1;
+	int i = 0;
+
+	if (func_volatile(func->funcid) != PROVOLATILE_IMMUTABLE || !func_strict(func->funcid))
+		return (Expr *) func;
+
+	foreach (lc, func->args)
+	{
+		if (!IsA(lfirst(lc), Const))
+		{
+			if (argno >= 0)
+				return (Expr *) func;
+			argno = i;
+		}
+		i++;
+	}
+
+	return ts_sort_transform_func_arg(func, argno);
+}
+
 /* sort_transforms_expr returns a simplified sort expression in a form
- * more common for indexes. Must return same data type & collation too.
+ * more common for indexes. The returned expression might have a different
+ * data type than the original one (e.g., when transforming
+ * date_part('epoch', time)), in which case it is ordered by the default btree
+ * ordering of its type.
  *
  * Sort transforms have the following correctness condition:
  *	Any ordering provided by the returned expression is a valid
@@ -196,7 +398,7 @@ ts_sort_transform_expr(Expr *orig_expr)
 	{
 		FuncExpr *func = (FuncExpr *) orig_expr;
 		char *func_name = get_func_name(func->funcid);
-		FuncInfo *finfo = ts_func_cache_get_bucketing_func(func->funcid);
+		FuncInfo *finfo = ts_func_cache_get(func->funcid);
 
 		if (NULL != finfo)
 		{
@@ -210,6 +412,8 @@ ts_sort_transform_expr(Expr *orig_expr)
 			return transform_timestamp_cast(func);
 		if (strncmp(func_name, "timestamptz", NAMEDATALEN) == 0)
 			return transform_timestamptz_cast(func);
+		if (list_member_oid(monotonic_func_oids_get(), func->funcid))
+			return transform_registered_monotonic_func(func);
 	}
 	if (IsA(orig_expr, OpExpr))
 	{
@@ -228,6 +432,29 @@ ts_sort_transform_expr(Expr *orig_expr)
 	return orig_expr;
 }
 
+/*
+ * Get the btree operator families to order the transformed expression by.
+ *
+ * If the transformed expression has a different type than the original
+ * expression, e.g., date_part('epoch', time) transformed to time, the
+ * operator families of the original expression might not apply. In that case
+ * the default btree operator family of the new type is used. Returns NIL if
+ * the type has no btree ordering.
+ */
+static List *
+sort_transform_opfamilies(EquivalenceClass *orig, Oid type_oid)
+{
+	TypeCacheEntry *tce = lookup_type_cache(type_oid, TYPECACHE_BTREE_OPFAMILY);
+
+	if (!OidIsValid(tce->btree_opf))
+		return NIL;
+
+	if (list_member_oid(orig->ec_opfamilies, tce->btree_opf))
+		return list_copy(orig->ec_opfamilies);
+
+	return list_make1_oid(tce->btree_opf);
+}
+
 /*	sort_transform_ec creates a new EquivalenceClass with transformed
  *	expressions if any of the members of the original EC can be transformed for the sort.
  */
@@ -248,7 +475,10 @@ sort_transform_ec(PlannerInfo *root, EquivalenceClass *orig)
 		{
 			EquivalenceMember *em;
 			Oid type_oid = exprType((Node *) transformed_expr);
-			List *opfamilies = list_copy(orig->ec_opfamilies);
+			List *opfamilies = sort_transform_opfamilies(orig, type_oid);
+
+			if (opfamilies == NIL)
+				continue;
 
 			/*
 			 * if the transform already exists for even one member, assume
@@ -355,7 +585,10 @@ ts_sort_transform_optimization(PlannerInfo *root, RelOptInfo *rel)
 
 	new_pk = make_canonical_pathkey(root,
 									transformed,
-									last_pk->pk_opfamily,
+									list_member_oid(transformed->ec_opfamilies,
+													last_pk->pk_opfamily) ?
+										last_pk->pk_opfamily :
+										linitial_oid(transformed->ec_opfamilies),
 									last_pk->pk_strategy,
 									last_pk->pk_nulls_first);
 
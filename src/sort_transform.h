@@ -7,7 +7,10 @@
 #define TIMESCALEDB_SORT_TRANSFORM_H
 
 #include <postgres.h>
+#include <nodes/primnodes.h>
 
 extern Expr *ts_sort_transform_expr(Expr *expr);
+extern Expr *ts_sort_transform_func_arg(FuncExpr *func, int argno);
+extern void ts_sort_transform_monotonic_funcs_invalidate(void);
 
 #endif /* TIMESCALEDB_SORT_TRANSFORM_H */
@@ -328,3 +328,43 @@ DROP INDEX :INDEX_NAME;
 
 DROP TABLE join_limit;
 
+
+-- test startup and runtime exclusion on chunks with CHECK constraints
+-- that are not dimension constraints. The single space partition has an
+-- unbounded slice, which does not get a CHECK constraint on the chunks.
+CREATE TABLE exclusion_check(time timestamptz NOT NULL CHECK (time >= '2000-01-01'), device_id int NOT NULL, value float);
+SELECT table_name FROM create_hypertable('exclusion_check','time','device_id',1,create_default_indexes:=false);
+INSERT INTO exclusion_check SELECT time, 1, 1.0 FROM generate_series('2000-01-01'::timestamptz,'2000-01-21','1d') g(time);
+ANALYZE exclusion_check;
+
+-- all chunks should be excluded during startup, the first chunk by
+-- the CHECK constraint on time
+:PREFIX SELECT * FROM exclusion_check WHERE time < '2000-01-01'::text::timestamptz;
+:PREFIX SELECT * FROM exclusion_check WHERE time > now();
+
+-- runtime exclusion in a parameterized nested loop should skip the
+-- first chunk for the value refuted by the CHECK constraint
+:PREFIX SELECT g.time, e.value FROM generate_series('1999-12-31'::timestamptz, '2000-01-06'::timestamptz, '1d'::interval) g(time) LEFT JOIN LATERAL(SELECT value FROM exclusion_check e WHERE e.time = g.time LIMIT 1) e ON true;
+
+-- with constraint_exclusion off, the CHECK constraint must not exclude
+-- the first chunk, only the dimension slices are used
+SET constraint_exclusion TO off;
+:PREFIX SELECT * FROM exclusion_check WHERE time < '2000-01-01'::text::timestamptz;
+RESET constraint_exclusion;
+
+DROP TABLE exclusion_check;
+
+-- test startup exclusion of space partitions with ANY on a parameter in
+-- a generic plan. The first 5 executions use custom plans that cover all
+-- chunks, after that the cheaper generic plan is used.
+PREPARE space_any(int[]) AS SELECT count(*) FROM metrics_space WHERE device_id = ANY($1);
+EXECUTE space_any(ARRAY[1,2,3,4,5,6,7,8,9,10]);
+EXECUTE space_any(ARRAY[1,2,3,4,5,6,7,8,9,10]);
+EXECUTE space_any(ARRAY[1,2,3,4,5,6,7,8,9,10]);
+EXECUTE space_any(ARRAY[1,2,3,4,5,6,7,8,9,10]);
+EXECUTE space_any(ARRAY[1,2,3,4,5,6,7,8,9,10]);
+-- should exclude the chunks of the space partition without device 1 and 2
+:PREFIX EXECUTE space_any(ARRAY[1,2]);
+-- should only scan the chunks of the space partition of device 1
+:PREFIX EXECUTE space_any(ARRAY[1]);
+DEALLOCATE space_any;
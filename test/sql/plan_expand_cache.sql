@@ -0,0 +1,50 @@
+-- This file and its contents are licensed under the Apache License 2.0.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-APACHE for a copy of the license.
+
+\c :TEST_DBNAME :ROLE_SUPERUSER
+CREATE OR REPLACE FUNCTION ts_test_plan_expand_cache_stats(OUT entries BIGINT, OUT hits BIGINT, OUT misses BIGINT)
+AS :MODULE_PATHNAME LANGUAGE C VOLATILE;
+\c :TEST_DBNAME :ROLE_DEFAULT_PERM_USER
+
+CREATE TABLE expand(time timestamptz NOT NULL, device int);
+SELECT table_name FROM create_hypertable('expand', 'time', chunk_time_interval => interval '1 day');
+INSERT INTO expand VALUES ('2000-01-01 12:00', 1), ('2000-01-02 12:00', 2);
+
+-- the first planning of a restriction fills the cache and the second one hits it
+SELECT count(*) FROM expand WHERE time > '2000-01-01';
+SELECT * FROM ts_test_plan_expand_cache_stats();
+SELECT count(*) FROM expand WHERE time > '2000-01-01';
+SELECT * FROM ts_test_plan_expand_cache_stats();
+
+-- inserting into an existing chunk keeps the cache
+INSERT INTO expand VALUES ('2000-01-02 13:00', 3);
+SELECT * FROM ts_test_plan_expand_cache_stats();
+
+-- creating a chunk flushes the cache, so the new chunk is found
+INSERT INTO expand VALUES ('2000-01-03 12:00', 4);
+SELECT * FROM ts_test_plan_expand_cache_stats();
+SELECT count(*) FROM expand WHERE time > '2000-01-01';
+SELECT * FROM ts_test_plan_expand_cache_stats();
+
+-- dropping a chunk flushes the cache, so the dropped chunk is not used
+SELECT count(*) FROM drop_chunks(older_than => '2000-01-02'::timestamptz, table_name => 'expand');
+SELECT * FROM ts_test_plan_expand_cache_stats();
+SELECT count(*) FROM expand WHERE time > '2000-01-01';
+SELECT count(*) FROM expand WHERE time > '2000-01-01';
+SELECT * FROM ts_test_plan_expand_cache_stats();
+
+-- an unrelated relation does not flush the cache
+CREATE TABLE unrelated(time timestamptz);
+ALTER TABLE unrelated ADD COLUMN value int;
+SELECT * FROM ts_test_plan_expand_cache_stats();
+
+-- restrictions that match the same slices share an entry
+SELECT count(*) FROM expand WHERE time > '2000-01-02 06:00';
+SELECT count(*) FROM expand WHERE time > '2000-01-02 07:00' AND time < '2000-01-03 06:00';
+SELECT * FROM ts_test_plan_expand_cache_stats();
+SELECT count(*) FROM expand WHERE time > '2000-01-03';
+SELECT * FROM ts_test_plan_expand_cache_stats();
+
+DROP TABLE unrelated;
+DROP TABLE expand;
@@ -0,0 +1,60 @@
+-- This file and its contents are licensed under the Apache License 2.0.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-APACHE for a copy of the license.
+
+-- the planning times vary between runs, so they are filtered out
+CREATE OR REPLACE FUNCTION explain_planning(query TEXT) RETURNS SETOF TEXT
+LANGUAGE PLPGSQL AS
+$BODY$
+DECLARE
+  line TEXT;
+BEGIN
+  FOR line IN EXECUTE format('EXPLAIN (costs off) %s', query) LOOP
+    RETURN NEXT regexp_replace(line, 'time=[0-9.]+ ms', 'time=X ms');
+  END LOOP;
+END
+$BODY$;
+
+CREATE OR REPLACE FUNCTION explain_format(query TEXT, output_format TEXT) RETURNS TEXT
+LANGUAGE PLPGSQL AS
+$BODY$
+DECLARE
+  plan TEXT;
+BEGIN
+  EXECUTE format('EXPLAIN (costs off, format %s) %s', output_format, query) INTO plan;
+  RETURN plan;
+END
+$BODY$;
+
+CREATE TABLE planning(time timestamptz NOT NULL, device int, value float);
+SELECT table_name FROM create_hypertable('planning', 'time');
+INSERT INTO planning VALUES ('2000-01-01', 1, 1.0), ('2000-02-01', 2, 2.0);
+
+-- no planning section without instrumentation
+EXPLAIN (costs off) SELECT * FROM planning;
+
+CREATE TABLE explain_formats AS
+SELECT output_format, explain_format('SELECT * FROM planning', output_format) AS plan
+FROM unnest(ARRAY['json', 'xml', 'yaml']) output_format;
+
+SET timescaledb.enable_planner_instrumentation TO on;
+SELECT * FROM explain_planning('SELECT * FROM planning');
+
+-- the structured formats have no planning section, so that their output is
+-- the same as without instrumentation
+SELECT output_format, explain_format('SELECT * FROM planning', output_format) = plan AS unchanged
+FROM explain_formats ORDER BY output_format;
+SELECT json_object_keys(explain_format('SELECT * FROM planning', 'json')::json->0);
+
+-- the statistics accumulate over all planned statements until reset
+SELECT _timescaledb_internal.planner_stats_reset();
+SELECT * FROM planning;
+RESET timescaledb.enable_planner_instrumentation;
+SELECT phase, calls, chunks FROM timescaledb_information.planner_stats;
+SELECT _timescaledb_internal.planner_stats_reset();
+SELECT phase, calls, total_time, mean_time, chunks FROM timescaledb_information.planner_stats;
+
+DROP TABLE planning;
+DROP TABLE explain_formats;
+DROP FUNCTION explain_planning(TEXT);
+DROP FUNCTION explain_format(TEXT, TEXT);
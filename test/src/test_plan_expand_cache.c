@@ -0,0 +1,40 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#include <postgres.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <access/htup_details.h>
+
+#include "export.h"
+#include "plan_expand_cache.h"
+
+TS_FUNCTION_INFO_V1(ts_test_plan_expand_cache_stats);
+
+/*
+ * Return the number of entries of the hypertable expansion cache and the
+ * number of lookups that hit or missed the cache in this backend.
+ */
+Datum
+ts_test_plan_expand_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	Datum values[3];
+	bool nulls[3] = { false };
+	int64 entries;
+	int64 hits;
+	int64 misses;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "function returning record called in context that cannot accept type record");
+
+	ts_plan_expand_cache_stats(&entries, &hits, &misses);
+
+	values[0] = Int64GetDatum(entries);
+	values[1] = Int64GetDatum(hits);
+	values[2] = Int64GetDatum(misses);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc), values, nulls)));
+}
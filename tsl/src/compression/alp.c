@@ -0,0 +1,900 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "compression/alp.h"
+
+#include <math.h>
+#include <catalog/pg_type.h>
+#include <utils/builtins.h>
+#include <utils/memutils.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+
+#include <compat.h>
+
+#include "compression/compression.h"
+#include "compression/deltadelta.h"
+#include "compression/gorilla.h"
+#include "compression/pfor.h"
+#include "compression/simd.h"
+#include "compression/simple8b_rle.h"
+#include "compression/utils.h"
+
+#define ALP_MAX_EXPONENT 18
+
+/*
+ * Scaled values must stay within +-2^51 so that they are exact as doubles and
+ * can be converted back to doubles with the magic number below.
+ */
+#define ALP_MAX_ENCODED ((double) (INT64CONST(1) << 51))
+
+/*
+ * Adding 1.5 * 2^52 to an integer within +-2^51 makes it the mantissa of a
+ * double in [2^52, 2^53], so the integer is converted by adding the bits of
+ * the magic number and subtracting the magic number as a double.
+ */
+#define ALP_MAGIC 6755399441055744.0
+#define ALP_MAGIC_BITS INT64CONST(0x4338000000000000)
+
+/* number of values the exponent is chosen on */
+#define ALP_SAMPLE_SIZE 256
+
+/* use gorilla if more than one in ALP_MAX_EXCEPTION_RATIO values is an exception */
+#define ALP_MAX_EXCEPTION_RATIO 4
+
+static const double alp_powers_of_ten[ALP_MAX_EXPONENT + 1] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+};
+
+typedef struct AlpCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_nulls;	  /* 1 if this has a NULLs bitmap after the exceptions, 0 otherwise */
+	uint8 exponent;		  /* the values are multiplied by 10^exponent */
+	uint8 has_exceptions; /* 1 if this has exceptions after the integers, 0 otherwise */
+	/*
+	 * the integers as a deltadelta or pfor compressed datum, padded to a
+	 * multiple of 8 bytes, the simple8b streams of exception positions and
+	 * exception values if there are exceptions, and the simple8b stream of NULL
+	 * flags if there are NULLs
+	 */
+	uint64 data[FLEXIBLE_ARRAY_MEMBER];
+} AlpCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	AlpCompressed test_val = { { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(AlpCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.exponent) +
+							 sizeof(test_val.has_exceptions),
+					 "AlpCompressed wrong size");
+	StaticAssertStmt(sizeof(AlpCompressed) == 8, "AlpCompressed wrong size");
+}
+
+/* the parts of an AlpCompressed */
+typedef struct AlpParts
+{
+	uint32 exponent;
+	CompressedDataHeader *integers;
+	Simple8bRleSerialized *exception_positions;
+	Simple8bRleSerialized *exceptions;
+	Simple8bRleSerialized *nulls;
+} AlpParts;
+
+typedef struct AlpDecompressionIterator
+{
+	DecompressionIterator base;
+	uint64 *values;
+	int64 position;
+	uint32 num_values;
+	Simple8bRleDecompressionIterator nulls;
+	bool has_nulls;
+} AlpDecompressionIterator;
+
+typedef struct AlpCompressor
+{
+	Oid element_type;
+	double *values;
+	uint32 num_values;
+	uint32 max_values;
+	Simple8bRleCompressor nulls;
+	bool has_nulls;
+} AlpCompressor;
+
+typedef struct ExtendedCompressor
+{
+	Compressor base;
+	AlpCompressor *internal;
+	Oid element_type;
+} ExtendedCompressor;
+
+/********************
+ *****  UTILS  *****
+ ********************/
+
+/* the bits of a value as stored for its type */
+static inline uint64
+alp_value_bits(double value, bool is_float4)
+{
+	return is_float4 ? float_get_bits((float) value) : double_get_bits(value);
+}
+
+static inline uint64
+alp_decode_value(int64 encoded, uint32 exponent, bool is_float4)
+{
+	/* dividing by an exact power of ten gives back decimal numbers exactly */
+	return alp_value_bits((double) encoded / alp_powers_of_ten[exponent], is_float4);
+}
+
+/*
+ * Scale a value to an integer with the given exponent. Returns false if the
+ * value does not decode back to the same bits, e.g., because it has more
+ * decimals, is out of range, or is NaN, infinite or negative zero.
+ */
+static inline bool
+alp_encode_value(double value, uint32 exponent, bool is_float4, int64 *encoded)
+{
+	double scaled = value * alp_powers_of_ten[exponent];
+
+	/* also false for NaN */
+	if (!(scaled >= -ALP_MAX_ENCODED && scaled <= ALP_MAX_ENCODED))
+		return false;
+
+	*encoded = (int64) rint(scaled);
+	return alp_decode_value(*encoded, exponent, is_float4) == alp_value_bits(value, is_float4);
+}
+
+static void
+alp_parts_from_compressed(AlpCompressed *compressed, AlpParts *parts)
+{
+	const char *data = (const char *) compressed->data;
+
+	*parts = (AlpParts){
+		.exponent = compressed->exponent,
+		.integers = (CompressedDataHeader *) data,
+	};
+
+	if (parts->exponent > ALP_MAX_EXPONENT)
+		elog(ERROR, "invalid exponent %u in alp", parts->exponent);
+
+	if (parts->integers->compression_algorithm != COMPRESSION_ALGORITHM_DELTADELTA &&
+		parts->integers->compression_algorithm != COMPRESSION_ALGORITHM_PFOR)
+		elog(ERROR,
+			 "invalid compression algorithm %d for alp integers",
+			 parts->integers->compression_algorithm);
+
+	data += TYPEALIGN(sizeof(uint64), VARSIZE(parts->integers));
+
+	if (compressed->has_exceptions)
+	{
+		parts->exception_positions = bytes_deserialize_simple8b_and_advance(&data);
+		parts->exceptions = bytes_deserialize_simple8b_and_advance(&data);
+	}
+	else
+		Assert(compressed->has_exceptions == 0);
+
+	if (compressed->has_nulls)
+		parts->nulls = bytes_deserialize_simple8b_and_advance(&data);
+	else
+		Assert(compressed->has_nulls == 0);
+}
+
+/******************************
+ ***  Compressor  ***
+ ******************************/
+
+static void
+alp_compressor_append_float4(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = alp_compressor_alloc(extended->element_type);
+
+	alp_compressor_append_value(extended->internal, DatumGetFloat4(val));
+}
+
+static void
+alp_compressor_append_float8(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = alp_compressor_alloc(extended->element_type);
+
+	alp_compressor_append_value(extended->internal, DatumGetFloat8(val));
+}
+
+static void
+alp_compressor_append_null_value(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = alp_compressor_alloc(extended->element_type);
+
+	alp_compressor_append_null(extended->internal);
+}
+
+static void *
+alp_compressor_finish_and_reset(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	void *compressed = alp_compressor_finish(extended->internal);
+	pfree(extended->internal->values);
+	pfree(extended->internal);
+	extended->internal = NULL;
+	return compressed;
+}
+
+const Compressor alp_float_compressor = {
+	.append_val = alp_compressor_append_float4,
+	.append_null = alp_compressor_append_null_value,
+	.finish = alp_compressor_finish_and_reset,
+};
+
+const Compressor alp_double_compressor = {
+	.append_val = alp_compressor_append_float8,
+	.append_null = alp_compressor_append_null_value,
+	.finish = alp_compressor_finish_and_reset,
+};
+
+Compressor *
+alp_compressor_for_type(Oid element_type)
+{
+	ExtendedCompressor *compressor = palloc(sizeof(*compressor));
+	switch (element_type)
+	{
+		case FLOAT4OID:
+			*compressor = (ExtendedCompressor){ .base = alp_float_compressor,
+												.element_type = element_type };
+			return &compressor->base;
+		case FLOAT8OID:
+			*compressor = (ExtendedCompressor){ .base = alp_double_compressor,
+												.element_type = element_type };
+			return &compressor->base;
+		default:
+			elog(ERROR, "invalid type for alp compressor %d", element_type);
+	}
+}
+
+AlpCompressor *
+alp_compressor_alloc(Oid element_type)
+{
+	AlpCompressor *compressor = palloc0(sizeof(*compressor));
+	compressor->element_type = element_type;
+	compressor->max_values = ALP_SAMPLE_SIZE;
+	compressor->values = palloc(sizeof(double) * compressor->max_values);
+	simple8brle_compressor_init(&compressor->nulls);
+	return compressor;
+}
+
+void
+alp_compressor_append_null(AlpCompressor *compressor)
+{
+	compressor->has_nulls = true;
+	simple8brle_compressor_append(&compressor->nulls, 1);
+}
+
+void
+alp_compressor_append_value(AlpCompressor *compressor, double next_val)
+{
+	if (compressor->num_values == compressor->max_values)
+	{
+		compressor->max_values *= 2;
+		compressor->values = repalloc(compressor->values, sizeof(double) * compressor->max_values);
+	}
+
+	compressor->values[compressor->num_values++] = next_val;
+	simple8brle_compressor_append(&compressor->nulls, 0);
+}
+
+/*
+ * Choose the exponent that makes the fewest values of a sample exceptions.
+ * Larger exponents only help values with more decimals, so the smallest one
+ * is taken among equals, which also keeps the integers small.
+ */
+static uint32
+alp_choose_exponent(const double *values, uint32 num_values, bool is_float4)
+{
+	uint32 step = Max(1, num_values / ALP_SAMPLE_SIZE);
+	uint32 best_exponent = 0;
+	uint32 best_exceptions = PG_UINT32_MAX;
+	uint32 exponent;
+
+	for (exponent = 0; exponent <= ALP_MAX_EXPONENT && best_exceptions > 0; exponent++)
+	{
+		uint32 exceptions = 0;
+		uint32 i;
+
+		for (i = 0; i < num_values; i += step)
+		{
+			int64 encoded;
+
+			if (!alp_encode_value(values[i], exponent, is_float4, &encoded))
+				exceptions++;
+		}
+
+		if (exceptions < best_exceptions)
+		{
+			best_exponent = exponent;
+			best_exceptions = exceptions;
+		}
+	}
+
+	return best_exponent;
+}
+
+/* compress values that are not decimal numbers with gorilla instead */
+static void *
+alp_compressor_to_gorilla(AlpCompressor *compressor, Simple8bRleSerialized *nulls)
+{
+	Compressor *gorilla = gorilla_compressor_for_type(compressor->element_type);
+	uint64 *null_flags = NULL;
+	uint32 num_rows = compressor->num_values;
+	uint32 value = 0;
+	uint32 row;
+
+	if (compressor->has_nulls)
+	{
+		null_flags = palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(
+												 nulls->num_elements));
+		num_rows = simple8brle_decompress_all_forward(nulls, null_flags);
+	}
+
+	for (row = 0; row < num_rows; row++)
+	{
+		if (null_flags != NULL && null_flags[row] != 0)
+			gorilla->append_null(gorilla);
+		else if (compressor->element_type == FLOAT4OID)
+			gorilla->append_val(gorilla, Float4GetDatum((float4) compressor->values[value++]));
+		else
+			gorilla->append_val(gorilla, Float8GetDatum(compressor->values[value++]));
+	}
+
+	Assert(value == compressor->num_values);
+	return gorilla->finish(gorilla);
+}
+
+static AlpCompressed *
+alp_from_parts(uint32 exponent, CompressedDataHeader *integers,
+			   Simple8bRleSerialized *exception_positions, Simple8bRleSerialized *exceptions,
+			   Simple8bRleSerialized *nulls)
+{
+	Size integers_size = VARSIZE(integers);
+	Size positions_size = 0;
+	Size exceptions_size = 0;
+	Size nulls_size = 0;
+	Size compressed_size;
+	char *compressed_data;
+	AlpCompressed *compressed;
+
+	if (exception_positions != NULL)
+	{
+		positions_size = simple8brle_serialized_total_size(exception_positions);
+		exceptions_size = simple8brle_serialized_total_size(exceptions);
+	}
+	if (nulls != NULL)
+		nulls_size = simple8brle_serialized_total_size(nulls);
+
+	compressed_size = sizeof(AlpCompressed) + TYPEALIGN(sizeof(uint64), integers_size) +
+					  positions_size + exceptions_size + nulls_size;
+
+	if (!AllocSizeIsValid(compressed_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	compressed_data = palloc0(compressed_size);
+	compressed = (AlpCompressed *) compressed_data;
+	SET_VARSIZE(&compressed->vl_len_, compressed_size);
+
+	compressed->compression_algorithm = COMPRESSION_ALGORITHM_ALP;
+	compressed->has_nulls = nulls_size != 0 ? 1 : 0;
+	compressed->exponent = exponent;
+	compressed->has_exceptions = positions_size != 0 ? 1 : 0;
+
+	compressed_data = (char *) compressed->data;
+	memcpy(compressed_data, integers, integers_size);
+	compressed_data += TYPEALIGN(sizeof(uint64), integers_size);
+
+	if (compressed->has_exceptions)
+	{
+		compressed_data = bytes_serialize_simple8b_and_advance(compressed_data,
+															   positions_size,
+															   exception_positions);
+		compressed_data =
+			bytes_serialize_simple8b_and_advance(compressed_data, exceptions_size, exceptions);
+	}
+
+	if (compressed->has_nulls)
+		bytes_serialize_simple8b_and_advance(compressed_data, nulls_size, nulls);
+
+	return compressed;
+}
+
+/*
+ * Compress the values as integers with the exponent chosen on a sample. The
+ * integers of exceptions repeat the previous integer, so that they do not
+ * disturb the compression of the integers.
+ */
+void *
+alp_compressor_finish(AlpCompressor *compressor)
+{
+	bool is_float4 = compressor->element_type == FLOAT4OID;
+	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
+	Simple8bRleCompressor exception_positions;
+	Simple8bRleCompressor exceptions;
+	Compressor *deltadelta;
+	Compressor *pfor;
+	CompressedDataHeader *deltadelta_integers;
+	CompressedDataHeader *pfor_integers;
+	CompressedDataHeader *integers;
+	int64 *encoded;
+	int64 last_encoded = 0;
+	uint32 num_exceptions = 0;
+	uint32 last_exception = 0;
+	uint32 exponent;
+	uint32 i;
+	AlpCompressed *compressed;
+
+	if (compressor->num_values == 0)
+		return NULL;
+
+	exponent = alp_choose_exponent(compressor->values, compressor->num_values, is_float4);
+
+	simple8brle_compressor_init(&exception_positions);
+	simple8brle_compressor_init(&exceptions);
+	encoded = palloc(sizeof(int64) * compressor->num_values);
+
+	for (i = 0; i < compressor->num_values; i++)
+	{
+		if (alp_encode_value(compressor->values[i], exponent, is_float4, &encoded[i]))
+		{
+			last_encoded = encoded[i];
+			continue;
+		}
+
+		simple8brle_compressor_append(&exception_positions, i - last_exception);
+		simple8brle_compressor_append(&exceptions,
+									  alp_value_bits(compressor->values[i], is_float4));
+		encoded[i] = last_encoded;
+		last_exception = i;
+		num_exceptions++;
+	}
+
+	if ((uint64) num_exceptions * ALP_MAX_EXCEPTION_RATIO > compressor->num_values)
+	{
+		pfree(encoded);
+		return alp_compressor_to_gorilla(compressor, nulls);
+	}
+
+	/* decimal numbers are either smooth or from a narrow range */
+	deltadelta = delta_delta_compressor_for_type(INT8OID);
+	pfor = pfor_compressor_for_type(INT8OID);
+	for (i = 0; i < compressor->num_values; i++)
+	{
+		deltadelta->append_val(deltadelta, Int64GetDatum(encoded[i]));
+		pfor->append_val(pfor, Int64GetDatum(encoded[i]));
+	}
+
+	deltadelta_integers = deltadelta->finish(deltadelta);
+	pfor_integers = pfor->finish(pfor);
+	if (VARSIZE(pfor_integers) < VARSIZE(deltadelta_integers))
+		integers = pfor_integers;
+	else
+		integers = deltadelta_integers;
+
+	compressed = alp_from_parts(exponent,
+								integers,
+								simple8brle_compressor_finish(&exception_positions),
+								simple8brle_compressor_finish(&exceptions),
+								compressor->has_nulls ? nulls : NULL);
+
+	pfree(encoded);
+	pfree(deltadelta_integers);
+	pfree(pfor_integers);
+
+	Assert(compressed->compression_algorithm == COMPRESSION_ALGORITHM_ALP);
+	return compressed;
+}
+
+/******************************
+ ***  Decompression  ***
+ ******************************/
+
+typedef void (*AlpDecodeFunc)(const int64 *encoded, uint32 num_values, uint32 exponent,
+							  bool is_float4, uint64 *restrict out);
+
+static void
+alp_decode_scalar(const int64 *encoded, uint32 num_values, uint32 exponent, bool is_float4,
+				  uint64 *restrict out)
+{
+	uint32 i;
+
+	for (i = 0; i < num_values; i++)
+		out[i] = alp_decode_value(encoded[i], exponent, is_float4);
+}
+
+#ifdef TS_USE_AVX2
+/*
+ * Decode four values per step. AVX2 cannot convert 64-bit integers to
+ * doubles, but the integers are small enough for the magic number conversion.
+ */
+static TS_TARGET_AVX2 void
+alp_decode_avx2(const int64 *encoded, uint32 num_values, uint32 exponent, bool is_float4,
+				uint64 *restrict out)
+{
+	const __m256i magic_bits = _mm256_set1_epi64x(ALP_MAGIC_BITS);
+	const __m256d magic = _mm256_set1_pd(ALP_MAGIC);
+	const __m256d power = _mm256_set1_pd(alp_powers_of_ten[exponent]);
+	uint32 i;
+
+	for (i = 0; i + 4 <= num_values; i += 4)
+	{
+		__m256i integers = _mm256_loadu_si256((const __m256i *) (encoded + i));
+		__m256d doubles =
+			_mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(integers, magic_bits)), magic);
+		__m256d decoded = _mm256_div_pd(doubles, power);
+
+		if (is_float4)
+			_mm256_storeu_si256((__m256i *) (out + i),
+								_mm256_cvtepu32_epi64(_mm_castps_si128(_mm256_cvtpd_ps(decoded))));
+		else
+			_mm256_storeu_si256((__m256i *) (out + i), _mm256_castpd_si256(decoded));
+	}
+
+	for (; i < num_values; i++)
+		out[i] = alp_decode_value(encoded[i], exponent, is_float4);
+}
+#endif
+
+static void alp_decode_choose(const int64 *encoded, uint32 num_values, uint32 exponent,
+							  bool is_float4, uint64 *restrict out);
+
+static AlpDecodeFunc alp_decode = alp_decode_choose;
+
+/* choose the implementation for the CPU on the first call */
+static void
+alp_decode_choose(const int64 *encoded, uint32 num_values, uint32 exponent, bool is_float4,
+				  uint64 *restrict out)
+{
+#ifdef TS_USE_AVX2
+	if (ts_cpu_supports_avx2())
+		alp_decode = alp_decode_avx2;
+	else
+#endif
+		alp_decode = alp_decode_scalar;
+
+	alp_decode(encoded, num_values, exponent, is_float4, out);
+}
+
+/* replace the values of the exceptions with their stored bits */
+static void
+alp_patch_exceptions(const AlpParts *parts, uint64 *values, uint32 num_values)
+{
+	uint32 num_exceptions = parts->exceptions->num_elements;
+	uint32 buffer_size = simple8brle_decompress_all_buffer_size(num_exceptions);
+	uint64 *positions = palloc(sizeof(uint64) * buffer_size);
+	uint64 *exceptions = palloc(sizeof(uint64) * buffer_size);
+	uint64 position = 0;
+	uint32 i;
+
+	if (simple8brle_decompress_all_forward(parts->exception_positions, positions) !=
+			num_exceptions ||
+		simple8brle_decompress_all_forward(parts->exceptions, exceptions) != num_exceptions)
+		elog(ERROR, "invalid number of exceptions in alp");
+
+	for (i = 0; i < num_exceptions; i++)
+	{
+		position += positions[i];
+		if (position >= num_values)
+			elog(ERROR, "invalid exception position in alp");
+
+		values[position] = exceptions[i];
+	}
+
+	pfree(positions);
+	pfree(exceptions);
+}
+
+/*
+ * Decode all non-NULL values into an array of their bits. Returns the number
+ * of values.
+ */
+static uint32
+alp_decode_all(const AlpParts *parts, Oid element_type, AlpDecodeFunc decode, uint64 **values)
+{
+	DecompressedColumn integers = { 0 };
+
+	if (element_type != FLOAT4OID && element_type != FLOAT8OID)
+		elog(ERROR, "invalid type requested from alp decompression %d", element_type);
+
+	decompress_all(PointerGetDatum(parts->integers), INT8OID, &integers);
+	if (integers.num_nulls != 0)
+		elog(ERROR, "invalid NULL integers in alp");
+
+	*values = palloc(sizeof(uint64) * Max(integers.num_values, 1));
+	decode((const int64 *) integers.values,
+		   integers.num_values,
+		   parts->exponent,
+		   element_type == FLOAT4OID,
+		   *values);
+
+	if (parts->exceptions != NULL)
+		alp_patch_exceptions(parts, *values, integers.num_values);
+
+	pfree(integers.values);
+	pfree(integers.nulls);
+	return integers.num_values;
+}
+
+static inline DecompressResult
+convert_from_internal(DecompressResultInternal res_internal, Oid element_type)
+{
+	if (res_internal.is_done || res_internal.is_null)
+	{
+		return (DecompressResult){
+			.is_done = res_internal.is_done,
+			.is_null = res_internal.is_null,
+		};
+	}
+
+	switch (element_type)
+	{
+		case FLOAT8OID:
+			return (DecompressResult){
+				.val = Float8GetDatum(bits_get_double(res_internal.val)),
+			};
+		case FLOAT4OID:
+			return (DecompressResult){
+				.val = Float4GetDatum(bits_get_float(res_internal.val)),
+			};
+		default:
+			elog(ERROR, "invalid type requested from alp decompression %d", element_type);
+	}
+}
+
+/*
+ * The values of a segment are decoded as a whole when the iterator is
+ * created, since the integers are decoded in bulk anyway.
+ */
+static DecompressionIterator *
+alp_decompression_iterator_init(Datum alp_compressed, Oid element_type, bool forward)
+{
+	AlpCompressed *compressed = (AlpCompressed *) PG_DETOAST_DATUM(alp_compressed);
+	AlpDecompressionIterator *iter = palloc(sizeof(*iter));
+	AlpParts parts;
+	uint64 *values;
+	uint32 num_values;
+
+	alp_parts_from_compressed(compressed, &parts);
+	num_values = alp_decode_all(&parts, element_type, alp_decode, &values);
+
+	*iter = (AlpDecompressionIterator){
+		.base = {
+			.compression_algorithm = COMPRESSION_ALGORITHM_ALP,
+			.forward = forward,
+			.element_type = element_type,
+			.try_next = forward ? alp_decompression_iterator_try_next_forward :
+								  alp_decompression_iterator_try_next_reverse,
+		},
+		.values = values,
+		.position = forward ? 0 : (int64) num_values - 1,
+		.num_values = num_values,
+		.has_nulls = parts.nulls != NULL,
+	};
+
+	if (iter->has_nulls)
+	{
+		if (forward)
+			simple8brle_decompression_iterator_init_forward(&iter->nulls, parts.nulls);
+		else
+			simple8brle_decompression_iterator_init_reverse(&iter->nulls, parts.nulls);
+	}
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+alp_decompression_iterator_from_datum_forward(Datum alp_compressed, Oid element_type)
+{
+	return alp_decompression_iterator_init(alp_compressed, element_type, true);
+}
+
+DecompressionIterator *
+alp_decompression_iterator_from_datum_reverse(Datum alp_compressed, Oid element_type)
+{
+	return alp_decompression_iterator_init(alp_compressed, element_type, false);
+}
+
+static DecompressResultInternal
+alp_decompression_iterator_try_next_internal(AlpDecompressionIterator *iter)
+{
+	uint64 val;
+
+	/* check for a null value */
+	if (iter->has_nulls)
+	{
+		Simple8bRleDecompressResult result =
+			iter->base.forward ? simple8brle_decompression_iterator_try_next_forward(&iter->nulls) :
+								 simple8brle_decompression_iterator_try_next_reverse(&iter->nulls);
+		if (result.is_done)
+			return (DecompressResultInternal){
+				.is_done = true,
+			};
+
+		if (result.val != 0)
+		{
+			Assert(result.val == 1);
+			return (DecompressResultInternal){
+				.is_null = true,
+			};
+		}
+	}
+
+	if (iter->position < 0 || iter->position >= iter->num_values)
+		return (DecompressResultInternal){
+			.is_done = true,
+		};
+
+	val = iter->values[iter->position];
+	iter->position += iter->base.forward ? 1 : -1;
+
+	return (DecompressResultInternal){
+		.val = val,
+	};
+}
+
+DecompressResult
+alp_decompression_iterator_try_next_forward(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_ALP && iter->forward);
+	return convert_from_internal(alp_decompression_iterator_try_next_internal(
+									 (AlpDecompressionIterator *) iter),
+								 iter->element_type);
+}
+
+DecompressResult
+alp_decompression_iterator_try_next_reverse(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_ALP && !iter->forward);
+	return convert_from_internal(alp_decompression_iterator_try_next_internal(
+									 (AlpDecompressionIterator *) iter),
+								 iter->element_type);
+}
+
+static void
+alp_decompress_all_internal(Datum compressed_datum, Oid element_type, DecompressedColumn *column,
+							AlpDecodeFunc decode)
+{
+	AlpCompressed *compressed = (AlpCompressed *) PG_DETOAST_DATUM(compressed_datum);
+	AlpParts parts;
+	uint64 *values;
+	uint32 num_values;
+
+	alp_parts_from_compressed(compressed, &parts);
+	num_values = alp_decode_all(&parts, element_type, decode, &values);
+
+	decompressed_column_init(column,
+							 element_type,
+							 parts.nulls != NULL ? parts.nulls->num_elements : num_values);
+
+	if (parts.nulls != NULL)
+	{
+		uint64 *null_flags =
+			palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(column->num_values));
+
+		simple8brle_decompress_all_forward(parts.nulls, null_flags);
+		decompressed_column_set_nulls(column, null_flags);
+		pfree(null_flags);
+	}
+
+	decompressed_column_fill_native(column, values, num_values);
+	pfree(values);
+}
+
+/*
+ * Decompress all values at once, converting the integers back to floats four
+ * at a time if the CPU supports it.
+ */
+void
+alp_decompress_all(Datum compressed_datum, Oid element_type, DecompressedColumn *column)
+{
+	alp_decompress_all_internal(compressed_datum, element_type, column, alp_decode);
+}
+
+void
+alp_decompress_all_scalar(Datum compressed_datum, Oid element_type, DecompressedColumn *column)
+{
+	alp_decompress_all_internal(compressed_datum, element_type, column, alp_decode_scalar);
+}
+
+/**********************************************************************************/
+/**********************************************************************************/
+
+void
+alp_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	AlpCompressed *data = (AlpCompressed *) header;
+	AlpParts parts;
+	bytea *integers;
+
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_ALP);
+	alp_parts_from_compressed(data, &parts);
+
+	pq_sendbyte(buffer, data->has_nulls);
+	pq_sendbyte(buffer, data->exponent);
+	pq_sendbyte(buffer, data->has_exceptions);
+
+	/* the integers in the format of their own algorithm */
+	integers = DatumGetByteaP(
+		DirectFunctionCall1(tsl_compressed_data_send, PointerGetDatum(parts.integers)));
+	pq_sendint32(buffer, VARSIZE(integers) - VARHDRSZ);
+	pq_sendbytes(buffer, VARDATA(integers), VARSIZE(integers) - VARHDRSZ);
+
+	if (data->has_exceptions)
+	{
+		simple8brle_serialized_send(buffer, parts.exception_positions);
+		simple8brle_serialized_send(buffer, parts.exceptions);
+	}
+
+	if (data->has_nulls)
+		simple8brle_serialized_send(buffer, parts.nulls);
+}
+
+Datum
+alp_compressed_recv(StringInfo buffer)
+{
+	uint8 has_nulls;
+	uint8 exponent;
+	uint8 has_exceptions;
+	uint32 integers_size;
+	StringInfoData integers_buffer;
+	CompressedDataHeader *integers;
+	Simple8bRleSerialized *exception_positions = NULL;
+	Simple8bRleSerialized *exceptions = NULL;
+	Simple8bRleSerialized *nulls = NULL;
+
+	has_nulls = pq_getmsgbyte(buffer);
+	if (has_nulls != 0 && has_nulls != 1)
+		elog(ERROR, "invalid recv in alp: bad bool");
+
+	exponent = pq_getmsgbyte(buffer);
+	if (exponent > ALP_MAX_EXPONENT)
+		elog(ERROR, "invalid recv in alp: bad exponent");
+
+	has_exceptions = pq_getmsgbyte(buffer);
+	if (has_exceptions != 0 && has_exceptions != 1)
+		elog(ERROR, "invalid recv in alp: bad bool");
+
+	integers_size = pq_getmsgint32(buffer);
+	integers_buffer = (StringInfoData){
+		.data = (char *) pq_getmsgbytes(buffer, integers_size),
+		.len = integers_size,
+		.maxlen = integers_size,
+	};
+	if (integers_size == 0 || (integers_buffer.data[0] != COMPRESSION_ALGORITHM_DELTADELTA &&
+							   integers_buffer.data[0] != COMPRESSION_ALGORITHM_PFOR))
+		elog(ERROR, "invalid recv in alp: bad integers");
+
+	integers = (CompressedDataHeader *) DatumGetPointer(
+		DirectFunctionCall1(tsl_compressed_data_recv, PointerGetDatum(&integers_buffer)));
+
+	if (has_exceptions)
+	{
+		exception_positions = simple8brle_serialized_recv(buffer);
+		exceptions = simple8brle_serialized_recv(buffer);
+		if (exception_positions->num_elements != exceptions->num_elements)
+			elog(ERROR, "invalid recv in alp: bad exceptions");
+	}
+
+	if (has_nulls)
+		nulls = simple8brle_serialized_recv(buffer);
+
+	PG_RETURN_POINTER(alp_from_parts(exponent, integers, exception_positions, exceptions, nulls));
+}
@@ -0,0 +1,69 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+/*
+ * ALP (adaptive lossless floating-point) compression is used for floats that
+ * originate from decimal numbers, e.g., prices or sensor readings with a fixed
+ * number of decimals. The XORs of such values have noisy mantissas, so they
+ * compress poorly with gorilla.
+ *
+ * Every value is multiplied by a power of ten that is chosen per segment, and
+ * the result is rounded to an integer. If dividing the integer by the same power
+ * of ten gives back the exact value, only the integer is stored; otherwise the
+ * value is an exception that is stored verbatim. The integers are compressed
+ * with deltadelta or pfor, whichever is smaller.
+ *
+ * Segments where too many values are exceptions, i.e., whose values are not
+ * decimal numbers, are compressed with gorilla instead.
+ */
+#ifndef TIMESCALEDB_TSL_COMPRESSION_ALP_H
+#define TIMESCALEDB_TSL_COMPRESSION_ALP_H
+
+#include <postgres.h>
+#include <c.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include <export.h>
+#include "compression/compression.h"
+
+typedef struct AlpCompressor AlpCompressor;
+typedef struct AlpCompressed AlpCompressed;
+typedef struct AlpDecompressionIterator AlpDecompressionIterator;
+
+extern Compressor *alp_compressor_for_type(Oid element_type);
+extern AlpCompressor *alp_compressor_alloc(Oid element_type);
+extern void alp_compressor_append_null(AlpCompressor *compressor);
+extern void alp_compressor_append_value(AlpCompressor *compressor, double next_val);
+extern void *alp_compressor_finish(AlpCompressor *compressor);
+
+extern DecompressionIterator *alp_decompression_iterator_from_datum_forward(Datum alp_compressed,
+																			Oid element_type);
+extern DecompressionIterator *alp_decompression_iterator_from_datum_reverse(Datum alp_compressed,
+																			Oid element_type);
+extern DecompressResult alp_decompression_iterator_try_next_forward(DecompressionIterator *iter);
+extern DecompressResult alp_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
+
+extern void alp_decompress_all(Datum alp_compressed, Oid element_type, DecompressedColumn *column);
+
+extern void alp_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum alp_compressed_recv(StringInfo buf);
+
+/* the portable implementation of bulk decoding, exposed for testing */
+extern void alp_decompress_all_scalar(Datum alp_compressed, Oid element_type,
+									  DecompressedColumn *column);
+
+#define ALP_ALGORITHM_DEFINITION                                                                   \
+	{                                                                                              \
+		.iterator_init_forward = alp_decompression_iterator_from_datum_forward,                    \
+		.iterator_init_reverse = alp_decompression_iterator_from_datum_reverse,                    \
+		.decompress_all = alp_decompress_all,                                                      \
+		.compressed_data_send = alp_compressed_send,                                               \
+		.compressed_data_recv = alp_compressed_recv,                                               \
+		.compressor_for_type = alp_compressor_for_type,                                            \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
+
+#endif
@@ -432,6 +432,63 @@ array_decompression_iterator_try_next_forward(DecompressionIterator *general_ite
 	};
 }
 
+/*
+ * Decompress all values at once. The deserializer knows the size of every
+ * element, so the sizes stream does not need to be decoded.
+ */
+void
+array_decompress_all(Datum compressed_array, Oid element_type, DecompressedColumn *column)
+{
+	const char *compressed_data = (void *) PG_DETOAST_DATUM(compressed_array);
+	ArrayCompressed *header = (ArrayCompressed *) compressed_data;
+	ArrayCompressedData data;
+	DatumDeserializer *deserializer;
+	const char *start_pointer;
+	uint32 num_values;
+	uint32 row;
+
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY);
+	if (element_type != header->element_type)
+		elog(ERROR, "trying to decompress the wrong type");
+
+	data = array_compressed_data_from_bytes(compressed_data + sizeof(*header),
+											VARSIZE(header) - sizeof(*header),
+											header->element_type,
+											header->has_nulls == 1);
+
+	num_values = data.nulls != NULL ? data.nulls->num_elements : data.sizes->num_elements;
+	decompressed_column_init(column, element_type, num_values);
+
+	if (data.nulls != NULL)
+	{
+		uint64 *null_flags =
+			palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_values));
+
+		simple8brle_decompress_all_forward(data.nulls, null_flags);
+		decompressed_column_set_nulls(column, null_flags);
+		pfree(null_flags);
+	}
+
+	if (data.sizes->num_elements != num_values - column->num_nulls)
+		elog(ERROR, "number of array elements does not match the NULL bitmap");
+
+	deserializer = create_datum_deserializer(element_type);
+	start_pointer = data.data;
+
+	for (row = 0; row < num_values; row++)
+	{
+		if (column->num_nulls > 0 && DECOMPRESSED_COLUMN_IS_NULL(column, row))
+			continue;
+
+		decompressed_column_store_datum(column,
+										row,
+										bytes_to_datum_and_advance(deserializer, &start_pointer));
+	}
+
+	if (start_pointer > data.data + data.data_len)
+		elog(ERROR, "array elements exceed the compressed data");
+}
+
 /**************************
  *** Decompress Reverse ***
  **************************/
@@ -41,6 +41,9 @@ extern DecompressionIterator *
 tsl_array_decompression_iterator_from_datum_reverse(Datum compressed_array, Oid element_type);
 extern DecompressResult array_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
 
+extern void array_decompress_all(Datum compressed_array, Oid element_type,
+								 DecompressedColumn *column);
+
 /* API for using this as an embedded data structure */
 typedef struct ArrayCompressorSerializationInfo ArrayCompressorSerializationInfo;
 extern ArrayCompressorSerializationInfo *
@@ -71,6 +74,7 @@ extern Datum tsl_array_compressor_finish(PG_FUNCTION_ARGS);
 	{                                                                                              \
 		.iterator_init_forward = tsl_array_decompression_iterator_from_datum_forward,              \
 		.iterator_init_reverse = tsl_array_decompression_iterator_from_datum_reverse,              \
+		.decompress_all = array_decompress_all,                                                    \
 		.compressed_data_send = array_compressed_send,                                             \
 		.compressed_data_recv = array_compressed_recv,                                             \
 		.compressor_for_type = array_compressor_for_type,                                          \
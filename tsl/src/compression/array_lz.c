@@ -0,0 +1,394 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "compression/array_lz.h"
+
+#include <common/pg_lzcompress.h>
+#include <lib/stringinfo.h>
+#include <utils/memutils.h>
+
+#include <compat.h>
+#include "config.h"
+
+#ifdef TS_USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef TS_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compression/array.h"
+
+/*
+ * Zstandard decompresses equally fast at every level, so a level that favors
+ * density over compression speed is used.
+ */
+#define ARRAY_ZSTD_LEVEL 9
+
+/* the block codec that compressed the data, stored on disk so it MUST NOT CHANGE */
+typedef enum ArrayLzCodec
+{
+	ARRAY_LZ_CODEC_PGLZ = 1,
+	ARRAY_LZ_CODEC_LZ4 = 2,
+	ARRAY_LZ_CODEC_ZSTD = 3,
+} ArrayLzCodec;
+
+typedef struct ArrayLzCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 codec;
+	uint8 padding[2];
+	/* size of the array compressed data without its varlena header */
+	uint32 raw_size;
+	/* the array compressed data without its varlena header, compressed with the codec */
+	char data[FLEXIBLE_ARRAY_MEMBER];
+} ArrayLzCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	ArrayLzCompressed test_val = { { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(ArrayLzCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.codec) + sizeof(test_val.padding) +
+							 sizeof(test_val.raw_size),
+					 "ArrayLzCompressed wrong size");
+	StaticAssertStmt(sizeof(ArrayLzCompressed) == 12, "ArrayLzCompressed wrong size");
+}
+
+typedef struct ExtendedCompressor
+{
+	Compressor base;
+	Compressor *array;
+	CompressionAlgorithms algorithm;
+} ExtendedCompressor;
+
+/********************
+ *****  UTILS  *****
+ ********************/
+
+/* the codec to compress with for an algorithm, pglz if the build lacks the codec */
+static ArrayLzCodec
+array_lz_codec_for_algorithm(CompressionAlgorithms algorithm)
+{
+	switch (algorithm)
+	{
+		case COMPRESSION_ALGORITHM_ARRAY_LZ4:
+#ifdef TS_USE_LZ4
+			return ARRAY_LZ_CODEC_LZ4;
+#else
+			return ARRAY_LZ_CODEC_PGLZ;
+#endif
+		case COMPRESSION_ALGORITHM_ARRAY_ZSTD:
+#ifdef TS_USE_ZSTD
+			return ARRAY_LZ_CODEC_ZSTD;
+#else
+			return ARRAY_LZ_CODEC_PGLZ;
+#endif
+		default:
+			elog(ERROR, "invalid algorithm %d for array_lz compression", algorithm);
+	}
+}
+
+const char *
+array_lz_codec_name(CompressedDataHeader *header)
+{
+	ArrayLzCompressed *compressed = (ArrayLzCompressed *) header;
+
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY_LZ4 ||
+		   header->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY_ZSTD);
+
+	switch (compressed->codec)
+	{
+		case ARRAY_LZ_CODEC_PGLZ:
+			return "pglz";
+		case ARRAY_LZ_CODEC_LZ4:
+			return "lz4";
+		case ARRAY_LZ_CODEC_ZSTD:
+			return "zstd";
+		default:
+			elog(ERROR, "invalid codec %d in array_lz compressed data", compressed->codec);
+	}
+}
+
+/* the largest size the codec can compress raw_size bytes to */
+static Size
+array_lz_max_compressed_size(ArrayLzCodec codec, int32 raw_size)
+{
+	switch (codec)
+	{
+		case ARRAY_LZ_CODEC_PGLZ:
+			return PGLZ_MAX_OUTPUT(raw_size);
+#ifdef TS_USE_LZ4
+		case ARRAY_LZ_CODEC_LZ4:
+			return LZ4_compressBound(raw_size);
+#endif
+#ifdef TS_USE_ZSTD
+		case ARRAY_LZ_CODEC_ZSTD:
+			return ZSTD_compressBound(raw_size);
+#endif
+		default:
+			elog(ERROR, "invalid codec %d for array_lz compression", codec);
+	}
+}
+
+/* returns the compressed size, or -1 if the codec could not compress the data */
+static int64
+array_lz_encode(ArrayLzCodec codec, const char *raw, int32 raw_size, char *dst, Size dst_size)
+{
+	switch (codec)
+	{
+		case ARRAY_LZ_CODEC_PGLZ:
+			return pglz_compress(raw, raw_size, dst, PGLZ_strategy_always);
+#ifdef TS_USE_LZ4
+		case ARRAY_LZ_CODEC_LZ4:
+		{
+			int size = LZ4_compress_default(raw, dst, raw_size, (int) dst_size);
+			return size > 0 ? size : -1;
+		}
+#endif
+#ifdef TS_USE_ZSTD
+		case ARRAY_LZ_CODEC_ZSTD:
+		{
+			size_t size = ZSTD_compress(dst, dst_size, raw, raw_size, ARRAY_ZSTD_LEVEL);
+			return ZSTD_isError(size) ? -1 : (int64) size;
+		}
+#endif
+		default:
+			elog(ERROR, "invalid codec %d for array_lz compression", codec);
+	}
+}
+
+/* returns the decompressed size, or -1 if the data is corrupted */
+static int64
+array_lz_decode(ArrayLzCodec codec, const char *src, int32 src_size, char *raw, int32 raw_size)
+{
+	switch (codec)
+	{
+		case ARRAY_LZ_CODEC_PGLZ:
+			return pglz_decompress(src, src_size, raw, raw_size);
+		case ARRAY_LZ_CODEC_LZ4:
+#ifdef TS_USE_LZ4
+		{
+			int size = LZ4_decompress_safe(src, raw, src_size, raw_size);
+			return size >= 0 ? size : -1;
+		}
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot decompress LZ4 compressed data"),
+					 errdetail("TimescaleDB was built without LZ4 support.")));
+#endif
+		case ARRAY_LZ_CODEC_ZSTD:
+#ifdef TS_USE_ZSTD
+		{
+			size_t size = ZSTD_decompress(raw, raw_size, src, src_size);
+			return ZSTD_isError(size) ? -1 : (int64) size;
+		}
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot decompress Zstandard compressed data"),
+					 errdetail("TimescaleDB was built without Zstandard support.")));
+#endif
+		default:
+			elog(ERROR, "invalid codec %d in array_lz compressed data", codec);
+	}
+}
+
+/* decompress the block back to the array compressed datum */
+static CompressedDataHeader *
+array_lz_decompress(Datum compressed_datum)
+{
+	ArrayLzCompressed *compressed = (ArrayLzCompressed *) PG_DETOAST_DATUM(compressed_datum);
+	int32 compressed_size = VARSIZE(compressed) - sizeof(ArrayLzCompressed);
+	CompressedDataHeader *array;
+
+	Assert(compressed->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY_LZ4 ||
+		   compressed->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY_ZSTD);
+
+	if (!AllocSizeIsValid((Size) VARHDRSZ + compressed->raw_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid decompressed size %u in array_lz compressed data",
+						compressed->raw_size)));
+
+	array = palloc(VARHDRSZ + compressed->raw_size);
+	if (array_lz_decode(compressed->codec,
+						compressed->data,
+						compressed_size,
+						VARDATA(array),
+						compressed->raw_size) != compressed->raw_size)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("array_lz compressed data is corrupted")));
+
+	SET_VARSIZE(array, VARHDRSZ + compressed->raw_size);
+	if (compressed->raw_size < sizeof(CompressedDataHeader) - VARHDRSZ ||
+		array->compression_algorithm != COMPRESSION_ALGORITHM_ARRAY)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("array_lz compressed data does not contain an array")));
+
+	return array;
+}
+
+/******************************
+ ***  Compressor  ***
+ ******************************/
+
+static void
+array_lz_compressor_append_val(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	extended->array->append_val(extended->array, val);
+}
+
+static void
+array_lz_compressor_append_null(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	extended->array->append_null(extended->array);
+}
+
+static void *
+array_lz_compressor_finish_and_reset(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	CompressedDataHeader *array = extended->array->finish(extended->array);
+
+	if (array == NULL)
+		return NULL;
+
+	return array_lz_compress(array, extended->algorithm);
+}
+
+static const Compressor array_lz_compressor = {
+	.append_val = array_lz_compressor_append_val,
+	.append_null = array_lz_compressor_append_null,
+	.finish = array_lz_compressor_finish_and_reset,
+};
+
+static Compressor *
+array_lz_compressor_for_type(Oid element_type, CompressionAlgorithms algorithm)
+{
+	ExtendedCompressor *compressor = palloc(sizeof(*compressor));
+	*compressor = (ExtendedCompressor){
+		.base = array_lz_compressor,
+		.array = array_compressor_for_type(element_type),
+		.algorithm = algorithm,
+	};
+	return &compressor->base;
+}
+
+Compressor *
+array_lz4_compressor_for_type(Oid element_type)
+{
+	return array_lz_compressor_for_type(element_type, COMPRESSION_ALGORITHM_ARRAY_LZ4);
+}
+
+Compressor *
+array_zstd_compressor_for_type(Oid element_type)
+{
+	return array_lz_compressor_for_type(element_type, COMPRESSION_ALGORITHM_ARRAY_ZSTD);
+}
+
+/*
+ * Compress the payload of an array compressed datum. Returns the array itself
+ * if the codec does not make it smaller, e.g., for random data.
+ */
+void *
+array_lz_compress(CompressedDataHeader *array, CompressionAlgorithms algorithm)
+{
+	ArrayLzCodec codec = array_lz_codec_for_algorithm(algorithm);
+	int32 raw_size = VARSIZE(array) - VARHDRSZ;
+	Size max_size = sizeof(ArrayLzCompressed) + array_lz_max_compressed_size(codec, raw_size);
+	ArrayLzCompressed *compressed;
+	int64 compressed_size;
+
+	Assert(array->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY);
+
+	if (!AllocSizeIsValid(max_size))
+		return array;
+
+	compressed = palloc0(max_size);
+	compressed_size = array_lz_encode(codec,
+									  VARDATA(array),
+									  raw_size,
+									  compressed->data,
+									  max_size - sizeof(ArrayLzCompressed));
+
+	if (compressed_size < 0 || sizeof(ArrayLzCompressed) + compressed_size >= VARSIZE(array))
+	{
+		pfree(compressed);
+		return array;
+	}
+
+	SET_VARSIZE(&compressed->vl_len_, sizeof(ArrayLzCompressed) + compressed_size);
+	compressed->compression_algorithm = algorithm;
+	compressed->codec = codec;
+	compressed->raw_size = raw_size;
+	return compressed;
+}
+
+/******************************
+ ***  Decompression  ***
+ ******************************/
+
+DecompressionIterator *
+array_lz_decompression_iterator_from_datum_forward(Datum compressed, Oid element_type)
+{
+	CompressedDataHeader *array = array_lz_decompress(compressed);
+	return tsl_array_decompression_iterator_from_datum_forward(PointerGetDatum(array),
+															   element_type);
+}
+
+DecompressionIterator *
+array_lz_decompression_iterator_from_datum_reverse(Datum compressed, Oid element_type)
+{
+	CompressedDataHeader *array = array_lz_decompress(compressed);
+	return tsl_array_decompression_iterator_from_datum_reverse(PointerGetDatum(array),
+															   element_type);
+}
+
+/* the values of by-reference types point into the decompressed array, so it is not freed */
+void
+array_lz_decompress_all(Datum compressed, Oid element_type, DecompressedColumn *column)
+{
+	CompressedDataHeader *array = array_lz_decompress(compressed);
+	array_decompress_all(PointerGetDatum(array), element_type, column);
+}
+
+/**********************************************************************************/
+/**********************************************************************************/
+
+/*
+ * The binary format is that of the array, so that data compressed with a codec
+ * that the receiving build lacks can still be restored. It is compressed again
+ * with the codec of the receiving build.
+ */
+void
+array_lz_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	array_compressed_send(array_lz_decompress(PointerGetDatum(header)), buffer);
+}
+
+Datum
+array_lz4_compressed_recv(StringInfo buffer)
+{
+	Datum array = array_compressed_recv(buffer);
+	PG_RETURN_POINTER(array_lz_compress((CompressedDataHeader *) DatumGetPointer(array),
+										COMPRESSION_ALGORITHM_ARRAY_LZ4));
+}
+
+Datum
+array_zstd_compressed_recv(StringInfo buffer)
+{
+	Datum array = array_compressed_recv(buffer);
+	PG_RETURN_POINTER(array_lz_compress((CompressedDataHeader *) DatumGetPointer(array),
+										COMPRESSION_ALGORITHM_ARRAY_ZSTD));
+}
@@ -0,0 +1,75 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+/*
+ * The `array_lz4` and `array_zstd` compression methods store the same data as
+ * `array`, compressed with a general-purpose block codec instead of relying
+ * on TOAST. They are meant for columns such as JSON or long text that neither
+ * gorilla, deltadelta nor dictionary compression can do much for: LZ4 is fast
+ * to decompress, Zstandard is denser.
+ *
+ * Both codecs are optional dependencies. If a codec is not available in the
+ * build, data is compressed with PostgreSQL's pglz instead, and the codec that
+ * was actually used is recorded in the compressed data. Since the payload is
+ * already compressed, the columns use external TOAST storage so that it is not
+ * compressed a second time. If the codec does not make the array smaller, the
+ * plain array is stored instead.
+ */
+#ifndef TIMESCALEDB_TSL_COMPRESSION_ARRAY_LZ_H
+#define TIMESCALEDB_TSL_COMPRESSION_ARRAY_LZ_H
+
+#include <postgres.h>
+#include <c.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include <export.h>
+#include "compression/compression.h"
+
+typedef struct ArrayLzCompressed ArrayLzCompressed;
+
+extern Compressor *array_lz4_compressor_for_type(Oid element_type);
+extern Compressor *array_zstd_compressor_for_type(Oid element_type);
+
+/* compress an array compressed datum with the codec of the given algorithm */
+extern void *array_lz_compress(CompressedDataHeader *array, CompressionAlgorithms algorithm);
+/* the name of the codec that compressed the data, e.g., "lz4" or "pglz" */
+extern const char *array_lz_codec_name(CompressedDataHeader *header);
+
+extern DecompressionIterator *array_lz_decompression_iterator_from_datum_forward(Datum compressed,
+																				 Oid element_type);
+extern DecompressionIterator *array_lz_decompression_iterator_from_datum_reverse(Datum compressed,
+																				 Oid element_type);
+
+extern void array_lz_decompress_all(Datum compressed, Oid element_type,
+									DecompressedColumn *column);
+
+extern void array_lz_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum array_lz4_compressed_recv(StringInfo buffer);
+extern Datum array_zstd_compressed_recv(StringInfo buffer);
+
+#define ARRAY_LZ4_ALGORITHM_DEFINITION                                                             \
+	{                                                                                              \
+		.iterator_init_forward = array_lz_decompression_iterator_from_datum_forward,               \
+		.iterator_init_reverse = array_lz_decompression_iterator_from_datum_reverse,               \
+		.decompress_all = array_lz_decompress_all,                                                 \
+		.compressed_data_send = array_lz_compressed_send,                                          \
+		.compressed_data_recv = array_lz4_compressed_recv,                                         \
+		.compressor_for_type = array_lz4_compressor_for_type,                                      \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
+
+#define ARRAY_ZSTD_ALGORITHM_DEFINITION                                                            \
+	{                                                                                              \
+		.iterator_init_forward = array_lz_decompression_iterator_from_datum_forward,               \
+		.iterator_init_reverse = array_lz_decompression_iterator_from_datum_reverse,               \
+		.decompress_all = array_lz_decompress_all,                                                 \
+		.compressed_data_send = array_lz_compressed_send,                                          \
+		.compressed_data_recv = array_zstd_compressed_recv,                                        \
+		.compressor_for_type = array_zstd_compressor_for_type,                                     \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
+
+#endif
@@ -201,6 +201,8 @@ compress_chunk_impl(Oid hypertable_relid, Oid chunk_relid)
 	List *htcols_list = NIL;
 	const ColumnCompressionInfo **colinfo_array;
 	int i = 0, htcols_listlen;
+	int32 batch_size;
+	bool adaptive_algorithms;
 	ChunkSize before_size, after_size;
 
 	hcache = ts_hypertable_cache_pin();
@@ -214,11 +216,16 @@ compress_chunk_impl(Oid hypertable_relid, Oid chunk_relid)
 	/* aquire locks on catalog tables to keep till end of txn */
 	LockRelationOid(catalog_get_table_id(ts_catalog_get(), HYPERTABLE_COMPRESSION),
 					AccessShareLock);
+	LockRelationOid(catalog_get_table_id(ts_catalog_get(), HYPERTABLE_COMPRESSION_SETTINGS),
+					AccessShareLock);
 	LockRelationOid(catalog_get_table_id(ts_catalog_get(), CHUNK), RowExclusiveLock);
 
 	// get compression properties for hypertable
 	htcols_list = ts_hypertable_compression_get(cxt.srcht->fd.id);
 	htcols_listlen = list_length(htcols_list);
+	if (!ts_hypertable_compression_get_batch_size(cxt.srcht->fd.id, &batch_size))
+		batch_size = DEFAULT_ROWS_PER_COMPRESSION;
+	adaptive_algorithms = ts_hypertable_compression_get_adaptive_algorithms(cxt.srcht->fd.id);
 	// create compressed chunk DDL and compress the data
 	compress_ht_chunk = create_compress_chunk_table(cxt.compress_ht, cxt.srcht_chunk);
 	/* convert list to array of pointers for compress_chunk */
@@ -232,7 +239,9 @@ compress_chunk_impl(Oid hypertable_relid, Oid chunk_relid)
 	compress_chunk(cxt.srcht_chunk->table_id,
 				   compress_ht_chunk->table_id,
 				   colinfo_array,
-				   htcols_listlen);
+				   htcols_listlen,
+				   batch_size,
+				   adaptive_algorithms);
 	chunk_dml_blocker_trigger_add(cxt.srcht_chunk->table_id);
 	after_size = compute_chunk_size(compress_ht_chunk->table_id);
 	compression_chunk_size_catalog_insert(cxt.srcht_chunk->fd.id,
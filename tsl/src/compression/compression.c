@@ -6,42 +6,66 @@
 
 #include "compression/compression.h"
 
+#include <access/genam.h>
 #include <access/heapam.h>
 #include <access/htup_details.h>
 #include <access/multixact.h>
+#include <access/parallel.h>
+#include <access/stratnum.h>
+#include <access/tupmacs.h>
+#include <access/tuptoaster.h>
 #include <access/xact.h>
 #include <catalog/namespace.h>
+#include <catalog/pg_am.h>
 #include <catalog/pg_attribute.h>
+#include <catalog/pg_index.h>
 #include <catalog/pg_type.h>
 #include <catalog/index.h>
 #include <catalog/heap.h>
 #include <funcapi.h>
 #include <libpq/pqformat.h>
 #include <miscadmin.h>
+#include <optimizer/paths.h>
+#include <port/atomics.h>
+#include <storage/bufmgr.h>
+#include <storage/latch.h>
 #include <storage/predicate.h>
+#include <storage/proc.h>
+#include <storage/shm_mq.h>
+#include <storage/shm_toc.h>
 #include <utils/builtins.h>
 #include <utils/datum.h>
 #include <utils/lsyscache.h>
 #include <utils/memutils.h>
 #include <utils/rel.h>
+#include <utils/relcache.h>
 #include <utils/snapmgr.h>
 #include <utils/syscache.h>
 #include <utils/tuplesort.h>
+#include <utils/tuplestore.h>
 #include <utils/typcache.h>
 
 #include <base64_compat.h>
 #include <catalog.h>
+#include <compat.h>
+#include <extension_constants.h>
+#include <guc.h>
+#include <hypertable_compression.h>
+#include <indexing.h>
 #include <utils.h>
 
+#include "alp.h"
 #include "array.h"
+#include "array_lz.h"
 #include "deltadelta.h"
 #include "dictionary.h"
 #include "gorilla.h"
+#include "jsonb.h"
+#include "pfor.h"
 #include "create.h"
 #include "custom_type_cache.h"
 #include "segment_meta.h"
 
-#define MAX_ROWS_PER_COMPRESSION 1000
 /* gap in sequence id between rows, potential for adding rows in gap later */
 #define SEQUENCE_NUM_GAP 10
 #define COMPRESSIONCOL_IS_SEGMENT_BY(col) (col->segmentby_column_index > 0)
@@ -52,6 +76,11 @@ static const CompressionAlgorithmDefinition definitions[_END_COMPRESSION_ALGORIT
 	[COMPRESSION_ALGORITHM_DICTIONARY] = DICTIONARY_ALGORITHM_DEFINITION,
 	[COMPRESSION_ALGORITHM_GORILLA] = GORILLA_ALGORITHM_DEFINITION,
 	[COMPRESSION_ALGORITHM_DELTADELTA] = DELTA_DELTA_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_PFOR] = PFOR_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_ALP] = ALP_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_ARRAY_LZ4] = ARRAY_LZ4_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_ARRAY_ZSTD] = ARRAY_ZSTD_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_JSONB] = JSONB_ALGORITHM_DEFINITION,
 };
 
 static Compressor *
@@ -90,13 +119,19 @@ typedef struct PerColumn
 	/* the compressor to use for regular columns, NULL for segmenters */
 	Compressor *compressor;
 	/*
-	 * Information on the metadata we'll store for this column (currently only min/max).
-	 * Only used for order-by columns right now, will be {-1, NULL} for others.
+	 * Information on the metadata we'll store for this column: min/max for
+	 * order-by columns, and min/max and the NULL count for columns in
+	 * timescaledb.compress_minmax. Will be {-1, NULL} where there is none.
 	 */
 	int16 min_metadata_attr_offset;
 	int16 max_metadata_attr_offset;
+	int16 null_count_metadata_attr_offset;
 	SegmentMetaMinMaxBuilder *min_max_metadata_builder;
 
+	/* bloom filter for columns in timescaledb.compress_bloom, {-1, NULL} for others */
+	int16 bloom_metadata_attr_offset;
+	SegmentMetaBloomBuilder *bloom_metadata_builder;
+
 	/* segment info; only used if compressor is NULL */
 	SegmentInfo *segment_info;
 } PerColumn;
@@ -127,8 +162,16 @@ typedef struct RowCompressor
 
 	/* the number of uncompressed rows compressed into the current compressed row */
 	uint32 rows_compressed_into_current_value;
+	/* the number of uncompressed rows after which the current compressed row is flushed */
+	uint32 rows_per_compressed_row;
+	/* choose rows_per_compressed_row from the size of the compressed data */
+	bool adaptive_batch_size;
+	/* estimated size of the widest compressed column per row, 0 if unknown */
+	double compressed_bytes_per_row;
 	/* a unique monotonically increasing (according to order by) id for each compressed row */
 	int32 sequence_num;
+	/* in parallel workers, compressed rows are sent to the leader through this queue */
+	shm_mq_handle *tuple_queue;
 
 	/* cached arrays used to build the HeapTuple */
 	Datum *compressed_values;
@@ -138,14 +181,45 @@ typedef struct RowCompressor
 static int16 *compress_chunk_populate_keys(Oid in_table, const ColumnCompressionInfo **columns,
 										   int n_columns, int *n_keys_out,
 										   const ColumnCompressionInfo ***keys_out);
+typedef struct SegmentPartition SegmentPartition;
+
+/*
+ * The rows of a chunk in compression order: either sorted, or read through an
+ * index that returns them in that order.
+ */
+typedef struct SortedRows
+{
+	Tuplesortstate *sorted;
+	Relation index_rel;
+	IndexScanDesc index_scan;
+	ScanDirection index_direction;
+	/* only return the rows of this partition in index scans */
+	const SegmentPartition *partition;
+} SortedRows;
+
+/* the rows compressed by this backend that were read through an index or sorted */
+static int64 sorted_rows_index_scans = 0;
+static int64 sorted_rows_sorts = 0;
+
 static Tuplesortstate *compress_chunk_sort_relation(Relation in_rel, int n_keys,
-													const ColumnCompressionInfo **keys);
+													const ColumnCompressionInfo **keys,
+													Snapshot snapshot,
+													const SegmentPartition *partition);
+static Oid compress_chunk_find_ordered_index(Relation in_rel, int n_keys,
+											 const ColumnCompressionInfo **keys,
+											 ScanDirection *direction);
+static void sorted_rows_begin(SortedRows *rows, Relation in_rel, int n_keys,
+							  const ColumnCompressionInfo **keys, Snapshot snapshot,
+							  const SegmentPartition *partition);
+static bool sorted_rows_next(SortedRows *rows, TupleTableSlot *slot);
+static void sorted_rows_end(SortedRows *rows);
 static void row_compressor_init(RowCompressor *row_compressor, TupleDesc uncompressed_tuple_desc,
 								Relation compressed_table, int num_compression_infos,
 								const ColumnCompressionInfo **column_compression_info,
-								int16 *column_offsets, int16 num_compressed_columns);
+								int16 *column_offsets, int16 num_compressed_columns,
+								int32 batch_size, bool adaptive_algorithms);
 static void row_compressor_append_sorted_rows(RowCompressor *row_compressor,
-											  Tuplesortstate *sorted_rel, TupleDesc sorted_desc);
+											  SortedRows *sorted_rows, TupleDesc sorted_desc);
 static void row_compressor_finish(RowCompressor *row_compressor);
 
 /********************
@@ -192,9 +266,59 @@ truncate_relation(Oid table_oid)
 	reindex_relation(table_oid, REINDEX_REL_PROCESS_TOAST, 0);
 }
 
+static bool compress_chunk_parallel(Relation in_rel, Relation out_rel,
+									const ColumnCompressionInfo **column_compression_info,
+									int num_compression_infos, int n_keys,
+									const ColumnCompressionInfo **keys, int32 batch_size,
+									bool adaptive_algorithms);
+
+/*
+ * Compress the rows of in_rel visible in snapshot in sorted order. If partition
+ * is set, only the segments of that partition are compressed. The compressed
+ * rows are inserted into out_rel, or sent to tuple_queue if that is set.
+ */
+static void
+compress_chunk_rows(Relation in_rel, Relation out_rel,
+					const ColumnCompressionInfo **column_compression_info,
+					int num_compression_infos, int16 *in_column_offsets, int n_keys,
+					const ColumnCompressionInfo **keys, int32 batch_size, bool adaptive_algorithms,
+					Snapshot snapshot, const SegmentPartition *partition,
+					shm_mq_handle *tuple_queue)
+{
+	TupleDesc in_desc = RelationGetDescr(in_rel);
+	TupleDesc out_desc = RelationGetDescr(out_rel);
+	SortedRows sorted_rows;
+	RowCompressor row_compressor;
+
+	sorted_rows_begin(&sorted_rows, in_rel, n_keys, keys, snapshot, partition);
+
+	row_compressor_init(&row_compressor,
+						in_desc,
+						out_rel,
+						num_compression_infos,
+						column_compression_info,
+						in_column_offsets,
+						out_desc->natts,
+						batch_size,
+						adaptive_algorithms);
+	row_compressor.tuple_queue = tuple_queue;
+
+	row_compressor_append_sorted_rows(&row_compressor, &sorted_rows, in_desc);
+
+	row_compressor_finish(&row_compressor);
+
+	sorted_rows_end(&sorted_rows);
+}
+
+/*
+ * Compress in_table into out_table. batch_size is the number of rows per
+ * compressed row, or HYPERTABLE_COMPRESSION_BATCH_SIZE_ADAPTIVE to choose it
+ * from the size of the compressed data. If adaptive_algorithms is set, the
+ * algorithm of every compressed value is chosen by trial encoding.
+ */
 void
 compress_chunk(Oid in_table, Oid out_table, const ColumnCompressionInfo **column_compression_info,
-			   int num_compression_infos)
+			   int num_compression_infos, int32 batch_size, bool adaptive_algorithms)
 {
 	int n_keys;
 	const ColumnCompressionInfo **keys;
@@ -219,29 +343,29 @@ compress_chunk(Oid in_table, Oid out_table, const ColumnCompressionInfo **column
 															&n_keys,
 															&keys);
 
-	TupleDesc in_desc = RelationGetDescr(in_rel);
-	TupleDesc out_desc = RelationGetDescr(out_rel);
-
-	Tuplesortstate *sorted_rel = compress_chunk_sort_relation(in_rel, n_keys, keys);
-
-	RowCompressor row_compressor;
-
-	Assert(num_compression_infos <= in_desc->natts);
-	Assert(num_compression_infos <= out_desc->natts);
-
-	row_compressor_init(&row_compressor,
-						in_desc,
-						out_rel,
-						num_compression_infos,
-						column_compression_info,
-						in_column_offsets,
-						out_desc->natts);
-
-	row_compressor_append_sorted_rows(&row_compressor, sorted_rel, in_desc);
-
-	row_compressor_finish(&row_compressor);
-
-	tuplesort_end(sorted_rel);
+	Assert(num_compression_infos <= RelationGetDescr(in_rel)->natts);
+	Assert(num_compression_infos <= RelationGetDescr(out_rel)->natts);
+
+	if (!compress_chunk_parallel(in_rel,
+								 out_rel,
+								 column_compression_info,
+								 num_compression_infos,
+								 n_keys,
+								 keys,
+								 batch_size,
+								 adaptive_algorithms))
+		compress_chunk_rows(in_rel,
+							out_rel,
+							column_compression_info,
+							num_compression_infos,
+							in_column_offsets,
+							n_keys,
+							keys,
+							batch_size,
+							adaptive_algorithms,
+							GetLatestSnapshot(),
+							NULL,
+							NULL);
 
 	truncate_relation(in_table);
 
@@ -305,8 +429,12 @@ static void compress_chunk_populate_sort_info_for_column(Oid table,
 														 AttrNumber *att_nums, Oid *sort_operator,
 														 Oid *collation, bool *nulls_first);
 
+static bool segment_partition_contains(const SegmentPartition *partition, HeapTuple tuple,
+									   TupleDesc tupdesc);
+
 static Tuplesortstate *
-compress_chunk_sort_relation(Relation in_rel, int n_keys, const ColumnCompressionInfo **keys)
+compress_chunk_sort_relation(Relation in_rel, int n_keys, const ColumnCompressionInfo **keys,
+							 Snapshot snapshot, const SegmentPartition *partition)
 {
 	TupleDesc tupDesc = RelationGetDescr(in_rel);
 	Tuplesortstate *tuplesortstate;
@@ -339,11 +467,12 @@ compress_chunk_sort_relation(Relation in_rel, int n_keys, const ColumnCompressio
 #endif
 										  false /*=randomAccess*/);
 
-	heapScan = heap_beginscan(in_rel, GetLatestSnapshot(), 0, (ScanKey) NULL);
+	heapScan = heap_beginscan(in_rel, snapshot, 0, (ScanKey) NULL);
 	for (tuple = heap_getnext(heapScan, ForwardScanDirection); tuple != NULL;
 		 tuple = heap_getnext(heapScan, ForwardScanDirection))
 	{
-		if (HeapTupleIsValid(tuple))
+		if (HeapTupleIsValid(tuple) &&
+			(partition == NULL || segment_partition_contains(partition, tuple, tupDesc)))
 		{
 			// TODO is this the most efficient way to do this?
 			//     (since we use begin_heap() the tuplestore expects tupleslots,
@@ -398,6 +527,565 @@ compress_chunk_populate_sort_info_for_column(Oid table, const ColumnCompressionI
 	ReleaseSysCache(tp);
 }
 
+/*
+ * Find an index that returns the rows of the chunk in compression order, so
+ * that they need not be sorted. Only the clustered index is used, i.e., the
+ * index the chunk was last reordered or clustered by. Reading a chunk through
+ * any other index visits the heap in random order, which is slower than
+ * sorting it.
+ */
+static Oid
+compress_chunk_find_ordered_index(Relation in_rel, int n_keys, const ColumnCompressionInfo **keys,
+								  ScanDirection *direction)
+{
+	Oid index_relid = ts_indexing_find_clustered_index(RelationGetRelid(in_rel));
+	Relation index_rel;
+	bool forward;
+	bool backward;
+	int n;
+
+	if (!OidIsValid(index_relid))
+		return InvalidOid;
+
+	index_rel = index_open(index_relid, AccessShareLock);
+
+	forward = index_rel->rd_rel->relam == BTREE_AM_OID && index_rel->rd_index->indisvalid &&
+			  IndexRelationGetNumberOfKeyAttributes(index_rel) >= n_keys &&
+			  RelationGetIndexPredicate(index_rel) == NIL;
+	backward = forward;
+
+	for (n = 0; n < n_keys && (forward || backward); n++)
+	{
+		Oid opfamily = index_rel->rd_opfamily[n];
+		Oid opcintype = index_rel->rd_opcintype[n];
+		bool index_desc = (index_rel->rd_indoption[n] & INDOPTION_DESC) != 0;
+		bool index_nulls_first = (index_rel->rd_indoption[n] & INDOPTION_NULLS_FIRST) != 0;
+		AttrNumber attnum;
+		Oid sort_operator;
+		Oid collation;
+		bool nulls_first;
+
+		compress_chunk_populate_sort_info_for_column(RelationGetRelid(in_rel),
+													 keys[n],
+													 &attnum,
+													 &sort_operator,
+													 &collation,
+													 &nulls_first);
+
+		if (index_rel->rd_index->indkey.values[n] != attnum ||
+			index_rel->rd_indcollation[n] != collation)
+		{
+			forward = backward = false;
+			break;
+		}
+
+		/* a backward scan returns every column in the reverse order of the index */
+		forward = forward && nulls_first == index_nulls_first &&
+				  sort_operator == get_opfamily_member(opfamily,
+													   opcintype,
+													   opcintype,
+													   index_desc ? BTGreaterStrategyNumber :
+																	BTLessStrategyNumber);
+		backward = backward && nulls_first != index_nulls_first &&
+				   sort_operator == get_opfamily_member(opfamily,
+														opcintype,
+														opcintype,
+														index_desc ? BTLessStrategyNumber :
+																	 BTGreaterStrategyNumber);
+	}
+
+	index_close(index_rel, AccessShareLock);
+
+	if (!forward && !backward)
+		return InvalidOid;
+
+	*direction = forward ? ForwardScanDirection : BackwardScanDirection;
+	return index_relid;
+}
+
+static void
+sorted_rows_begin(SortedRows *rows, Relation in_rel, int n_keys, const ColumnCompressionInfo **keys,
+				  Snapshot snapshot, const SegmentPartition *partition)
+{
+	Oid index_relid;
+
+	*rows = (SortedRows){
+		.index_direction = ForwardScanDirection,
+		.partition = partition,
+	};
+
+	index_relid = compress_chunk_find_ordered_index(in_rel, n_keys, keys, &rows->index_direction);
+
+	if (OidIsValid(index_relid))
+	{
+		rows->index_rel = index_open(index_relid, AccessShareLock);
+		rows->index_scan = index_beginscan(in_rel, rows->index_rel, snapshot, 0, 0);
+		index_rescan(rows->index_scan, NULL, 0, NULL, 0);
+		sorted_rows_index_scans++;
+	}
+	else
+	{
+		rows->sorted = compress_chunk_sort_relation(in_rel, n_keys, keys, snapshot, partition);
+		sorted_rows_sorts++;
+	}
+}
+
+static bool
+sorted_rows_next(SortedRows *rows, TupleTableSlot *slot)
+{
+	HeapTuple tuple;
+
+	if (rows->sorted != NULL)
+		return tuplesort_gettupleslot(rows->sorted,
+									  true /*=forward*/,
+#if !PG96
+									  false /*=copy*/,
+#endif
+									  slot,
+									  NULL /*=abbrev*/);
+
+	while ((tuple = index_getnext(rows->index_scan, rows->index_direction)) != NULL)
+	{
+		if (rows->partition != NULL &&
+			!segment_partition_contains(rows->partition, tuple, slot->tts_tupleDescriptor))
+			continue;
+
+		ExecStoreTuple(tuple, slot, rows->index_scan->xs_cbuf, false);
+		return true;
+	}
+
+	return false;
+}
+
+static void
+sorted_rows_end(SortedRows *rows)
+{
+	if (rows->sorted != NULL)
+		tuplesort_end(rows->sorted);
+	else
+	{
+		index_endscan(rows->index_scan);
+		index_close(rows->index_rel, AccessShareLock);
+	}
+}
+
+/*
+ * Get the number of times this backend read the rows to compress through an
+ * ordered index and the number of times it sorted them, for testing.
+ */
+void
+compress_chunk_sorted_rows_stats(int64 *index_scans, int64 *sorts)
+{
+	*index_scans = sorted_rows_index_scans;
+	*sorts = sorted_rows_sorts;
+}
+
+/*****************************
+ ** parallel compress_chunk **
+ *****************************/
+
+/*
+ * Chunks with segment by columns can be compressed in parallel: the segments
+ * are partitioned by the hash of their segment by values, and each parallel
+ * worker sorts and compresses the rows of one partition at a time. Since every
+ * segment is compressed by a single worker, the sequence numbers are still
+ * increasing within each segment, which is all that decompression relies on.
+ *
+ * Parallel workers cannot insert, so they send the compressed rows to the
+ * leader through a tuple queue each. The leader collects them in a tuplestore
+ * and inserts them once it has left parallel mode. Compressing and sorting,
+ * which dominate the cost, are done in parallel, while writing the compressed
+ * chunk, including TOAST, remains serial.
+ *
+ * Every partition is a separate scan of the chunk, which synchronized scans
+ * keep close to a single pass over the chunk when the workers run
+ * concurrently.
+ */
+
+/* parallel workers run the compression, their queues need not be large */
+#define PARALLEL_COMPRESS_QUEUE_SIZE 65536
+
+#define PARALLEL_COMPRESS_KEY_SHARED UINT64CONST(0xE000000000000001)
+#define PARALLEL_COMPRESS_KEY_QUEUES UINT64CONST(0xE000000000000002)
+
+/* chunks compressed in parallel by this backend and the workers launched for them */
+static int64 parallel_compress_chunks = 0;
+static int64 parallel_compress_workers = 0;
+
+typedef struct ParallelCompressShared
+{
+	Oid in_table;
+	Oid out_table;
+	int32 batch_size;
+	bool adaptive_algorithms;
+	uint32 num_partitions;
+	/* the next partition to compress */
+	pg_atomic_uint32 next_partition;
+	/* the number of partitions that were compressed completely */
+	pg_atomic_uint32 partitions_done;
+	int num_compression_infos;
+	ColumnCompressionInfo column_compression_info[FLEXIBLE_ARRAY_MEMBER];
+} ParallelCompressShared;
+
+struct SegmentPartition
+{
+	int n_segment_keys;
+	AttrNumber *attnums;
+	Oid *collations;
+	FmgrInfo *hash_fns;
+	uint32 num_partitions;
+	uint32 partition;
+};
+
+/*
+ * Set up partitioning by the segment by columns, the first keys. Returns NULL
+ * if there are no segment by columns or one of them cannot be hashed.
+ */
+static SegmentPartition *
+segment_partition_create(Relation in_rel, int n_keys, const ColumnCompressionInfo **keys,
+						 uint32 num_partitions)
+{
+	TupleDesc tupdesc = RelationGetDescr(in_rel);
+	SegmentPartition *partition;
+	int n_segment_keys = 0;
+	int i;
+
+	while (n_segment_keys < n_keys && COMPRESSIONCOL_IS_SEGMENT_BY(keys[n_segment_keys]))
+		n_segment_keys++;
+
+	if (n_segment_keys == 0)
+		return NULL;
+
+	partition = palloc(sizeof(*partition));
+	*partition = (SegmentPartition){
+		.n_segment_keys = n_segment_keys,
+		.attnums = palloc(sizeof(*partition->attnums) * n_segment_keys),
+		.collations = palloc(sizeof(*partition->collations) * n_segment_keys),
+		.hash_fns = palloc(sizeof(*partition->hash_fns) * n_segment_keys),
+		.num_partitions = num_partitions,
+		.partition = 0,
+	};
+
+	for (i = 0; i < n_segment_keys; i++)
+	{
+		AttrNumber attnum = get_attnum(RelationGetRelid(in_rel), NameStr(keys[i]->attname));
+		Form_pg_attribute attr;
+		TypeCacheEntry *tentry;
+
+		if (!AttributeNumberIsValid(attnum))
+			elog(ERROR, "could not find column \"%s\"", NameStr(keys[i]->attname));
+
+		attr = TupleDescAttr(tupdesc, AttrNumberGetAttrOffset(attnum));
+		tentry = lookup_type_cache(attr->atttypid, TYPECACHE_HASH_PROC_FINFO);
+		if (!OidIsValid(tentry->hash_proc))
+			return NULL;
+
+		partition->attnums[i] = attnum;
+		partition->collations[i] = attr->attcollation;
+		fmgr_info_copy(&partition->hash_fns[i], &tentry->hash_proc_finfo, CurrentMemoryContext);
+	}
+
+	return partition;
+}
+
+/* Does the tuple belong to a segment of the partition? */
+static bool
+segment_partition_contains(const SegmentPartition *partition, HeapTuple tuple, TupleDesc tupdesc)
+{
+	uint32 hash = 0;
+	int i;
+
+	for (i = 0; i < partition->n_segment_keys; i++)
+	{
+		bool is_null;
+		Datum value = heap_getattr(tuple, partition->attnums[i], tupdesc, &is_null);
+
+		/* rotate and xor, like the hash of grouping columns */
+		hash = (hash << 1) | ((hash & 0x80000000) ? 1 : 0);
+
+		/* NULL hashes to 0 */
+		if (!is_null)
+			hash ^= DatumGetUInt32(FunctionCall1Coll(&partition->hash_fns[i],
+													  partition->collations[i],
+													  value));
+	}
+
+	return hash % partition->num_partitions == partition->partition;
+}
+
+/*
+ * Entry point of the parallel workers: compress partitions until there are
+ * none left.
+ */
+void
+tsl_compress_chunk_parallel_worker(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCompressShared *shared =
+		shm_toc_lookup_compat(toc, PARALLEL_COMPRESS_KEY_SHARED, false);
+	char *queues = shm_toc_lookup_compat(toc, PARALLEL_COMPRESS_KEY_QUEUES, false);
+	shm_mq *mq = (shm_mq *) (queues + ParallelWorkerNumber * PARALLEL_COMPRESS_QUEUE_SIZE);
+	shm_mq_handle *mqh;
+	const ColumnCompressionInfo **column_compression_info =
+		palloc(sizeof(*column_compression_info) * shared->num_compression_infos);
+	Relation in_rel;
+	Relation out_rel;
+	int16 *in_column_offsets;
+	int n_keys;
+	const ColumnCompressionInfo **keys;
+	SegmentPartition *partition;
+	uint32 partition_num;
+	int i;
+
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* the leader already holds stronger locks on both */
+	in_rel = relation_open(shared->in_table, AccessShareLock);
+	out_rel = relation_open(shared->out_table, AccessShareLock);
+
+	for (i = 0; i < shared->num_compression_infos; i++)
+		column_compression_info[i] = &shared->column_compression_info[i];
+
+	in_column_offsets = compress_chunk_populate_keys(shared->in_table,
+													 column_compression_info,
+													 shared->num_compression_infos,
+													 &n_keys,
+													 &keys);
+	partition = segment_partition_create(in_rel, n_keys, keys, shared->num_partitions);
+	if (partition == NULL)
+		elog(ERROR,
+			 "cannot partition the segments of chunk \"%s\"",
+			 get_rel_name(shared->in_table));
+
+	for (partition_num = pg_atomic_fetch_add_u32(&shared->next_partition, 1);
+		 partition_num < shared->num_partitions;
+		 partition_num = pg_atomic_fetch_add_u32(&shared->next_partition, 1))
+	{
+		partition->partition = partition_num;
+		compress_chunk_rows(in_rel,
+							out_rel,
+							column_compression_info,
+							shared->num_compression_infos,
+							in_column_offsets,
+							n_keys,
+							keys,
+							shared->batch_size,
+							shared->adaptive_algorithms,
+							GetActiveSnapshot(),
+							partition,
+							mqh);
+		pg_atomic_fetch_add_u32(&shared->partitions_done, 1);
+	}
+
+	relation_close(out_rel, AccessShareLock);
+	relation_close(in_rel, AccessShareLock);
+}
+
+/*
+ * Collect the compressed rows from the queues of the workers until all of
+ * them are done.
+ */
+static void
+compress_chunk_parallel_receive(shm_mq_handle **queues, int num_queues,
+								Tuplestorestate *compressed_rows)
+{
+	bool *done = palloc0(sizeof(*done) * num_queues);
+	int num_done = 0;
+
+	while (num_done < num_queues)
+	{
+		bool received = false;
+		int i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < num_queues; i++)
+		{
+			while (!done[i])
+			{
+				HeapTupleData tuple;
+				Size nbytes;
+				void *data;
+				shm_mq_result result = shm_mq_receive(queues[i], &nbytes, &data, true);
+
+				if (result == SHM_MQ_WOULD_BLOCK)
+					break;
+
+				if (result == SHM_MQ_DETACHED)
+				{
+					done[i] = true;
+					num_done++;
+					break;
+				}
+
+				tuple.t_len = nbytes;
+				ItemPointerSetInvalid(&tuple.t_self);
+				tuple.t_tableOid = InvalidOid;
+				tuple.t_data = data;
+				tuplestore_puttuple(compressed_rows, &tuple);
+				received = true;
+			}
+		}
+
+		if (!received && num_done < num_queues)
+		{
+			WaitLatchCompat(MyLatch, WL_LATCH_SET, 0);
+			ResetLatch(MyLatch);
+		}
+	}
+
+	pfree(done);
+}
+
+static void
+compress_chunk_insert_rows(Relation out_rel, Tuplestorestate *compressed_rows)
+{
+	CommandId mycid = GetCurrentCommandId(true);
+	BulkInsertState bistate = GetBulkInsertState();
+	TupleTableSlot *slot = MakeTupleTableSlotCompat(RelationGetDescr(out_rel));
+
+	while (tuplestore_gettupleslot(compressed_rows, true /*=forward*/, false /*=copy*/, slot))
+	{
+		HeapTuple tuple = ExecCopySlotTuple(slot);
+
+		heap_insert(out_rel, tuple, mycid, 0 /*=options*/, bistate);
+		heap_freetuple(tuple);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	FreeBulkInsertState(bistate);
+}
+
+static void
+compress_chunk_parallel_cleanup(ParallelContext *pcxt)
+{
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+	PopActiveSnapshot();
+}
+
+/*
+ * Compress in_rel into out_rel with parallel workers. Returns false, without
+ * compressing anything, if the chunk is not compressed in parallel.
+ */
+static bool
+compress_chunk_parallel(Relation in_rel, Relation out_rel,
+						const ColumnCompressionInfo **column_compression_info,
+						int num_compression_infos, int n_keys, const ColumnCompressionInfo **keys,
+						int32 batch_size, bool adaptive_algorithms)
+{
+	int nworkers = ts_guc_max_parallel_compression_workers;
+	Size shared_size = add_size(offsetof(ParallelCompressShared, column_compression_info),
+								mul_size(sizeof(ColumnCompressionInfo), num_compression_infos));
+	ParallelContext *pcxt;
+	ParallelCompressShared *shared;
+	char *queue_space;
+	shm_mq_handle **queues;
+	Tuplestorestate *compressed_rows;
+	bool all_partitions_done;
+	int nworkers_launched;
+	int i;
+
+	if (nworkers <= 0 || IsInParallelMode() ||
+		RelationGetNumberOfBlocks(in_rel) < (BlockNumber) min_parallel_table_scan_size ||
+		segment_partition_create(in_rel, n_keys, keys, 1) == NULL)
+		return false;
+
+	/*
+	 * The workers scan the chunk with the active snapshot of the leader. It
+	 * must see the same rows as the serial compression.
+	 */
+	PushActiveSnapshot(GetLatestSnapshot());
+	EnterParallelMode();
+
+	pcxt = CreateParallelContextCompat(TS_LIBDIR TSL_LIBRARY_NAME "-" TIMESCALEDB_VERSION_MOD,
+									   "tsl_compress_chunk_parallel_worker",
+									   nworkers);
+	shm_toc_estimate_chunk(&pcxt->estimator, shared_size);
+	shm_toc_estimate_chunk(&pcxt->estimator, mul_size(PARALLEL_COMPRESS_QUEUE_SIZE, nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+	InitializeParallelDSM(pcxt);
+
+	/* no workers can be used, e.g., because there was no dynamic shared memory */
+	if (pcxt->nworkers == 0)
+	{
+		compress_chunk_parallel_cleanup(pcxt);
+		return false;
+	}
+
+	shared = shm_toc_allocate(pcxt->toc, shared_size);
+	shared->in_table = RelationGetRelid(in_rel);
+	shared->out_table = RelationGetRelid(out_rel);
+	shared->batch_size = batch_size;
+	shared->adaptive_algorithms = adaptive_algorithms;
+	shared->num_partitions = pcxt->nworkers;
+	pg_atomic_init_u32(&shared->next_partition, 0);
+	pg_atomic_init_u32(&shared->partitions_done, 0);
+	shared->num_compression_infos = num_compression_infos;
+	for (i = 0; i < num_compression_infos; i++)
+		shared->column_compression_info[i] = *column_compression_info[i];
+	shm_toc_insert(pcxt->toc, PARALLEL_COMPRESS_KEY_SHARED, shared);
+
+	queue_space = shm_toc_allocate(pcxt->toc, PARALLEL_COMPRESS_QUEUE_SIZE * pcxt->nworkers);
+	shm_toc_insert(pcxt->toc, PARALLEL_COMPRESS_KEY_QUEUES, queue_space);
+	queues = palloc(sizeof(*queues) * pcxt->nworkers);
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq *mq = shm_mq_create(queue_space + i * PARALLEL_COMPRESS_QUEUE_SIZE,
+								   PARALLEL_COMPRESS_QUEUE_SIZE);
+
+		shm_mq_set_receiver(mq, MyProc);
+		queues[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+
+	LaunchParallelWorkers(pcxt);
+
+	if (pcxt->nworkers_launched == 0)
+	{
+		compress_chunk_parallel_cleanup(pcxt);
+		return false;
+	}
+
+	/* workers that fail to start detach from their queue */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		shm_mq_set_handle(queues[i], pcxt->worker[i].bgwhandle);
+
+	compressed_rows = tuplestore_begin_heap(false /*=randomAccess*/, false, work_mem);
+	compress_chunk_parallel_receive(queues, pcxt->nworkers_launched, compressed_rows);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* the partitions of workers that failed to start are taken by others */
+	all_partitions_done = pg_atomic_read_u32(&shared->partitions_done) == shared->num_partitions;
+	nworkers_launched = pcxt->nworkers_launched;
+
+	compress_chunk_parallel_cleanup(pcxt);
+
+	if (!all_partitions_done)
+		elog(ERROR,
+			 "parallel compression of chunk \"%s\" did not compress all segments",
+			 RelationGetRelationName(in_rel));
+
+	compress_chunk_insert_rows(out_rel, compressed_rows);
+	tuplestore_end(compressed_rows);
+
+	parallel_compress_chunks++;
+	parallel_compress_workers += nworkers_launched;
+
+	return true;
+}
+
+/*
+ * Get the number of chunks this backend compressed in parallel and the number
+ * of parallel workers launched for them, for testing.
+ */
+void
+compress_chunk_parallel_stats(int64 *chunks, int64 *workers)
+{
+	*chunks = parallel_compress_chunks;
+	*workers = parallel_compress_workers;
+}
+
 /********************
  ** row_compressor **
  ********************/
@@ -408,8 +1096,12 @@ static bool row_compressor_new_row_is_in_new_group(RowCompressor *row_compressor
 static void row_compressor_append_row(RowCompressor *row_compressor, TupleTableSlot *row);
 static void row_compressor_flush(RowCompressor *row_compressor, CommandId mycid,
 								 bool changed_groups);
+static void row_compressor_adapt_batch_size(RowCompressor *row_compressor,
+											Size max_compressed_size, bool changed_groups);
 
 static SegmentInfo *segment_info_new(Form_pg_attribute column_attr);
+static Compressor *adaptive_compressor_for_type(CompressionAlgorithms default_algorithm,
+												Form_pg_attribute column_attr);
 static void segment_info_update(SegmentInfo *segment_info, Datum val, bool is_null);
 static bool segment_info_datum_is_in_group(SegmentInfo *segment_info, Datum datum, bool is_null);
 
@@ -418,8 +1110,10 @@ static void
 row_compressor_init(RowCompressor *row_compressor, TupleDesc uncompressed_tuple_desc,
 					Relation compressed_table, int num_compression_infos,
 					const ColumnCompressionInfo **column_compression_info, int16 *in_column_offsets,
-					int16 num_columns_in_compressed_table)
+					int16 num_columns_in_compressed_table, int32 batch_size,
+					bool adaptive_algorithms)
 {
+	bool adaptive_batch_size = batch_size == HYPERTABLE_COMPRESSION_BATCH_SIZE_ADAPTIVE;
 	TupleDesc out_desc = RelationGetDescr(compressed_table);
 	int col;
 	Name count_metadata_name = DatumGetName(
@@ -459,9 +1153,15 @@ row_compressor_init(RowCompressor *row_compressor, TupleDesc uncompressed_tuple_
 		.compressed_values = palloc(sizeof(Datum) * num_columns_in_compressed_table),
 		.compressed_is_null = palloc(sizeof(bool) * num_columns_in_compressed_table),
 		.rows_compressed_into_current_value = 0,
+		.rows_per_compressed_row = adaptive_batch_size ? DEFAULT_ROWS_PER_COMPRESSION : batch_size,
+		.adaptive_batch_size = adaptive_batch_size,
+		.compressed_bytes_per_row = 0,
 		.sequence_num = SEQUENCE_NUM_GAP,
+		.tuple_queue = NULL,
 	};
 
+	Assert(batch_size >= 0);
+
 	memset(row_compressor->compressed_is_null, 1, sizeof(bool) * num_columns_in_compressed_table);
 
 	for (col = 0; col < num_compression_infos; col++)
@@ -482,13 +1182,17 @@ row_compressor_init(RowCompressor *row_compressor, TupleDesc uncompressed_tuple_
 		{
 			int16 segment_min_attr_offset = -1;
 			int16 segment_max_attr_offset = -1;
+			int16 segment_null_count_attr_offset = -1;
 			SegmentMetaMinMaxBuilder *segment_min_max_builder = NULL;
+			int16 segment_bloom_attr_offset = -1;
+			SegmentMetaBloomBuilder *segment_bloom_builder = NULL;
 			if (compressed_column_attr->atttypid != compressed_data_type_oid)
 				elog(ERROR,
 					 "expected column '%s' to be a compressed data type",
 					 compression_info->attname.data);
 
-			if (compression_info->orderby_column_index > 0)
+			if (compression_info->orderby_column_index > 0 ||
+				compression_info->minmax_column_index > 0)
 			{
 				char *segment_min_col_name = compression_column_segment_min_name(compression_info);
 				char *segment_max_col_name = compression_column_segment_max_name(compression_info);
@@ -506,12 +1210,43 @@ row_compressor_init(RowCompressor *row_compressor, TupleDesc uncompressed_tuple_
 					segment_meta_min_max_builder_create(column_attr->atttypid,
 														column_attr->attcollation);
 			}
+			if (compression_info->orderby_column_index <= 0 &&
+				compression_info->minmax_column_index > 0)
+			{
+				char *segment_null_count_col_name =
+					compression_column_segment_null_count_name(compression_info);
+				AttrNumber segment_null_count_attr_number =
+					get_attnum(compressed_table->rd_id, segment_null_count_col_name);
+				if (segment_null_count_attr_number == InvalidAttrNumber)
+					elog(ERROR, "couldn't find metadata column %s", segment_null_count_col_name);
+				segment_null_count_attr_offset =
+					AttrNumberGetAttrOffset(segment_null_count_attr_number);
+			}
+			if (compression_info->bloom_column_index > 0)
+			{
+				char *segment_bloom_col_name =
+					compression_column_segment_bloom_name(compression_info);
+				AttrNumber segment_bloom_attr_number =
+					get_attnum(compressed_table->rd_id, segment_bloom_col_name);
+				if (segment_bloom_attr_number == InvalidAttrNumber)
+					elog(ERROR, "couldn't find metadata column %s", segment_bloom_col_name);
+				segment_bloom_attr_offset = AttrNumberGetAttrOffset(segment_bloom_attr_number);
+				segment_bloom_builder =
+					segment_meta_bloom_builder_create(column_attr->atttypid,
+													  column_attr->attcollation);
+			}
 			*column = (PerColumn){
-				.compressor = compressor_for_algorithm_and_type(compression_info->algo_id,
-																column_attr->atttypid),
+				.compressor =
+					adaptive_algorithms ?
+						adaptive_compressor_for_type(compression_info->algo_id, column_attr) :
+						compressor_for_algorithm_and_type(compression_info->algo_id,
+														  column_attr->atttypid),
 				.min_metadata_attr_offset = segment_min_attr_offset,
 				.max_metadata_attr_offset = segment_max_attr_offset,
+				.null_count_metadata_attr_offset = segment_null_count_attr_offset,
 				.min_max_metadata_builder = segment_min_max_builder,
+				.bloom_metadata_attr_offset = segment_bloom_attr_offset,
+				.bloom_metadata_builder = segment_bloom_builder,
 			};
 		}
 		else
@@ -524,35 +1259,24 @@ row_compressor_init(RowCompressor *row_compressor, TupleDesc uncompressed_tuple_
 				.segment_info = segment_info_new(column_attr),
 				.min_metadata_attr_offset = -1,
 				.max_metadata_attr_offset = -1,
+				.null_count_metadata_attr_offset = -1,
+				.bloom_metadata_attr_offset = -1,
 			};
 		}
 	}
 }
 
 static void
-row_compressor_append_sorted_rows(RowCompressor *row_compressor, Tuplesortstate *sorted_rel,
+row_compressor_append_sorted_rows(RowCompressor *row_compressor, SortedRows *sorted_rows,
 								  TupleDesc sorted_desc)
 {
-	CommandId mycid = GetCurrentCommandId(true);
+	/* parallel workers cannot insert, the leader does that for them */
+	CommandId mycid =
+		row_compressor->tuple_queue == NULL ? GetCurrentCommandId(true) : InvalidCommandId;
 	TupleTableSlot *slot = MakeTupleTableSlotCompat(sorted_desc);
-	bool got_tuple;
 	bool first_iteration = true;
 
-	for (got_tuple = tuplesort_gettupleslot(sorted_rel,
-											true /*=forward*/,
-#if !PG96
-											false /*=copy*/,
-#endif
-											slot,
-											NULL /*=abbrev*/);
-		 got_tuple;
-		 got_tuple = tuplesort_gettupleslot(sorted_rel,
-											true /*=forward*/,
-#if !PG96
-											false /*=copy*/,
-#endif
-											slot,
-											NULL /*=abbrev*/))
+	while (sorted_rows_next(sorted_rows, slot))
 	{
 		bool changed_groups, compressed_row_is_full;
 		MemoryContext old_ctx;
@@ -568,7 +1292,8 @@ row_compressor_append_sorted_rows(RowCompressor *row_compressor, Tuplesortstate
 
 		changed_groups = row_compressor_new_row_is_in_new_group(row_compressor, slot);
 		compressed_row_is_full =
-			row_compressor->rows_compressed_into_current_value >= MAX_ROWS_PER_COMPRESSION;
+			row_compressor->rows_compressed_into_current_value >=
+			row_compressor->rows_per_compressed_row;
 		if (compressed_row_is_full || changed_groups)
 		{
 			if (row_compressor->rows_compressed_into_current_value > 0)
@@ -670,6 +1395,10 @@ row_compressor_append_row(RowCompressor *row_compressor, TupleTableSlot *row)
 				segment_meta_min_max_builder_update_val(row_compressor->per_column[col]
 															.min_max_metadata_builder,
 														val);
+			if (row_compressor->per_column[col].bloom_metadata_builder != NULL)
+				segment_meta_bloom_builder_update_val(row_compressor->per_column[col]
+														  .bloom_metadata_builder,
+													  val);
 		}
 	}
 
@@ -681,6 +1410,7 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 {
 	int16 col;
 	HeapTuple compressed_tuple;
+	Size max_compressed_size = 0;
 
 	for (col = 0; col < row_compressor->n_input_columns; col++)
 	{
@@ -705,8 +1435,11 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 			/* non-segment columns are NULL iff all the values are NULL */
 			row_compressor->compressed_is_null[compressed_col] = compressed_data == NULL;
 			if (compressed_data != NULL)
+			{
 				row_compressor->compressed_values[compressed_col] =
 					PointerGetDatum(compressed_data);
+				max_compressed_size = Max(max_compressed_size, VARSIZE_ANY(compressed_data));
+			}
 
 			if (column->min_max_metadata_builder != NULL)
 			{
@@ -730,6 +1463,30 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 					row_compressor->compressed_is_null[column->min_metadata_attr_offset] = true;
 					row_compressor->compressed_is_null[column->max_metadata_attr_offset] = true;
 				}
+
+				if (column->null_count_metadata_attr_offset >= 0)
+				{
+					row_compressor->compressed_is_null[column->null_count_metadata_attr_offset] =
+						false;
+					row_compressor->compressed_values[column->null_count_metadata_attr_offset] =
+						Int32GetDatum(segment_meta_min_max_builder_null_count(
+							column->min_max_metadata_builder));
+				}
+			}
+
+			if (column->bloom_metadata_builder != NULL)
+			{
+				Assert(column->bloom_metadata_attr_offset >= 0);
+
+				/* like min/max, the filter is NULL iff all the values are NULL */
+				if (!segment_meta_bloom_builder_empty(column->bloom_metadata_builder))
+				{
+					row_compressor->compressed_is_null[column->bloom_metadata_attr_offset] = false;
+					row_compressor->compressed_values[column->bloom_metadata_attr_offset] =
+						segment_meta_bloom_builder_finish(column->bloom_metadata_builder);
+				}
+				else
+					row_compressor->compressed_is_null[column->bloom_metadata_attr_offset] = true;
 			}
 		}
 		else if (column->segment_info != NULL)
@@ -756,11 +1513,25 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 	compressed_tuple = heap_form_tuple(RelationGetDescr(row_compressor->compressed_table),
 									   row_compressor->compressed_values,
 									   row_compressor->compressed_is_null);
-	heap_insert(row_compressor->compressed_table,
-				compressed_tuple,
-				mycid,
-				0 /*=options*/,
-				row_compressor->bistate);
+	if (row_compressor->tuple_queue != NULL)
+	{
+		if (shm_mq_send(row_compressor->tuple_queue,
+						compressed_tuple->t_len,
+						compressed_tuple->t_data,
+						false /*=nowait*/) != SHM_MQ_SUCCESS)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("could not send compressed row to the parallel leader")));
+	}
+	else
+		heap_insert(row_compressor->compressed_table,
+					compressed_tuple,
+					mycid,
+					0 /*=options*/,
+					row_compressor->bistate);
+
+	if (row_compressor->adaptive_batch_size)
+		row_compressor_adapt_batch_size(row_compressor, max_compressed_size, changed_groups);
 
 	/* free the compressed values now that we're done with them (the old compressor is freed in
 	 * finish()) */
@@ -773,16 +1544,8 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 
 		compressed_col = row_compressor->uncompressed_col_to_compressed_col[col];
 		Assert(compressed_col >= 0);
-		if (row_compressor->compressed_is_null[compressed_col])
-			continue;
-
-		/* don't free the segment-bys if we've overflowed the row, we still need them */
-		if (column->segment_info != NULL && !changed_groups)
-			continue;
-
-		if (column->compressor != NULL || !column->segment_info->typ_by_val)
-			pfree(DatumGetPointer(row_compressor->compressed_values[compressed_col]));
 
+		/* the NULL count must also be reset for segments that are all NULL */
 		if (column->min_max_metadata_builder != NULL)
 		{
 			/* segment_meta_min_max_builder_reset will free the values, so  clear here */
@@ -799,6 +1562,28 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 			segment_meta_min_max_builder_reset(column->min_max_metadata_builder);
 		}
 
+		if (column->bloom_metadata_builder != NULL)
+		{
+			if (!row_compressor->compressed_is_null[column->bloom_metadata_attr_offset])
+			{
+				pfree(DatumGetPointer(
+					row_compressor->compressed_values[column->bloom_metadata_attr_offset]));
+				row_compressor->compressed_values[column->bloom_metadata_attr_offset] = 0;
+				row_compressor->compressed_is_null[column->bloom_metadata_attr_offset] = true;
+			}
+			segment_meta_bloom_builder_reset(column->bloom_metadata_builder);
+		}
+
+		if (row_compressor->compressed_is_null[compressed_col])
+			continue;
+
+		/* don't free the segment-bys if we've overflowed the row, we still need them */
+		if (column->segment_info != NULL && !changed_groups)
+			continue;
+
+		if (column->compressor != NULL || !column->segment_info->typ_by_val)
+			pfree(DatumGetPointer(row_compressor->compressed_values[compressed_col]));
+
 		row_compressor->compressed_values[compressed_col] = 0;
 		row_compressor->compressed_is_null[compressed_col] = true;
 	}
@@ -807,6 +1592,58 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 	MemoryContextReset(row_compressor->per_row_ctx);
 }
 
+/*
+ * Adaptive batch size (timescaledb.compress_batch_size = 'adaptive').
+ *
+ * Compressed values too large for the heap tuple are stored in TOAST chunks of
+ * TOAST_MAX_CHUNK_SIZE bytes, four to a page. The widest compressed column
+ * of a batch dominates how much has to be detoasted to read the batch. So the
+ * batches are sized such that the widest column fills
+ * ADAPTIVE_BATCH_TOAST_CHUNKS TOAST chunks, i.e. four full TOAST pages. The
+ * target size is the middle of the last chunk, so that small errors in the
+ * estimate neither spill into an additional, mostly empty chunk nor leave the
+ * last one mostly empty.
+ *
+ * Columns that compress well thus get larger batches, which improves the
+ * compression ratio, while wide columns get smaller batches, which keeps the
+ * per-batch decompression cost bounded. The size per row is estimated from the
+ * previous batches of the chunk. Batches flushed because the segment (or the
+ * chunk) ended are usually cut short and compress worse than full batches, so
+ * they do not update the estimate.
+ */
+#define ADAPTIVE_BATCH_TOAST_CHUNKS 16
+#define ADAPTIVE_BATCH_TARGET_SIZE                                                                 \
+	((ADAPTIVE_BATCH_TOAST_CHUNKS - 1) * TOAST_MAX_CHUNK_SIZE + TOAST_MAX_CHUNK_SIZE / 2)
+#define ADAPTIVE_BATCH_MIN_ROWS 100
+#define ADAPTIVE_BATCH_MAX_ROWS 10000
+
+static void
+row_compressor_adapt_batch_size(RowCompressor *row_compressor, Size max_compressed_size,
+								bool changed_groups)
+{
+	uint32 rows = row_compressor->rows_compressed_into_current_value;
+	double bytes_per_row;
+	double batch_size;
+
+	if (changed_groups || rows < ADAPTIVE_BATCH_MIN_ROWS || max_compressed_size == 0)
+		return;
+
+	bytes_per_row = (double) max_compressed_size / rows;
+
+	/* smooth the estimate, the size per row varies from batch to batch */
+	if (row_compressor->compressed_bytes_per_row > 0)
+		bytes_per_row = (row_compressor->compressed_bytes_per_row + bytes_per_row) / 2;
+	row_compressor->compressed_bytes_per_row = bytes_per_row;
+
+	batch_size = ADAPTIVE_BATCH_TARGET_SIZE / bytes_per_row;
+	if (batch_size < ADAPTIVE_BATCH_MIN_ROWS)
+		batch_size = ADAPTIVE_BATCH_MIN_ROWS;
+	if (batch_size > ADAPTIVE_BATCH_MAX_ROWS)
+		batch_size = ADAPTIVE_BATCH_MAX_ROWS;
+
+	row_compressor->rows_per_compressed_row = (uint32) batch_size;
+}
+
 static void
 row_compressor_finish(RowCompressor *row_compressor)
 {
@@ -883,6 +1720,271 @@ segment_info_datum_is_in_group(SegmentInfo *segment_info, Datum datum, bool is_n
 	return DatumGetBool(data_is_eq);
 }
 
+/*************************
+ ** adaptive_compressor **
+ *************************/
+
+/*
+ * Adaptive compression (timescaledb.compress_adaptive_algorithms).
+ *
+ * The compressor buffers the values of a batch. When the batch is finished, a
+ * sample of it is encoded with every algorithm that supports the type of the
+ * column, and the batch is compressed with the algorithm that produced the
+ * smallest output. Ties go to the algorithm configured for the column. Every
+ * compressed value starts with the id of its algorithm, so decompression does
+ * not need to know which one was chosen.
+ *
+ * Batches of up to ADAPTIVE_TRIAL_SAMPLE_SIZE values are encoded completely
+ * with every algorithm and the output of the winner is used as is. For larger
+ * batches the sample is made of runs of consecutive values spread over the
+ * batch, so that delta and XOR based encodings see representative input while
+ * the cost of the trials stays bounded.
+ */
+#define ADAPTIVE_TRIAL_RUNS 4
+#define ADAPTIVE_TRIAL_RUN_LENGTH 64
+#define ADAPTIVE_TRIAL_SAMPLE_SIZE (ADAPTIVE_TRIAL_RUNS * ADAPTIVE_TRIAL_RUN_LENGTH)
+
+typedef struct AdaptiveCompressor
+{
+	Compressor base;
+	/* the compressors of the candidate algorithms, the configured one first */
+	int num_candidates;
+	Compressor *candidates[_END_COMPRESSION_ALGORITHMS];
+	int16 typlen;
+	bool typbyval;
+	/* the values of the current batch, allocated in the per-row context */
+	Datum *values;
+	bool *nulls;
+	uint32 num_values;
+	uint32 max_values;
+	bool has_non_null;
+} AdaptiveCompressor;
+
+static void
+adaptive_compressor_append(AdaptiveCompressor *adaptive, Datum val, bool is_null)
+{
+	if (adaptive->values == NULL)
+	{
+		adaptive->max_values = DEFAULT_ROWS_PER_COMPRESSION;
+		adaptive->values = palloc(sizeof(*adaptive->values) * adaptive->max_values);
+		adaptive->nulls = palloc(sizeof(*adaptive->nulls) * adaptive->max_values);
+	}
+	else if (adaptive->num_values == adaptive->max_values)
+	{
+		adaptive->max_values *= 2;
+		adaptive->values =
+			repalloc(adaptive->values, sizeof(*adaptive->values) * adaptive->max_values);
+		adaptive->nulls =
+			repalloc(adaptive->nulls, sizeof(*adaptive->nulls) * adaptive->max_values);
+	}
+
+	/* the value is only valid as long as the row it came from */
+	adaptive->values[adaptive->num_values] =
+		is_null ? (Datum) 0 : datumCopy(val, adaptive->typbyval, adaptive->typlen);
+	adaptive->nulls[adaptive->num_values] = is_null;
+	adaptive->num_values++;
+	adaptive->has_non_null |= !is_null;
+}
+
+static void
+adaptive_compressor_append_val(Compressor *compressor, Datum val)
+{
+	adaptive_compressor_append((AdaptiveCompressor *) compressor, val, false);
+}
+
+static void
+adaptive_compressor_append_null(Compressor *compressor)
+{
+	adaptive_compressor_append((AdaptiveCompressor *) compressor, (Datum) 0, true);
+}
+
+static void
+adaptive_compressor_add_values(AdaptiveCompressor *adaptive, Compressor *compressor,
+							   uint32 start, uint32 end)
+{
+	uint32 i;
+
+	for (i = start; i < end; i++)
+	{
+		if (adaptive->nulls[i])
+			compressor->append_null(compressor);
+		else
+			compressor->append_val(compressor, adaptive->values[i]);
+	}
+}
+
+/* Encode the sample of the batch, or the whole batch if it is small */
+static void *
+adaptive_compressor_encode_sample(AdaptiveCompressor *adaptive, Compressor *compressor)
+{
+	uint32 run;
+
+	if (adaptive->num_values <= ADAPTIVE_TRIAL_SAMPLE_SIZE)
+	{
+		adaptive_compressor_add_values(adaptive, compressor, 0, adaptive->num_values);
+		return compressor->finish(compressor);
+	}
+
+	for (run = 0; run < ADAPTIVE_TRIAL_RUNS; run++)
+	{
+		uint32 start = (uint64) run * (adaptive->num_values - ADAPTIVE_TRIAL_RUN_LENGTH) /
+					   (ADAPTIVE_TRIAL_RUNS - 1);
+
+		adaptive_compressor_add_values(adaptive,
+									   compressor,
+									   start,
+									   start + ADAPTIVE_TRIAL_RUN_LENGTH);
+	}
+
+	return compressor->finish(compressor);
+}
+
+/* Compress the batch with the candidate that encodes the sample the smallest */
+static void *
+adaptive_compressor_compress(AdaptiveCompressor *adaptive)
+{
+	void *compressed = NULL;
+	Size compressed_size = 0;
+	int winner = 0;
+	int i;
+
+	if (adaptive->num_candidates == 1)
+	{
+		adaptive_compressor_add_values(adaptive, adaptive->candidates[0], 0, adaptive->num_values);
+		return adaptive->candidates[0]->finish(adaptive->candidates[0]);
+	}
+
+	for (i = 0; i < adaptive->num_candidates; i++)
+	{
+		void *trial = adaptive_compressor_encode_sample(adaptive, adaptive->candidates[i]);
+		Size trial_size = trial == NULL ? 0 : VARSIZE_ANY(trial);
+
+		if (i == 0 || trial_size < compressed_size)
+		{
+			if (compressed != NULL)
+				pfree(compressed);
+			compressed = trial;
+			compressed_size = trial_size;
+			winner = i;
+		}
+		else if (trial != NULL)
+			pfree(trial);
+	}
+
+	/* the trials of small batches encoded all the values */
+	if (adaptive->num_values <= ADAPTIVE_TRIAL_SAMPLE_SIZE)
+		return compressed;
+
+	if (compressed != NULL)
+		pfree(compressed);
+
+	adaptive_compressor_add_values(adaptive,
+								   adaptive->candidates[winner],
+								   0,
+								   adaptive->num_values);
+	return adaptive->candidates[winner]->finish(adaptive->candidates[winner]);
+}
+
+static void *
+adaptive_compressor_finish(Compressor *compressor)
+{
+	AdaptiveCompressor *adaptive = (AdaptiveCompressor *) compressor;
+	void *compressed = NULL;
+
+	/* like the other compressors, return NULL if all the values are NULL */
+	if (adaptive->has_non_null)
+		compressed = adaptive_compressor_compress(adaptive);
+
+	/* the buffers are freed with the per-row context */
+	adaptive->values = NULL;
+	adaptive->nulls = NULL;
+	adaptive->num_values = 0;
+	adaptive->max_values = 0;
+	adaptive->has_non_null = false;
+
+	return compressed;
+}
+
+static const Compressor adaptive_compressor = {
+	.append_val = adaptive_compressor_append_val,
+	.append_null = adaptive_compressor_append_null,
+	.finish = adaptive_compressor_finish,
+};
+
+/*
+ * Create an adaptive compressor for a column. The candidates are the
+ * configured algorithm of the column and all the others that support its
+ * type.
+ */
+static Compressor *
+adaptive_compressor_for_type(CompressionAlgorithms default_algorithm,
+							 Form_pg_attribute column_attr)
+{
+	Oid type = column_attr->atttypid;
+	AdaptiveCompressor *adaptive = palloc(sizeof(*adaptive));
+	CompressionAlgorithms candidates[_END_COMPRESSION_ALGORITHMS];
+	int num_candidates = 0;
+	TypeCacheEntry *tentry;
+	int i;
+
+	*adaptive = (AdaptiveCompressor){
+		.base = adaptive_compressor,
+		.typlen = column_attr->attlen,
+		.typbyval = column_attr->attbyval,
+	};
+
+	candidates[num_candidates++] = default_algorithm;
+
+	switch (type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			candidates[num_candidates++] = COMPRESSION_ALGORITHM_DELTADELTA;
+			candidates[num_candidates++] = COMPRESSION_ALGORITHM_PFOR;
+			candidates[num_candidates++] = COMPRESSION_ALGORITHM_GORILLA;
+			break;
+		case DATEOID:
+#ifdef HAVE_INT64_TIMESTAMP
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#endif
+			candidates[num_candidates++] = COMPRESSION_ALGORITHM_DELTADELTA;
+			break;
+		case FLOAT4OID:
+		case FLOAT8OID:
+			candidates[num_candidates++] = COMPRESSION_ALGORITHM_ALP;
+			candidates[num_candidates++] = COMPRESSION_ALGORITHM_GORILLA;
+			break;
+		default:
+			break;
+	}
+
+	tentry = lookup_type_cache(type, TYPECACHE_EQ_OPR_FINFO | TYPECACHE_HASH_PROC_FINFO);
+	if (tentry->hash_proc_finfo.fn_addr != NULL && tentry->eq_opr_finfo.fn_addr != NULL)
+		candidates[num_candidates++] = COMPRESSION_ALGORITHM_DICTIONARY;
+
+	candidates[num_candidates++] = COMPRESSION_ALGORITHM_ARRAY;
+
+	Assert(num_candidates <= _END_COMPRESSION_ALGORITHMS);
+
+	for (i = 0; i < num_candidates; i++)
+	{
+		int j;
+		bool duplicate = false;
+
+		/* the configured algorithm is also among the others */
+		for (j = 0; j < i; j++)
+			duplicate |= candidates[j] == candidates[i];
+
+		if (!duplicate)
+			adaptive->candidates[adaptive->num_candidates++] =
+				compressor_for_algorithm_and_type(candidates[i], type);
+	}
+
+	return &adaptive->base;
+}
+
 /**********************
  ** decompress_chunk **
  **********************/
@@ -1373,3 +2475,246 @@ compression_get_toast_storage(CompressionAlgorithms algorithm)
 		elog(ERROR, "invalid compression algorithm %d", algorithm);
 	return definitions[algorithm].compressed_data_storage;
 }
+
+/*
+ * Bulk decompression
+ */
+
+/*
+ * Prepare a column for receiving num_values decompressed elements of the
+ * given type. Any previous content is discarded but the arrays are reused.
+ */
+void
+decompressed_column_init(DecompressedColumn *column, Oid element_type, uint32 num_values)
+{
+	Size nulls_words = (num_values + 63) / 64;
+
+	if (column->element_type != element_type || column->values == NULL)
+	{
+		column->element_type = element_type;
+		get_typlenbyval(element_type, &column->typlen, &column->typbyval);
+		column->native_values = column->typlen == 1 || column->typlen == 2 ||
+								column->typlen == 4 || column->typlen == 8;
+		column->value_bytes = column->native_values ? column->typlen : sizeof(Datum);
+	}
+
+	/* elements are at most 8 bytes wide, so size the arrays for the widest element */
+	if (column->values == NULL)
+	{
+		column->capacity = Max(num_values, 64);
+		column->values = palloc(sizeof(uint64) * column->capacity);
+		column->nulls = palloc(sizeof(uint64) * ((column->capacity + 63) / 64));
+	}
+	else if (num_values > column->capacity)
+	{
+		column->capacity = Max(num_values, column->capacity * 2);
+		column->values = repalloc(column->values, sizeof(uint64) * column->capacity);
+		column->nulls = repalloc(column->nulls, sizeof(uint64) * ((column->capacity + 63) / 64));
+	}
+
+	column->num_values = num_values;
+	column->num_nulls = 0;
+	column->has_dictionary = false;
+	memset(column->nulls, 0, sizeof(uint64) * nulls_words);
+}
+
+/*
+ * Mark an initialized column as decompressed from a dictionary and return the
+ * array for the codes of its rows, which the caller fills in. The dictionary
+ * must stay valid as long as the values of the column are used.
+ */
+uint32 *
+decompressed_column_init_dictionary(DecompressedColumn *column, Datum *dictionary,
+									uint32 num_distinct, bool sorted)
+{
+	Assert(column->values != NULL);
+
+	if (column->codes == NULL)
+	{
+		/* allocate next to the other arrays, so that it can be reused the same way */
+		column->codes_capacity = column->capacity;
+		column->codes = MemoryContextAlloc(GetMemoryChunkContext(column->values),
+										   sizeof(uint32) * column->codes_capacity);
+	}
+	else if (column->num_values > column->codes_capacity)
+	{
+		column->codes_capacity = column->capacity;
+		column->codes = repalloc(column->codes, sizeof(uint32) * column->codes_capacity);
+	}
+
+	column->has_dictionary = true;
+	column->dictionary_sorted = sorted;
+	column->num_distinct = num_distinct;
+	column->dictionary = dictionary;
+	return column->codes;
+}
+
+/*
+ * Set the NULL bitmap from an array of flags, where a non-zero flag marks a
+ * NULL. This is the representation of the NULL streams of the compression
+ * algorithms once decompressed.
+ */
+void
+decompressed_column_set_nulls(DecompressedColumn *column, const uint64 *null_flags)
+{
+	uint32 num_nulls = 0;
+	uint32 i;
+
+	for (i = 0; i < column->num_values; i++)
+	{
+		uint64 is_null = null_flags[i] != 0;
+
+		column->nulls[i / 64] |= is_null << (i % 64);
+		num_nulls += is_null;
+	}
+
+	column->num_nulls = num_nulls;
+}
+
+#define FILL_NATIVE(type)                                                                          \
+	do                                                                                             \
+	{                                                                                              \
+		type *restrict out = (type *) column->values;                                              \
+		uint32 in = 0;                                                                             \
+		uint32 row;                                                                                \
+                                                                                                   \
+		if (column->num_nulls == 0)                                                                \
+		{                                                                                          \
+			for (row = 0; row < num_values; row++)                                                 \
+				out[row] = (type) values[row];                                                     \
+			break;                                                                                 \
+		}                                                                                          \
+                                                                                                   \
+		for (row = 0; row < column->num_values; row++)                                             \
+		{                                                                                          \
+			if (DECOMPRESSED_COLUMN_IS_NULL(column, row))                                          \
+			{                                                                                      \
+				out[row] = 0;                                                                      \
+				continue;                                                                          \
+			}                                                                                      \
+			out[row] = (type) values[in++];                                                        \
+		}                                                                                          \
+	} while (0)
+
+/*
+ * Fill the non-NULL positions of a column with native values from an array of
+ * uint64, narrowing them to the width of the element type. The NULL bitmap
+ * must already be set.
+ */
+void
+decompressed_column_fill_native(DecompressedColumn *column, const uint64 *values,
+								uint32 num_values)
+{
+	if (!column->native_values)
+		elog(ERROR, "invalid type %u for native decompression", column->element_type);
+
+	if (num_values != column->num_values - column->num_nulls)
+		elog(ERROR, "number of decompressed values does not match the NULL bitmap");
+
+	switch (column->value_bytes)
+	{
+		case 1:
+			FILL_NATIVE(uint8);
+			break;
+		case 2:
+			FILL_NATIVE(uint16);
+			break;
+		case 4:
+			FILL_NATIVE(uint32);
+			break;
+		case 8:
+			FILL_NATIVE(uint64);
+			break;
+		default:
+			elog(ERROR, "unexpected element width %d", column->value_bytes);
+	}
+}
+
+#undef FILL_NATIVE
+
+/*
+ * Move the non-NULL values of a column of 8-byte native values to their rows,
+ * for algorithms that decompress the values straight into the column. The
+ * values must be stored in order at the start of the values array, and the
+ * NULL bitmap must already be set.
+ */
+void
+decompressed_column_expand_native(DecompressedColumn *column, uint32 num_values)
+{
+	uint64 *values = (uint64 *) column->values;
+	uint32 in = num_values;
+	uint32 row;
+
+	if (!column->native_values || column->value_bytes != sizeof(uint64))
+		elog(ERROR, "invalid type %u for native decompression", column->element_type);
+
+	if (num_values != column->num_values - column->num_nulls)
+		elog(ERROR, "number of decompressed values does not match the NULL bitmap");
+
+	if (column->num_nulls == 0)
+		return;
+
+	/* go backwards, so that no value is overwritten before it is moved */
+	for (row = column->num_values; row > 0; row--)
+	{
+		if (DECOMPRESSED_COLUMN_IS_NULL(column, row - 1))
+			values[row - 1] = 0;
+		else
+			values[row - 1] = values[--in];
+	}
+}
+
+void
+decompressed_column_store_datum(DecompressedColumn *column, uint32 row, Datum value)
+{
+	char *ptr = column->values + (Size) row * column->value_bytes;
+
+	Assert(row < column->num_values);
+
+	if (!column->native_values)
+		*((Datum *) ptr) = value;
+	else if (column->typbyval)
+		store_att_byval(ptr, value, column->typlen);
+	else
+		memcpy(ptr, DatumGetPointer(value), column->typlen);
+}
+
+/*
+ * Get a decompressed element as a Datum. Elements of by-reference types point
+ * into the column's values array, the dictionary, or the compressed data, so
+ * they are only valid as long as all of them are.
+ */
+Datum
+decompressed_column_get_datum(const DecompressedColumn *column, uint32 row)
+{
+	char *ptr = column->values + (Size) row * column->value_bytes;
+
+	Assert(row < column->num_values);
+
+	if (!column->native_values)
+	{
+		if (column->has_dictionary)
+			return column->dictionary[column->codes[row]];
+
+		return *((Datum *) ptr);
+	}
+
+	return fetch_att(ptr, column->typbyval, column->typlen);
+}
+
+/*
+ * Decompress all elements of a compressed datum into a column.
+ */
+void
+decompress_all(Datum compressed, Oid element_type, DecompressedColumn *column)
+{
+	CompressedDataHeader *header = (CompressedDataHeader *) PG_DETOAST_DATUM(compressed);
+
+	if (header->compression_algorithm == _INVALID_COMPRESSION_ALGORITHM ||
+		header->compression_algorithm >= _END_COMPRESSION_ALGORITHMS)
+		elog(ERROR, "invalid compression algorithm %d", header->compression_algorithm);
+
+	definitions[header->compression_algorithm].decompress_all(PointerGetDatum(header),
+															  element_type,
+															  column);
+}
@@ -10,6 +10,8 @@
 #include <c.h>
 #include <fmgr.h>
 #include <lib/stringinfo.h>
+#include <storage/dsm.h>
+#include <storage/shm_toc.h>
 
 /*
  * Compressed data starts with a specialized varlen type starting with the usual
@@ -28,6 +30,10 @@ typedef struct CompressedDataHeader
 	CompressedDataHeaderFields;
 } CompressedDataHeader;
 
+/* number of rows compressed into a single compressed datum if timescaledb.compress_batch_size
+ * is not set */
+#define DEFAULT_ROWS_PER_COMPRESSION 1000
+
 /* On 32-bit architectures, 64-bit values are boxed when returned as datums. To avoid
 this overhead we have this type and corresponding iterators for efficiency. The iterators
 are private to the compression algorithms for now. */
@@ -69,8 +75,60 @@ typedef struct DecompressionIterator
 } DecompressionIterator;
 
 /*
- * TOAST_STORAGE_EXTENDED for out of line storage.
- * TOAST_STORAGE_EXTERNAL for out of line storage + native PG toast compression
+ * A whole compressed datum decompressed at once into contiguous arrays.
+ *
+ * Elements of fixed-width types of up to 8 bytes (all the types supported by
+ * gorilla and deltadelta) are stored in their native representation, e.g., an
+ * int32 column is decompressed into an int32[] array, so that the values can be
+ * processed with tight loops. Elements of all other types are stored as
+ * Datums. The values at NULL positions are undefined.
+ *
+ * NULLs are stored in a bitmap where a set bit marks a NULL value.
+ *
+ * Dictionary-compressed data additionally keeps the dictionary of distinct
+ * values and the code, i.e., the index into the dictionary, of every row, so
+ * that predicates can be evaluated once per distinct value. Elements that are
+ * not stored natively are then only looked up in the dictionary when they are
+ * read.
+ *
+ * A column must be zero-initialized before its first use. The arrays can be
+ * reused between calls to avoid reallocating them for every compressed datum;
+ * they are grown as needed in the memory context they were first allocated in.
+ */
+typedef struct DecompressedColumn
+{
+	Oid element_type;
+	int16 typlen;
+	bool typbyval;
+	/* are the values stored in their native representation or as Datums? */
+	bool native_values;
+	/* width of an element in the values array */
+	int16 value_bytes;
+
+	uint32 num_values; /* number of elements, including NULLs */
+	uint32 num_nulls;
+	uint32 capacity; /* number of elements the arrays can hold */
+	char *values;
+	uint64 *nulls;
+
+	/* set if the column was decompressed from a dictionary */
+	bool has_dictionary;
+	/* is the dictionary in ascending order of the type's default btree opclass? */
+	bool dictionary_sorted;
+	uint32 num_distinct;
+	Datum *dictionary;
+	uint32 *codes; /* the code of every row, 0 for NULLs */
+	uint32 codes_capacity;
+} DecompressedColumn;
+
+#define DECOMPRESSED_COLUMN_IS_NULL(col, i)                                                        \
+	(((col)->nulls[(i) / 64] & (UINT64CONST(1) << ((i) % 64))) != 0)
+#define DECOMPRESSED_COLUMN_SET_NULL(col, i)                                                       \
+	((col)->nulls[(i) / 64] |= (UINT64CONST(1) << ((i) % 64)))
+
+/*
+ * TOAST_STORAGE_EXTERNAL for out of line storage.
+ * TOAST_STORAGE_EXTENDED for out of line storage + native PG toast compression
  * used when you want to enable postgres native toast
  * compression on the output of the compression algorithm.
  */
@@ -84,6 +142,7 @@ typedef struct CompressionAlgorithmDefinition
 {
 	DecompressionIterator *(*iterator_init_forward)(Datum, Oid element_type);
 	DecompressionIterator *(*iterator_init_reverse)(Datum, Oid element_type);
+	void (*decompress_all)(Datum, Oid element_type, DecompressedColumn *result);
 	void (*compressed_data_send)(CompressedDataHeader *, StringInfo);
 	Datum (*compressed_data_recv)(StringInfo);
 
@@ -100,6 +159,11 @@ typedef enum CompressionAlgorithms
 	COMPRESSION_ALGORITHM_DICTIONARY,
 	COMPRESSION_ALGORITHM_GORILLA,
 	COMPRESSION_ALGORITHM_DELTADELTA,
+	COMPRESSION_ALGORITHM_PFOR,
+	COMPRESSION_ALGORITHM_ALP,
+	COMPRESSION_ALGORITHM_ARRAY_LZ4,
+	COMPRESSION_ALGORITHM_ARRAY_ZSTD,
+	COMPRESSION_ALGORITHM_JSONB,
 
 	/* When adding an algorithm also add a static assert statement below */
 	/* end of real values */
@@ -127,18 +191,39 @@ pg_attribute_unused() assert_num_compression_algorithms_sane(void)
 	StaticAssertStmt(COMPRESSION_ALGORITHM_DICTIONARY == 2, "algorithm index has changed");
 	StaticAssertStmt(COMPRESSION_ALGORITHM_GORILLA == 3, "algorithm index has changed");
 	StaticAssertStmt(COMPRESSION_ALGORITHM_DELTADELTA == 4, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_PFOR == 5, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_ALP == 6, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_ARRAY_LZ4 == 7, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_ARRAY_ZSTD == 8, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_JSONB == 9, "algorithm index has changed");
 
 	/* This should change when adding a new algorithm after adding the new algorithm to the assert
 	 * list above. This statement prevents adding a new algorithm without updating the asserts above
 	 */
-	StaticAssertStmt(_END_COMPRESSION_ALGORITHMS == 5,
+	StaticAssertStmt(_END_COMPRESSION_ALGORITHMS == 10,
 					 "number of algorithms have changed, the asserts should be updated");
 }
 
 extern CompressionStorage compression_get_toast_storage(CompressionAlgorithms algo);
 extern void compress_chunk(Oid in_table, Oid out_table,
-						   const ColumnCompressionInfo **column_compression_info, int num_columns);
+						   const ColumnCompressionInfo **column_compression_info, int num_columns,
+						   int32 batch_size, bool adaptive_algorithms);
 extern void decompress_chunk(Oid in_table, Oid out_table);
+extern PGDLLEXPORT void tsl_compress_chunk_parallel_worker(dsm_segment *seg, shm_toc *toc);
+extern void compress_chunk_sorted_rows_stats(int64 *index_scans, int64 *sorts);
+extern void compress_chunk_parallel_stats(int64 *chunks, int64 *workers);
+
+extern void decompressed_column_init(DecompressedColumn *column, Oid element_type,
+									 uint32 num_values);
+extern void decompressed_column_store_datum(DecompressedColumn *column, uint32 row, Datum value);
+extern Datum decompressed_column_get_datum(const DecompressedColumn *column, uint32 row);
+extern void decompressed_column_set_nulls(DecompressedColumn *column, const uint64 *null_flags);
+extern void decompressed_column_fill_native(DecompressedColumn *column, const uint64 *values,
+											uint32 num_values);
+extern void decompressed_column_expand_native(DecompressedColumn *column, uint32 num_values);
+extern uint32 *decompressed_column_init_dictionary(DecompressedColumn *column, Datum *dictionary,
+												   uint32 num_distinct, bool sorted);
+extern void decompress_all(Datum compressed, Oid element_type, DecompressedColumn *column);
 
 extern DecompressionIterator *(*tsl_get_decompression_iterator_init(
 	CompressionAlgorithms algorithm, bool reverse))(Datum, Oid element_type);
@@ -58,7 +58,8 @@ typedef struct CompressColInfo
 } CompressColInfo;
 
 static void compresscolinfo_init(CompressColInfo *cc, Oid srctbl_relid, List *segmentby_cols,
-								 List *orderby_cols);
+								 List *orderby_cols, List *minmax_cols, List *bloom_cols,
+								 List *lz4_cols, List *zstd_cols, List *jsonb_cols);
 static void compresscolinfo_add_catalog_entries(CompressColInfo *compress_cols, int32 htid);
 
 #define PRINT_COMPRESSION_TABLE_NAME(buf, prefix, hypertable_id)                                   \
@@ -114,6 +115,10 @@ get_default_algorithm_id(Oid typeoid)
 	}
 }
 
+/*
+ * Metadata columns of order by columns are numbered by the order by index,
+ * those of columns in timescaledb.compress_minmax by their index in that list.
+ */
 static char *
 compression_column_segment_metadata_name(const FormData_hypertable_compression *fd,
 										 const char *type)
@@ -121,12 +126,21 @@ compression_column_segment_metadata_name(const FormData_hypertable_compression *
 	char *buf = palloc(sizeof(char) * NAMEDATALEN);
 	int ret;
 
-	Assert(fd->orderby_column_index > 0);
-	ret = snprintf(buf,
-				   NAMEDATALEN,
-				   COMPRESSION_COLUMN_METADATA_PREFIX "%s_%d",
-				   type,
-				   fd->orderby_column_index);
+	if (fd->orderby_column_index > 0)
+		ret = snprintf(buf,
+					   NAMEDATALEN,
+					   COMPRESSION_COLUMN_METADATA_PREFIX "%s_%d",
+					   type,
+					   fd->orderby_column_index);
+	else
+	{
+		Assert(fd->minmax_column_index > 0);
+		ret = snprintf(buf,
+					   NAMEDATALEN,
+					   COMPRESSION_COLUMN_METADATA_PREFIX "col_%s_%d",
+					   type,
+					   fd->minmax_column_index);
+	}
 	if (ret < 0 || ret > NAMEDATALEN)
 	{
 		ereport(ERROR,
@@ -147,6 +161,34 @@ compression_column_segment_max_name(const FormData_hypertable_compression *fd)
 	return compression_column_segment_metadata_name(fd, "max");
 }
 
+/* only columns in timescaledb.compress_minmax have a NULL count */
+char *
+compression_column_segment_null_count_name(const FormData_hypertable_compression *fd)
+{
+	Assert(fd->orderby_column_index <= 0 && fd->minmax_column_index > 0);
+	return compression_column_segment_metadata_name(fd, "null_count");
+}
+
+/* bloom filters are numbered by the index in timescaledb.compress_bloom */
+char *
+compression_column_segment_bloom_name(const FormData_hypertable_compression *fd)
+{
+	char *buf = palloc(sizeof(char) * NAMEDATALEN);
+	int ret;
+
+	Assert(fd->bloom_column_index > 0);
+	ret = snprintf(buf,
+				   NAMEDATALEN,
+				   COMPRESSION_COLUMN_METADATA_PREFIX "bloom_%d",
+				   fd->bloom_column_index);
+	if (ret < 0 || ret > NAMEDATALEN)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR), errmsg("bad segment metadata column name")));
+	}
+	return buf;
+}
+
 static void
 compresscolinfo_add_metadata_columns(CompressColInfo *cc, Relation uncompressed_rel)
 {
@@ -174,7 +216,8 @@ compresscolinfo_add_metadata_columns(CompressColInfo *cc, Relation uncompressed_
 
 	for (colno = 0; colno < cc->numcols; colno++)
 	{
-		if (cc->col_meta[colno].orderby_column_index > 0)
+		if (cc->col_meta[colno].orderby_column_index > 0 ||
+			cc->col_meta[colno].minmax_column_index > 0)
 		{
 			FormData_hypertable_compression fd = cc->col_meta[colno];
 			AttrNumber col_attno = get_attnum(uncompressed_rel->rd_id, NameStr(fd.attname));
@@ -185,8 +228,9 @@ compresscolinfo_add_metadata_columns(CompressColInfo *cc, Relation uncompressed_
 			if (!OidIsValid(type->lt_opr))
 				ereport(ERROR,
 						(errcode(ERRCODE_UNDEFINED_FUNCTION),
-						 errmsg("invalid order by column type: could not identify an less-than "
+						 errmsg("invalid %s column type: could not identify an less-than "
 								"operator for type %s",
+								fd.orderby_column_index > 0 ? "order by" : "minmax",
 								format_type_be(attr->atttypid))));
 
 			/* segment_meta min and max columns */
@@ -202,7 +246,117 @@ compresscolinfo_add_metadata_columns(CompressColInfo *cc, Relation uncompressed_
 									  attr->atttypid,
 									  -1 /* typemod */,
 									  0 /*collation*/));
+
+			/* number of NULLs in the segment, for IS NULL and IS NOT NULL */
+			if (fd.orderby_column_index <= 0)
+				cc->coldeflist = lappend(cc->coldeflist,
+										 makeColumnDef(compression_column_segment_null_count_name(
+														   &cc->col_meta[colno]),
+													   INT4OID,
+													   -1 /* typemod */,
+													   0 /*collation*/));
+		}
+	}
+
+	for (colno = 0; colno < cc->numcols; colno++)
+	{
+		if (cc->col_meta[colno].bloom_column_index > 0)
+		{
+			FormData_hypertable_compression fd = cc->col_meta[colno];
+			AttrNumber col_attno = get_attnum(uncompressed_rel->rd_id, NameStr(fd.attname));
+			Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(uncompressed_rel),
+												   AttrNumberGetAttrOffset(col_attno));
+			TypeCacheEntry *type = lookup_type_cache(attr->atttypid, TYPECACHE_HASH_PROC);
+
+			if (!OidIsValid(type->hash_proc))
+				ereport(ERROR,
+						(errcode(ERRCODE_UNDEFINED_FUNCTION),
+						 errmsg("invalid bloom column type: could not identify a hash function "
+								"for type %s",
+								format_type_be(attr->atttypid))));
+
+			/* segment_meta bloom filter column */
+			cc->coldeflist =
+				lappend(cc->coldeflist,
+						makeColumnDef(compression_column_segment_bloom_name(&cc->col_meta[colno]),
+									  BYTEAOID,
+									  -1 /* typemod */,
+									  0 /*collation*/));
+		}
+	}
+}
+
+/* the option that selects an algorithm for a list of columns */
+static const char *
+column_algorithm_option(int16 algorithm)
+{
+	switch (algorithm)
+	{
+		case COMPRESSION_ALGORITHM_ARRAY_LZ4:
+			return "compress_lz4";
+		case COMPRESSION_ALGORITHM_ARRAY_ZSTD:
+			return "compress_zstd";
+		case COMPRESSION_ALGORITHM_JSONB:
+			return "compress_jsonb";
+		default:
+			elog(ERROR, "invalid algorithm %d for a column option", algorithm);
+	}
+}
+
+/*
+ * Use the algorithm of an option for its columns, i.e., a block codec for
+ * timescaledb.compress_lz4 or timescaledb.compress_zstd and jsonb shredding for
+ * timescaledb.compress_jsonb. Segment by columns are not compressed and a
+ * column can only use one algorithm.
+ */
+static void
+set_column_algorithm(Relation rel, List *cols, CompressionAlgorithms algorithm,
+					 int16 *segorder_colindex, int seg_attnolen, int16 *algo_ids)
+{
+	const char *option = column_algorithm_option(algorithm);
+	ListCell *lc;
+
+	foreach (lc, cols)
+	{
+		CompressedParsedCol *col = (CompressedParsedCol *) lfirst(lc);
+		AttrNumber col_attno = get_attnum(rel->rd_id, NameStr(col->colname));
+		if (col_attno == InvalidAttrNumber)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("column \"%s\" in option timescaledb.%s does not exist",
+							NameStr(col->colname),
+							option)));
+		}
+		if (segorder_colindex[col_attno - 1] > 0 &&
+			segorder_colindex[col_attno - 1] <= seg_attnolen)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("cannot use column \"%s\" in both timescaledb.%s and "
+							"timescaledb.compress_segmentby",
+							NameStr(col->colname),
+							option)));
+		}
+		if (algo_ids[col_attno - 1] != 0 && algo_ids[col_attno - 1] != algorithm)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("cannot use column \"%s\" in both timescaledb.%s and timescaledb.%s",
+							NameStr(col->colname),
+							column_algorithm_option(algo_ids[col_attno - 1]),
+							option)));
+		}
+		if (algorithm == COMPRESSION_ALGORITHM_JSONB &&
+			TupleDescAttr(rel->rd_att, col_attno - 1)->atttypid != JSONBOID)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("column \"%s\" in option timescaledb.%s must be of type jsonb",
+							NameStr(col->colname),
+							option)));
 		}
+		algo_ids[col_attno - 1] = algorithm;
 	}
 }
 
@@ -213,15 +367,24 @@ compresscolinfo_add_metadata_columns(CompressColInfo *cc, Relation uncompressed_
  * 2. create the columndefs for the new compressed hypertable
  *     segmentby_cols have same datatype as the original table
  *     all other cols have COMPRESSEDDATA_TYPE type
+ * 3. number the minmax_cols that are not order by columns, since order by
+ *    columns have min/max metadata anyway
+ * 4. number the bloom_cols
+ * 5. use array_lz4 or array_zstd compression for the lz4_cols and zstd_cols, and
+ *    jsonb compression for the jsonb_cols
  */
 static void
 compresscolinfo_init(CompressColInfo *cc, Oid srctbl_relid, List *segmentby_cols,
-					 List *orderby_cols)
+					 List *orderby_cols, List *minmax_cols, List *bloom_cols, List *lz4_cols,
+					 List *zstd_cols, List *jsonb_cols)
 {
 	Relation rel;
 	TupleDesc tupdesc;
 	int i, colno, attno;
 	int16 *segorder_colindex;
+	int16 *minmax_colindex;
+	int16 *bloom_colindex;
+	int16 *algo_ids;
 	int seg_attnolen = 0;
 	ListCell *lc;
 	Oid compresseddata_oid = ts_custom_type_cache_get(CUSTOM_TYPE_COMPRESSED_DATA)->type_oid;
@@ -229,6 +392,9 @@ compresscolinfo_init(CompressColInfo *cc, Oid srctbl_relid, List *segmentby_cols
 	seg_attnolen = list_length(segmentby_cols);
 	rel = relation_open(srctbl_relid, AccessShareLock);
 	segorder_colindex = palloc0(sizeof(int32) * (rel->rd_att->natts));
+	minmax_colindex = palloc0(sizeof(int16) * (rel->rd_att->natts));
+	bloom_colindex = palloc0(sizeof(int16) * (rel->rd_att->natts));
+	algo_ids = palloc0(sizeof(int16) * (rel->rd_att->natts));
 	tupdesc = rel->rd_att;
 	i = 1;
 
@@ -276,6 +442,76 @@ compresscolinfo_init(CompressColInfo *cc, Oid srctbl_relid, List *segmentby_cols
 		}
 		segorder_colindex[col_attno - 1] = i++;
 	}
+	i = 1;
+	foreach (lc, minmax_cols)
+	{
+		CompressedParsedCol *col = (CompressedParsedCol *) lfirst(lc);
+		AttrNumber col_attno = get_attnum(rel->rd_id, NameStr(col->colname));
+		if (col_attno == InvalidAttrNumber)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("column \"%s\" in option timescaledb.compress_minmax does not exist",
+							NameStr(col->colname))));
+		}
+		if (segorder_colindex[col_attno - 1] > 0 &&
+			segorder_colindex[col_attno - 1] <= seg_attnolen)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("cannot use column \"%s\" in both timescaledb.compress_minmax and "
+							"timescaledb.compress_segmentby",
+							NameStr(col->colname))));
+		}
+		/* skip order by columns and duplicates */
+		if (segorder_colindex[col_attno - 1] > 0 || minmax_colindex[col_attno - 1] > 0)
+			continue;
+		minmax_colindex[col_attno - 1] = i++;
+	}
+	i = 1;
+	foreach (lc, bloom_cols)
+	{
+		CompressedParsedCol *col = (CompressedParsedCol *) lfirst(lc);
+		AttrNumber col_attno = get_attnum(rel->rd_id, NameStr(col->colname));
+		if (col_attno == InvalidAttrNumber)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("column \"%s\" in option timescaledb.compress_bloom does not exist",
+							NameStr(col->colname))));
+		}
+		if (segorder_colindex[col_attno - 1] > 0 &&
+			segorder_colindex[col_attno - 1] <= seg_attnolen)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("cannot use column \"%s\" in both timescaledb.compress_bloom and "
+							"timescaledb.compress_segmentby",
+							NameStr(col->colname))));
+		}
+		/* skip duplicates */
+		if (bloom_colindex[col_attno - 1] > 0)
+			continue;
+		bloom_colindex[col_attno - 1] = i++;
+	}
+	set_column_algorithm(rel,
+						 lz4_cols,
+						 COMPRESSION_ALGORITHM_ARRAY_LZ4,
+						 segorder_colindex,
+						 seg_attnolen,
+						 algo_ids);
+	set_column_algorithm(rel,
+						 zstd_cols,
+						 COMPRESSION_ALGORITHM_ARRAY_ZSTD,
+						 segorder_colindex,
+						 seg_attnolen,
+						 algo_ids);
+	set_column_algorithm(rel,
+						 jsonb_cols,
+						 COMPRESSION_ALGORITHM_JSONB,
+						 segorder_colindex,
+						 seg_attnolen,
+						 algo_ids);
 
 	cc->numcols = 0;
 	cc->col_meta = palloc0(sizeof(FormData_hypertable_compression) * tupdesc->natts);
@@ -296,6 +532,8 @@ compresscolinfo_init(CompressColInfo *cc, Oid srctbl_relid, List *segmentby_cols
 				 COMPRESSION_COLUMN_METADATA_PREFIX);
 
 		namestrcpy(&cc->col_meta[colno].attname, NameStr(attr->attname));
+		cc->col_meta[colno].minmax_column_index = minmax_colindex[attno];
+		cc->col_meta[colno].bloom_column_index = bloom_colindex[attno];
 		if (segorder_colindex[attno] > 0)
 		{
 			if (segorder_colindex[attno] <= seg_attnolen)
@@ -315,7 +553,9 @@ compresscolinfo_init(CompressColInfo *cc, Oid srctbl_relid, List *segmentby_cols
 		if (attroid == InvalidOid)
 		{
 			attroid = compresseddata_oid; /* default type for column */
-			cc->col_meta[colno].algo_id = get_default_algorithm_id(attr->atttypid);
+			cc->col_meta[colno].algo_id = algo_ids[attno] != 0 ?
+											  algo_ids[attno] :
+											  get_default_algorithm_id(attr->atttypid);
 		}
 		else
 		{
@@ -328,6 +568,9 @@ compresscolinfo_init(CompressColInfo *cc, Oid srctbl_relid, List *segmentby_cols
 	cc->numcols = colno;
 	compresscolinfo_add_metadata_columns(cc, rel);
 	pfree(segorder_colindex);
+	pfree(minmax_colindex);
+	pfree(bloom_colindex);
+	pfree(algo_ids);
 	relation_close(rel, AccessShareLock);
 }
 
@@ -395,6 +638,36 @@ compresscolinfo_add_catalog_entries(CompressColInfo *compress_cols, int32 htid)
 	heap_close(rel, NoLock); /*lock will be released at end of transaction only*/
 }
 
+static void
+compression_settings_add_catalog_entry(int32 htid, int32 batch_size, bool adaptive_algorithms)
+{
+	Catalog *catalog = ts_catalog_get();
+	Relation rel;
+	Datum values[Natts_hypertable_compression_settings];
+	bool nulls[Natts_hypertable_compression_settings] = { false };
+	CatalogSecurityContext sec_ctx;
+
+	rel = heap_open(catalog_get_table_id(catalog, HYPERTABLE_COMPRESSION_SETTINGS),
+					RowExclusiveLock);
+
+	values[AttrNumberGetAttrOffset(Anum_hypertable_compression_settings_hypertable_id)] =
+		Int32GetDatum(htid);
+	/* a negative batch size means the option was not set */
+	if (batch_size >= 0)
+		values[AttrNumberGetAttrOffset(Anum_hypertable_compression_settings_batch_size)] =
+			Int32GetDatum(batch_size);
+	else
+		nulls[AttrNumberGetAttrOffset(Anum_hypertable_compression_settings_batch_size)] = true;
+	values[AttrNumberGetAttrOffset(Anum_hypertable_compression_settings_adaptive_algorithms)] =
+		BoolGetDatum(adaptive_algorithms);
+
+	ts_catalog_database_info_become_owner(ts_catalog_database_info_get(), &sec_ctx);
+	ts_catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+	ts_catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, NoLock); /*lock will be released at end of transaction only*/
+}
+
 static void
 create_compressed_table_indexes(Oid compresstable_relid, CompressColInfo *compress_cols)
 {
@@ -839,6 +1112,12 @@ check_modify_compression_options(Hypertable *ht, WithClauseResult *with_clause_o
 		ListCell *lc;
 		bool segment_by_set = false;
 		bool order_by_set = false;
+		bool minmax_set = false;
+		bool bloom_set = false;
+		bool lz4_set = false;
+		bool zstd_set = false;
+		bool jsonb_set = false;
+		int32 batch_size;
 
 		foreach (lc, info)
 		{
@@ -847,6 +1126,16 @@ check_modify_compression_options(Hypertable *ht, WithClauseResult *with_clause_o
 				segment_by_set = true;
 			if (fd->orderby_column_index > 0)
 				order_by_set = true;
+			if (fd->minmax_column_index > 0)
+				minmax_set = true;
+			if (fd->bloom_column_index > 0)
+				bloom_set = true;
+			if (fd->algo_id == COMPRESSION_ALGORITHM_ARRAY_LZ4)
+				lz4_set = true;
+			if (fd->algo_id == COMPRESSION_ALGORITHM_ARRAY_ZSTD)
+				zstd_set = true;
+			if (fd->algo_id == COMPRESSION_ALGORITHM_JSONB)
+				jsonb_set = true;
 		}
 		if (with_clause_options[CompressOrderBy].is_default && order_by_set)
 			ereport(ERROR,
@@ -859,6 +1148,49 @@ check_modify_compression_options(Hypertable *ht, WithClauseResult *with_clause_o
 					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 					 errmsg("need to specify timescaledb.compress_segmentby if it was previously "
 							"set")));
+
+		if (with_clause_options[CompressMinMax].is_default && minmax_set)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg(
+						 "need to specify timescaledb.compress_minmax if it was previously set")));
+
+		if (with_clause_options[CompressBloom].is_default && bloom_set)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg(
+						 "need to specify timescaledb.compress_bloom if it was previously set")));
+
+		if (with_clause_options[CompressLz4].is_default && lz4_set)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("need to specify timescaledb.compress_lz4 if it was previously set")));
+
+		if (with_clause_options[CompressZstd].is_default && zstd_set)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg(
+						 "need to specify timescaledb.compress_zstd if it was previously set")));
+
+		if (with_clause_options[CompressJsonb].is_default && jsonb_set)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg(
+						 "need to specify timescaledb.compress_jsonb if it was previously set")));
+
+		if (with_clause_options[CompressBatchSize].is_default &&
+			ts_hypertable_compression_get_batch_size(ht->fd.id, &batch_size))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("need to specify timescaledb.compress_batch_size if it was previously "
+							"set")));
+
+		if (with_clause_options[CompressAdaptiveAlgorithms].is_default &&
+			ts_hypertable_compression_get_adaptive_algorithms(ht->fd.id))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("need to specify timescaledb.compress_adaptive_algorithms if it was "
+							"previously set")));
 	}
 }
 
@@ -880,7 +1212,14 @@ disable_compression(Hypertable *ht, WithClauseResult *with_clause_options)
 {
 	bool compression_already_enabled = TS_HYPERTABLE_HAS_COMPRESSION(ht);
 	if (!with_clause_options[CompressOrderBy].is_default ||
-		!with_clause_options[CompressSegmentBy].is_default)
+		!with_clause_options[CompressSegmentBy].is_default ||
+		!with_clause_options[CompressMinMax].is_default ||
+		!with_clause_options[CompressBloom].is_default ||
+		!with_clause_options[CompressBatchSize].is_default ||
+		!with_clause_options[CompressAdaptiveAlgorithms].is_default ||
+		!with_clause_options[CompressLz4].is_default ||
+		!with_clause_options[CompressZstd].is_default ||
+		!with_clause_options[CompressJsonb].is_default)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("cannot set additional compression options when disabling compression")));
@@ -911,6 +1250,13 @@ tsl_process_compress_table(AlterTableCmd *cmd, Hypertable *ht,
 	Oid ownerid;
 	List *segmentby_cols;
 	List *orderby_cols;
+	List *minmax_cols;
+	List *bloom_cols;
+	List *lz4_cols;
+	List *zstd_cols;
+	List *jsonb_cols;
+	int32 batch_size;
+	bool adaptive_algorithms;
 	ContinuousAggHypertableStatus caggstat;
 	List *constraint_list = NIL;
 
@@ -952,7 +1298,22 @@ tsl_process_compress_table(AlterTableCmd *cmd, Hypertable *ht,
 	segmentby_cols = ts_compress_hypertable_parse_segment_by(with_clause_options, ht);
 	orderby_cols = ts_compress_hypertable_parse_order_by(with_clause_options, ht);
 	orderby_cols = add_time_to_order_by_if_not_included(orderby_cols, segmentby_cols, ht);
-	compresscolinfo_init(&compress_cols, ht->main_table_relid, segmentby_cols, orderby_cols);
+	minmax_cols = ts_compress_hypertable_parse_minmax(with_clause_options, ht);
+	bloom_cols = ts_compress_hypertable_parse_bloom(with_clause_options, ht);
+	lz4_cols = ts_compress_hypertable_parse_lz4(with_clause_options, ht);
+	zstd_cols = ts_compress_hypertable_parse_zstd(with_clause_options, ht);
+	jsonb_cols = ts_compress_hypertable_parse_jsonb(with_clause_options, ht);
+	batch_size = ts_compress_hypertable_parse_batch_size(with_clause_options);
+	adaptive_algorithms = ts_compress_hypertable_parse_adaptive_algorithms(with_clause_options);
+	compresscolinfo_init(&compress_cols,
+						 ht->main_table_relid,
+						 segmentby_cols,
+						 orderby_cols,
+						 minmax_cols,
+						 bloom_cols,
+						 lz4_cols,
+						 zstd_cols,
+						 jsonb_cols);
 	/* check if we can create a compressed hypertable with existing constraints */
 	constraint_list = validate_existing_constraints(ht, &compress_cols);
 
@@ -960,6 +1321,8 @@ tsl_process_compress_table(AlterTableCmd *cmd, Hypertable *ht,
 	LockRelationOid(catalog_get_table_id(ts_catalog_get(), HYPERTABLE), RowExclusiveLock);
 	LockRelationOid(catalog_get_table_id(ts_catalog_get(), HYPERTABLE_COMPRESSION),
 					RowExclusiveLock);
+	LockRelationOid(catalog_get_table_id(ts_catalog_get(), HYPERTABLE_COMPRESSION_SETTINGS),
+					RowExclusiveLock);
 
 	if (TS_HYPERTABLE_HAS_COMPRESSION(ht))
 	{
@@ -971,6 +1334,8 @@ tsl_process_compress_table(AlterTableCmd *cmd, Hypertable *ht,
 	ts_hypertable_set_compressed_id(ht, compress_htid);
 
 	compresscolinfo_add_catalog_entries(&compress_cols, ht->fd.id);
+	if (batch_size >= 0 || adaptive_algorithms)
+		compression_settings_add_catalog_entry(ht->fd.id, batch_size, adaptive_algorithms);
 	/*add the constraints to the new compressed hypertable */
 	ht = ts_hypertable_get_by_id(ht->fd.id); /*reload updated info*/
 	ts_hypertable_clone_constraints_to_compressed(ht, constraint_list);
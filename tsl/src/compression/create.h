@@ -23,5 +23,7 @@ Chunk *create_compress_chunk_table(Hypertable *compress_ht, Chunk *src_chunk);
 
 char *compression_column_segment_min_name(const FormData_hypertable_compression *fd);
 char *compression_column_segment_max_name(const FormData_hypertable_compression *fd);
+char *compression_column_segment_null_count_name(const FormData_hypertable_compression *fd);
+char *compression_column_segment_bloom_name(const FormData_hypertable_compression *fd);
 
 #endif /* TIMESCALEDB_TSL_COMPRESSION_CREATE_H */
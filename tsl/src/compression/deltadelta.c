@@ -21,6 +21,7 @@
 #include <utils.h>
 
 #include "compression/compression.h"
+#include "compression/simd.h"
 #include "compression/simple8b_rle.h"
 
 static uint64 zig_zag_encode(uint64 value);
@@ -636,6 +637,148 @@ delta_delta_decompression_iterator_from_datum_reverse(Datum deltadelta_compresse
 	return &iterator->base;
 }
 
+/*
+ * Reconstruct the values from their zig-zag encoded delta-of-deltas, in
+ * place, with a running sum over the delta-of-deltas giving the deltas and a
+ * running sum over the deltas giving the values.
+ */
+static void
+delta_delta_decode_scalar(uint64 *values, uint32 num_values)
+{
+	uint64 prev_val = 0;
+	uint64 prev_delta = 0;
+	uint32 i;
+
+	for (i = 0; i < num_values; i++)
+	{
+		prev_delta += zig_zag_decode(values[i]);
+		prev_val += prev_delta;
+		values[i] = prev_val;
+	}
+}
+
+#ifdef TS_USE_AVX2
+/* inclusive prefix sum over the four lanes of a vector */
+static TS_FORCE_INLINE TS_TARGET_AVX2 __m256i
+prefix_sum_avx2(__m256i x)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	/* add the vector shifted up by one lane: [a, a+b, b+c, c+d] */
+	x = _mm256_add_epi64(x,
+						 _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)),
+											zero,
+											0x03));
+	/* and by two lanes: [a, a+b, a+b+c, a+b+c+d] */
+	x = _mm256_add_epi64(x,
+						 _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)),
+											zero,
+											0x0F));
+	return x;
+}
+
+/*
+ * Decode four values per step. Both running sums are computed within the
+ * vector, and the last delta and value of a step are broadcast to all lanes
+ * and carried into the next step.
+ */
+static TS_TARGET_AVX2 void
+delta_delta_decode_avx2(uint64 *values, uint32 num_values)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi64x(1);
+	__m256i delta_carry = zero;
+	__m256i value_carry = zero;
+	uint64 prev_val;
+	uint64 prev_delta;
+	uint32 i;
+
+	for (i = 0; i + 4 <= num_values; i += 4)
+	{
+		__m256i encoded = _mm256_loadu_si256((const __m256i *) (values + i));
+		__m256i delta_deltas = _mm256_xor_si256(_mm256_srli_epi64(encoded, 1),
+												_mm256_sub_epi64(zero,
+																 _mm256_and_si256(encoded, one)));
+		__m256i deltas = _mm256_add_epi64(prefix_sum_avx2(delta_deltas), delta_carry);
+		__m256i vals = _mm256_add_epi64(prefix_sum_avx2(deltas), value_carry);
+
+		_mm256_storeu_si256((__m256i *) (values + i), vals);
+		delta_carry = _mm256_permute4x64_epi64(deltas, _MM_SHUFFLE(3, 3, 3, 3));
+		value_carry = _mm256_permute4x64_epi64(vals, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	prev_delta = _mm_cvtsi128_si64(_mm256_castsi256_si128(delta_carry));
+	prev_val = _mm_cvtsi128_si64(_mm256_castsi256_si128(value_carry));
+
+	for (; i < num_values; i++)
+	{
+		prev_delta += zig_zag_decode(values[i]);
+		prev_val += prev_delta;
+		values[i] = prev_val;
+	}
+}
+#endif
+
+static void delta_delta_decode_choose(uint64 *values, uint32 num_values);
+
+static void (*delta_delta_decode)(uint64 *values, uint32 num_values) = delta_delta_decode_choose;
+
+/* choose the implementation for the CPU on the first call */
+static void
+delta_delta_decode_choose(uint64 *values, uint32 num_values)
+{
+#ifdef TS_USE_AVX2
+	if (ts_cpu_supports_avx2())
+		delta_delta_decode = delta_delta_decode_avx2;
+	else
+#endif
+		delta_delta_decode = delta_delta_decode_scalar;
+
+	delta_delta_decode(values, num_values);
+}
+
+/*
+ * Decompress all values at once. The delta-of-deltas are decoded into an
+ * array first, and then the values are reconstructed with a running sum over
+ * that array, which avoids the per-value iterator state and function calls.
+ */
+void
+delta_delta_decompress_all(Datum compressed_datum, Oid element_type, DecompressedColumn *column)
+{
+	DeltaDeltaCompressed *compressed = (DeltaDeltaCompressed *) PG_DETOAST_DATUM(compressed_datum);
+	const char *data = (char *) &compressed->delta_deltas;
+	Simple8bRleSerialized *deltas = bytes_deserialize_simple8b_and_advance(&data);
+	Simple8bRleSerialized *nulls = NULL;
+	uint32 num_values = deltas->num_elements;
+	uint32 num_deltas = deltas->num_elements;
+	uint64 *values;
+
+	if (compressed->has_nulls)
+	{
+		nulls = bytes_deserialize_simple8b_and_advance(&data);
+		num_values = nulls->num_elements;
+	}
+
+	decompressed_column_init(column, element_type, num_values);
+
+	if (nulls != NULL)
+	{
+		uint64 *null_flags =
+			palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_values));
+
+		simple8brle_decompress_all_forward(nulls, null_flags);
+		decompressed_column_set_nulls(column, null_flags);
+		pfree(null_flags);
+	}
+
+	values = palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_deltas));
+	simple8brle_decompress_all_forward(deltas, values);
+	delta_delta_decode(values, num_deltas);
+
+	decompressed_column_fill_native(column, values, num_deltas);
+	pfree(values);
+}
+
 /**********************************************************************************/
 /**********************************************************************************/
 void
@@ -12,6 +12,7 @@
 #include <access/tupmacs.h>
 #include <catalog/pg_aggregate.h>
 #include <catalog/namespace.h>
+#include <catalog/pg_collation.h>
 #include <catalog/pg_type.h>
 #include <funcapi.h>
 #include <lib/stringinfo.h>
@@ -32,6 +33,7 @@
 /*
  * A compression bitmap is stored as
  *     bool has_nulls
+ *     bool is_sorted: are the dictionary items in ascending order, see dictionary.h
  *     padding
  *     Oid element_type: the element stored by this compressed dictionary
  *     uint32 num_distinct: the number of distinct values
@@ -42,7 +44,8 @@ typedef struct DictionaryCompressed
 {
 	CompressedDataHeaderFields;
 	uint8 has_nulls;
-	uint8 padding[2];
+	uint8 is_sorted;
+	uint8 padding[1];
 	Oid element_type;
 	uint32 num_distinct;
 	/* 8-byte alignment sentinel for the following fields */
@@ -56,7 +59,8 @@ pg_attribute_unused() assertions(void)
 	/* make sure no padding bytes make it to disk */
 	StaticAssertStmt(sizeof(DictionaryCompressed) ==
 						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
-							 sizeof(test_val.has_nulls) + sizeof(test_val.padding) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.is_sorted) +
+							 sizeof(test_val.padding) +
 							 sizeof(test_val.element_type) + sizeof(test_val.num_distinct),
 					 "CompressedDictionary wrong size");
 	StaticAssertStmt(sizeof(DictionaryCompressed) == 16, "CompressedDictionary wrong size");
@@ -87,7 +91,12 @@ typedef struct DictionaryCompressor
 	bool typbyval;
 	char typalign;
 	bool has_nulls;
-	Simple8bRleCompressor dictionary_indexes;
+	/* comparison function to sort the dictionary with, NULL if the type has none */
+	FmgrInfo *cmp_proc;
+	/* the dictionary indexes in insertion order, remapped when the dictionary is sorted */
+	uint32 *indexes;
+	uint32 num_indexes;
+	uint32 indexes_capacity;
 	Simple8bRleCompressor nulls;
 } DictionaryCompressor;
 
@@ -150,7 +159,9 @@ dictionary_compressor_alloc(Oid type)
 {
 	DictionaryCompressor *compressor = palloc(sizeof(*compressor));
 	TypeCacheEntry *tentry =
-		lookup_type_cache(type, TYPECACHE_EQ_OPR_FINFO | TYPECACHE_HASH_PROC_FINFO);
+		lookup_type_cache(type,
+						  TYPECACHE_EQ_OPR_FINFO | TYPECACHE_HASH_PROC_FINFO |
+							  TYPECACHE_CMP_PROC_FINFO);
 
 	compressor->next_index = 0;
 	compressor->has_nulls = false;
@@ -158,10 +169,14 @@ dictionary_compressor_alloc(Oid type)
 	compressor->typlen = tentry->typlen;
 	compressor->typbyval = tentry->typbyval;
 	compressor->typalign = tentry->typalign;
+	compressor->cmp_proc =
+		OidIsValid(tentry->cmp_proc_finfo.fn_oid) ? &tentry->cmp_proc_finfo : NULL;
 
 	compressor->dictionary_items = dictionary_hash_alloc(tentry);
 
-	simple8brle_compressor_init(&compressor->dictionary_indexes);
+	compressor->num_indexes = 0;
+	compressor->indexes_capacity = 64;
+	compressor->indexes = palloc(sizeof(uint32) * compressor->indexes_capacity);
 	simple8brle_compressor_init(&compressor->nulls);
 	return compressor;
 }
@@ -191,7 +206,14 @@ dictionary_compressor_append(DictionaryCompressor *compressor, Datum val)
 		compressor->next_index += 1;
 	}
 
-	simple8brle_compressor_append(&compressor->dictionary_indexes, dict_item->index);
+	if (compressor->num_indexes == compressor->indexes_capacity)
+	{
+		compressor->indexes_capacity *= 2;
+		compressor->indexes =
+			repalloc(compressor->indexes, sizeof(uint32) * compressor->indexes_capacity);
+	}
+
+	compressor->indexes[compressor->num_indexes++] = dict_item->index;
 	simple8brle_compressor_append(&compressor->nulls, 0);
 }
 
@@ -207,33 +229,79 @@ typedef struct DictionaryCompressorSerializationInfo
 	Datum *value_array; /* same as dictionary_serialization_info just as a regular array */
 	ArrayCompressorSerializationInfo *dictionary_serialization_info;
 	bool is_all_null;
+	bool is_sorted;
 } DictionaryCompressorSerializationInfo;
 
+typedef struct DictionarySortContext
+{
+	FmgrInfo *cmp_proc;
+	Oid collation;
+	const Datum *values;
+} DictionarySortContext;
+
+static int
+dictionary_item_cmp(const void *left, const void *right, void *arg)
+{
+	DictionarySortContext *context = arg;
+
+	return DatumGetInt32(FunctionCall2Coll(context->cmp_proc,
+										   context->collation,
+										   context->values[*(const uint32 *) left],
+										   context->values[*(const uint32 *) right]));
+}
+
+/*
+ * Sort the dictionary items and return the new index of every item, indexed by
+ * its old index.
+ */
+static uint32 *
+dictionary_sort(DictionaryCompressor *compressor, Datum *values, uint32 num_distinct)
+{
+	DictionarySortContext context = {
+		.cmp_proc = compressor->cmp_proc,
+		.collation = dictionary_sort_collation(compressor->type),
+		.values = values,
+	};
+	uint32 *order = palloc(sizeof(uint32) * num_distinct);
+	uint32 *new_index = palloc(sizeof(uint32) * num_distinct);
+	Datum *sorted = palloc(sizeof(Datum) * num_distinct);
+	uint32 i;
+
+	for (i = 0; i < num_distinct; i++)
+		order[i] = i;
+
+	qsort_arg(order, num_distinct, sizeof(uint32), dictionary_item_cmp, &context);
+
+	for (i = 0; i < num_distinct; i++)
+	{
+		new_index[order[i]] = i;
+		sorted[i] = values[order[i]];
+	}
+
+	memcpy(values, sorted, sizeof(Datum) * num_distinct);
+	pfree(sorted);
+	pfree(order);
+	return new_index;
+}
+
 static DictionaryCompressorSerializationInfo
 compressor_get_serialization_info(DictionaryCompressor *compressor)
 {
-	Simple8bRleSerialized *dict_indexes =
-		simple8brle_compressor_finish(&compressor->dictionary_indexes);
 	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
+	Simple8bRleCompressor dict_indexes;
 	dictionary_iterator dictionary_item_iterator;
-
-	ArrayCompressor *array_comp = array_compressor_alloc(compressor->type);
+	uint32 *new_index = NULL;
+	ArrayCompressor *array_comp;
 
 	/* the total size is header size + bitmaps size + nulls? + data sizesize */
-	DictionaryCompressorSerializationInfo sizes = { .dictionary_compressed_indexes = dict_indexes,
-													.compressed_nulls = nulls,
-													.value_array = palloc(compressor->next_index *
-																		  sizeof(Datum)) };
+	DictionaryCompressorSerializationInfo sizes = { .compressed_nulls = nulls };
 	Size header_size = sizeof(DictionaryCompressed);
 
-	if (sizes.dictionary_compressed_indexes == NULL)
+	if (compressor->num_indexes == 0)
 		return (DictionaryCompressorSerializationInfo){ .is_all_null = true };
 
-	sizes.bitmaps_size = simple8brle_serialized_total_size(dict_indexes);
-	sizes.total_size = MAXALIGN(header_size) + sizes.bitmaps_size;
-	if (compressor->has_nulls)
-		sizes.nulls_size = simple8brle_serialized_total_size(nulls);
-	sizes.total_size += sizes.nulls_size;
+	array_comp = array_compressor_alloc(compressor->type);
+	sizes.value_array = palloc(compressor->next_index * sizeof(Datum));
 
 	dictionary_start_iterate(compressor->dictionary_items, &dictionary_item_iterator);
 	sizes.num_distinct = 0;
@@ -245,6 +313,29 @@ compressor_get_serialization_info(DictionaryCompressor *compressor)
 		sizes.value_array[dict_item->index] = dict_item->key;
 		sizes.num_distinct += 1;
 	}
+
+	/* sorted dictionaries allow evaluating range predicates on the indexes */
+	if (compressor->cmp_proc != NULL)
+	{
+		new_index = dictionary_sort(compressor, sizes.value_array, sizes.num_distinct);
+		sizes.is_sorted = true;
+	}
+
+	simple8brle_compressor_init(&dict_indexes);
+	for (uint32 i = 0; i < compressor->num_indexes; i++)
+	{
+		uint32 index = compressor->indexes[i];
+
+		simple8brle_compressor_append(&dict_indexes, new_index != NULL ? new_index[index] : index);
+	}
+	sizes.dictionary_compressed_indexes = simple8brle_compressor_finish(&dict_indexes);
+
+	sizes.bitmaps_size = simple8brle_serialized_total_size(sizes.dictionary_compressed_indexes);
+	sizes.total_size = MAXALIGN(header_size) + sizes.bitmaps_size;
+	if (compressor->has_nulls)
+		sizes.nulls_size = simple8brle_serialized_total_size(nulls);
+	sizes.total_size += sizes.nulls_size;
+
 	for (int i = 0; i < sizes.num_distinct; i++)
 	{
 		array_compressor_append(array_comp, sizes.value_array[i]);
@@ -272,6 +363,7 @@ dictionary_compressed_from_serialization_info(DictionaryCompressorSerializationI
 	bitmap->compression_algorithm = COMPRESSION_ALGORITHM_DICTIONARY;
 	bitmap->element_type = element_type;
 	bitmap->has_nulls = sizes.nulls_size > 0 ? 1 : 0;
+	bitmap->is_sorted = sizes.is_sorted ? 1 : 0;
 	bitmap->num_distinct = sizes.num_distinct;
 
 	data = data + sizeof(DictionaryCompressed);
@@ -347,6 +439,27 @@ dictionary_compressor_finish(DictionaryCompressor *compressor)
 /// Decompressor ///
 ////////////////////
 
+/* Decompress the dictionary items stored after the indexes and NULLs */
+static void
+dictionary_values_decompress(const DictionaryCompressed *compressed, const char *data, Size size,
+							 Datum *values)
+{
+	DecompressionIterator *dictionary_iterator =
+		array_decompression_iterator_alloc_forward(data,
+												   size,
+												   compressed->element_type,
+												   /* has_nulls */ false);
+
+	for (int i = 0; i < compressed->num_distinct; i++)
+	{
+		DecompressResult res = array_decompression_iterator_try_next_forward(dictionary_iterator);
+		Assert(!res.is_null);
+		Assert(!res.is_done);
+		values[i] = res.val;
+	}
+	Assert(array_decompression_iterator_try_next_forward(dictionary_iterator).is_done);
+}
+
 static void
 dictionary_decompression_iterator_init(DictionaryDecompressionIterator *iter, const char *data,
 									   bool scan_forward, Oid element_type)
@@ -355,7 +468,6 @@ dictionary_decompression_iterator_init(DictionaryDecompressionIterator *iter, co
 	Size total_size = VARSIZE(bitmap);
 	Size remaining_size;
 	Simple8bRleSerialized *s8_bitmap;
-	DecompressionIterator *dictionary_iterator;
 
 	*iter = (DictionaryDecompressionIterator){
 		.base = {
@@ -388,19 +500,87 @@ dictionary_decompression_iterator_init(DictionaryDecompressionIterator *iter, co
 
 	remaining_size = total_size - (data - (char *) bitmap);
 
-	dictionary_iterator = array_decompression_iterator_alloc_forward(data,
-																	 remaining_size,
-																	 bitmap->element_type,
-																	 /* has_nulls */ false);
+	dictionary_values_decompress(bitmap, data, remaining_size, iter->values);
+}
 
-	for (int i = 0; i < bitmap->num_distinct; i++)
+/*
+ * Decompress all values at once. The dictionary indexes are decoded into the
+ * codes of the column, which map the rows to the dictionary items. Only
+ * elements that are stored natively are copied into the values array; all
+ * others are looked up in the dictionary when they are read.
+ */
+void
+dictionary_decompress_all(Datum dictionary_compressed, Oid element_type,
+						  DecompressedColumn *column)
+{
+	const DictionaryCompressed *compressed =
+		(const DictionaryCompressed *) PG_DETOAST_DATUM(dictionary_compressed);
+	const char *data = (const char *) compressed + sizeof(DictionaryCompressed);
+	Simple8bRleSerialized *s8_indexes = bytes_deserialize_simple8b_and_advance(&data);
+	Simple8bRleSerialized *s8_nulls = NULL;
+	Datum *dictionary = palloc(sizeof(Datum) * compressed->num_distinct);
+	uint32 num_indexes = s8_indexes->num_elements;
+	uint32 num_values = num_indexes;
+	uint64 *indexes;
+	uint32 *codes;
+	uint32 next_index = 0;
+	uint32 row;
+
+	if (compressed->has_nulls == 1)
 	{
-		DecompressResult res = array_decompression_iterator_try_next_forward(dictionary_iterator);
-		Assert(!res.is_null);
-		Assert(!res.is_done);
-		iter->values[i] = res.val;
+		s8_nulls = bytes_deserialize_simple8b_and_advance(&data);
+		num_values = s8_nulls->num_elements;
 	}
-	Assert(array_decompression_iterator_try_next_forward(dictionary_iterator).is_done);
+
+	dictionary_values_decompress(compressed,
+								 data,
+								 VARSIZE(compressed) - (data - (const char *) compressed),
+								 dictionary);
+
+	decompressed_column_init(column, element_type, num_values);
+
+	if (s8_nulls != NULL)
+	{
+		uint64 *null_flags =
+			palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_values));
+
+		simple8brle_decompress_all_forward(s8_nulls, null_flags);
+		decompressed_column_set_nulls(column, null_flags);
+		pfree(null_flags);
+	}
+
+	if (num_indexes != num_values - column->num_nulls)
+		elog(ERROR, "number of dictionary indexes does not match the NULL bitmap");
+
+	indexes = palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_indexes));
+	simple8brle_decompress_all_forward(s8_indexes, indexes);
+
+	codes = decompressed_column_init_dictionary(column,
+												dictionary,
+												compressed->num_distinct,
+												compressed->is_sorted == 1);
+
+	for (row = 0; row < num_values; row++)
+	{
+		uint64 index;
+
+		if (column->num_nulls > 0 && DECOMPRESSED_COLUMN_IS_NULL(column, row))
+		{
+			codes[row] = 0;
+			continue;
+		}
+
+		index = indexes[next_index++];
+
+		if (index >= compressed->num_distinct)
+			elog(ERROR, "invalid dictionary index");
+
+		codes[row] = index;
+		if (column->native_values)
+			decompressed_column_store_datum(column, row, dictionary[index]);
+	}
+
+	pfree(indexes);
 }
 DecompressionIterator *
 tsl_dictionary_decompression_iterator_from_datum_forward(Datum dictionary_compressed,
@@ -505,6 +685,12 @@ dictionary_decompression_iterator_try_next_reverse(DecompressionIterator *iter_b
 	};
 }
 
+Oid
+dictionary_sort_collation(Oid element_type)
+{
+	return type_is_collatable(element_type) ? C_COLLATION_OID : InvalidOid;
+}
+
 /////////////////////
 /// SQL Functions ///
 /////////////////////
@@ -559,6 +745,34 @@ tsl_dictionary_compressor_finish(PG_FUNCTION_ARGS)
 /// I/O Functions ///
 /////////////////////
 
+static bool
+dictionary_items_are_sorted(const DictionaryCompressed *compressed)
+{
+	TypeCacheEntry *tentry = lookup_type_cache(compressed->element_type, TYPECACHE_CMP_PROC_FINFO);
+	Oid collation = dictionary_sort_collation(compressed->element_type);
+	DictionaryDecompressionIterator iterator;
+	uint32 i;
+
+	if (!OidIsValid(tentry->cmp_proc_finfo.fn_oid))
+		return false;
+
+	dictionary_decompression_iterator_init(&iterator,
+										   (const char *) compressed,
+										   true,
+										   compressed->element_type);
+
+	for (i = 1; i < compressed->num_distinct; i++)
+	{
+		if (DatumGetInt32(FunctionCall2Coll(&tentry->cmp_proc_finfo,
+											collation,
+											iterator.values[i - 1],
+											iterator.values[i])) >= 0)
+			return false;
+	}
+
+	return true;
+}
+
 void
 dictionary_compressed_send(CompressedDataHeader *header, StringInfo buffer)
 {
@@ -605,6 +819,7 @@ Datum
 dictionary_compressed_recv(StringInfo buffer)
 {
 	DictionaryCompressorSerializationInfo data = { 0 };
+	DictionaryCompressed *compressed;
 	uint8 has_nulls;
 	Oid element_type;
 
@@ -635,5 +850,10 @@ dictionary_compressed_recv(StringInfo buffer)
 				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
 				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
 
-	return PointerGetDatum(dictionary_compressed_from_serialization_info(data, element_type));
+	compressed = dictionary_compressed_from_serialization_info(data, element_type);
+
+	/* the binary format does not include the flag, so check the order of the items */
+	compressed->is_sorted = dictionary_items_are_sorted(compressed) ? 1 : 0;
+
+	return PointerGetDatum(compressed);
 }
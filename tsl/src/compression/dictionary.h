@@ -9,6 +9,11 @@
  * object. The row->dictionary item mapping is stored as a series of integer-based indexes into the
  * dictionary array ordered by row number (called dictionary_indexes; compressed using
  * `simple8b_rle`).
+ *
+ * If the type has a default btree operator class, the dictionary is sorted in its order, using
+ * the C collation for collatable types so that the order does not depend on the locale. Predicates
+ * can then be evaluated on the dictionary with a binary search and on the rows by comparing their
+ * indexes. Dictionaries compressed by older versions are treated as unsorted.
  */
 #ifndef TIMESCALEDB_TSL_DICTIONARY_COMPRESSION_H
 #define TIMESCALEDB_TSL_DICTIONARY_COMPRESSION_H
@@ -43,6 +48,11 @@ tsl_dictionary_decompression_iterator_from_datum_reverse(Datum dictionary_compre
 extern DecompressResult
 dictionary_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
 
+extern void dictionary_decompress_all(Datum dictionary_compressed, Oid element_type,
+									  DecompressedColumn *column);
+
+extern Oid dictionary_sort_collation(Oid element_type);
+
 extern void dictionary_compressed_send(CompressedDataHeader *header, StringInfo buffer);
 extern Datum dictionary_compressed_recv(StringInfo buf);
 
@@ -53,6 +63,7 @@ extern Datum tsl_dictionary_compressor_finish(PG_FUNCTION_ARGS);
 	{                                                                                              \
 		.iterator_init_forward = tsl_dictionary_decompression_iterator_from_datum_forward,         \
 		.iterator_init_reverse = tsl_dictionary_decompression_iterator_from_datum_reverse,         \
+		.decompress_all = dictionary_decompress_all,                                               \
 		.compressed_data_send = dictionary_compressed_send,                                        \
 		.compressed_data_recv = dictionary_compressed_recv,                                        \
 		.compressor_for_type = dictionary_compressor_for_type,                                     \
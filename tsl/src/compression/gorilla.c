@@ -24,6 +24,7 @@
 #include <base64_compat.h>
 
 #include "compression/compression.h"
+#include "compression/simd.h"
 #include "compression/simple8b_rle.h"
 
 #if !(PG10 || PG96 || PG11)
@@ -731,6 +732,184 @@ gorilla_decompression_iterator_try_next_forward(DecompressionIterator *iter_base
 								 iter_base->element_type);
 }
 
+/*
+ * Reader for the bit arrays used by bulk decompression. Unlike
+ * BitArrayIterator, the unread bits of the current bucket are kept in a local
+ * buffer, so that reading a value only shifts and masks the buffer, and memory
+ * is only touched when the buffer runs out and is refilled from the next
+ * bucket. The buckets hold their values starting at the least significant
+ * bit, and a value that spans two buckets has its low-order bits in the first.
+ */
+typedef struct GorillaBitReader
+{
+	const uint64 *buckets;
+	uint32 num_buckets;
+	uint32 next_bucket;
+	uint64 buffer;   /* the unread bits, starting at the least significant bit */
+	uint32 buffered; /* number of unread bits in the buffer */
+} GorillaBitReader;
+
+static void
+gorilla_bit_reader_init(GorillaBitReader *reader, const BitArray *array)
+{
+	*reader = (GorillaBitReader){
+		.buckets = bit_array_buckets(array),
+		.num_buckets = bit_array_num_buckets(array),
+	};
+}
+
+/* read the next num_bits bits, which must be at most 64 */
+static TS_FORCE_INLINE uint64
+gorilla_bit_reader_next(GorillaBitReader *reader, uint32 num_bits)
+{
+	uint64 next;
+	uint64 value;
+	uint32 bits_from_next;
+
+	Assert(num_bits <= 64);
+
+	if (num_bits == 0)
+		return 0;
+
+	if (likely(num_bits <= reader->buffered))
+	{
+		value = reader->buffer & (PG_UINT64_MAX >> (64 - num_bits));
+		/* shift in two steps, since shifting by 64 bits is undefined */
+		reader->buffer = (reader->buffer >> (num_bits - 1)) >> 1;
+		reader->buffered -= num_bits;
+		return value;
+	}
+
+	if (unlikely(reader->next_bucket >= reader->num_buckets))
+		elog(ERROR, "gorilla bit stream is too short");
+
+	/* the bits left in the buffer are the low-order bits of the value */
+	next = reader->buckets[reader->next_bucket++];
+	bits_from_next = num_bits - reader->buffered;
+	value = (reader->buffer | (next << reader->buffered)) & (PG_UINT64_MAX >> (64 - num_bits));
+	reader->buffer = (next >> (bits_from_next - 1)) >> 1;
+	reader->buffered = 64 - bits_from_next;
+	return value;
+}
+
+/*
+ * Decompress all values at once.
+ *
+ * The tag and bit-width streams are decoded into arrays up front, and all
+ * leading zeros are read in one pass and combined with their bit widths into
+ * the shift that aligns an xor with the value. Reconstructing a value then
+ * only needs to read its xor bits, which is done with a GorillaBitReader. The
+ * values of 8-byte types are written straight into the column.
+ */
+void
+gorilla_decompress_all(Datum gorilla_compressed, Oid element_type, DecompressedColumn *column)
+{
+	CompressedGorillaData gorilla_data;
+	GorillaBitReader leading_zeros;
+	GorillaBitReader xors;
+	uint64 *tag0s;
+	uint64 *tag1s;
+	uint64 *xor_sizes;
+	uint64 *restrict values;
+	uint32 num_values;
+	uint32 num_non_null;
+	uint32 num_tag1s;
+	uint32 num_xor_sizes;
+	uint32 next_tag1 = 0;
+	uint32 next_xor_size = 0;
+	uint32 xor_bits = 0;
+	uint32 xor_shift = 0;
+	uint64 prev_val = 0;
+	uint32 i;
+
+	compressed_gorilla_data_init_from_datum(&gorilla_data, gorilla_compressed);
+
+	num_non_null = gorilla_data.tag0s->num_elements;
+	num_values = gorilla_data.nulls != NULL ? gorilla_data.nulls->num_elements : num_non_null;
+	num_tag1s = gorilla_data.tag1s->num_elements;
+	num_xor_sizes = gorilla_data.num_bits_used_per_xor->num_elements;
+
+	decompressed_column_init(column, element_type, num_values);
+
+	if (gorilla_data.nulls != NULL)
+	{
+		uint64 *null_flags =
+			palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_values));
+
+		simple8brle_decompress_all_forward(gorilla_data.nulls, null_flags);
+		decompressed_column_set_nulls(column, null_flags);
+		pfree(null_flags);
+	}
+
+	tag0s = palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_non_null));
+	simple8brle_decompress_all_forward(gorilla_data.tag0s, tag0s);
+	tag1s = palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_tag1s));
+	simple8brle_decompress_all_forward(gorilla_data.tag1s, tag1s);
+	xor_sizes = palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(num_xor_sizes));
+	simple8brle_decompress_all_forward(gorilla_data.num_bits_used_per_xor, xor_sizes);
+
+	/*
+	 * Replace every bit width with the width in the low byte and the shift in
+	 * the next byte. A shift is only needed if the xor does not reach the
+	 * least significant bit.
+	 */
+	gorilla_bit_reader_init(&leading_zeros, &gorilla_data.leading_zeros);
+	for (i = 0; i < num_xor_sizes; i++)
+	{
+		uint64 num_leading_zeros = gorilla_bit_reader_next(&leading_zeros, BITS_PER_LEADING_ZEROS);
+		uint64 num_bits = xor_sizes[i];
+
+		if (num_bits > 64)
+			elog(ERROR, "invalid gorilla bit width " UINT64_FORMAT, num_bits);
+
+		xor_sizes[i] = num_bits;
+		if (num_leading_zeros + num_bits < 64)
+			xor_sizes[i] |= (64 - (num_leading_zeros + num_bits)) << 8;
+	}
+
+	if (num_non_null != column->num_values - column->num_nulls)
+		elog(ERROR, "number of decompressed values does not match the NULL bitmap");
+
+	/* the values are reconstructed in place of the tag0s unless they go to the column */
+	if (column->native_values && column->value_bytes == sizeof(uint64))
+		values = (uint64 *) column->values;
+	else
+		values = tag0s;
+
+	gorilla_bit_reader_init(&xors, &gorilla_data.xors);
+	for (i = 0; i < num_non_null; i++)
+	{
+		if (tag0s[i] != 0)
+		{
+			if (unlikely(next_tag1 >= num_tag1s))
+				elog(ERROR, "gorilla tag stream is too short");
+
+			if (tag1s[next_tag1++] != 0)
+			{
+				if (unlikely(next_xor_size >= num_xor_sizes))
+					elog(ERROR, "gorilla bit width stream is too short");
+
+				xor_bits = xor_sizes[next_xor_size] & 0xFF;
+				xor_shift = xor_sizes[next_xor_size] >> 8;
+				next_xor_size++;
+			}
+
+			prev_val ^= gorilla_bit_reader_next(&xors, xor_bits) << xor_shift;
+		}
+
+		values[i] = prev_val;
+	}
+
+	if (values == (uint64 *) column->values)
+		decompressed_column_expand_native(column, num_non_null);
+	else
+		decompressed_column_fill_native(column, values, num_non_null);
+
+	pfree(tag0s);
+	pfree(tag1s);
+	pfree(xor_sizes);
+}
+
 /****************************************
  *** reversed  DecompressionIterator  ***
  ****************************************/
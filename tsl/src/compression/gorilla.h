@@ -89,6 +89,9 @@ gorilla_decompression_iterator_from_datum_reverse(Datum gorilla_compressed, Oid
 extern DecompressResult
 gorilla_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
 
+extern void gorilla_decompress_all(Datum gorilla_compressed, Oid element_type,
+								   DecompressedColumn *column);
+
 extern void gorilla_compressed_send(CompressedDataHeader *compressed, StringInfo buffer);
 extern Datum gorilla_compressed_recv(StringInfo buf);
 
@@ -99,6 +102,7 @@ extern Datum tsl_gorilla_compressor_finish(PG_FUNCTION_ARGS);
 	{                                                                                              \
 		.iterator_init_forward = gorilla_decompression_iterator_from_datum_forward,                \
 		.iterator_init_reverse = gorilla_decompression_iterator_from_datum_reverse,                \
+		.decompress_all = gorilla_decompress_all,                                                  \
 		.compressed_data_send = gorilla_compressed_send,                                           \
 		.compressed_data_recv = gorilla_compressed_recv,                                           \
 		.compressor_for_type = gorilla_compressor_for_type,                                        \
@@ -0,0 +1,1171 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "compression/jsonb.h"
+
+#include <catalog/pg_type.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+#include <utils/builtins.h>
+#include <utils/int8.h>
+#include <utils/jsonb.h>
+#include <utils/memutils.h>
+#include <utils/numeric.h>
+
+#include <compat.h>
+
+#include "compression/array.h"
+#include "compression/compression.h"
+#include "compression/deltadelta.h"
+#include "compression/dictionary.h"
+#include "compression/simple8b_rle.h"
+
+/* shred at most this many keys per segment */
+#define JSONB_MAX_STREAMS 64
+
+/* shred keys whose values have the type of their stream in at least 1 in this many objects */
+#define JSONB_MIN_KEY_RATIO 2
+
+/* the type of the values of a stream, stored on disk so it MUST NOT CHANGE */
+typedef enum JsonbStreamType
+{
+	/* not a stream type, for values that are stored in the residual */
+	JSONB_STREAM_NONE = 0,
+	/* numbers without decimals that fit an int8 */
+	JSONB_STREAM_INT8 = 1,
+	JSONB_STREAM_NUMERIC = 2,
+	JSONB_STREAM_TEXT = 3,
+	JSONB_STREAM_BOOL = 4,
+} JsonbStreamType;
+
+/* the kind of a row, stored on disk so it MUST NOT CHANGE */
+typedef enum JsonbRowKind
+{
+	JSONB_ROW_NULL = 0,
+	/* an object, whose keys are in the streams and the residual */
+	JSONB_ROW_OBJECT = 1,
+	/* any other value, which is stored in the residual */
+	JSONB_ROW_OTHER = 2,
+} JsonbRowKind;
+
+typedef struct JsonbCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_residual; /* 1 if this has a residual after the streams, 0 otherwise */
+	uint16 num_streams;
+	/*
+	 * the simple8b stream of row kinds, the streams of the shredded keys, each
+	 * a JsonbStreamHeader followed by the key and the compressed values padded
+	 * to a multiple of 8 bytes, and the array compressed residual if there is
+	 * one
+	 */
+	uint64 data[FLEXIBLE_ARRAY_MEMBER];
+} JsonbCompressed;
+
+typedef struct JsonbStreamHeader
+{
+	uint32 key_len;
+	uint8 type;
+	/* 1 if some values of the key are stored in the residual, 0 otherwise */
+	uint8 in_residual;
+	uint8 padding[2];
+} JsonbStreamHeader;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	JsonbCompressed test_val = { { 0 } };
+	JsonbStreamHeader test_header = { 0 };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(JsonbCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_residual) + sizeof(test_val.num_streams),
+					 "JsonbCompressed wrong size");
+	StaticAssertStmt(sizeof(JsonbCompressed) == 8, "JsonbCompressed wrong size");
+	StaticAssertStmt(sizeof(JsonbStreamHeader) ==
+						 sizeof(test_header.key_len) + sizeof(test_header.type) +
+							 sizeof(test_header.in_residual) + sizeof(test_header.padding),
+					 "JsonbStreamHeader wrong size");
+	StaticAssertStmt(sizeof(JsonbStreamHeader) == 8, "JsonbStreamHeader wrong size");
+}
+
+/* the stream of a shredded key */
+typedef struct JsonbStream
+{
+	const char *key;
+	uint32 key_len;
+	JsonbStreamType type;
+	bool in_residual;
+	CompressedDataHeader *values;
+} JsonbStream;
+
+/* the parts of a JsonbCompressed */
+typedef struct JsonbParts
+{
+	Simple8bRleSerialized *kinds;
+	uint32 num_streams;
+	JsonbStream *streams;
+	CompressedDataHeader *residual;
+} JsonbParts;
+
+/* a key and value of a top level object */
+typedef struct JsonbPair
+{
+	JsonbValue key;
+	JsonbValue value;
+	JsonbStreamType type;
+	int64 int_value;
+} JsonbPair;
+
+/* a stream that is being built */
+typedef struct JsonbStreamBuilder
+{
+	JsonbStream stream;
+	/* number of values of the key that have the type of the stream */
+	uint32 count;
+	Compressor *compressor;
+	/* was a value appended for the current row? */
+	bool has_value;
+} JsonbStreamBuilder;
+
+typedef struct JsonbCompressor
+{
+	Compressor base;
+	/* the values of the segment, NULL for NULLs */
+	Jsonb **values;
+	uint32 num_values;
+	uint32 max_values;
+} JsonbCompressor;
+
+typedef struct JsonbDecompressionIterator
+{
+	DecompressionIterator base;
+	DecompressedColumn values;
+	int64 position;
+} JsonbDecompressionIterator;
+
+/********************
+ *****  UTILS  *****
+ ********************/
+
+/* compare keys in the order of keys in jsonb objects, i.e., shorter keys first */
+static inline int
+jsonb_key_cmp(const char *a, uint32 a_len, const char *b, uint32 b_len)
+{
+	if (a_len != b_len)
+		return a_len < b_len ? -1 : 1;
+	return memcmp(a, b, a_len);
+}
+
+static bool
+jsonb_key_is_requested(const char *key, uint32 key_len, char **keys, int num_keys)
+{
+	int i;
+
+	for (i = 0; i < num_keys; i++)
+	{
+		if (strlen(keys[i]) == key_len && memcmp(keys[i], key, key_len) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static Oid
+jsonb_stream_element_type(JsonbStreamType type)
+{
+	switch (type)
+	{
+		case JSONB_STREAM_INT8:
+			return INT8OID;
+		case JSONB_STREAM_NUMERIC:
+			return NUMERICOID;
+		case JSONB_STREAM_TEXT:
+			return TEXTOID;
+		case JSONB_STREAM_BOOL:
+			return BOOLOID;
+		default:
+			elog(ERROR, "invalid stream type %d in jsonb", type);
+	}
+}
+
+/*
+ * The stream type of a value. Numbers are integers if their text has no
+ * decimals, so that they are converted back to the same text.
+ */
+static JsonbStreamType
+jsonb_value_stream_type(const JsonbValue *value, int64 *int_value)
+{
+	switch (value->type)
+	{
+		case jbvString:
+			return JSONB_STREAM_TEXT;
+		case jbvBool:
+			return JSONB_STREAM_BOOL;
+		case jbvNumeric:
+		{
+			char *str =
+				DatumGetCString(DirectFunctionCall1(numeric_out,
+													NumericGetDatum(value->val.numeric)));
+			const char *digits = str[0] == '-' ? str + 1 : str;
+			bool is_int = digits[0] != '\0' && strspn(digits, "0123456789") == strlen(digits) &&
+						  scanint8(str, true, int_value);
+
+			pfree(str);
+			return is_int ? JSONB_STREAM_INT8 : JSONB_STREAM_NUMERIC;
+		}
+		default:
+			return JSONB_STREAM_NONE;
+	}
+}
+
+/* does a value of the type belong to a stream of the stream type? */
+static inline bool
+jsonb_stream_accepts(JsonbStreamType stream_type, JsonbStreamType value_type)
+{
+	return value_type == stream_type ||
+		   (stream_type == JSONB_STREAM_NUMERIC && value_type == JSONB_STREAM_INT8);
+}
+
+static Datum
+jsonb_pair_stream_datum(const JsonbPair *pair, JsonbStreamType stream_type)
+{
+	switch (stream_type)
+	{
+		case JSONB_STREAM_INT8:
+			return Int64GetDatum(pair->int_value);
+		case JSONB_STREAM_NUMERIC:
+			return NumericGetDatum(pair->value.val.numeric);
+		case JSONB_STREAM_TEXT:
+			return PointerGetDatum(cstring_to_text_with_len(pair->value.val.string.val,
+															pair->value.val.string.len));
+		case JSONB_STREAM_BOOL:
+			return BoolGetDatum(pair->value.val.boolean);
+		default:
+			elog(ERROR, "invalid stream type %d in jsonb", stream_type);
+	}
+}
+
+static void
+jsonb_stream_value(JsonbStreamType type, Datum datum, JsonbValue *value)
+{
+	switch (type)
+	{
+		case JSONB_STREAM_INT8:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(DirectFunctionCall1(int8_numeric, datum));
+			break;
+		case JSONB_STREAM_NUMERIC:
+			value->type = jbvNumeric;
+			value->val.numeric = DatumGetNumeric(datum);
+			break;
+		case JSONB_STREAM_TEXT:
+		{
+			text *str = DatumGetTextPP(datum);
+			value->type = jbvString;
+			value->val.string.val = VARDATA_ANY(str);
+			value->val.string.len = VARSIZE_ANY_EXHDR(str);
+			break;
+		}
+		case JSONB_STREAM_BOOL:
+			value->type = jbvBool;
+			value->val.boolean = DatumGetBool(datum);
+			break;
+		default:
+			elog(ERROR, "invalid stream type %d in jsonb", type);
+	}
+}
+
+static void
+jsonb_parts_from_compressed(JsonbCompressed *compressed, JsonbParts *parts)
+{
+	const char *data = (const char *) compressed->data;
+	const char *end = (const char *) compressed + VARSIZE(compressed);
+	uint32 i;
+
+	*parts = (JsonbParts){
+		.kinds = bytes_deserialize_simple8b_and_advance(&data),
+		.num_streams = compressed->num_streams,
+		.streams = palloc(sizeof(JsonbStream) * Max(compressed->num_streams, 1)),
+	};
+
+	for (i = 0; i < parts->num_streams; i++)
+	{
+		const JsonbStreamHeader *header = (const JsonbStreamHeader *) data;
+		JsonbStream *stream = &parts->streams[i];
+
+		if (data + sizeof(JsonbStreamHeader) > end)
+			elog(ERROR, "invalid stream in jsonb");
+
+		*stream = (JsonbStream){
+			.key = data + sizeof(JsonbStreamHeader),
+			.key_len = header->key_len,
+			.type = header->type,
+			.in_residual = header->in_residual != 0,
+		};
+		jsonb_stream_element_type(stream->type);
+
+		data += TYPEALIGN(sizeof(uint64), sizeof(JsonbStreamHeader) + (Size) stream->key_len);
+		if (data + sizeof(CompressedDataHeader) > end)
+			elog(ERROR, "invalid stream in jsonb");
+
+		stream->values = (CompressedDataHeader *) data;
+		data += TYPEALIGN(sizeof(uint64), VARSIZE(stream->values));
+	}
+
+	if (compressed->has_residual)
+	{
+		if (data + sizeof(CompressedDataHeader) > end)
+			elog(ERROR, "invalid residual in jsonb");
+
+		parts->residual = (CompressedDataHeader *) data;
+		if (parts->residual->compression_algorithm != COMPRESSION_ALGORITHM_ARRAY)
+			elog(ERROR,
+				 "invalid compression algorithm %d for jsonb residual",
+				 parts->residual->compression_algorithm);
+	}
+	else
+		Assert(compressed->has_residual == 0);
+}
+
+static JsonbCompressed *
+jsonb_from_parts(Simple8bRleSerialized *kinds, JsonbStream *streams, uint32 num_streams,
+				 CompressedDataHeader *residual)
+{
+	Size kinds_size = simple8brle_serialized_total_size(kinds);
+	Size compressed_size = sizeof(JsonbCompressed) + kinds_size;
+	char *compressed_data;
+	JsonbCompressed *compressed;
+	uint32 i;
+
+	if (num_streams > PG_UINT16_MAX)
+		elog(ERROR, "too many streams in jsonb");
+
+	for (i = 0; i < num_streams; i++)
+		compressed_size +=
+			TYPEALIGN(sizeof(uint64), sizeof(JsonbStreamHeader) + (Size) streams[i].key_len) +
+			TYPEALIGN(sizeof(uint64), VARSIZE(streams[i].values));
+
+	if (residual != NULL)
+		compressed_size += TYPEALIGN(sizeof(uint64), VARSIZE(residual));
+
+	if (!AllocSizeIsValid(compressed_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	compressed_data = palloc0(compressed_size);
+	compressed = (JsonbCompressed *) compressed_data;
+	SET_VARSIZE(&compressed->vl_len_, compressed_size);
+
+	compressed->compression_algorithm = COMPRESSION_ALGORITHM_JSONB;
+	compressed->has_residual = residual != NULL ? 1 : 0;
+	compressed->num_streams = num_streams;
+
+	compressed_data = (char *) compressed->data;
+	compressed_data = bytes_serialize_simple8b_and_advance(compressed_data, kinds_size, kinds);
+
+	for (i = 0; i < num_streams; i++)
+	{
+		JsonbStreamHeader *header = (JsonbStreamHeader *) compressed_data;
+
+		header->key_len = streams[i].key_len;
+		header->type = streams[i].type;
+		header->in_residual = streams[i].in_residual ? 1 : 0;
+		memcpy(compressed_data + sizeof(JsonbStreamHeader), streams[i].key, streams[i].key_len);
+		compressed_data +=
+			TYPEALIGN(sizeof(uint64), sizeof(JsonbStreamHeader) + (Size) streams[i].key_len);
+
+		memcpy(compressed_data, streams[i].values, VARSIZE(streams[i].values));
+		compressed_data += TYPEALIGN(sizeof(uint64), VARSIZE(streams[i].values));
+	}
+
+	if (residual != NULL)
+		memcpy(compressed_data, residual, VARSIZE(residual));
+
+	return compressed;
+}
+
+/******************************
+ ***  Compressor  ***
+ ******************************/
+
+static void
+jsonb_compressor_append(JsonbCompressor *compressor, Jsonb *value)
+{
+	if (compressor->num_values == compressor->max_values)
+	{
+		compressor->max_values = Max(compressor->max_values * 2, 64);
+		compressor->values =
+			compressor->values == NULL ?
+				palloc(sizeof(Jsonb *) * compressor->max_values) :
+				repalloc(compressor->values, sizeof(Jsonb *) * compressor->max_values);
+	}
+
+	compressor->values[compressor->num_values++] = value;
+}
+
+static void
+jsonb_compressor_append_val(Compressor *compressor, Datum val)
+{
+	jsonb_compressor_append((JsonbCompressor *) compressor, (Jsonb *) PG_DETOAST_DATUM_COPY(val));
+}
+
+static void
+jsonb_compressor_append_null(Compressor *compressor)
+{
+	jsonb_compressor_append((JsonbCompressor *) compressor, NULL);
+}
+
+typedef struct JsonbPairCmpContext
+{
+	const JsonbPair *pairs;
+} JsonbPairCmpContext;
+
+static int
+jsonb_pair_cmp(const void *a, const void *b, void *arg)
+{
+	const JsonbPair *pairs = ((JsonbPairCmpContext *) arg)->pairs;
+	const JsonbValue *key_a = &pairs[*(const uint32 *) a].key;
+	const JsonbValue *key_b = &pairs[*(const uint32 *) b].key;
+
+	return jsonb_key_cmp(key_a->val.string.val,
+						 key_a->val.string.len,
+						 key_b->val.string.val,
+						 key_b->val.string.len);
+}
+
+static int
+jsonb_stream_builder_count_cmp(const void *a, const void *b)
+{
+	const JsonbStreamBuilder *builder_a = (const JsonbStreamBuilder *) a;
+	const JsonbStreamBuilder *builder_b = (const JsonbStreamBuilder *) b;
+
+	if (builder_a->count != builder_b->count)
+		return builder_a->count > builder_b->count ? -1 : 1;
+	return jsonb_key_cmp(builder_a->stream.key,
+						 builder_a->stream.key_len,
+						 builder_b->stream.key,
+						 builder_b->stream.key_len);
+}
+
+static int
+jsonb_stream_builder_key_cmp(const void *a, const void *b)
+{
+	const JsonbStreamBuilder *builder_a = (const JsonbStreamBuilder *) a;
+	const JsonbStreamBuilder *builder_b = (const JsonbStreamBuilder *) b;
+
+	return jsonb_key_cmp(builder_a->stream.key,
+						 builder_a->stream.key_len,
+						 builder_b->stream.key,
+						 builder_b->stream.key_len);
+}
+
+/*
+ * Choose the keys to shred. The pairs of all objects are sorted by key, and a
+ * key is shredded if enough objects have a value of the same type for it.
+ * Integers also count for a numeric stream. Returns the streams in key order.
+ */
+static JsonbStreamBuilder *
+jsonb_choose_streams(const JsonbPair *pairs, uint32 num_pairs, uint32 num_objects,
+					 uint32 *num_streams)
+{
+	JsonbPairCmpContext context = { .pairs = pairs };
+	uint32 *order = palloc(sizeof(uint32) * Max(num_pairs, 1));
+	JsonbStreamBuilder *streams = NULL;
+	uint32 max_streams = 0;
+	uint32 start;
+	uint32 i;
+
+	*num_streams = 0;
+
+	for (i = 0; i < num_pairs; i++)
+		order[i] = i;
+
+	qsort_arg(order, num_pairs, sizeof(uint32), jsonb_pair_cmp, &context);
+
+	for (start = 0; start < num_pairs; start = i)
+	{
+		const JsonbValue *key = &pairs[order[start]].key;
+		uint32 counts[JSONB_STREAM_BOOL + 1] = { 0 };
+		JsonbStreamType type;
+		uint32 count;
+
+		for (i = start; i < num_pairs && jsonb_pair_cmp(&order[start], &order[i], &context) == 0;
+			 i++)
+			counts[pairs[order[i]].type]++;
+
+		if (counts[JSONB_STREAM_NUMERIC] > 0)
+			type = JSONB_STREAM_NUMERIC;
+		else
+			type = JSONB_STREAM_INT8;
+		count = counts[JSONB_STREAM_INT8] + counts[JSONB_STREAM_NUMERIC];
+
+		if (counts[JSONB_STREAM_TEXT] > count)
+		{
+			type = JSONB_STREAM_TEXT;
+			count = counts[JSONB_STREAM_TEXT];
+		}
+		if (counts[JSONB_STREAM_BOOL] > count)
+		{
+			type = JSONB_STREAM_BOOL;
+			count = counts[JSONB_STREAM_BOOL];
+		}
+
+		if (count == 0 || (uint64) count * JSONB_MIN_KEY_RATIO < num_objects)
+			continue;
+
+		if (*num_streams == max_streams)
+		{
+			max_streams = Max(max_streams * 2, 16);
+			streams = streams == NULL ? palloc(sizeof(JsonbStreamBuilder) * max_streams) :
+										repalloc(streams, sizeof(JsonbStreamBuilder) * max_streams);
+		}
+
+		streams[(*num_streams)++] = (JsonbStreamBuilder){
+			.stream = {
+				.key = key->val.string.val,
+				.key_len = key->val.string.len,
+				.type = type,
+				.in_residual = count < i - start,
+			},
+			.count = count,
+		};
+	}
+
+	/* keep the keys with the most values */
+	if (*num_streams > JSONB_MAX_STREAMS)
+	{
+		qsort(streams, *num_streams, sizeof(JsonbStreamBuilder), jsonb_stream_builder_count_cmp);
+		*num_streams = JSONB_MAX_STREAMS;
+		qsort(streams, *num_streams, sizeof(JsonbStreamBuilder), jsonb_stream_builder_key_cmp);
+	}
+
+	pfree(order);
+	return streams;
+}
+
+static JsonbStreamBuilder *
+jsonb_find_stream(JsonbStreamBuilder *streams, uint32 num_streams, const JsonbValue *key)
+{
+	uint32 low = 0;
+	uint32 high = num_streams;
+
+	while (low < high)
+	{
+		uint32 middle = low + (high - low) / 2;
+		int cmp = jsonb_key_cmp(streams[middle].stream.key,
+								streams[middle].stream.key_len,
+								key->val.string.val,
+								key->val.string.len);
+
+		if (cmp == 0)
+			return &streams[middle];
+		if (cmp < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return NULL;
+}
+
+static Compressor *
+jsonb_stream_compressor(JsonbStreamType type)
+{
+	switch (type)
+	{
+		case JSONB_STREAM_INT8:
+			return delta_delta_compressor_for_type(INT8OID);
+		case JSONB_STREAM_NUMERIC:
+			return array_compressor_for_type(NUMERICOID);
+		case JSONB_STREAM_TEXT:
+		case JSONB_STREAM_BOOL:
+			return dictionary_compressor_for_type(jsonb_stream_element_type(type));
+		default:
+			elog(ERROR, "invalid stream type %d in jsonb", type);
+	}
+}
+
+/*
+ * Append the values of an object to the streams and return the residual
+ * object of the keys that are not in a stream, or NULL if there are none.
+ */
+static Jsonb *
+jsonb_append_object(JsonbStreamBuilder *streams, uint32 num_streams, const JsonbPair *pairs,
+					uint32 num_pairs)
+{
+	JsonbParseState *state = NULL;
+	JsonbValue *residual = NULL;
+	uint32 i;
+
+	for (i = 0; i < num_streams; i++)
+		streams[i].has_value = false;
+
+	for (i = 0; i < num_pairs; i++)
+	{
+		const JsonbPair *pair = &pairs[i];
+		JsonbStreamBuilder *stream = jsonb_find_stream(streams, num_streams, &pair->key);
+
+		if (stream != NULL && jsonb_stream_accepts(stream->stream.type, pair->type))
+		{
+			stream->compressor->append_val(stream->compressor,
+										   jsonb_pair_stream_datum(pair, stream->stream.type));
+			stream->has_value = true;
+			continue;
+		}
+
+		if (state == NULL)
+			pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+		pushJsonbValue(&state, WJB_KEY, (JsonbValue *) &pair->key);
+		pushJsonbValue(&state, WJB_VALUE, (JsonbValue *) &pair->value);
+	}
+
+	for (i = 0; i < num_streams; i++)
+	{
+		if (!streams[i].has_value)
+			streams[i].compressor->append_null(streams[i].compressor);
+	}
+
+	if (state == NULL)
+		return NULL;
+
+	residual = pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	return JsonbValueToJsonb(residual);
+}
+
+static void *
+jsonb_compress(Jsonb **values, uint32 num_values)
+{
+	uint32 *row_pairs = palloc(sizeof(uint32) * (num_values + 1));
+	JsonbPair *pairs = NULL;
+	uint32 num_pairs = 0;
+	uint32 max_pairs = 0;
+	uint32 num_objects = 0;
+	bool has_values = false;
+	JsonbStreamBuilder *builders;
+	JsonbStream *streams;
+	uint32 num_streams;
+	uint32 num_finished = 0;
+	Compressor *residual = array_compressor_for_type(JSONBOID);
+	CompressedDataHeader *residual_compressed;
+	Simple8bRleCompressor kinds;
+	uint32 row;
+	uint32 i;
+
+	/* collect the key and value pairs of all objects */
+	for (row = 0; row < num_values; row++)
+	{
+		JsonbIterator *it;
+		JsonbIteratorToken token;
+		JsonbValue value;
+
+		row_pairs[row] = num_pairs;
+
+		if (values[row] == NULL)
+			continue;
+
+		has_values = true;
+		if (!JB_ROOT_IS_OBJECT(values[row]))
+			continue;
+
+		num_objects++;
+		it = JsonbIteratorInit(&values[row]->root);
+		while ((token = JsonbIteratorNext(&it, &value, true)) != WJB_DONE)
+		{
+			if (token == WJB_KEY)
+			{
+				if (num_pairs == max_pairs)
+				{
+					max_pairs = Max(max_pairs * 2, 256);
+					pairs = pairs == NULL ? palloc(sizeof(JsonbPair) * max_pairs) :
+											repalloc(pairs, sizeof(JsonbPair) * max_pairs);
+				}
+				pairs[num_pairs].key = value;
+			}
+			else if (token == WJB_VALUE)
+			{
+				JsonbPair *pair = &pairs[num_pairs++];
+
+				pair->value = value;
+				pair->type = jsonb_value_stream_type(&value, &pair->int_value);
+			}
+		}
+	}
+	row_pairs[num_values] = num_pairs;
+
+	if (!has_values)
+		return NULL;
+
+	builders = jsonb_choose_streams(pairs, num_pairs, num_objects, &num_streams);
+	for (i = 0; i < num_streams; i++)
+		builders[i].compressor = jsonb_stream_compressor(builders[i].stream.type);
+
+	simple8brle_compressor_init(&kinds);
+
+	for (row = 0; row < num_values; row++)
+	{
+		Jsonb *rest;
+
+		if (values[row] == NULL)
+		{
+			simple8brle_compressor_append(&kinds, JSONB_ROW_NULL);
+			for (i = 0; i < num_streams; i++)
+				builders[i].compressor->append_null(builders[i].compressor);
+			residual->append_null(residual);
+			continue;
+		}
+
+		if (!JB_ROOT_IS_OBJECT(values[row]))
+		{
+			simple8brle_compressor_append(&kinds, JSONB_ROW_OTHER);
+			for (i = 0; i < num_streams; i++)
+				builders[i].compressor->append_null(builders[i].compressor);
+			residual->append_val(residual, PointerGetDatum(values[row]));
+			continue;
+		}
+
+		simple8brle_compressor_append(&kinds, JSONB_ROW_OBJECT);
+		rest = jsonb_append_object(builders,
+								   num_streams,
+								   &pairs[row_pairs[row]],
+								   row_pairs[row + 1] - row_pairs[row]);
+		if (rest != NULL)
+			residual->append_val(residual, PointerGetDatum(rest));
+		else
+			residual->append_null(residual);
+	}
+
+	streams = palloc(sizeof(JsonbStream) * Max(num_streams, 1));
+	for (i = 0; i < num_streams; i++)
+	{
+		builders[i].stream.values = builders[i].compressor->finish(builders[i].compressor);
+
+		/* a stream without values has no values to restore */
+		if (builders[i].stream.values != NULL)
+			streams[num_finished++] = builders[i].stream;
+	}
+
+	residual_compressed = residual->finish(residual);
+
+	return jsonb_from_parts(simple8brle_compressor_finish(&kinds),
+							streams,
+							num_finished,
+							residual_compressed);
+}
+
+static void *
+jsonb_compressor_finish_and_reset(Compressor *compressor)
+{
+	JsonbCompressor *jsonb_compressor = (JsonbCompressor *) compressor;
+	void *compressed = jsonb_compress(jsonb_compressor->values, jsonb_compressor->num_values);
+
+	jsonb_compressor->num_values = 0;
+	return compressed;
+}
+
+static const Compressor jsonb_compressor = {
+	.append_val = jsonb_compressor_append_val,
+	.append_null = jsonb_compressor_append_null,
+	.finish = jsonb_compressor_finish_and_reset,
+};
+
+Compressor *
+jsonb_compressor_for_type(Oid element_type)
+{
+	JsonbCompressor *compressor;
+
+	if (element_type != JSONBOID)
+		elog(ERROR, "invalid type for jsonb compressor %d", element_type);
+
+	compressor = palloc(sizeof(*compressor));
+	*compressor = (JsonbCompressor){
+		.base = jsonb_compressor,
+	};
+	return &compressor->base;
+}
+
+/******************************
+ ***  Decompression  ***
+ ******************************/
+
+/* build an object from the values of a row in the streams and the residual */
+static Jsonb *
+jsonb_build_object(const JsonbParts *parts, const DecompressedColumn *stream_values,
+				   const DecompressedColumn *residual, uint32 row, char **keys, int num_keys)
+{
+	JsonbParseState *state = NULL;
+	JsonbValue *object;
+	uint32 i;
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	for (i = 0; i < parts->num_streams; i++)
+	{
+		const JsonbStream *stream = &parts->streams[i];
+		JsonbValue key;
+		JsonbValue value;
+
+		/* streams that are not needed are not decompressed */
+		if (stream_values[i].values == NULL || DECOMPRESSED_COLUMN_IS_NULL(&stream_values[i], row))
+			continue;
+
+		key.type = jbvString;
+		key.val.string.val = (char *) stream->key;
+		key.val.string.len = stream->key_len;
+		jsonb_stream_value(stream->type,
+						   decompressed_column_get_datum(&stream_values[i], row),
+						   &value);
+
+		pushJsonbValue(&state, WJB_KEY, &key);
+		pushJsonbValue(&state, WJB_VALUE, &value);
+	}
+
+	if (residual != NULL && !DECOMPRESSED_COLUMN_IS_NULL(residual, row))
+	{
+		Jsonb *rest = (Jsonb *) PG_DETOAST_DATUM(decompressed_column_get_datum(residual, row));
+		JsonbIterator *it;
+		JsonbIteratorToken token;
+		JsonbValue value;
+		bool is_requested = false;
+
+		if (!JB_ROOT_IS_OBJECT(rest))
+			elog(ERROR, "invalid residual in jsonb");
+
+		it = JsonbIteratorInit(&rest->root);
+		while ((token = JsonbIteratorNext(&it, &value, true)) != WJB_DONE)
+		{
+			if (token == WJB_KEY)
+			{
+				is_requested = keys == NULL || jsonb_key_is_requested(value.val.string.val,
+																	  value.val.string.len,
+																	  keys,
+																	  num_keys);
+				if (is_requested)
+					pushJsonbValue(&state, WJB_KEY, &value);
+			}
+			else if (token == WJB_VALUE && is_requested)
+				pushJsonbValue(&state, WJB_VALUE, &value);
+		}
+	}
+
+	object = pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	return JsonbValueToJsonb(object);
+}
+
+/*
+ * Decompress all rows, with only the requested keys if keys is not NULL. Only
+ * the streams of the requested keys are decompressed, and the residual only if
+ * it can contain them.
+ */
+static void
+jsonb_decompress_internal(Datum compressed_datum, char **keys, int num_keys,
+						  DecompressedColumn *column)
+{
+	JsonbCompressed *compressed = (JsonbCompressed *) PG_DETOAST_DATUM(compressed_datum);
+	JsonbParts parts;
+	DecompressedColumn *stream_values;
+	DecompressedColumn residual = { 0 };
+	bool need_residual = keys == NULL;
+	uint64 *kinds;
+	uint32 num_rows;
+	uint32 row;
+	uint32 i;
+	int k;
+
+	Assert(compressed->compression_algorithm == COMPRESSION_ALGORITHM_JSONB);
+	jsonb_parts_from_compressed(compressed, &parts);
+
+	kinds = palloc(sizeof(uint64) *
+				   simple8brle_decompress_all_buffer_size(parts.kinds->num_elements));
+	num_rows = simple8brle_decompress_all_forward(parts.kinds, kinds);
+
+	for (row = 0; row < num_rows; row++)
+	{
+		if (kinds[row] > JSONB_ROW_OTHER)
+			elog(ERROR, "invalid row kind in jsonb");
+		need_residual |= kinds[row] == JSONB_ROW_OTHER;
+	}
+
+	/* values of the requested keys are in the residual if they have no stream */
+	for (k = 0; keys != NULL && k < num_keys && !need_residual; k++)
+	{
+		bool has_stream = false;
+
+		for (i = 0; i < parts.num_streams && !has_stream; i++)
+			has_stream = jsonb_key_is_requested(parts.streams[i].key,
+												parts.streams[i].key_len,
+												&keys[k],
+												1);
+		need_residual = !has_stream;
+	}
+
+	stream_values = palloc0(sizeof(DecompressedColumn) * Max(parts.num_streams, 1));
+	for (i = 0; i < parts.num_streams; i++)
+	{
+		JsonbStream *stream = &parts.streams[i];
+
+		if (keys != NULL &&
+			!jsonb_key_is_requested(stream->key, stream->key_len, keys, num_keys))
+			continue;
+
+		need_residual |= stream->in_residual;
+		decompress_all(PointerGetDatum(stream->values),
+					   jsonb_stream_element_type(stream->type),
+					   &stream_values[i]);
+		if (stream_values[i].num_values != num_rows)
+			elog(ERROR, "invalid number of values in jsonb stream");
+	}
+
+	if (need_residual && parts.residual != NULL)
+	{
+		decompress_all(PointerGetDatum(parts.residual), JSONBOID, &residual);
+		if (residual.num_values != num_rows)
+			elog(ERROR, "invalid number of values in jsonb residual");
+	}
+	else
+		need_residual = false;
+
+	decompressed_column_init(column, JSONBOID, num_rows);
+
+	for (row = 0; row < num_rows; row++)
+	{
+		switch (kinds[row])
+		{
+			case JSONB_ROW_NULL:
+				DECOMPRESSED_COLUMN_SET_NULL(column, row);
+				column->num_nulls++;
+				break;
+			case JSONB_ROW_OTHER:
+				if (!need_residual || DECOMPRESSED_COLUMN_IS_NULL(&residual, row))
+					elog(ERROR, "missing residual in jsonb");
+				decompressed_column_store_datum(column,
+												row,
+												decompressed_column_get_datum(&residual, row));
+				break;
+			case JSONB_ROW_OBJECT:
+			{
+				Jsonb *object = jsonb_build_object(&parts,
+												   stream_values,
+												   need_residual ? &residual : NULL,
+												   row,
+												   keys,
+												   num_keys);
+				decompressed_column_store_datum(column, row, PointerGetDatum(object));
+				break;
+			}
+		}
+	}
+
+	pfree(kinds);
+}
+
+void
+jsonb_decompress_all(Datum compressed, Oid element_type, DecompressedColumn *column)
+{
+	if (element_type != JSONBOID)
+		elog(ERROR, "invalid type requested from jsonb decompression %d", element_type);
+
+	jsonb_decompress_internal(compressed, NULL, 0, column);
+}
+
+void
+jsonb_decompress_keys(Datum compressed, char **keys, int num_keys, DecompressedColumn *column)
+{
+	jsonb_decompress_internal(compressed, keys, num_keys, column);
+}
+
+/*
+ * The objects are built from several streams, so the values of a segment are
+ * decompressed as a whole when the iterator is created.
+ */
+static DecompressionIterator *
+jsonb_decompression_iterator_init(Datum compressed, bool forward, char **keys, int num_keys)
+{
+	JsonbDecompressionIterator *iter = palloc0(sizeof(*iter));
+
+	jsonb_decompress_internal(compressed, keys, num_keys, &iter->values);
+
+	iter->base = (DecompressionIterator){
+		.compression_algorithm = COMPRESSION_ALGORITHM_JSONB,
+		.forward = forward,
+		.element_type = JSONBOID,
+		.try_next = forward ? jsonb_decompression_iterator_try_next_forward :
+							  jsonb_decompression_iterator_try_next_reverse,
+	};
+	iter->position = forward ? 0 : (int64) iter->values.num_values - 1;
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+jsonb_decompression_iterator_from_datum_forward(Datum compressed, Oid element_type)
+{
+	if (element_type != JSONBOID)
+		elog(ERROR, "invalid type requested from jsonb decompression %d", element_type);
+
+	return jsonb_decompression_iterator_init(compressed, true, NULL, 0);
+}
+
+DecompressionIterator *
+jsonb_decompression_iterator_from_datum_reverse(Datum compressed, Oid element_type)
+{
+	if (element_type != JSONBOID)
+		elog(ERROR, "invalid type requested from jsonb decompression %d", element_type);
+
+	return jsonb_decompression_iterator_init(compressed, false, NULL, 0);
+}
+
+DecompressionIterator *
+jsonb_decompression_iterator_from_datum_keys(Datum compressed, bool forward, char **keys,
+											 int num_keys)
+{
+	return jsonb_decompression_iterator_init(compressed, forward, keys, num_keys);
+}
+
+static DecompressResult
+jsonb_decompression_iterator_try_next(JsonbDecompressionIterator *iter)
+{
+	int64 position = iter->position;
+
+	if (position < 0 || position >= iter->values.num_values)
+		return (DecompressResult){
+			.is_done = true,
+		};
+
+	iter->position += iter->base.forward ? 1 : -1;
+
+	if (DECOMPRESSED_COLUMN_IS_NULL(&iter->values, position))
+		return (DecompressResult){
+			.is_null = true,
+		};
+
+	return (DecompressResult){
+		.val = decompressed_column_get_datum(&iter->values, position),
+	};
+}
+
+DecompressResult
+jsonb_decompression_iterator_try_next_forward(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_JSONB && iter->forward);
+	return jsonb_decompression_iterator_try_next((JsonbDecompressionIterator *) iter);
+}
+
+DecompressResult
+jsonb_decompression_iterator_try_next_reverse(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_JSONB && !iter->forward);
+	return jsonb_decompression_iterator_try_next((JsonbDecompressionIterator *) iter);
+}
+
+/**********************************************************************************/
+/**********************************************************************************/
+
+/* send a nested compressed datum in the format of its own algorithm */
+static void
+jsonb_send_nested(StringInfo buffer, CompressedDataHeader *nested)
+{
+	bytea *data =
+		DatumGetByteaP(DirectFunctionCall1(tsl_compressed_data_send, PointerGetDatum(nested)));
+
+	pq_sendint32(buffer, VARSIZE(data) - VARHDRSZ);
+	pq_sendbytes(buffer, VARDATA(data), VARSIZE(data) - VARHDRSZ);
+}
+
+static CompressedDataHeader *
+jsonb_recv_nested(StringInfo buffer)
+{
+	uint32 size = pq_getmsgint32(buffer);
+	StringInfoData nested_buffer = {
+		.data = (char *) pq_getmsgbytes(buffer, size),
+		.len = size,
+		.maxlen = size,
+	};
+
+	if (size == 0)
+		elog(ERROR, "invalid recv in jsonb: bad stream");
+
+	return (CompressedDataHeader *) DatumGetPointer(
+		DirectFunctionCall1(tsl_compressed_data_recv, PointerGetDatum(&nested_buffer)));
+}
+
+void
+jsonb_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	JsonbCompressed *data = (JsonbCompressed *) header;
+	JsonbParts parts;
+	uint32 i;
+
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_JSONB);
+	jsonb_parts_from_compressed(data, &parts);
+
+	pq_sendbyte(buffer, data->has_residual);
+	pq_sendint32(buffer, parts.num_streams);
+	simple8brle_serialized_send(buffer, parts.kinds);
+
+	for (i = 0; i < parts.num_streams; i++)
+	{
+		pq_sendint32(buffer, parts.streams[i].key_len);
+		pq_sendbytes(buffer, parts.streams[i].key, parts.streams[i].key_len);
+		pq_sendbyte(buffer, parts.streams[i].type);
+		pq_sendbyte(buffer, parts.streams[i].in_residual ? 1 : 0);
+		jsonb_send_nested(buffer, parts.streams[i].values);
+	}
+
+	if (data->has_residual)
+		jsonb_send_nested(buffer, parts.residual);
+}
+
+Datum
+jsonb_compressed_recv(StringInfo buffer)
+{
+	uint8 has_residual;
+	uint32 num_streams;
+	Simple8bRleSerialized *kinds;
+	JsonbStream *streams;
+	CompressedDataHeader *residual = NULL;
+	uint32 i;
+
+	has_residual = pq_getmsgbyte(buffer);
+	if (has_residual != 0 && has_residual != 1)
+		elog(ERROR, "invalid recv in jsonb: bad bool");
+
+	num_streams = pq_getmsgint32(buffer);
+	if (num_streams > PG_UINT16_MAX)
+		elog(ERROR, "invalid recv in jsonb: bad number of streams");
+
+	kinds = simple8brle_serialized_recv(buffer);
+
+	streams = palloc(sizeof(JsonbStream) * Max(num_streams, 1));
+	for (i = 0; i < num_streams; i++)
+	{
+		JsonbStream *stream = &streams[i];
+		uint8 in_residual;
+
+		stream->key_len = pq_getmsgint32(buffer);
+		stream->key = pq_getmsgbytes(buffer, stream->key_len);
+		stream->type = pq_getmsgbyte(buffer);
+		if (stream->type < JSONB_STREAM_INT8 || stream->type > JSONB_STREAM_BOOL)
+			elog(ERROR, "invalid recv in jsonb: bad stream type");
+
+		in_residual = pq_getmsgbyte(buffer);
+		if (in_residual != 0 && in_residual != 1)
+			elog(ERROR, "invalid recv in jsonb: bad bool");
+		stream->in_residual = in_residual == 1;
+
+		stream->values = jsonb_recv_nested(buffer);
+	}
+
+	if (has_residual)
+	{
+		residual = jsonb_recv_nested(buffer);
+		if (residual->compression_algorithm != COMPRESSION_ALGORITHM_ARRAY)
+			elog(ERROR, "invalid recv in jsonb: bad residual");
+	}
+
+	PG_RETURN_POINTER(jsonb_from_parts(kinds, streams, num_streams, residual));
+}
@@ -0,0 +1,69 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+/*
+ * The `jsonb` compression method shreds jsonb objects into their keys. Top
+ * level keys that most objects of a segment have, with values of the same
+ * scalar type, are stored as a value stream each: integers are compressed with
+ * deltadelta, other numbers with array, and strings and booleans with
+ * dictionary compression. All other keys, and values that do not fit the type
+ * of their key's stream, are stored as a residual object per row that is array
+ * compressed. Values that are not objects are stored whole in the residual.
+ *
+ * Objects are decompressed by merging the values of the streams with the
+ * residual. Since a jsonb object does not remember the order of its keys, the
+ * result is equal to the compressed object.
+ *
+ * If only some keys of a column are used, e.g., by `payload->>'temp'`, the
+ * objects can be decompressed with only these keys. This decompresses only the
+ * streams of the keys, and skips the residual if it cannot contain them.
+ */
+#ifndef TIMESCALEDB_TSL_COMPRESSION_JSONB_H
+#define TIMESCALEDB_TSL_COMPRESSION_JSONB_H
+
+#include <postgres.h>
+#include <c.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include <export.h>
+#include "compression/compression.h"
+
+typedef struct JsonbCompressed JsonbCompressed;
+
+extern Compressor *jsonb_compressor_for_type(Oid element_type);
+
+extern DecompressionIterator *jsonb_decompression_iterator_from_datum_forward(Datum compressed,
+																			  Oid element_type);
+extern DecompressionIterator *jsonb_decompression_iterator_from_datum_reverse(Datum compressed,
+																			  Oid element_type);
+extern DecompressResult jsonb_decompression_iterator_try_next_forward(DecompressionIterator *iter);
+extern DecompressResult jsonb_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
+
+extern void jsonb_decompress_all(Datum compressed, Oid element_type, DecompressedColumn *column);
+
+/* decompress the objects with only the given top level keys */
+extern DecompressionIterator *jsonb_decompression_iterator_from_datum_keys(Datum compressed,
+																		   bool forward,
+																		   char **keys,
+																		   int num_keys);
+extern void jsonb_decompress_keys(Datum compressed, char **keys, int num_keys,
+								  DecompressedColumn *column);
+
+extern void jsonb_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum jsonb_compressed_recv(StringInfo buffer);
+
+#define JSONB_ALGORITHM_DEFINITION                                                                 \
+	{                                                                                              \
+		.iterator_init_forward = jsonb_decompression_iterator_from_datum_forward,                  \
+		.iterator_init_reverse = jsonb_decompression_iterator_from_datum_reverse,                  \
+		.decompress_all = jsonb_decompress_all,                                                    \
+		.compressed_data_send = jsonb_compressed_send,                                             \
+		.compressed_data_recv = jsonb_compressed_recv,                                             \
+		.compressor_for_type = jsonb_compressor_for_type,                                          \
+		.compressed_data_storage = TOAST_STORAGE_EXTENDED,                                         \
+	}
+
+#endif
@@ -0,0 +1,1055 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "compression/pfor.h"
+
+#include <catalog/pg_type.h>
+#include <utils/builtins.h>
+#include <utils/memutils.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+
+#include <compat.h>
+
+#include "compression/compression.h"
+#include "compression/simd.h"
+#include "compression/simple8b_rle.h"
+
+/*
+ * Layout of the packed offsets of a block.
+ *
+ * Value i of a block belongs to lane i % PFOR_LANES and is the (i / PFOR_LANES)th
+ * value of its lane. Each lane is a bit stream of offsets of the block's width,
+ * and the words of the lanes are interleaved, i.e., word w of lane l is stored
+ * at index w * PFOR_LANES + l. The jth value of every lane thus starts at the
+ * same bit offset j * width within the same word index, so the four values
+ * i = 4j .. 4j + 3 are unpacked with one vector load, shift and mask, and land
+ * in consecutive positions of the output.
+ *
+ * The lanes of the last block are padded with zeros up to the same number of
+ * values, so unpacking always produces whole blocks.
+ */
+#define PFOR_BLOCK_SIZE 128
+#define PFOR_LANES 4
+
+/*
+ * The approximate cost in bits of an exception in addition to its high bits:
+ * the gap to the previous exception and the simple8b overhead of both.
+ */
+#define PFOR_EXCEPTION_OVERHEAD_BITS 16
+
+typedef struct PforCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_nulls; /* 1 if this has a NULLs bitmap after the exceptions, 0 otherwise */
+	uint8 padding[2];
+	uint32 num_values; /* number of non-NULL values */
+	uint32 num_exceptions;
+	/*
+	 * references (uint64 per block), widths (uint8 per block, padded to a
+	 * multiple of 8 bytes), the packed words, the simple8b streams of
+	 * exception positions and exception high bits if there are exceptions, and
+	 * the simple8b stream of NULL flags if there are NULLs
+	 */
+	uint64 data[FLEXIBLE_ARRAY_MEMBER];
+} PforCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	PforCompressed test_val = { { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(PforCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.padding) +
+							 sizeof(test_val.num_values) + sizeof(test_val.num_exceptions),
+					 "PforCompressed wrong size");
+	StaticAssertStmt(sizeof(PforCompressed) == 16, "PforCompressed wrong size");
+	/* the AVX2 kernel unpacks one value of every lane at once */
+	StaticAssertStmt(PFOR_LANES == 4, "PFOR_LANES must match the vector width");
+}
+
+/* the parts of a PforCompressed */
+typedef struct PforParts
+{
+	uint32 num_values;
+	uint32 num_blocks;
+	uint32 num_exceptions;
+	const uint64 *references;
+	const uint8 *widths;
+	const uint64 *packed;
+	Simple8bRleSerialized *exception_positions;
+	Simple8bRleSerialized *exception_values;
+	Simple8bRleSerialized *nulls;
+} PforParts;
+
+typedef struct PforDecompressionIterator
+{
+	DecompressionIterator base;
+	uint64 *values;
+	int64 position;
+	uint32 num_values;
+	Simple8bRleDecompressionIterator nulls;
+	bool has_nulls;
+} PforDecompressionIterator;
+
+typedef struct PforCompressor
+{
+	uint64 *values;
+	uint32 num_values;
+	uint32 max_values;
+	Simple8bRleCompressor nulls;
+	bool has_nulls;
+} PforCompressor;
+
+typedef struct ExtendedCompressor
+{
+	Compressor base;
+	PforCompressor *internal;
+} ExtendedCompressor;
+
+/********************
+ *****  UTILS  *****
+ ********************/
+
+static inline uint32
+pfor_num_blocks(uint32 num_values)
+{
+	return (num_values + PFOR_BLOCK_SIZE - 1) / PFOR_BLOCK_SIZE;
+}
+
+static inline uint32
+pfor_block_values(uint32 num_values, uint32 block)
+{
+	return Min(PFOR_BLOCK_SIZE, num_values - block * PFOR_BLOCK_SIZE);
+}
+
+static inline uint32
+pfor_lane_values(uint32 block_values)
+{
+	return (block_values + PFOR_LANES - 1) / PFOR_LANES;
+}
+
+/* number of packed words of a block, over all lanes */
+static inline uint32
+pfor_block_words(uint32 block_values, uint32 width)
+{
+	return PFOR_LANES * ((pfor_lane_values(block_values) * width + 63) / 64);
+}
+
+static inline uint64
+pfor_width_mask(uint32 width)
+{
+	return width == 64 ? ~UINT64CONST(0) : (UINT64CONST(1) << width) - 1;
+}
+
+/* number of bits needed to store the value */
+static inline uint32
+pfor_bit_width(uint64 value)
+{
+#ifdef HAVE__BUILTIN_CLZ
+	return value == 0 ? 0 : 64 - __builtin_clzll(value);
+#else
+	uint32 width = 0;
+
+	while (value != 0)
+	{
+		value >>= 1;
+		width++;
+	}
+	return width;
+#endif
+}
+
+static uint32
+pfor_packed_words(uint32 num_values, const uint8 *widths)
+{
+	uint32 num_blocks = pfor_num_blocks(num_values);
+	uint32 num_words = 0;
+	uint32 block;
+
+	for (block = 0; block < num_blocks; block++)
+		num_words += pfor_block_words(pfor_block_values(num_values, block), widths[block]);
+
+	return num_words;
+}
+
+static void
+pfor_parts_from_compressed(const PforCompressed *compressed, PforParts *parts)
+{
+	const char *data = (const char *) compressed->data;
+
+	*parts = (PforParts){
+		.num_values = compressed->num_values,
+		.num_blocks = pfor_num_blocks(compressed->num_values),
+		.num_exceptions = compressed->num_exceptions,
+	};
+
+	parts->references = (const uint64 *) data;
+	data += sizeof(uint64) * parts->num_blocks;
+	parts->widths = (const uint8 *) data;
+	data += TYPEALIGN(sizeof(uint64), parts->num_blocks);
+	parts->packed = (const uint64 *) data;
+	data += sizeof(uint64) * pfor_packed_words(parts->num_values, parts->widths);
+
+	if (parts->num_exceptions > 0)
+	{
+		parts->exception_positions = bytes_deserialize_simple8b_and_advance(&data);
+		parts->exception_values = bytes_deserialize_simple8b_and_advance(&data);
+		Assert(parts->exception_positions->num_elements == parts->num_exceptions);
+		Assert(parts->exception_values->num_elements == parts->num_exceptions);
+	}
+
+	if (compressed->has_nulls)
+		parts->nulls = bytes_deserialize_simple8b_and_advance(&data);
+	else
+		Assert(compressed->has_nulls == 0);
+}
+
+/******************************
+ ***  Compressor  ***
+ ******************************/
+
+static void
+pfor_compressor_append_int16(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = pfor_compressor_alloc();
+
+	pfor_compressor_append_value(extended->internal, DatumGetInt16(val));
+}
+
+static void
+pfor_compressor_append_int32(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = pfor_compressor_alloc();
+
+	pfor_compressor_append_value(extended->internal, DatumGetInt32(val));
+}
+
+static void
+pfor_compressor_append_int64(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = pfor_compressor_alloc();
+
+	pfor_compressor_append_value(extended->internal, DatumGetInt64(val));
+}
+
+static void
+pfor_compressor_append_null_value(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = pfor_compressor_alloc();
+
+	pfor_compressor_append_null(extended->internal);
+}
+
+static void *
+pfor_compressor_finish_and_reset(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	void *compressed = pfor_compressor_finish(extended->internal);
+	pfree(extended->internal->values);
+	pfree(extended->internal);
+	extended->internal = NULL;
+	return compressed;
+}
+
+const Compressor pfor_uint16_compressor = {
+	.append_val = pfor_compressor_append_int16,
+	.append_null = pfor_compressor_append_null_value,
+	.finish = pfor_compressor_finish_and_reset,
+};
+const Compressor pfor_uint32_compressor = {
+	.append_val = pfor_compressor_append_int32,
+	.append_null = pfor_compressor_append_null_value,
+	.finish = pfor_compressor_finish_and_reset,
+};
+const Compressor pfor_uint64_compressor = {
+	.append_val = pfor_compressor_append_int64,
+	.append_null = pfor_compressor_append_null_value,
+	.finish = pfor_compressor_finish_and_reset,
+};
+
+Compressor *
+pfor_compressor_for_type(Oid element_type)
+{
+	ExtendedCompressor *compressor = palloc(sizeof(*compressor));
+	switch (element_type)
+	{
+		case INT2OID:
+			*compressor = (ExtendedCompressor){ .base = pfor_uint16_compressor };
+			return &compressor->base;
+		case INT4OID:
+			*compressor = (ExtendedCompressor){ .base = pfor_uint32_compressor };
+			return &compressor->base;
+		case INT8OID:
+			*compressor = (ExtendedCompressor){ .base = pfor_uint64_compressor };
+			return &compressor->base;
+		default:
+			elog(ERROR, "invalid type for pfor compressor %d", element_type);
+	}
+}
+
+PforCompressor *
+pfor_compressor_alloc(void)
+{
+	PforCompressor *compressor = palloc0(sizeof(*compressor));
+	compressor->max_values = PFOR_BLOCK_SIZE;
+	compressor->values = palloc(sizeof(uint64) * compressor->max_values);
+	simple8brle_compressor_init(&compressor->nulls);
+	return compressor;
+}
+
+void
+pfor_compressor_append_null(PforCompressor *compressor)
+{
+	compressor->has_nulls = true;
+	simple8brle_compressor_append(&compressor->nulls, 1);
+}
+
+void
+pfor_compressor_append_value(PforCompressor *compressor, int64 next_val)
+{
+	if (compressor->num_values == compressor->max_values)
+	{
+		compressor->max_values *= 2;
+		compressor->values = repalloc(compressor->values, sizeof(uint64) * compressor->max_values);
+	}
+
+	compressor->values[compressor->num_values++] = (uint64) next_val;
+	simple8brle_compressor_append(&compressor->nulls, 0);
+}
+
+/*
+ * Choose the frame of a block: the reference is the minimum of the block, and
+ * the width is the one minimizing the packed size of the block plus the size
+ * of the exceptions it causes. Returns the number of exceptions.
+ */
+static uint32
+pfor_choose_frame(const uint64 *values, uint32 num_values, uint64 *reference, uint8 *width)
+{
+	uint32 counts[65] = { 0 };
+	uint32 max_width = 0;
+	uint32 best_width;
+	uint32 best_exceptions = 0;
+	uint64 best_cost;
+	uint32 exceptions = 0;
+	int64 min = (int64) values[0];
+	uint32 i;
+	int w;
+
+	for (i = 1; i < num_values; i++)
+		min = Min(min, (int64) values[i]);
+
+	for (i = 0; i < num_values; i++)
+	{
+		uint32 bits = pfor_bit_width(values[i] - (uint64) min);
+
+		counts[bits]++;
+		max_width = Max(max_width, bits);
+	}
+
+	/* narrower widths only win if few values need more bits */
+	best_width = max_width;
+	best_cost = (uint64) num_values * max_width;
+	for (w = (int) max_width - 1; w >= 0; w--)
+	{
+		uint64 cost;
+
+		exceptions += counts[w + 1];
+		cost = (uint64) num_values * w +
+			   (uint64) exceptions * (max_width - w + PFOR_EXCEPTION_OVERHEAD_BITS);
+		if (cost < best_cost)
+		{
+			best_cost = cost;
+			best_width = w;
+			best_exceptions = exceptions;
+		}
+	}
+
+	*reference = (uint64) min;
+	*width = best_width;
+	return best_exceptions;
+}
+
+/*
+ * Pack the low bits of the offsets of a block into its lanes and append the
+ * high bits of the offsets that do not fit to the exception streams.
+ */
+static void
+pfor_pack_block(const uint64 *values, uint32 num_values, uint32 first_position, uint64 reference,
+				uint32 width, uint64 *words, uint32 *last_exception,
+				Simple8bRleCompressor *exception_positions,
+				Simple8bRleCompressor *exception_values)
+{
+	const uint64 mask = pfor_width_mask(width);
+	uint32 i;
+
+	for (i = 0; i < num_values; i++)
+	{
+		uint64 offset = values[i] - reference;
+		uint32 lane = i % PFOR_LANES;
+		uint32 bit = (i / PFOR_LANES) * width;
+		uint32 word = bit / 64;
+		uint32 shift = bit % 64;
+
+		if (width > 0)
+		{
+			uint64 low = offset & mask;
+
+			words[PFOR_LANES * word + lane] |= low << shift;
+			if (shift + width > 64)
+				words[PFOR_LANES * (word + 1) + lane] |= low >> (64 - shift);
+		}
+
+		if (width < 64 && (offset >> width) != 0)
+		{
+			uint32 position = first_position + i;
+
+			simple8brle_compressor_append(exception_positions, position - *last_exception);
+			simple8brle_compressor_append(exception_values, offset >> width);
+			*last_exception = position;
+		}
+	}
+}
+
+static PforCompressed *
+pfor_from_parts(uint32 num_values, uint32 num_exceptions, const uint64 *references,
+				const uint8 *widths, const uint64 *packed,
+				Simple8bRleSerialized *exception_positions,
+				Simple8bRleSerialized *exception_values, Simple8bRleSerialized *nulls)
+{
+	uint32 num_blocks = pfor_num_blocks(num_values);
+	Size packed_size = sizeof(uint64) * pfor_packed_words(num_values, widths);
+	Size positions_size = 0;
+	Size exception_values_size = 0;
+	Size nulls_size = 0;
+	Size compressed_size;
+	char *compressed_data;
+	PforCompressed *compressed;
+
+	if (num_exceptions > 0)
+	{
+		positions_size = simple8brle_serialized_total_size(exception_positions);
+		exception_values_size = simple8brle_serialized_total_size(exception_values);
+	}
+	if (nulls != NULL)
+		nulls_size = simple8brle_serialized_total_size(nulls);
+
+	compressed_size = sizeof(PforCompressed) + sizeof(uint64) * (Size) num_blocks +
+					  TYPEALIGN(sizeof(uint64), num_blocks) + packed_size + positions_size +
+					  exception_values_size + nulls_size;
+
+	if (!AllocSizeIsValid(compressed_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	compressed_data = palloc0(compressed_size);
+	compressed = (PforCompressed *) compressed_data;
+	SET_VARSIZE(&compressed->vl_len_, compressed_size);
+
+	compressed->compression_algorithm = COMPRESSION_ALGORITHM_PFOR;
+	compressed->has_nulls = nulls_size != 0 ? 1 : 0;
+	compressed->num_values = num_values;
+	compressed->num_exceptions = num_exceptions;
+
+	compressed_data = (char *) compressed->data;
+	memcpy(compressed_data, references, sizeof(uint64) * num_blocks);
+	compressed_data += sizeof(uint64) * num_blocks;
+	memcpy(compressed_data, widths, num_blocks);
+	compressed_data += TYPEALIGN(sizeof(uint64), num_blocks);
+	memcpy(compressed_data, packed, packed_size);
+	compressed_data += packed_size;
+
+	if (num_exceptions > 0)
+	{
+		compressed_data = bytes_serialize_simple8b_and_advance(compressed_data,
+															   positions_size,
+															   exception_positions);
+		compressed_data = bytes_serialize_simple8b_and_advance(compressed_data,
+															   exception_values_size,
+															   exception_values);
+	}
+
+	if (compressed->has_nulls)
+	{
+		Assert(nulls->num_elements > num_values);
+		bytes_serialize_simple8b_and_advance(compressed_data, nulls_size, nulls);
+	}
+
+	return compressed;
+}
+
+/*
+ * Compress the values in two passes over the blocks: the first chooses the
+ * frames and sizes the packed words, and the second packs the offsets and
+ * collects the exceptions.
+ */
+void *
+pfor_compressor_finish(PforCompressor *compressor)
+{
+	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
+	Simple8bRleCompressor exception_positions;
+	Simple8bRleCompressor exception_values;
+	uint32 num_values = compressor->num_values;
+	uint32 num_blocks = pfor_num_blocks(num_values);
+	uint32 num_exceptions = 0;
+	uint32 last_exception = 0;
+	uint64 *references;
+	uint8 *widths;
+	uint64 *packed;
+	uint64 *words;
+	uint32 block;
+	PforCompressed *compressed;
+
+	if (num_values == 0)
+		return NULL;
+
+	references = palloc(sizeof(uint64) * num_blocks);
+	widths = palloc(num_blocks);
+
+	for (block = 0; block < num_blocks; block++)
+		num_exceptions += pfor_choose_frame(compressor->values + block * PFOR_BLOCK_SIZE,
+											pfor_block_values(num_values, block),
+											&references[block],
+											&widths[block]);
+
+	simple8brle_compressor_init(&exception_positions);
+	simple8brle_compressor_init(&exception_values);
+	packed = palloc0(sizeof(uint64) * pfor_packed_words(num_values, widths));
+
+	words = packed;
+	for (block = 0; block < num_blocks; block++)
+	{
+		uint32 block_values = pfor_block_values(num_values, block);
+
+		pfor_pack_block(compressor->values + block * PFOR_BLOCK_SIZE,
+						block_values,
+						block * PFOR_BLOCK_SIZE,
+						references[block],
+						widths[block],
+						words,
+						&last_exception,
+						&exception_positions,
+						&exception_values);
+		words += pfor_block_words(block_values, widths[block]);
+	}
+
+	compressed = pfor_from_parts(num_values,
+								 num_exceptions,
+								 references,
+								 widths,
+								 packed,
+								 simple8brle_compressor_finish(&exception_positions),
+								 simple8brle_compressor_finish(&exception_values),
+								 compressor->has_nulls ? nulls : NULL);
+
+	pfree(references);
+	pfree(widths);
+	pfree(packed);
+
+	Assert(compressed->compression_algorithm == COMPRESSION_ALGORITHM_PFOR);
+	return compressed;
+}
+
+/******************************
+ ***  Decompression  ***
+ ******************************/
+
+/*
+ * Unpack the offsets of a block of a non-zero width and add the reference.
+ * Every lane is unpacked completely, so the output of the last block is padded
+ * to a multiple of PFOR_LANES values.
+ */
+static TS_FORCE_INLINE void
+unpack_block_scalar(const uint64 *words, uint64 reference, uint32 width, uint32 lane_values,
+					uint64 *restrict out)
+{
+	const uint64 mask = pfor_width_mask(width);
+	uint32 j;
+	uint32 lane;
+
+	for (j = 0; j < lane_values; j++)
+	{
+		uint32 bit = j * width;
+		uint32 word = bit / 64;
+		uint32 shift = bit % 64;
+
+		for (lane = 0; lane < PFOR_LANES; lane++)
+		{
+			uint64 value = words[PFOR_LANES * word + lane] >> shift;
+
+			if (shift + width > 64)
+				value |= words[PFOR_LANES * (word + 1) + lane] << (64 - shift);
+			out[PFOR_LANES * j + lane] = (value & mask) + reference;
+		}
+	}
+}
+
+#ifdef TS_USE_AVX2
+/* unpack the jth value of all four lanes at once */
+static TS_FORCE_INLINE TS_TARGET_AVX2 void
+unpack_block_avx2(const uint64 *words, uint64 reference, uint32 width, uint32 lane_values,
+				  uint64 *restrict out)
+{
+	const __m256i mask = _mm256_set1_epi64x((long long) pfor_width_mask(width));
+	const __m256i ref = _mm256_set1_epi64x((long long) reference);
+	uint32 j;
+
+	for (j = 0; j < lane_values; j++)
+	{
+		uint32 bit = j * width;
+		uint32 word = bit / 64;
+		uint32 shift = bit % 64;
+		const __m256i *in = (const __m256i *) (words + PFOR_LANES * word);
+		__m256i value = _mm256_srl_epi64(_mm256_loadu_si256(in), _mm_cvtsi32_si128(shift));
+
+		/* the values continue in the next word of their lanes */
+		if (shift + width > 64)
+			value = _mm256_or_si256(value,
+									_mm256_sll_epi64(_mm256_loadu_si256(in + 1),
+													 _mm_cvtsi32_si128(64 - shift)));
+
+		_mm256_storeu_si256((__m256i *) (out + PFOR_LANES * j),
+							_mm256_add_epi64(_mm256_and_si256(value, mask), ref));
+	}
+}
+#endif
+
+/*
+ * The body of the block unpacking loop, instantiated once per kernel so that
+ * each instance is compiled for the instruction set of its kernel. Blocks of
+ * width zero have no packed words and consist of the reference only.
+ */
+#define PFOR_UNPACK_BLOCKS(KERNEL)                                                                 \
+	uint32 num_blocks = pfor_num_blocks(num_values);                                               \
+	uint32 block;                                                                                  \
+                                                                                                   \
+	for (block = 0; block < num_blocks; block++)                                                   \
+	{                                                                                              \
+		uint32 block_values = pfor_block_values(num_values, block);                                \
+		uint32 lane_values = pfor_lane_values(block_values);                                       \
+		uint64 *restrict block_out = out + block * PFOR_BLOCK_SIZE;                                \
+                                                                                                   \
+		if (widths[block] == 0)                                                                    \
+		{                                                                                          \
+			uint32 i;                                                                              \
+                                                                                                   \
+			for (i = 0; i < PFOR_LANES * lane_values; i++)                                         \
+				block_out[i] = references[block];                                                  \
+			continue;                                                                              \
+		}                                                                                          \
+                                                                                                   \
+		KERNEL(packed, references[block], widths[block], lane_values, block_out);                  \
+		packed += pfor_block_words(block_values, widths[block]);                                   \
+	}
+
+typedef void (*PforUnpackBlocksFunc)(const uint64 *references, const uint8 *widths,
+									 const uint64 *packed, uint32 num_values, uint64 *restrict out);
+
+static void
+pfor_unpack_blocks_scalar(const uint64 *references, const uint8 *widths, const uint64 *packed,
+						  uint32 num_values, uint64 *restrict out)
+{
+	PFOR_UNPACK_BLOCKS(unpack_block_scalar);
+}
+
+#ifdef TS_USE_AVX2
+static TS_TARGET_AVX2 void
+pfor_unpack_blocks_avx2(const uint64 *references, const uint8 *widths, const uint64 *packed,
+						uint32 num_values, uint64 *restrict out)
+{
+	PFOR_UNPACK_BLOCKS(unpack_block_avx2);
+}
+#endif
+
+#undef PFOR_UNPACK_BLOCKS
+
+static void pfor_unpack_blocks_choose(const uint64 *references, const uint8 *widths,
+									  const uint64 *packed, uint32 num_values,
+									  uint64 *restrict out);
+
+static PforUnpackBlocksFunc pfor_unpack_blocks = pfor_unpack_blocks_choose;
+
+static PforUnpackBlocksFunc
+pfor_unpack_blocks_select(void)
+{
+#ifdef TS_USE_AVX2
+	if (ts_cpu_supports_avx2())
+		return pfor_unpack_blocks_avx2;
+#endif
+	return pfor_unpack_blocks_scalar;
+}
+
+/* choose the implementation for the CPU on the first call */
+static void
+pfor_unpack_blocks_choose(const uint64 *references, const uint8 *widths, const uint64 *packed,
+						  uint32 num_values, uint64 *restrict out)
+{
+	pfor_unpack_blocks = pfor_unpack_blocks_select();
+	pfor_unpack_blocks(references, widths, packed, num_values, out);
+}
+
+/* the name of the implementation that unpacks the blocks */
+const char *
+pfor_unpack_implementation(void)
+{
+	if (pfor_unpack_blocks == pfor_unpack_blocks_choose)
+		pfor_unpack_blocks = pfor_unpack_blocks_select();
+
+#ifdef TS_USE_AVX2
+	if (pfor_unpack_blocks == pfor_unpack_blocks_avx2)
+		return "avx2";
+#endif
+	return "scalar";
+}
+
+/* add the high bits of the exceptions to the unpacked low bits */
+static void
+pfor_patch_exceptions(const PforParts *parts, uint64 *values)
+{
+	uint32 buffer_size = simple8brle_decompress_all_buffer_size(parts->num_exceptions);
+	uint64 *positions = palloc(sizeof(uint64) * buffer_size);
+	uint64 *high_bits = palloc(sizeof(uint64) * buffer_size);
+	uint64 position = 0;
+	uint32 i;
+
+	if (simple8brle_decompress_all_forward(parts->exception_positions, positions) !=
+			parts->num_exceptions ||
+		simple8brle_decompress_all_forward(parts->exception_values, high_bits) !=
+			parts->num_exceptions)
+		elog(ERROR, "invalid number of exceptions in pfor");
+
+	for (i = 0; i < parts->num_exceptions; i++)
+	{
+		uint32 width;
+
+		position += positions[i];
+		if (position >= parts->num_values)
+			elog(ERROR, "invalid exception position in pfor");
+
+		width = parts->widths[position / PFOR_BLOCK_SIZE];
+		if (width >= 64)
+			elog(ERROR, "invalid exception in pfor");
+
+		values[position] += high_bits[i] << width;
+	}
+
+	pfree(positions);
+	pfree(high_bits);
+}
+
+/*
+ * Decode all non-NULL values into an array padded to whole blocks.
+ */
+static uint64 *
+pfor_decode(const PforParts *parts, PforUnpackBlocksFunc unpack)
+{
+	uint64 *values = palloc(sizeof(uint64) * parts->num_blocks * PFOR_BLOCK_SIZE);
+
+	unpack(parts->references, parts->widths, parts->packed, parts->num_values, values);
+
+	if (parts->num_exceptions > 0)
+		pfor_patch_exceptions(parts, values);
+
+	return values;
+}
+
+static inline DecompressResult
+convert_from_internal(DecompressResultInternal res_internal, Oid element_type)
+{
+	if (res_internal.is_done || res_internal.is_null)
+	{
+		return (DecompressResult){
+			.is_done = res_internal.is_done,
+			.is_null = res_internal.is_null,
+		};
+	}
+
+	switch (element_type)
+	{
+		case INT8OID:
+			return (DecompressResult){
+				.val = Int64GetDatum(res_internal.val),
+			};
+		case INT4OID:
+			return (DecompressResult){
+				.val = Int32GetDatum(res_internal.val),
+			};
+		case INT2OID:
+			return (DecompressResult){
+				.val = Int16GetDatum(res_internal.val),
+			};
+		default:
+			elog(ERROR, "invalid type requested from pfor decompression %d", element_type);
+	}
+}
+
+/*
+ * The values of a segment are unpacked as a whole when the iterator is
+ * created, since the packed values cannot be decoded one by one in reverse
+ * order anyway.
+ */
+static DecompressionIterator *
+pfor_decompression_iterator_init(Datum pfor_compressed, Oid element_type, bool forward)
+{
+	PforCompressed *compressed = (PforCompressed *) PG_DETOAST_DATUM(pfor_compressed);
+	PforDecompressionIterator *iter = palloc(sizeof(*iter));
+	PforParts parts;
+
+	pfor_parts_from_compressed(compressed, &parts);
+
+	*iter = (PforDecompressionIterator){
+		.base = {
+			.compression_algorithm = COMPRESSION_ALGORITHM_PFOR,
+			.forward = forward,
+			.element_type = element_type,
+			.try_next = forward ? pfor_decompression_iterator_try_next_forward :
+								  pfor_decompression_iterator_try_next_reverse,
+		},
+		.values = pfor_decode(&parts, pfor_unpack_blocks),
+		.position = forward ? 0 : (int64) parts.num_values - 1,
+		.num_values = parts.num_values,
+		.has_nulls = parts.nulls != NULL,
+	};
+
+	if (iter->has_nulls)
+	{
+		if (forward)
+			simple8brle_decompression_iterator_init_forward(&iter->nulls, parts.nulls);
+		else
+			simple8brle_decompression_iterator_init_reverse(&iter->nulls, parts.nulls);
+	}
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+pfor_decompression_iterator_from_datum_forward(Datum pfor_compressed, Oid element_type)
+{
+	return pfor_decompression_iterator_init(pfor_compressed, element_type, true);
+}
+
+DecompressionIterator *
+pfor_decompression_iterator_from_datum_reverse(Datum pfor_compressed, Oid element_type)
+{
+	return pfor_decompression_iterator_init(pfor_compressed, element_type, false);
+}
+
+static DecompressResultInternal
+pfor_decompression_iterator_try_next_internal(PforDecompressionIterator *iter)
+{
+	uint64 val;
+
+	/* check for a null value */
+	if (iter->has_nulls)
+	{
+		Simple8bRleDecompressResult result =
+			iter->base.forward ? simple8brle_decompression_iterator_try_next_forward(&iter->nulls) :
+								 simple8brle_decompression_iterator_try_next_reverse(&iter->nulls);
+		if (result.is_done)
+			return (DecompressResultInternal){
+				.is_done = true,
+			};
+
+		if (result.val != 0)
+		{
+			Assert(result.val == 1);
+			return (DecompressResultInternal){
+				.is_null = true,
+			};
+		}
+	}
+
+	if (iter->position < 0 || iter->position >= iter->num_values)
+		return (DecompressResultInternal){
+			.is_done = true,
+		};
+
+	val = iter->values[iter->position];
+	iter->position += iter->base.forward ? 1 : -1;
+
+	return (DecompressResultInternal){
+		.val = val,
+	};
+}
+
+DecompressResult
+pfor_decompression_iterator_try_next_forward(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_PFOR && iter->forward);
+	return convert_from_internal(pfor_decompression_iterator_try_next_internal(
+									 (PforDecompressionIterator *) iter),
+								 iter->element_type);
+}
+
+DecompressResult
+pfor_decompression_iterator_try_next_reverse(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_PFOR && !iter->forward);
+	return convert_from_internal(pfor_decompression_iterator_try_next_internal(
+									 (PforDecompressionIterator *) iter),
+								 iter->element_type);
+}
+
+static void
+pfor_decompress_all_internal(Datum compressed_datum, Oid element_type, DecompressedColumn *column,
+							 PforUnpackBlocksFunc unpack)
+{
+	PforCompressed *compressed = (PforCompressed *) PG_DETOAST_DATUM(compressed_datum);
+	PforParts parts;
+	uint64 *values;
+
+	pfor_parts_from_compressed(compressed, &parts);
+
+	decompressed_column_init(column,
+							 element_type,
+							 parts.nulls != NULL ? parts.nulls->num_elements : parts.num_values);
+
+	if (parts.nulls != NULL)
+	{
+		uint64 *null_flags =
+			palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(column->num_values));
+
+		simple8brle_decompress_all_forward(parts.nulls, null_flags);
+		decompressed_column_set_nulls(column, null_flags);
+		pfree(null_flags);
+	}
+
+	values = pfor_decode(&parts, unpack);
+	decompressed_column_fill_native(column, values, parts.num_values);
+	pfree(values);
+}
+
+/*
+ * Decompress all values at once, unpacking whole blocks with the vector
+ * kernel if the CPU supports it.
+ */
+void
+pfor_decompress_all(Datum compressed_datum, Oid element_type, DecompressedColumn *column)
+{
+	pfor_decompress_all_internal(compressed_datum, element_type, column, pfor_unpack_blocks);
+}
+
+void
+pfor_decompress_all_scalar(Datum compressed_datum, Oid element_type, DecompressedColumn *column)
+{
+	pfor_decompress_all_internal(compressed_datum,
+								 element_type,
+								 column,
+								 pfor_unpack_blocks_scalar);
+}
+
+/**********************************************************************************/
+/**********************************************************************************/
+
+void
+pfor_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	const PforCompressed *data = (PforCompressed *) header;
+	PforParts parts;
+	uint32 num_words;
+	uint32 i;
+
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_PFOR);
+	pfor_parts_from_compressed(data, &parts);
+	num_words = pfor_packed_words(parts.num_values, parts.widths);
+
+	pq_sendbyte(buffer, data->has_nulls);
+	pq_sendint32(buffer, parts.num_values);
+	pq_sendint32(buffer, parts.num_exceptions);
+	for (i = 0; i < parts.num_blocks; i++)
+		pq_sendint64(buffer, parts.references[i]);
+	for (i = 0; i < parts.num_blocks; i++)
+		pq_sendbyte(buffer, parts.widths[i]);
+	for (i = 0; i < num_words; i++)
+		pq_sendint64(buffer, parts.packed[i]);
+
+	if (parts.num_exceptions > 0)
+	{
+		simple8brle_serialized_send(buffer, parts.exception_positions);
+		simple8brle_serialized_send(buffer, parts.exception_values);
+	}
+
+	if (data->has_nulls)
+		simple8brle_serialized_send(buffer, parts.nulls);
+}
+
+Datum
+pfor_compressed_recv(StringInfo buffer)
+{
+	uint8 has_nulls;
+	uint32 num_values;
+	uint32 num_exceptions;
+	uint32 num_blocks;
+	uint32 num_words;
+	uint64 *references;
+	uint8 *widths;
+	uint64 *packed;
+	Simple8bRleSerialized *exception_positions = NULL;
+	Simple8bRleSerialized *exception_values = NULL;
+	Simple8bRleSerialized *nulls = NULL;
+	uint32 i;
+
+	has_nulls = pq_getmsgbyte(buffer);
+	if (has_nulls != 0 && has_nulls != 1)
+		elog(ERROR, "invalid recv in pfor: bad bool");
+
+	num_values = pq_getmsgint32(buffer);
+	num_exceptions = pq_getmsgint32(buffer);
+	if (num_values == 0 || num_exceptions > num_values)
+		elog(ERROR, "invalid recv in pfor: bad number of values");
+
+	num_blocks = pfor_num_blocks(num_values);
+	references = palloc(sizeof(uint64) * num_blocks);
+	widths = palloc(num_blocks);
+	for (i = 0; i < num_blocks; i++)
+		references[i] = pq_getmsgint64(buffer);
+	for (i = 0; i < num_blocks; i++)
+	{
+		widths[i] = pq_getmsgbyte(buffer);
+		if (widths[i] > 64)
+			elog(ERROR, "invalid recv in pfor: bad width");
+	}
+
+	num_words = pfor_packed_words(num_values, widths);
+	packed = palloc(sizeof(uint64) * num_words);
+	for (i = 0; i < num_words; i++)
+		packed[i] = pq_getmsgint64(buffer);
+
+	if (num_exceptions > 0)
+	{
+		exception_positions = simple8brle_serialized_recv(buffer);
+		exception_values = simple8brle_serialized_recv(buffer);
+		if (exception_positions->num_elements != num_exceptions ||
+			exception_values->num_elements != num_exceptions)
+			elog(ERROR, "invalid recv in pfor: bad number of exceptions");
+	}
+
+	if (has_nulls)
+	{
+		nulls = simple8brle_serialized_recv(buffer);
+		if (nulls->num_elements <= num_values)
+			elog(ERROR, "invalid recv in pfor: bad nulls");
+	}
+
+	PG_RETURN_POINTER(pfor_from_parts(num_values,
+									  num_exceptions,
+									  references,
+									  widths,
+									  packed,
+									  exception_positions,
+									  exception_values,
+									  nulls));
+}
@@ -0,0 +1,72 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+/*
+ * PFOR (patched frame of reference) is used to encode integers that lie in a
+ * narrow range without being smooth, e.g., status codes, counters that reset,
+ * or random identifiers, for which the delta-of-deltas of deltadelta are no
+ * smaller than the values themselves.
+ *
+ * The values are split into blocks of PFOR_BLOCK_SIZE values. Every block
+ * stores the offsets of its values from the minimum of the block (the frame of
+ * reference), bit-packed with a width chosen to minimize the size of the block.
+ * Offsets that need more bits than that are exceptions: only their low bits are
+ * packed, and their high bits are stored separately and patched in after
+ * unpacking.
+ *
+ * The offsets of a block are packed into four interleaved lanes, see pfor.c,
+ * so that four values can be unpacked at once with vector instructions.
+ */
+#ifndef TIMESCALEDB_TSL_COMPRESSION_PFOR_H
+#define TIMESCALEDB_TSL_COMPRESSION_PFOR_H
+
+#include <postgres.h>
+#include <c.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include <export.h>
+#include "compression/compression.h"
+
+typedef struct PforCompressor PforCompressor;
+typedef struct PforCompressed PforCompressed;
+typedef struct PforDecompressionIterator PforDecompressionIterator;
+
+extern Compressor *pfor_compressor_for_type(Oid element_type);
+extern PforCompressor *pfor_compressor_alloc(void);
+extern void pfor_compressor_append_null(PforCompressor *compressor);
+extern void pfor_compressor_append_value(PforCompressor *compressor, int64 next_val);
+extern void *pfor_compressor_finish(PforCompressor *compressor);
+
+extern DecompressionIterator *pfor_decompression_iterator_from_datum_forward(Datum pfor_compressed,
+																			 Oid element_type);
+extern DecompressionIterator *pfor_decompression_iterator_from_datum_reverse(Datum pfor_compressed,
+																			 Oid element_type);
+extern DecompressResult pfor_decompression_iterator_try_next_forward(DecompressionIterator *iter);
+extern DecompressResult pfor_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
+
+extern void pfor_decompress_all(Datum pfor_compressed, Oid element_type,
+								DecompressedColumn *column);
+
+extern void pfor_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum pfor_compressed_recv(StringInfo buf);
+
+/* the portable implementation of bulk unpacking, exposed for testing */
+extern void pfor_decompress_all_scalar(Datum pfor_compressed, Oid element_type,
+									   DecompressedColumn *column);
+extern const char *pfor_unpack_implementation(void);
+
+#define PFOR_ALGORITHM_DEFINITION                                                                  \
+	{                                                                                              \
+		.iterator_init_forward = pfor_decompression_iterator_from_datum_forward,                   \
+		.iterator_init_reverse = pfor_decompression_iterator_from_datum_reverse,                   \
+		.decompress_all = pfor_decompress_all,                                                     \
+		.compressed_data_send = pfor_compressed_send,                                              \
+		.compressed_data_recv = pfor_compressed_recv,                                              \
+		.compressor_for_type = pfor_compressor_for_type,                                           \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
+
+#endif
@@ -5,10 +5,12 @@
  * LICENSE-TIMESCALE for a copy of the license.
  */
 #include <postgres.h>
+#include <utils/array.h>
 #include <utils/sortsupport.h>
 #include <utils/typcache.h>
 #include <utils/builtins.h>
 #include <utils/datum.h>
+#include <utils/lsyscache.h>
 #include <libpq/pqformat.h>
 
 #include "segment_meta.h"
@@ -18,7 +20,7 @@ typedef struct SegmentMetaMinMaxBuilder
 {
 	Oid type_oid;
 	bool empty;
-	bool has_null;
+	int32 null_count;
 
 	SortSupportData ssup;
 	bool type_by_val;
@@ -42,7 +44,7 @@ segment_meta_min_max_builder_create(Oid type_oid, Oid collation)
 	*builder = (SegmentMetaMinMaxBuilder){
 		.type_oid = type_oid,
 		.empty = true,
-		.has_null = false,
+		.null_count = 0,
 		.type_by_val = type->typbyval,
 		.type_len = type->typlen,
 	};
@@ -89,7 +91,7 @@ segment_meta_min_max_builder_update_val(SegmentMetaMinMaxBuilder *builder, Datum
 void
 segment_meta_min_max_builder_update_null(SegmentMetaMinMaxBuilder *builder)
 {
-	builder->has_null = true;
+	builder->null_count++;
 }
 
 void
@@ -106,7 +108,7 @@ segment_meta_min_max_builder_reset(SegmentMetaMinMaxBuilder *builder)
 		builder->max = 0;
 	}
 	builder->empty = true;
-	builder->has_null = false;
+	builder->null_count = 0;
 }
 
 Datum
@@ -144,3 +146,259 @@ segment_meta_min_max_builder_empty(SegmentMetaMinMaxBuilder *builder)
 {
 	return builder->empty;
 }
+
+int32
+segment_meta_min_max_builder_null_count(SegmentMetaMinMaxBuilder *builder)
+{
+	return builder->null_count;
+}
+
+/*
+ * Bloom filter of the values of a segment.
+ *
+ * The filter is a bytea holding a power-of-two number of bits, with at least
+ * SEGMENT_META_BLOOM_BITS_PER_VALUE bits per distinct value hash. Values are
+ * hashed with the hash function of their type, which is also used when
+ * probing, so the filter can only be probed with values of the column type.
+ * The bit positions are derived from that hash by double hashing.
+ */
+#define SEGMENT_META_BLOOM_BITS_PER_VALUE 8
+#define SEGMENT_META_BLOOM_MIN_BITS 64
+#define SEGMENT_META_BLOOM_NUM_HASHES 4
+
+typedef struct SegmentMetaBloomBuilder
+{
+	FmgrInfo hash_finfo;
+	Oid collation;
+	uint32 *hashes;
+	uint32 num_hashes;
+	uint32 max_hashes;
+} SegmentMetaBloomBuilder;
+
+static FmgrInfo *
+bloom_type_hash_finfo(Oid type_oid)
+{
+	TypeCacheEntry *type = lookup_type_cache(type_oid, TYPECACHE_HASH_PROC_FINFO);
+
+	if (!OidIsValid(type->hash_proc))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_FUNCTION),
+				 errmsg("could not identify a hash function for type %s",
+						format_type_be(type_oid))));
+
+	return &type->hash_proc_finfo;
+}
+
+static inline void
+bloom_hash_positions(uint32 hash, uint32 *h1, uint32 *h2)
+{
+	/* the type hash functions are not well mixed for all types, e.g. int4 */
+	uint64 x = hash;
+
+	x ^= x >> 33;
+	x *= UINT64CONST(0xff51afd7ed558ccd);
+	x ^= x >> 33;
+	x *= UINT64CONST(0xc4ceb9fe1a85ec53);
+	x ^= x >> 33;
+
+	*h1 = (uint32) x;
+	/* odd so that all the probes are distinct */
+	*h2 = (uint32)(x >> 32) | 1;
+}
+
+static bool
+bloom_contains_hash(const bytea *bloom, uint32 hash)
+{
+	const uint8 *bits = (const uint8 *) VARDATA_ANY(bloom);
+	uint32 mask = VARSIZE_ANY_EXHDR(bloom) * BITS_PER_BYTE - 1;
+	uint32 h1, h2;
+	int i;
+
+	bloom_hash_positions(hash, &h1, &h2);
+
+	for (i = 0; i < SEGMENT_META_BLOOM_NUM_HASHES; i++)
+	{
+		uint32 bit = (h1 + i * h2) & mask;
+
+		if ((bits[bit / BITS_PER_BYTE] & (1 << (bit % BITS_PER_BYTE))) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+SegmentMetaBloomBuilder *
+segment_meta_bloom_builder_create(Oid type_oid, Oid collation)
+{
+	SegmentMetaBloomBuilder *builder = palloc(sizeof(*builder));
+
+	*builder = (SegmentMetaBloomBuilder){
+		.collation = collation,
+		.num_hashes = 0,
+		.max_hashes = 64,
+	};
+
+	fmgr_info_copy(&builder->hash_finfo, bloom_type_hash_finfo(type_oid), CurrentMemoryContext);
+	builder->hashes = palloc(sizeof(*builder->hashes) * builder->max_hashes);
+
+	return builder;
+}
+
+void
+segment_meta_bloom_builder_update_val(SegmentMetaBloomBuilder *builder, Datum val)
+{
+	if (builder->num_hashes == builder->max_hashes)
+	{
+		builder->max_hashes *= 2;
+		builder->hashes =
+			repalloc(builder->hashes, sizeof(*builder->hashes) * builder->max_hashes);
+	}
+
+	builder->hashes[builder->num_hashes++] =
+		DatumGetUInt32(FunctionCall1Coll(&builder->hash_finfo, builder->collation, val));
+}
+
+bool
+segment_meta_bloom_builder_empty(SegmentMetaBloomBuilder *builder)
+{
+	return builder->num_hashes == 0;
+}
+
+static int
+uint32_cmp(const void *a, const void *b)
+{
+	uint32 left = *(const uint32 *) a;
+	uint32 right = *(const uint32 *) b;
+
+	return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+/*
+ * Build the filter. It is sized by the number of distinct hashes, so that
+ * columns with few distinct values per segment get small filters.
+ */
+Datum
+segment_meta_bloom_builder_finish(SegmentMetaBloomBuilder *builder)
+{
+	uint32 num_distinct = 0;
+	uint64 num_bits = SEGMENT_META_BLOOM_MIN_BITS;
+	bytea *bloom;
+	uint8 *bits;
+	uint32 i;
+
+	if (builder->num_hashes == 0)
+		elog(ERROR, "trying to get bloom filter from an empty builder");
+
+	qsort(builder->hashes, builder->num_hashes, sizeof(*builder->hashes), uint32_cmp);
+	for (i = 0; i < builder->num_hashes; i++)
+	{
+		if (i == 0 || builder->hashes[i] != builder->hashes[num_distinct - 1])
+			builder->hashes[num_distinct++] = builder->hashes[i];
+	}
+
+	while (num_bits < (uint64) num_distinct * SEGMENT_META_BLOOM_BITS_PER_VALUE)
+		num_bits *= 2;
+
+	bloom = palloc0(VARHDRSZ + num_bits / BITS_PER_BYTE);
+	SET_VARSIZE(bloom, VARHDRSZ + num_bits / BITS_PER_BYTE);
+	bits = (uint8 *) VARDATA(bloom);
+
+	for (i = 0; i < num_distinct; i++)
+	{
+		uint32 h1, h2;
+		int j;
+
+		bloom_hash_positions(builder->hashes[i], &h1, &h2);
+		for (j = 0; j < SEGMENT_META_BLOOM_NUM_HASHES; j++)
+		{
+			uint32 bit = (h1 + j * h2) & (num_bits - 1);
+
+			bits[bit / BITS_PER_BYTE] |= 1 << (bit % BITS_PER_BYTE);
+		}
+	}
+
+	return PointerGetDatum(bloom);
+}
+
+void
+segment_meta_bloom_builder_reset(SegmentMetaBloomBuilder *builder)
+{
+	builder->num_hashes = 0;
+}
+
+/* cache the hash function of the probed type across calls */
+static FmgrInfo *
+bloom_probe_hash_finfo(FunctionCallInfo fcinfo, Oid type_oid)
+{
+	FmgrInfo *finfo = fcinfo->flinfo->fn_extra;
+
+	if (finfo == NULL)
+	{
+		finfo = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(*finfo));
+		fmgr_info_copy(finfo, bloom_type_hash_finfo(type_oid), fcinfo->flinfo->fn_mcxt);
+		fcinfo->flinfo->fn_extra = finfo;
+	}
+
+	return finfo;
+}
+
+/*
+ * segment_meta_bloom_contains(bloom BYTEA, value ANYELEMENT)
+ *
+ * Returns false if the segment cannot contain the value, true if it might.
+ */
+Datum
+tsl_segment_meta_bloom_contains(PG_FUNCTION_ARGS)
+{
+	bytea *bloom = PG_GETARG_BYTEA_PP(0);
+	FmgrInfo *finfo = bloom_probe_hash_finfo(fcinfo, get_fn_expr_argtype(fcinfo->flinfo, 1));
+	uint32 hash = DatumGetUInt32(FunctionCall1Coll(finfo, PG_GET_COLLATION(), PG_GETARG_DATUM(1)));
+
+	PG_RETURN_BOOL(bloom_contains_hash(bloom, hash));
+}
+
+/*
+ * segment_meta_bloom_contains_any(bloom BYTEA, values ANYARRAY)
+ *
+ * Returns false if the segment cannot contain any of the values, true if it
+ * might. NULL elements never match.
+ */
+Datum
+tsl_segment_meta_bloom_contains_any(PG_FUNCTION_ARGS)
+{
+	bytea *bloom = PG_GETARG_BYTEA_PP(0);
+	ArrayType *values = PG_GETARG_ARRAYTYPE_P(1);
+	Oid element_type = ARR_ELEMTYPE(values);
+	FmgrInfo *finfo = bloom_probe_hash_finfo(fcinfo, element_type);
+	Datum *elements;
+	bool *nulls;
+	int num_elements;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	int i;
+
+	get_typlenbyvalalign(element_type, &typlen, &typbyval, &typalign);
+	deconstruct_array(values,
+					  element_type,
+					  typlen,
+					  typbyval,
+					  typalign,
+					  &elements,
+					  &nulls,
+					  &num_elements);
+
+	for (i = 0; i < num_elements; i++)
+	{
+		uint32 hash;
+
+		if (nulls[i])
+			continue;
+
+		hash = DatumGetUInt32(FunctionCall1Coll(finfo, PG_GET_COLLATION(), elements[i]));
+		if (bloom_contains_hash(bloom, hash))
+			PG_RETURN_BOOL(true);
+	}
+
+	PG_RETURN_BOOL(false);
+}
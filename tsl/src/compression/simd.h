@@ -0,0 +1,46 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#ifndef TIMESCALEDB_TSL_COMPRESSION_SIMD_H
+#define TIMESCALEDB_TSL_COMPRESSION_SIMD_H
+
+#include <postgres.h>
+
+/*
+ * Support for decompression kernels that use instruction set extensions not
+ * enabled for the whole build.
+ *
+ * Such kernels are compiled with a per-function target attribute and chosen
+ * at runtime, so the build keeps working on any CPU of the architecture.
+ * This needs __builtin_cpu_supports() and target attributes, which GCC
+ * supports since 4.9.
+ */
+#if defined(__x86_64__) &&                                                                         \
+	(defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define TS_USE_AVX2
+#include <immintrin.h>
+#define TS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__GNUC__)
+#define TS_FORCE_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define TS_FORCE_INLINE __forceinline
+#else
+#define TS_FORCE_INLINE inline
+#endif
+
+static inline bool
+ts_cpu_supports_avx2(void)
+{
+#ifdef TS_USE_AVX2
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+#endif /* TIMESCALEDB_TSL_COMPRESSION_SIMD_H */
@@ -17,6 +17,7 @@
 
 #include <adts/uint64_vec.h>
 #include "compat.h"
+#include "compression/simple8b_rle_decode.h"
 
 /* This is defined as a header file as it is expected to be used as a primitive
  * for "real" compression algorithms, not used directly on SQL data. Also, due to inlining.
@@ -150,6 +151,10 @@ simple8brle_decompression_iterator_try_next_forward(Simple8bRleDecompressionIter
 static inline Simple8bRleDecompressResult
 simple8brle_decompression_iterator_try_next_reverse(Simple8bRleDecompressionIterator *iter);
 
+static inline uint32 simple8brle_decompress_all_buffer_size(uint32 num_elements);
+static inline uint32 simple8brle_decompress_all_forward(const Simple8bRleSerialized *compressed,
+														uint64 *restrict out);
+
 static inline void simple8brle_serialized_send(StringInfo buffer,
 											   const Simple8bRleSerialized *data);
 static inline char *bytes_serialize_simple8b_and_advance(char *dest, size_t expected_size,
@@ -676,6 +681,46 @@ simple8brle_decompression_iterator_try_next_reverse(Simple8bRleDecompressionIter
 	};
 }
 
+/**************************
+ ***  Bulk Decompression  ***
+ **************************/
+
+/*
+ * Number of elements the output buffer of simple8brle_decompress_all_forward
+ * needs room for. Blocks are always decoded as a whole, so up to one block's
+ * worth of elements may be written past the last element.
+ */
+static inline uint32
+simple8brle_decompress_all_buffer_size(uint32 num_elements)
+{
+	return num_elements + SIMPLE8B_MAX_VALUES_PER_SLOT;
+}
+
+/*
+ * Decompress all elements into the out array, which must have room for
+ * simple8brle_decompress_all_buffer_size() elements. Returns the number of
+ * elements decompressed.
+ *
+ * Unlike the iterators, this decodes a whole block per step with a kernel
+ * specialized for the selector of the block, see simple8b_rle_decode.c.
+ */
+static inline uint32
+simple8brle_decompress_all_forward(const Simple8bRleSerialized *compressed, uint64 *restrict out)
+{
+	uint32 num_selector_slots =
+		simple8brle_num_selector_slots_for_num_blocks(compressed->num_blocks);
+	uint32 decompressed = simple8brle_decode_blocks(compressed->slots,
+													compressed->slots + num_selector_slots,
+													compressed->num_blocks,
+													compressed->num_elements,
+													out);
+
+	if (decompressed < compressed->num_elements)
+		elog(ERROR, "compressed integer stream is too short");
+
+	return compressed->num_elements;
+}
+
 /********************************************
  ***  Simple8bRlePartiallyCompressedData  ***
  ********************************************/
@@ -0,0 +1,169 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#include <postgres.h>
+
+#include "compression/simd.h"
+#include "compression/simple8b_rle.h"
+#include "compression/simple8b_rle_decode.h"
+
+/*
+ * Unpack the values of a packed block. The kernels are only called with
+ * constant widths, so they are fully unrolled with constant shifts and masks.
+ */
+static TS_FORCE_INLINE void
+unpack_scalar(uint64 data, const uint32 bits, const uint32 num_values, uint64 *restrict out)
+{
+	const uint64 mask = (UINT64CONST(1) << bits) - 1;
+	uint32 i;
+
+	for (i = 0; i < num_values; i++)
+		out[i] = (data >> (bits * i)) & mask;
+}
+
+#ifdef TS_USE_AVX2
+/*
+ * Unpack four values per step with per-lane variable shifts. Up to three
+ * values past the end of the block are written; they are overwritten by the
+ * next block or fall into the padding of the output buffer.
+ */
+static TS_FORCE_INLINE TS_TARGET_AVX2 void
+unpack_avx2(uint64 data, const uint32 bits, const uint32 num_values, uint64 *restrict out)
+{
+	const __m256i mask = _mm256_set1_epi64x((long long) ((UINT64CONST(1) << bits) - 1));
+	const __m256i step = _mm256_set1_epi64x(4 * bits);
+	const __m256i block = _mm256_set1_epi64x((long long) data);
+	__m256i shift = _mm256_setr_epi64x(0, bits, 2 * bits, 3 * bits);
+	uint32 i;
+
+	for (i = 0; i < num_values; i += 4)
+	{
+		_mm256_storeu_si256((__m256i *) (out + i),
+							_mm256_and_si256(_mm256_srlv_epi64(block, shift), mask));
+		shift = _mm256_add_epi64(shift, step);
+	}
+}
+#endif
+
+#define SIMPLE8B_UNPACK_CASE(selector, bits, num_values, KERNEL)                                   \
+	case selector:                                                                                 \
+		KERNEL(data, bits, num_values, block_out);                                                 \
+		decoded += num_values;                                                                     \
+		break
+
+/*
+ * The body of the block decoding loop, instantiated once per kernel so that
+ * each instance is compiled for the instruction set of its kernel.
+ */
+#define SIMPLE8B_DECODE_BLOCKS(KERNEL)                                                             \
+	uint32 decoded = 0;                                                                            \
+	uint32 block;                                                                                  \
+                                                                                                   \
+	for (block = 0; block < num_blocks && decoded < num_elements; block++)                         \
+	{                                                                                              \
+		uint8 selector = (selector_slots[block / SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT] >>          \
+						  ((block % SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT) *                        \
+						   SIMPLE8B_BITS_PER_SELECTOR)) &                                          \
+						 ((1 << SIMPLE8B_BITS_PER_SELECTOR) - 1);                                  \
+		uint64 data = blocks[block];                                                               \
+		uint64 *restrict block_out = out + decoded;                                                \
+                                                                                                   \
+		switch (selector)                                                                          \
+		{                                                                                          \
+			SIMPLE8B_UNPACK_CASE(1, 1, 64, KERNEL);                                                \
+			SIMPLE8B_UNPACK_CASE(2, 2, 32, KERNEL);                                                \
+			SIMPLE8B_UNPACK_CASE(3, 3, 21, KERNEL);                                                \
+			SIMPLE8B_UNPACK_CASE(4, 4, 16, KERNEL);                                                \
+			SIMPLE8B_UNPACK_CASE(5, 5, 12, KERNEL);                                                \
+			SIMPLE8B_UNPACK_CASE(6, 6, 10, KERNEL);                                                \
+			SIMPLE8B_UNPACK_CASE(7, 7, 9, KERNEL);                                                 \
+			SIMPLE8B_UNPACK_CASE(8, 8, 8, KERNEL);                                                 \
+			SIMPLE8B_UNPACK_CASE(9, 10, 6, KERNEL);                                                \
+			SIMPLE8B_UNPACK_CASE(10, 12, 5, KERNEL);                                               \
+			SIMPLE8B_UNPACK_CASE(11, 16, 4, KERNEL);                                               \
+			SIMPLE8B_UNPACK_CASE(12, 21, 3, KERNEL);                                               \
+			SIMPLE8B_UNPACK_CASE(13, 32, 2, KERNEL);                                               \
+			case 14:                                                                               \
+				block_out[0] = data;                                                               \
+				decoded += 1;                                                                      \
+				break;                                                                             \
+			case SIMPLE8B_RLE_SELECTOR:                                                            \
+			{                                                                                      \
+				uint64 repeated_value = simple8brle_rledata_value(data);                           \
+				uint32 repeat_count = simple8brle_rledata_repeatcount(data);                       \
+				uint32 i;                                                                          \
+                                                                                                   \
+				/* RLE blocks can be longer than the buffer padding, so clamp them */              \
+				repeat_count = Min(repeat_count, num_elements - decoded);                          \
+				for (i = 0; i < repeat_count; i++)                                                 \
+					block_out[i] = repeated_value;                                                 \
+				decoded += repeat_count;                                                           \
+				break;                                                                             \
+			}                                                                                      \
+			default:                                                                               \
+				elog(ERROR, "invalid selector %d", selector);                                      \
+				break;                                                                             \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	return decoded
+
+uint32
+simple8brle_decode_blocks_scalar(const uint64 *selector_slots, const uint64 *blocks,
+								 uint32 num_blocks, uint32 num_elements, uint64 *restrict out)
+{
+	SIMPLE8B_DECODE_BLOCKS(unpack_scalar);
+}
+
+#ifdef TS_USE_AVX2
+static TS_TARGET_AVX2 uint32
+simple8brle_decode_blocks_avx2(const uint64 *selector_slots, const uint64 *blocks,
+							   uint32 num_blocks, uint32 num_elements, uint64 *restrict out)
+{
+	SIMPLE8B_DECODE_BLOCKS(unpack_avx2);
+}
+#endif
+
+#undef SIMPLE8B_DECODE_BLOCKS
+#undef SIMPLE8B_UNPACK_CASE
+
+static Simple8bRleDecodeBlocksFunc
+simple8brle_decode_blocks_select(void)
+{
+#ifdef TS_USE_AVX2
+	if (ts_cpu_supports_avx2())
+		return simple8brle_decode_blocks_avx2;
+#endif
+	return simple8brle_decode_blocks_scalar;
+}
+
+/*
+ * Choose the best implementation for the CPU on the first call and replace
+ * the function pointer with it, so that later calls go there directly.
+ */
+static uint32
+simple8brle_decode_blocks_choose(const uint64 *selector_slots, const uint64 *blocks,
+								 uint32 num_blocks, uint32 num_elements, uint64 *restrict out)
+{
+	simple8brle_decode_blocks = simple8brle_decode_blocks_select();
+
+	return simple8brle_decode_blocks(selector_slots, blocks, num_blocks, num_elements, out);
+}
+
+Simple8bRleDecodeBlocksFunc simple8brle_decode_blocks = simple8brle_decode_blocks_choose;
+
+/* the name of the implementation that decodes the blocks */
+const char *
+simple8brle_decode_blocks_implementation(void)
+{
+	if (simple8brle_decode_blocks == simple8brle_decode_blocks_choose)
+		simple8brle_decode_blocks = simple8brle_decode_blocks_select();
+
+#ifdef TS_USE_AVX2
+	if (simple8brle_decode_blocks == simple8brle_decode_blocks_avx2)
+		return "avx2";
+#endif
+	return "scalar";
+}
@@ -0,0 +1,35 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#ifndef TIMESCALEDB_TSL_COMPRESSION_SIMPLE8B_RLE_DECODE_H
+#define TIMESCALEDB_TSL_COMPRESSION_SIMPLE8B_RLE_DECODE_H
+
+#include <postgres.h>
+
+/*
+ * Block-at-a-time decoding of simple8b RLE data.
+ *
+ * Decodes the blocks of a simple8b stream, given its selector slots and its
+ * data blocks, into out until at least num_elements elements are decoded.
+ * Packed blocks are always decoded as a whole, so up to one block's worth of
+ * elements may be written past num_elements. Returns the number of elements
+ * decoded, which is less than num_elements if the stream is too short.
+ *
+ * Every selector has its own unrolled kernel. On x86-64 an AVX2 variant of
+ * the kernels is chosen at runtime if the CPU supports it.
+ */
+typedef uint32 (*Simple8bRleDecodeBlocksFunc)(const uint64 *selector_slots, const uint64 *blocks,
+											  uint32 num_blocks, uint32 num_elements,
+											  uint64 *restrict out);
+
+extern Simple8bRleDecodeBlocksFunc simple8brle_decode_blocks;
+
+/* the portable implementation, exposed for testing */
+extern uint32 simple8brle_decode_blocks_scalar(const uint64 *selector_slots, const uint64 *blocks,
+											   uint32 num_blocks, uint32 num_elements,
+											   uint64 *restrict out);
+extern const char *simple8brle_decode_blocks_implementation(void);
+
+#endif /* TIMESCALEDB_TSL_COMPRESSION_SIMPLE8B_RLE_DECODE_H */
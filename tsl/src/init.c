@@ -115,6 +115,8 @@ CrossModuleFunctions tsl_cm_functions = {
 	.process_compress_table = tsl_process_compress_table,
 	.compress_chunk = tsl_compress_chunk,
 	.decompress_chunk = tsl_decompress_chunk,
+	.segment_meta_bloom_contains = tsl_segment_meta_bloom_contains,
+	.segment_meta_bloom_contains_any = tsl_segment_meta_bloom_contains_any,
 };
 
 TS_FUNCTION_INFO_V1(ts_module_init);
@@ -5,7 +5,10 @@
  */
 
 #include <postgres.h>
+#include <access/sysattr.h>
+#include <catalog/pg_aggregate.h>
 #include <catalog/pg_operator.h>
+#include <catalog/pg_type.h>
 #include <nodes/bitmapset.h>
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
@@ -13,26 +16,33 @@
 #include <optimizer/cost.h>
 #include <optimizer/pathnode.h>
 #include <optimizer/paths.h>
+#include <optimizer/prep.h>
 #include <optimizer/restrictinfo.h>
 #include <optimizer/tlist.h>
 #include <optimizer/var.h>
+#include <parser/parse_func.h>
 #include <parser/parsetree.h>
 #include <utils/builtins.h>
 #include <utils/lsyscache.h>
+#include <utils/selfuncs.h>
+#include <utils/syscache.h>
 #include <utils/typcache.h>
 #include <miscadmin.h>
 
 #include "compat.h"
 #include "chunk.h"
+#include "extension_constants.h"
 #include "hypertable.h"
 #include "hypertable_compression.h"
 #include "compression/create.h"
 #include "nodes/decompress_chunk/decompress_chunk.h"
 #include "nodes/decompress_chunk/planner.h"
 #include "nodes/decompress_chunk/qual_pushdown.h"
+#include "planner_import.h"
 #include "utils.h"
 
 #define DECOMPRESS_CHUNK_CPU_TUPLE_COST 0.01
+#define DECOMPRESS_CHUNK_AGG_CPU_VALUE_COST 0.00025
 #define DECOMPRESS_CHUNK_BATCH_SIZE 1000
 
 static CustomPathMethods decompress_chunk_path_methods = {
@@ -286,6 +296,11 @@ build_compressioninfo(PlannerInfo *root, Hypertable *ht, RelOptInfo *chunk_rel)
 
 	info->hypertable_compression_info = ts_hypertable_compression_get(ht->fd.id);
 
+	/* adaptive batches are sized during compression, so assume the default size for them */
+	if (!ts_hypertable_compression_get_batch_size(ht->fd.id, &info->batch_size) ||
+		info->batch_size == HYPERTABLE_COMPRESSION_BATCH_SIZE_ADAPTIVE)
+		info->batch_size = DECOMPRESS_CHUNK_BATCH_SIZE;
+
 	foreach (lc, info->hypertable_compression_info)
 	{
 		FormData_hypertable_compression *fd = lfirst(lc);
@@ -310,7 +325,7 @@ build_compressioninfo(PlannerInfo *root, Hypertable *ht, RelOptInfo *chunk_rel)
  * we put cost of 1 tuple of compressed_scan as startup cost
  */
 static void
-cost_decompress_chunk(Path *path, Path *compressed_path)
+cost_decompress_chunk(Path *path, Path *compressed_path, int batch_size)
 {
 	/* startup_cost is cost before fetching first tuple */
 	if (compressed_path->rows > 0)
@@ -318,7 +333,7 @@ cost_decompress_chunk(Path *path, Path *compressed_path)
 
 	/* total_cost is cost for fetching all tuples */
 	path->total_cost = compressed_path->total_cost + path->rows * DECOMPRESS_CHUNK_CPU_TUPLE_COST;
-	path->rows = compressed_path->rows * DECOMPRESS_CHUNK_BATCH_SIZE;
+	path->rows = compressed_path->rows * batch_size;
 }
 
 void
@@ -360,7 +375,7 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, Hyp
 	/* translate chunk_rel->baserestrictinfo */
 	pushdown_quals(root, chunk_rel, compressed_rel, info->hypertable_compression_info);
 	set_baserel_size_estimates(root, compressed_rel);
-	new_row_estimate = compressed_rel->rows * DECOMPRESS_CHUNK_BATCH_SIZE;
+	new_row_estimate = compressed_rel->rows * info->batch_size;
 	/* adjust the parent's estimate by the diff of new and old estimate */
 	hypertable_rel->rows += (new_row_estimate - chunk_rel->rows);
 	chunk_rel->rows = new_row_estimate;
@@ -418,7 +433,7 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, Hyp
 						  0.0,
 						  work_mem,
 						  -1);
-				cost_decompress_chunk(&dcpath->cpath.path, &sort_path);
+				cost_decompress_chunk(&dcpath->cpath.path, &sort_path, info->batch_size);
 			}
 			add_path(chunk_rel, &dcpath->cpath.path);
 		}
@@ -452,6 +467,493 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, Hyp
 	compressed_rel->reloptkind = RELOPT_DEADREL;
 }
 
+/*
+ * Can DecompressChunk compute the aggregate? It has to be an aggregate of a
+ * single column of the hypertable, or of no column like count(*), without
+ * DISTINCT, ORDER BY or FILTER. The transition state must not be internal,
+ * so that it can be passed on to the Finalize Aggregate as is.
+ */
+static bool
+is_decompress_chunk_aggref(Aggref *aggref, Index ht_relid)
+{
+	HeapTuple tuple;
+	Form_pg_aggregate aggform;
+	bool supported;
+
+	if (aggref->aggfilter != NULL || aggref->aggorder != NIL || aggref->aggdistinct != NIL ||
+		aggref->aggdirectargs != NIL || aggref->aggkind != AGGKIND_NORMAL || aggref->aggvariadic ||
+		aggref->aggtranstype == INTERNALOID)
+		return false;
+
+	if (aggref->args != NIL)
+	{
+		TargetEntry *tle = linitial(aggref->args);
+		Var *var;
+
+		if (list_length(aggref->args) != 1 || !IsA(tle->expr, Var))
+			return false;
+
+		var = castNode(Var, tle->expr);
+		if (var->varno != ht_relid || var->varattno <= 0 || var->varlevelsup != 0)
+			return false;
+	}
+
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for aggregate %u", aggref->aggfnoid);
+	aggform = (Form_pg_aggregate) GETSTRUCT(tuple);
+
+	/* polymorphic transition functions need the argument types of the expression */
+	supported = OidIsValid(aggform->aggcombinefn) && !IsPolymorphicType(aggform->aggtranstype);
+	ReleaseSysCache(tuple);
+
+	return supported;
+}
+
+static bool
+contains_function_walker(Node *node, Oid *funcid)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, FuncExpr) && castNode(FuncExpr, node)->funcid == *funcid)
+		return true;
+
+	return expression_tree_walker(node, contains_function_walker, funcid);
+}
+
+/*
+ * Queries that partialize their aggregates with partialize_agg() get all their
+ * Aggregates turned into partial ones later on, which would break the
+ * Finalize Aggregate.
+ */
+static bool
+has_partialize_function(Query *parse)
+{
+	Oid argtypes[] = { ANYELEMENTOID };
+	Oid funcid =
+		LookupFuncName(list_make2(makeString(INTERNAL_SCHEMA_NAME), makeString("partialize_agg")),
+					   lengthof(argtypes),
+					   argtypes,
+					   true);
+
+	return OidIsValid(funcid) && contains_function_walker((Node *) parse->targetList, &funcid);
+}
+
+/*
+ * The scan tuple of DecompressChunk in aggregation mode only has the user
+ * columns of the chunk, so the quals and the aggregates may not refer to the
+ * whole row or system columns.
+ */
+static bool
+chunk_rel_uses_only_user_columns(RelOptInfo *chunk_rel)
+{
+	Bitmapset *attrs_used = NULL;
+	ListCell *lc;
+
+	pull_varattnos((Node *) chunk_rel->reltarget->exprs, chunk_rel->relid, &attrs_used);
+	foreach (lc, chunk_rel->baserestrictinfo)
+		pull_varattnos((Node *) lfirst_node(RestrictInfo, lc)->clause,
+					   chunk_rel->relid,
+					   &attrs_used);
+
+	return bms_is_empty(attrs_used) ||
+		   bms_next_member(attrs_used, -1) > 0 - FirstLowInvalidHeapAttributeNumber;
+}
+
+/*
+ * calculate cost for DecompressChunkPath in aggregation mode
+ *
+ * no tuples are formed, the aggregates are computed in loops over the
+ * decompressed values of a batch or from its metadata, so we only add a
+ * fraction of the cost of a transition function call per decompressed value
+ */
+static void
+cost_decompress_chunk_agg(Path *path, Path *compressed_path, int batch_size, int num_inputs)
+{
+	double rows = compressed_path->rows * batch_size;
+
+	path->rows = 1;
+	path->startup_cost = compressed_path->total_cost +
+						 compressed_path->rows * DECOMPRESS_CHUNK_CPU_TUPLE_COST +
+						 rows * num_inputs * DECOMPRESS_CHUNK_AGG_CPU_VALUE_COST;
+	path->total_cost = path->startup_cost;
+}
+
+/*
+ * Build the pathkeys of the compressed scan that return the batches of a
+ * group one after another. This requires that all grouping columns are
+ * segmentby columns.
+ */
+static bool
+build_compressed_group_pathkeys(PlannerInfo *root, CompressionInfo *info,
+								List **compressed_pathkeys)
+{
+	ListCell *lc;
+
+	*compressed_pathkeys = NIL;
+
+	foreach (lc, root->group_pathkeys)
+	{
+		PathKey *pk = lfirst(lc);
+		Var *var = (Var *) ts_find_em_expr_for_rel(pk->pk_eclass, info->chunk_rel);
+		char *column_name;
+		Oid sortop;
+
+		if (var == NULL || !IsA(var, Var) ||
+			!bms_is_member(var->varattno, info->chunk_segmentby_attnos))
+			return false;
+
+		column_name = get_attname_compat(info->chunk_rte->relid, var->varattno, false);
+		var = makeVar(info->compressed_rel->relid,
+					  get_attnum(info->compressed_rte->relid, column_name),
+					  var->vartype,
+					  var->vartypmod,
+					  var->varcollid,
+					  0);
+
+		sortop = get_opfamily_member(pk->pk_opfamily, var->vartype, var->vartype, pk->pk_strategy);
+		*compressed_pathkeys = lappend(*compressed_pathkeys,
+									   make_pathkey_from_compressed(root,
+																	info->compressed_rel->relid,
+																	(Expr *) var,
+																	sortop,
+																	pk->pk_nulls_first));
+	}
+
+	return true;
+}
+
+/*
+ * Create a DecompressChunkPath that computes the partial aggregates of the
+ * target. With grouping columns, the compressed scan is sorted by them and a
+ * partial aggregate is returned for every group, sorted like the groups.
+ * Returns NULL if the grouping columns are not segmentby columns of the
+ * chunk.
+ */
+static Path *
+decompress_chunk_agg_path_create(PlannerInfo *root, DecompressChunkPath *path, PathTarget *target,
+								 List *group_exprs)
+{
+	DecompressChunkPath *agg_path = copy_decompress_chunk_path(path);
+	Path *compressed_path = linitial(path->cpath.custom_paths);
+	Path sort_path; /* dummy for result of cost_sort */
+	int num_inputs = 0;
+	ListCell *lc;
+
+	agg_path->aggregate = true;
+	agg_path->cpath.path.pathtarget = target;
+
+	/* the aggregates do not depend on the order of the batches */
+	agg_path->cpath.path.pathkeys = NIL;
+	agg_path->compressed_pathkeys = NIL;
+	agg_path->needs_sequence_num = false;
+	agg_path->reverse = false;
+
+	foreach (lc, target->exprs)
+	{
+		Expr *expr = lfirst(lc);
+
+		if (IsA(expr, Aggref) && castNode(Aggref, expr)->args != NIL)
+			num_inputs++;
+		else if (IsA(expr, Var) &&
+				 !bms_is_member(castNode(Var, expr)->varattno, path->info->chunk_segmentby_attnos))
+			return NULL;
+	}
+
+	if (group_exprs != NIL)
+	{
+		if (!build_compressed_group_pathkeys(root, path->info, &agg_path->compressed_pathkeys))
+			return NULL;
+		agg_path->cpath.path.pathkeys = root->group_pathkeys;
+
+		/* the sort is added during plan creation, see decompress_chunk_plan_create() */
+		if (!pathkeys_contained_in(agg_path->compressed_pathkeys, compressed_path->pathkeys))
+		{
+			cost_sort(&sort_path,
+					  root,
+					  agg_path->compressed_pathkeys,
+					  compressed_path->total_cost,
+					  compressed_path->rows,
+					  compressed_path->pathtarget->width,
+					  0.0,
+					  work_mem,
+					  -1);
+			sort_path.rows = compressed_path->rows;
+			compressed_path = &sort_path;
+		}
+	}
+
+	cost_decompress_chunk_agg(&agg_path->cpath.path,
+							  compressed_path,
+							  path->info->batch_size,
+							  num_inputs);
+
+	/* a group has at least one batch */
+	if (group_exprs != NIL)
+		agg_path->cpath.path.rows =
+			estimate_num_groups(root, group_exprs, compressed_path->rows, NULL);
+
+	return &agg_path->cpath.path;
+}
+
+/*
+ * Create a Partial Aggregate for a chunk that is not compressed. With
+ * grouping columns the result has to be sorted like the groups, which is
+ * done either by sorting the rows before a GroupAggregate or by sorting the
+ * groups of a HashAggregate, whichever is cheaper.
+ */
+static Path *
+partial_agg_path_create(PlannerInfo *root, Path *subpath, PathTarget *target,
+						AggClauseCosts *agg_costs, List *group_exprs)
+{
+	RelOptInfo *chunk_rel = subpath->parent;
+	List *group_clause = root->parse->groupClause;
+	Path *sorted_path = subpath;
+	Path *hashed_path;
+	double num_groups;
+
+	if (group_exprs == NIL)
+		return (Path *) create_agg_path(root,
+										chunk_rel,
+										subpath,
+										target,
+										AGG_PLAIN,
+										AGGSPLIT_INITIAL_SERIAL,
+										NIL,
+										NIL,
+										agg_costs,
+										1);
+
+	num_groups = estimate_num_groups(root, group_exprs, subpath->rows, NULL);
+
+	if (!pathkeys_contained_in(root->group_pathkeys, subpath->pathkeys))
+		sorted_path =
+			(Path *) create_sort_path(root, chunk_rel, subpath, root->group_pathkeys, -1.0);
+	sorted_path = (Path *) create_agg_path(root,
+										   chunk_rel,
+										   sorted_path,
+										   target,
+										   AGG_SORTED,
+										   AGGSPLIT_INITIAL_SERIAL,
+										   group_clause,
+										   NIL,
+										   agg_costs,
+										   num_groups);
+
+	if (!grouping_is_hashable(group_clause))
+		return sorted_path;
+
+	hashed_path = (Path *) create_agg_path(root,
+										   chunk_rel,
+										   subpath,
+										   target,
+										   AGG_HASHED,
+										   AGGSPLIT_INITIAL_SERIAL,
+										   group_clause,
+										   NIL,
+										   agg_costs,
+										   num_groups);
+	hashed_path =
+		(Path *) create_sort_path(root, chunk_rel, hashed_path, root->group_pathkeys, -1.0);
+
+	return hashed_path->total_cost < sorted_path->total_cost ? hashed_path : sorted_path;
+}
+
+/* the expressions of the target that are not aggregates, i.e., the grouping columns */
+static List *
+get_group_exprs(PathTarget *target)
+{
+	List *group_exprs = NIL;
+	ListCell *lc;
+
+	foreach (lc, target->exprs)
+	{
+		if (!IsA(lfirst(lc), Aggref))
+			group_exprs = lappend(group_exprs, lfirst(lc));
+	}
+
+	return group_exprs;
+}
+
+/*
+ * Add a path that aggregates every chunk of a hypertable separately and
+ * combines the partial aggregates of the chunks, for queries with aggregates
+ * that are either not grouped or grouped by segmentby columns. Compressed
+ * chunks are aggregated by DecompressChunk, which computes the partial
+ * aggregates from the batches instead of forming a tuple for every
+ * decompressed row. The other chunks get a Partial Aggregate.
+ *
+ * With GROUP BY, the batches of a compressed chunk are read sorted by the
+ * grouping columns, so that DecompressChunk returns a partial aggregate per
+ * group in the order of the groups. The partial aggregates of all chunks are
+ * merged in that order and combined by a GroupAggregate, which does not need
+ * a hash table or a sort of the decompressed rows.
+ */
+void
+ts_decompress_chunk_generate_agg_paths(PlannerInfo *root, RelOptInfo *input_rel,
+									   RelOptInfo *output_rel)
+{
+	Query *parse = root->parse;
+	PathTarget *target = root->upper_targets[UPPERREL_GROUP_AGG];
+	PathTarget *partial_target;
+	AppendPath *append;
+	Path *agg_append;
+	AggClauseCosts agg_costs;
+	AggClauseCosts agg_partial_costs;
+	AggClauseCosts agg_final_costs;
+	List *group_exprs;
+	List *subpaths = NIL;
+	bool has_decompress_chunk = false;
+	double num_groups = 1;
+	ListCell *lc;
+	int i = 0;
+
+	if (parse->commandType != CMD_SELECT || !parse->hasAggs || parse->groupingSets != NIL ||
+		parse->hasTargetSRFs || input_rel->reloptkind != RELOPT_BASEREL ||
+		!IsA(input_rel->cheapest_total_path, AppendPath))
+		return;
+
+	if (parse->groupClause != NIL && !grouping_is_sortable(parse->groupClause))
+		return;
+
+	append = castNode(AppendPath, input_rel->cheapest_total_path);
+	if (append->path.param_info != NULL || append->path.parallel_aware ||
+		has_partialize_function(parse))
+		return;
+
+	MemSet(&agg_costs, 0, sizeof(AggClauseCosts));
+	get_agg_clause_costs(root, (Node *) target->exprs, AGGSPLIT_SIMPLE, &agg_costs);
+	get_agg_clause_costs(root, parse->havingQual, AGGSPLIT_SIMPLE, &agg_costs);
+	if (agg_costs.hasNonPartial || agg_costs.hasNonSerial)
+		return;
+
+	/* the partial target has the grouping columns and the aggregates */
+	partial_target = ts_make_partial_grouping_target(root, target);
+	foreach (lc, partial_target->exprs)
+	{
+		Expr *expr = lfirst(lc);
+
+		if (IsA(expr, Aggref))
+		{
+			if (!is_decompress_chunk_aggref(castNode(Aggref, expr), input_rel->relid))
+				return;
+		}
+		else if (!IsA(expr, Var) || castNode(Var, expr)->varno != input_rel->relid ||
+				 castNode(Var, expr)->varattno <= 0 ||
+				 get_pathtarget_sortgroupref(partial_target, i) == 0)
+			return;
+
+		i++;
+	}
+
+	MemSet(&agg_partial_costs, 0, sizeof(AggClauseCosts));
+	MemSet(&agg_final_costs, 0, sizeof(AggClauseCosts));
+	get_agg_clause_costs(root,
+						 (Node *) partial_target->exprs,
+						 AGGSPLIT_INITIAL_SERIAL,
+						 &agg_partial_costs);
+	get_agg_clause_costs(root, (Node *) target->exprs, AGGSPLIT_FINAL_DESERIAL, &agg_final_costs);
+	get_agg_clause_costs(root, parse->havingQual, AGGSPLIT_FINAL_DESERIAL, &agg_final_costs);
+
+	foreach (lc, append->subpaths)
+	{
+		Path *subpath = lfirst(lc);
+		RelOptInfo *chunk_rel = subpath->parent;
+		AppendRelInfo *appinfo = ts_get_appendrelinfo(root, chunk_rel->relid, true);
+		PathTarget *chunk_target;
+
+		if (appinfo == NULL || subpath->param_info != NULL)
+			return;
+
+		chunk_target = copy_pathtarget(partial_target);
+		chunk_target->exprs =
+			(List *) adjust_appendrel_attrs_compat(root, (Node *) partial_target->exprs, appinfo);
+		group_exprs = get_group_exprs(chunk_target);
+
+		if (IsA(subpath, CustomPath) &&
+			castNode(CustomPath, subpath)->methods == &decompress_chunk_path_methods)
+		{
+			if (!chunk_rel_uses_only_user_columns(chunk_rel))
+				return;
+
+			subpath = decompress_chunk_agg_path_create(root,
+													   (DecompressChunkPath *) subpath,
+													   chunk_target,
+													   group_exprs);
+			if (subpath == NULL)
+				return;
+			has_decompress_chunk = true;
+		}
+		else
+			subpath = partial_agg_path_create(root,
+											  subpath,
+											  chunk_target,
+											  &agg_partial_costs,
+											  group_exprs);
+
+		subpaths = lappend(subpaths, subpath);
+	}
+
+	if (!has_decompress_chunk)
+		return;
+
+	group_exprs = get_group_exprs(partial_target);
+	if (group_exprs != NIL)
+		num_groups = estimate_num_groups(root, group_exprs, input_rel->rows, NULL);
+
+	if (group_exprs != NIL && root->group_pathkeys != NIL)
+	{
+		/* merge the partial aggregates of the chunks in the order of the groups */
+#if PG96
+		agg_append = (Path *) create_merge_append_path(root,
+													   input_rel,
+													   subpaths,
+													   root->group_pathkeys,
+													   NULL);
+#else
+		agg_append = (Path *) create_merge_append_path(root,
+													   input_rel,
+													   subpaths,
+													   root->group_pathkeys,
+													   NULL,
+													   NIL);
+#endif
+		agg_append->pathtarget = partial_target;
+	}
+	else
+	{
+		/* like the Append of the chunks, with one partial aggregate per chunk */
+		AppendPath *path = makeNode(AppendPath);
+
+		memcpy(path, append, sizeof(AppendPath));
+		path->subpaths = subpaths;
+		path->path.pathtarget = partial_target;
+		path->path.pathkeys = NIL;
+		path->path.rows = 0;
+		path->path.startup_cost = ((Path *) linitial(subpaths))->startup_cost;
+		path->path.total_cost = 0;
+		foreach (lc, subpaths)
+		{
+			path->path.rows += ((Path *) lfirst(lc))->rows;
+			path->path.total_cost += ((Path *) lfirst(lc))->total_cost;
+		}
+		agg_append = &path->path;
+	}
+
+	add_path(output_rel,
+			 (Path *) create_agg_path(root,
+									  output_rel,
+									  agg_append,
+									  target,
+									  group_exprs != NIL ? AGG_SORTED : AGG_PLAIN,
+									  AGGSPLIT_FINAL_DESERIAL,
+									  parse->groupClause,
+									  (List *) parse->havingQual,
+									  &agg_final_costs,
+									  num_groups));
+}
+
 static void
 compressed_reltarget_add_whole_row_var(RelOptInfo *compressed_rel)
 {
@@ -961,7 +1463,7 @@ decompress_chunk_path_create(PlannerInfo *root, CompressionInfo *info, int paral
 	path->cpath.custom_paths = list_make1(compressed_path);
 	path->reverse = false;
 	path->compressed_pathkeys = NIL;
-	cost_decompress_chunk(&path->cpath.path, compressed_path);
+	cost_decompress_chunk(&path->cpath.path, compressed_path, info->batch_size);
 
 	return path;
 }
@@ -24,6 +24,8 @@ typedef struct CompressionInfo
 
 	int hypertable_id;
 	List *hypertable_compression_info;
+	/* expected number of rows per compressed row */
+	int32 batch_size;
 
 	int num_orderby_columns;
 	int num_segmentby_columns;
@@ -51,10 +53,17 @@ typedef struct DecompressChunkPath
 	List *compressed_pathkeys;
 	bool needs_sequence_num;
 	bool reverse;
+	/*
+	 * produce the partial aggregates of the pathtarget instead of the
+	 * decompressed tuples
+	 */
+	bool aggregate;
 } DecompressChunkPath;
 
 void ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht,
 										Chunk *chunk);
+void ts_decompress_chunk_generate_agg_paths(PlannerInfo *root, RelOptInfo *input_rel,
+											RelOptInfo *output_rel);
 
 FormData_hypertable_compression *get_column_compressioninfo(List *hypertable_compression_info,
 															char *column_name);
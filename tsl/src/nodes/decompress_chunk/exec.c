@@ -5,8 +5,13 @@
  */
 
 #include <postgres.h>
+#include <math.h>
 #include <miscadmin.h>
+#include <access/stratnum.h>
 #include <access/sysattr.h>
+#include <catalog/pg_aggregate.h>
+#include <catalog/pg_proc.h>
+#include <catalog/pg_type.h>
 #include <executor/executor.h>
 #include <nodes/bitmapset.h>
 #include <nodes/makefuncs.h>
@@ -18,16 +23,26 @@
 #include <optimizer/predtest.h>
 #include <optimizer/prep.h>
 #include <optimizer/restrictinfo.h>
+#include <optimizer/var.h>
 #include <parser/parsetree.h>
 #include <rewrite/rewriteManip.h>
+#include <utils/array.h>
 #include <utils/builtins.h>
 #include <utils/datum.h>
+#include <utils/date.h>
+#include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
 #include <utils/memutils.h>
+#include <utils/pg_locale.h>
+#include <utils/syscache.h>
 #include <utils/typcache.h>
 
 #include "compat.h"
 #include "compression/array.h"
 #include "compression/compression.h"
+#include "compression/dictionary.h"
+#include "compression/jsonb.h"
+#include "guc.h"
 #include "nodes/decompress_chunk/decompress_chunk.h"
 #include "nodes/decompress_chunk/exec.h"
 #include "nodes/decompress_chunk/planner.h"
@@ -39,6 +54,7 @@ typedef enum DecompressChunkColumnType
 	COMPRESSED_COLUMN,
 	COUNT_COLUMN,
 	SEQUENCE_NUM_COLUMN,
+	SEGMENT_META_COLUMN,
 } DecompressChunkColumnType;
 
 typedef struct DecompressChunkColumnState
@@ -57,14 +73,160 @@ typedef struct DecompressChunkColumnState
 		struct
 		{
 			DecompressionIterator *iterator;
+			/* values of the current batch in vectorized mode */
+			DecompressedColumn values;
+			bool isnull;
+			/* the compressed value of the current batch, as stored in the compressed chunk */
+			Datum batch_value;
+			/*
+			 * Columns that the quals do not reference are only detoasted and
+			 * decompressed once a row of the batch passes the quals.
+			 */
+			bool lazy;
+			bool decompressed;
+			/* number of values the iterator of a lazy column returned */
+			uint32 position;
+			/* the only keys of a jsonb column that the query uses */
+			char **jsonb_keys;
+			int num_jsonb_keys;
 		} compressed;
 	};
 } DecompressChunkColumnState;
 
+typedef enum VectorQualOperator
+{
+	VECTOR_QUAL_LT,
+	VECTOR_QUAL_LE,
+	VECTOR_QUAL_EQ,
+	VECTOR_QUAL_NE,
+	VECTOR_QUAL_GE,
+	VECTOR_QUAL_GT,
+} VectorQualOperator;
+
+/*
+ * The representation a vectorized qual compares the decompressed values in.
+ * The comparison is done in the native type of the column whenever the
+ * constant can be represented in it, and in the wider type otherwise.
+ */
+typedef enum VectorQualType
+{
+	VECTOR_QUAL_INT16,
+	VECTOR_QUAL_INT16_AS_INT64,
+	VECTOR_QUAL_INT32,
+	VECTOR_QUAL_INT32_AS_INT64,
+	VECTOR_QUAL_INT64,
+	VECTOR_QUAL_FLOAT4,
+	VECTOR_QUAL_FLOAT4_AS_FLOAT8,
+	VECTOR_QUAL_FLOAT8,
+	/*
+	 * Any other strict operator, called on the Datums of the column. On
+	 * dictionary-compressed batches it is evaluated once per distinct value
+	 * and the rows are filtered by their dictionary codes.
+	 */
+	VECTOR_QUAL_DATUM,
+} VectorQualType;
+
+/*
+ * A qual of the form "column <op> constant" or "column <op> ANY/ALL(array)"
+ * on a compressed column that is evaluated on whole decompressed batches
+ * instead of on individual tuples.
+ */
+typedef struct VectorQual
+{
+	/* index of the column in the column state */
+	int column;
+	VectorQualType type;
+	/* not set for VECTOR_QUAL_DATUM quals with operators that are not comparisons */
+	VectorQualOperator op;
+	union
+	{
+		int64 i;
+		double f;
+	} value;
+
+	/* VECTOR_QUAL_DATUM quals */
+	FmgrInfo opfunc;
+	Oid collation;
+	/* the constant, or the array elements; a row matches any (use_or) or all of them */
+	Datum *constants;
+	int num_constants;
+	bool use_or;
+	/* can sorted dictionaries be searched with the type's comparison function? */
+	bool sorted_search;
+	FmgrInfo *cmp_proc;
+	Oid sort_collation;
+} VectorQual;
+
+/*
+ * The aggregates that are computed in loops over the decompressed values of a
+ * batch. All other aggregates are computed by calling their transition
+ * function.
+ */
+typedef enum DecompressChunkAggKind
+{
+	AGG_GENERIC,
+	AGG_COUNT_STAR,
+	AGG_COUNT,
+	/* sum(int2) and sum(int4) with an int8 transition state */
+	AGG_SUM_INT,
+	AGG_SUM_FLOAT4,
+	AGG_SUM_FLOAT8,
+	/* avg(int2) and avg(int4) with an int8[] transition state of count and sum */
+	AGG_AVG_INT,
+} DecompressChunkAggKind;
+
+/*
+ * A partial aggregate that DecompressChunk computes in aggregation mode,
+ * see ts_decompress_chunk_generate_agg_paths()
+ */
+typedef struct DecompressChunkAggState
+{
+	DecompressChunkAggKind kind;
+	/* attno of the partial aggregate in the scan tuple */
+	AttrNumber resno;
+	/* index of the input column in the column state, -1 if there is none */
+	int column;
+	/* attno of the min or max of the input column in the compressed tuple, 0 if not used */
+	AttrNumber meta_attno;
+
+	FmgrInfo transfn;
+	int num_args;
+	Oid collation;
+	int16 transtyplen;
+	bool transtypbyval;
+	Datum initval;
+	bool initval_isnull;
+
+	/* transition state of AGG_GENERIC */
+	Datum value;
+	bool isnull;
+	bool no_trans_value;
+
+	/* transition state of the other kinds, isnull is set if the sum is NULL */
+	int64 count;
+	int64 int_sum;
+	float4 float4_sum;
+	float8 float8_sum;
+} DecompressChunkAggState;
+
+/* a segmentby column that the partial aggregates are grouped by */
+typedef struct DecompressChunkGroupColumn
+{
+	/* index of the column in the column state */
+	int column;
+	int16 typlen;
+	bool typbyval;
+	/* value of the current group */
+	Datum value;
+	bool isnull;
+} DecompressChunkGroupColumn;
+
 typedef struct DecompressChunkState
 {
 	CustomScanState csstate;
 	List *varattno_map;
+	/* the keys of jsonb columns to decompress, see build_jsonb_keys() */
+	List *jsonb_keys;
 	int num_columns;
 	DecompressChunkColumnState *columns;
 
@@ -75,6 +237,40 @@ typedef struct DecompressChunkState
 	List *hypertable_compression_info;
 	int counter;
 	MemoryContext per_batch_context;
+
+	/* are there columns that are decompressed after the quals passed? */
+	bool has_lazy_columns;
+	/* row of the batch in the scan slot, in the order the rows are returned */
+	uint32 batch_row;
+	uint32 next_batch_row;
+
+	/* decompress whole batches at once and filter them with vectorized quals */
+	bool vectorized;
+	int num_vector_quals;
+	VectorQual *vector_quals;
+	/* rows of the current batch that passed the vectorized quals, in output order */
+	uint32 *selection;
+	uint32 num_selected;
+	uint32 next_selected;
+	/* result of the vectorized quals for every row of the current batch */
+	uint8 *qual_result;
+	uint32 selection_capacity;
+
+	/* return the partial aggregates of the chunk instead of the decompressed tuples */
+	bool aggregate;
+	bool aggregate_done;
+	/* aggregate the selected rows of whole batches instead of single tuples */
+	bool batch_aggregation;
+	MemoryContext agg_context;
+	int num_aggregates;
+	DecompressChunkAggState *aggregates;
+	/* the partial aggregates are returned per group of consecutive batches */
+	int num_group_columns;
+	DecompressChunkGroupColumn *group_columns;
+	/* the batch or tuple that starts the next group, it is not aggregated yet */
+	TupleTableSlot *group_pending;
+	/* the slot the partial aggregates are returned in */
+	TupleTableSlot *agg_slot;
 } DecompressChunkState;
 
 static TupleTableSlot *decompress_chunk_exec(CustomScanState *node);
@@ -82,6 +278,7 @@ static void decompress_chunk_begin(CustomScanState *node, EState *estate, int ef
 static void decompress_chunk_end(CustomScanState *node);
 static void decompress_chunk_rescan(CustomScanState *node);
 static TupleTableSlot *decompress_chunk_create_tuple(DecompressChunkState *state);
+static TupleTableSlot *decompress_chunk_create_tuple_vectorized(DecompressChunkState *state);
 
 static CustomExecMethods decompress_chunk_state_methods = {
 	.BeginCustomScan = decompress_chunk_begin,
@@ -104,11 +301,36 @@ decompress_chunk_state_create(CustomScan *cscan)
 	state->hypertable_id = linitial_int(settings);
 	state->chunk_relid = lsecond_int(settings);
 	state->reverse = lthird_int(settings);
+	state->aggregate = lfourth_int(settings);
 	state->varattno_map = lsecond(cscan->custom_private);
+	state->jsonb_keys = lthird(cscan->custom_private);
 
 	return (Node *) state;
 }
 
+/* set the keys to decompress if the query uses only some keys of a jsonb column */
+static void
+initialize_jsonb_keys(DecompressChunkState *state, DecompressChunkColumnState *column)
+{
+	ListCell *lc;
+
+	foreach (lc, state->jsonb_keys)
+	{
+		List *column_keys = lfirst(lc);
+		ListCell *key;
+		int i = 0;
+
+		if (intVal(linitial(column_keys)) != column->attno)
+			continue;
+
+		column->compressed.num_jsonb_keys = list_length(column_keys) - 1;
+		column->compressed.jsonb_keys = palloc(sizeof(char *) * column->compressed.num_jsonb_keys);
+		for_each_cell (key, lnext(list_head(column_keys)))
+			column->compressed.jsonb_keys[i++] = strVal(lfirst(key));
+		return;
+	}
+}
+
 /*
  * initialize column state
  *
@@ -133,193 +355,1983 @@ initialize_column_state(DecompressChunkState *state)
 		DecompressChunkColumnState *column = &state->columns[i];
 		column->attno = lfirst_int(lc);
 
-		if (column->attno > 0)
+		if (column->attno > 0)
+		{
+			/* normal column that is also present in uncompressed chunk */
+			Form_pg_attribute attribute =
+				TupleDescAttr(desc, AttrNumberGetAttrOffset(lfirst_int(lc)));
+			FormData_hypertable_compression *ht_info =
+				get_column_compressioninfo(state->hypertable_compression_info,
+										   NameStr(attribute->attname));
+
+			column->typid = attribute->atttypid;
+
+			if (ht_info->segmentby_column_index > 0)
+				column->type = SEGMENTBY_COLUMN;
+			else
+			{
+				column->type = COMPRESSED_COLUMN;
+				initialize_jsonb_keys(state, column);
+			}
+		}
+		else
+		{
+			/* metadata columns */
+			switch (column->attno)
+			{
+				case DECOMPRESS_CHUNK_COUNT_ID:
+					column->type = COUNT_COLUMN;
+					break;
+				case DECOMPRESS_CHUNK_SEQUENCE_NUM_ID:
+					column->type = SEQUENCE_NUM_COLUMN;
+					break;
+				case DECOMPRESS_CHUNK_SEGMENT_META_ID:
+					column->type = SEGMENT_META_COLUMN;
+					break;
+				default:
+					elog(ERROR, "Invalid column attno \"%d\"", column->attno);
+					break;
+			}
+		}
+	}
+}
+
+/*
+ * The varno of the Vars of the quals. They refer to the scan tuple with
+ * INDEX_VAR if it is given by custom_scan_tlist, as it is in aggregation mode.
+ */
+static Index
+get_scan_varno(CustomScan *cscan)
+{
+	return cscan->custom_scan_tlist != NIL ? INDEX_VAR : cscan->scan.scanrelid;
+}
+
+/*
+ * Decompress the columns that only the projection uses lazily. If no row of a
+ * batch passes the quals, these columns are never fetched from TOAST. In
+ * aggregation mode, the columns that only the aggregates use are lazy even
+ * if there are no quals, since not every aggregate needs the values.
+ */
+static void
+initialize_lazy_columns(DecompressChunkState *state, CustomScan *cscan)
+{
+	Bitmapset *qual_attrs = NULL;
+	int i;
+
+	if (cscan->scan.plan.qual == NIL && !state->aggregate)
+		return;
+
+	pull_varattnos((Node *) cscan->scan.plan.qual, get_scan_varno(cscan), &qual_attrs);
+
+	/* a whole row reference in the quals needs all columns */
+	if (bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, qual_attrs))
+		return;
+
+	for (i = 0; i < state->num_columns; i++)
+	{
+		DecompressChunkColumnState *column = &state->columns[i];
+
+		if (column->type != COMPRESSED_COLUMN ||
+			bms_is_member(column->attno - FirstLowInvalidHeapAttributeNumber, qual_attrs))
+			continue;
+
+		column->compressed.lazy = true;
+		state->has_lazy_columns = true;
+	}
+}
+
+typedef struct ConstifyTableOidContext
+{
+	Index chunk_index;
+	Oid chunk_relid;
+} ConstifyTableOidContext;
+
+static Node *
+constify_tableoid_walker(Node *node, ConstifyTableOidContext *ctx)
+{
+	if (node == NULL)
+		return NULL;
+
+	if (IsA(node, Var))
+	{
+		Var *var = castNode(Var, node);
+
+		if (var->varno != ctx->chunk_index)
+			return node;
+
+		if (var->varattno == TableOidAttributeNumber)
+			return (
+				Node *) makeConst(OIDOID, -1, InvalidOid, 4, (Datum) ctx->chunk_relid, false, true);
+
+		/*
+		 * we doublecheck system columns here because projection will
+		 * segfault if any system columns get through
+		 */
+		if (var->varattno < 0)
+			elog(ERROR, "transparent decompression only supports tableoid system column");
+
+		return node;
+	}
+
+	return expression_tree_mutator(node, constify_tableoid_walker, (void *) ctx);
+}
+
+static List *
+constify_tableoid(List *node, Index chunk_index, Oid chunk_relid)
+{
+	ConstifyTableOidContext ctx = {
+		.chunk_index = chunk_index,
+		.chunk_relid = chunk_relid,
+	};
+
+	return (List *) constify_tableoid_walker((Node *) node, &ctx);
+}
+
+static bool
+vector_qual_set_operator(VectorQual *qual, Oid opno, Oid column_type)
+{
+	TypeCacheEntry *tce = lookup_type_cache(column_type, TYPECACHE_BTREE_OPFAMILY);
+	Oid negator;
+
+	if (!OidIsValid(tce->btree_opf))
+		return false;
+
+	switch (get_op_opfamily_strategy(opno, tce->btree_opf))
+	{
+		case BTLessStrategyNumber:
+			qual->op = VECTOR_QUAL_LT;
+			return true;
+		case BTLessEqualStrategyNumber:
+			qual->op = VECTOR_QUAL_LE;
+			return true;
+		case BTEqualStrategyNumber:
+			qual->op = VECTOR_QUAL_EQ;
+			return true;
+		case BTGreaterEqualStrategyNumber:
+			qual->op = VECTOR_QUAL_GE;
+			return true;
+		case BTGreaterStrategyNumber:
+			qual->op = VECTOR_QUAL_GT;
+			return true;
+		default:
+			break;
+	}
+
+	/* "<>" is not part of the btree operator family but is the negator of "=" */
+	negator = get_negator(opno);
+	if (OidIsValid(negator) &&
+		get_op_opfamily_strategy(negator, tce->btree_opf) == BTEqualStrategyNumber)
+	{
+		qual->op = VECTOR_QUAL_NE;
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+vector_qual_set_value(VectorQual *qual, Oid column_type, Const *value)
+{
+	int64 i;
+	double f;
+
+	if (value->constisnull)
+		return false;
+
+	switch (column_type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			switch (value->consttype)
+			{
+				case INT2OID:
+					i = DatumGetInt16(value->constvalue);
+					break;
+				case INT4OID:
+					i = DatumGetInt32(value->constvalue);
+					break;
+				case INT8OID:
+					i = DatumGetInt64(value->constvalue);
+					break;
+				default:
+					return false;
+			}
+
+			qual->value.i = i;
+			if (column_type == INT2OID)
+				qual->type = (i >= PG_INT16_MIN && i <= PG_INT16_MAX) ? VECTOR_QUAL_INT16 :
+																		VECTOR_QUAL_INT16_AS_INT64;
+			else if (column_type == INT4OID)
+				qual->type = (i >= PG_INT32_MIN && i <= PG_INT32_MAX) ? VECTOR_QUAL_INT32 :
+																		VECTOR_QUAL_INT32_AS_INT64;
+			else
+				qual->type = VECTOR_QUAL_INT64;
+			return true;
+		case DATEOID:
+			if (value->consttype != DATEOID)
+				return false;
+			qual->value.i = DatumGetDateADT(value->constvalue);
+			qual->type = VECTOR_QUAL_INT32;
+			return true;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			if (value->consttype != column_type)
+				return false;
+			qual->value.i = DatumGetInt64(value->constvalue);
+			qual->type = VECTOR_QUAL_INT64;
+			return true;
+		case FLOAT4OID:
+		case FLOAT8OID:
+			switch (value->consttype)
+			{
+				case FLOAT4OID:
+					f = DatumGetFloat4(value->constvalue);
+					break;
+				case FLOAT8OID:
+					f = DatumGetFloat8(value->constvalue);
+					break;
+				default:
+					return false;
+			}
+
+			/*
+			 * NaN is larger than any other value in PostgreSQL, the
+			 * comparison loops only get this right for NaN column values
+			 */
+			if (isnan(f))
+				return false;
+
+			qual->value.f = f;
+			if (column_type == FLOAT4OID)
+				qual->type = ((double) (float4) f == f) ? VECTOR_QUAL_FLOAT4 :
+														  VECTOR_QUAL_FLOAT4_AS_FLOAT8;
+			else
+				qual->type = VECTOR_QUAL_FLOAT8;
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Can sorted dictionaries be searched for the constants of the qual? They are
+ * sorted with the comparison function of the type in the C collation, so their
+ * order only matches that of the operator for non-collatable types and the C
+ * collation. The equality of the built-in string types is bytewise for all
+ * collations, though.
+ */
+static bool
+vector_qual_can_search_sorted(VectorQual *qual, Oid column_type, Oid const_type, bool is_array)
+{
+	TypeCacheEntry *tce = lookup_type_cache(column_type, TYPECACHE_CMP_PROC_FINFO);
+	bool is_equality = qual->op == VECTOR_QUAL_EQ || qual->op == VECTOR_QUAL_NE;
+
+	if (const_type != column_type || !OidIsValid(tce->cmp_proc_finfo.fn_oid))
+		return false;
+
+	/* "= ANY" and "<> ALL" are the only array quals that match sets of items */
+	if (is_array && !(qual->op == VECTOR_QUAL_EQ && qual->use_or) &&
+		!(qual->op == VECTOR_QUAL_NE && !qual->use_or))
+		return false;
+
+	if (type_is_collatable(column_type) && !lc_collate_is_c(qual->collation) &&
+		!(is_equality && (column_type == TEXTOID || column_type == BPCHAROID)))
+		return false;
+
+	qual->cmp_proc = &tce->cmp_proc_finfo;
+	qual->sort_collation = dictionary_sort_collation(column_type);
+	return true;
+}
+
+/*
+ * Set up a qual that calls the operator on the Datums of the column, for the
+ * operators and types that the vectorized comparisons do not support.
+ */
+static bool
+vector_qual_set_datum(VectorQual *qual, Oid opno, Oid collation, Oid column_type, Oid const_type,
+					  Datum *constants, int num_constants, bool is_array, bool use_or)
+{
+	Oid opfuncid = get_opcode(opno);
+
+	/*
+	 * NULL values never match, which is only right for strict operators, and
+	 * the operator is called only once for repeated values
+	 */
+	if (!OidIsValid(opfuncid) || !func_strict(opfuncid) ||
+		func_volatile(opfuncid) == PROVOLATILE_VOLATILE)
+		return false;
+
+	qual->type = VECTOR_QUAL_DATUM;
+	qual->collation = collation;
+	qual->constants = constants;
+	qual->num_constants = num_constants;
+	qual->use_or = use_or;
+	fmgr_info(opfuncid, &qual->opfunc);
+
+	qual->sorted_search = vector_qual_set_operator(qual, opno, column_type) &&
+						  vector_qual_can_search_sorted(qual, column_type, const_type, is_array);
+
+	return true;
+}
+
+/*
+ * Find the compressed column a Var of the scan refers to. Returns the index
+ * of the column in the column state, or -1 if it is not a compressed column.
+ */
+static int
+find_compressed_column(DecompressChunkState *state, Index scanrelid, Node *node)
+{
+	Var *var;
+	int i;
+
+	if (!IsA(node, Var))
+		return -1;
+
+	var = castNode(Var, node);
+
+	if (var->varno != scanrelid || var->varattno <= 0 || var->varlevelsup != 0)
+		return -1;
+
+	for (i = 0; i < state->num_columns; i++)
+	{
+		DecompressChunkColumnState *column = &state->columns[i];
+
+		if (column->attno == var->varattno)
+			return column->type == COMPRESSED_COLUMN ? i : -1;
+	}
+
+	return -1;
+}
+
+/*
+ * Check if a qual is "column <op> ANY/ALL(array)" with a constant array that
+ * can be evaluated vectorized and fill in the vectorized qual if so.
+ */
+static bool
+make_vector_array_qual(DecompressChunkState *state, Index scanrelid, ScalarArrayOpExpr *saop,
+					   VectorQual *qual)
+{
+	Const *array_const;
+	ArrayType *array;
+	Oid element_type;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	Datum *elements;
+	bool *nulls;
+	int num_elements;
+	int column;
+	int i;
+
+	if (list_length(saop->args) != 2 || !IsA(lsecond(saop->args), Const))
+		return false;
+
+	column = find_compressed_column(state, scanrelid, linitial(saop->args));
+	array_const = castNode(Const, lsecond(saop->args));
+
+	if (column < 0 || array_const->constisnull)
+		return false;
+
+	array = DatumGetArrayTypeP(array_const->constvalue);
+	element_type = ARR_ELEMTYPE(array);
+	get_typlenbyvalalign(element_type, &typlen, &typbyval, &typalign);
+	deconstruct_array(array,
+					  element_type,
+					  typlen,
+					  typbyval,
+					  typalign,
+					  &elements,
+					  &nulls,
+					  &num_elements);
+
+	/* NULL elements make the result NULL instead of false, leave these to the executor */
+	for (i = 0; i < num_elements; i++)
+	{
+		if (nulls[i])
+			return false;
+	}
+
+	qual->column = column;
+
+	return vector_qual_set_datum(qual,
+								 saop->opno,
+								 saop->inputcollid,
+								 state->columns[column].typid,
+								 element_type,
+								 elements,
+								 num_elements,
+								 true,
+								 saop->useOr);
+}
+
+/*
+ * Check if a qual is a comparison between a compressed column and a constant
+ * that can be evaluated vectorized and fill in the vectorized qual if so.
+ */
+static bool
+make_vector_qual(DecompressChunkState *state, Index scanrelid, Expr *expr, VectorQual *qual)
+{
+	OpExpr *op;
+	Node *left;
+	Node *right;
+	Oid opno;
+	Const *value;
+	Oid column_type;
+	int column;
+
+	if (IsA(expr, ScalarArrayOpExpr))
+		return make_vector_array_qual(state, scanrelid, castNode(ScalarArrayOpExpr, expr), qual);
+
+	if (!IsA(expr, OpExpr))
+		return false;
+
+	op = castNode(OpExpr, expr);
+
+	if (list_length(op->args) != 2)
+		return false;
+
+	left = linitial(op->args);
+	right = lsecond(op->args);
+	opno = op->opno;
+
+	/* normalize "constant <op> column" to "column <commutator> constant" */
+	if (IsA(left, Const) && IsA(right, Var))
+	{
+		Node *tmp = left;
+
+		left = right;
+		right = tmp;
+		opno = get_commutator(opno);
+	}
+
+	if (!OidIsValid(opno) || !IsA(right, Const))
+		return false;
+
+	column = find_compressed_column(state, scanrelid, left);
+
+	if (column < 0)
+		return false;
+
+	qual->column = column;
+	column_type = state->columns[column].typid;
+	value = castNode(Const, right);
+
+	if (vector_qual_set_operator(qual, opno, column_type) &&
+		vector_qual_set_value(qual, column_type, value))
+		return true;
+
+	if (value->constisnull)
+		return false;
+
+	return vector_qual_set_datum(qual,
+								 opno,
+								 op->inputcollid,
+								 column_type,
+								 value->consttype,
+								 &value->constvalue,
+								 1,
+								 false,
+								 true);
+}
+
+/*
+ * Set up decompression of whole batches.
+ *
+ * The quals of the scan that compare a compressed column with a constant or
+ * an array of constants are evaluated on the decompressed batches, so only the
+ * remaining quals are evaluated per tuple.
+ */
+static void
+initialize_vectorized_state(DecompressChunkState *state, CustomScan *cscan)
+{
+	PlanState *ps = &state->csstate.ss.ps;
+	List *quals = cscan->scan.plan.qual;
+	List *remaining_quals = NIL;
+	ListCell *lc;
+	int i;
+
+	/* allocate the decompression arrays once so they are reused for all batches; they are
+	 * enlarged when a batch has more rows than the default batch size */
+	for (i = 0; i < state->num_columns; i++)
+	{
+		DecompressChunkColumnState *column = &state->columns[i];
+
+		if (column->type == COMPRESSED_COLUMN)
+			decompressed_column_init(&column->compressed.values,
+									 column->typid,
+									 DEFAULT_ROWS_PER_COMPRESSION);
+	}
+
+	state->selection_capacity = DEFAULT_ROWS_PER_COMPRESSION;
+	state->selection = palloc(sizeof(uint32) * state->selection_capacity);
+	state->qual_result = palloc(sizeof(uint8) * state->selection_capacity);
+
+	state->num_vector_quals = 0;
+	state->vector_quals = palloc(sizeof(VectorQual) * Max(list_length(quals), 1));
+
+	foreach (lc, quals)
+	{
+		VectorQual *qual = &state->vector_quals[state->num_vector_quals];
+
+		if (make_vector_qual(state, get_scan_varno(cscan), lfirst(lc), qual))
+			state->num_vector_quals++;
+		else
+			remaining_quals = lappend(remaining_quals, lfirst(lc));
+	}
+
+	/*
+	 * Evaluate the comparisons of native values first, so that quals calling
+	 * functions for every row only need to look at the rows that remain.
+	 */
+	for (i = 1; i < state->num_vector_quals; i++)
+	{
+		VectorQual qual = state->vector_quals[i];
+		int j = i;
+
+		if (qual.type == VECTOR_QUAL_DATUM)
+			continue;
+
+		for (; j > 0 && state->vector_quals[j - 1].type == VECTOR_QUAL_DATUM; j--)
+			state->vector_quals[j] = state->vector_quals[j - 1];
+		state->vector_quals[j] = qual;
+	}
+
+	if (state->num_vector_quals > 0)
+	{
+#if PG96
+		ps->qual = (List *) ExecInitExpr((Expr *) remaining_quals, ps);
+#else
+		ps->qual = ExecInitQual(remaining_quals, ps);
+#endif
+	}
+}
+
+/*
+ * Set up a partial aggregate. The aggregates with a built-in transition
+ * function that only does arithmetic are computed in loops, see
+ * aggregate_batch_column(), the others with their transition function like
+ * in nodeAgg.c.
+ */
+static void
+initialize_aggregate(DecompressChunkState *state, DecompressChunkAggState *agg, Aggref *aggref,
+					 AttrNumber resno, AttrNumber meta_attno)
+{
+	HeapTuple tuple;
+	Form_pg_aggregate aggform;
+	Datum textinitval;
+	Oid transtype;
+	int i;
+
+	agg->resno = resno;
+	agg->meta_attno = meta_attno;
+	agg->collation = aggref->inputcollid;
+	agg->column = -1;
+	agg->num_args = list_length(aggref->args) + 1;
+
+	if (aggref->args != NIL)
+	{
+		Var *var = castNode(Var, castNode(TargetEntry, linitial(aggref->args))->expr);
+
+		for (i = 0; i < state->num_columns; i++)
+		{
+			if (state->columns[i].attno == var->varattno)
+				agg->column = i;
+		}
+
+		if (agg->column < 0)
+			elog(ERROR, "input column of aggregate not found");
+	}
+
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for aggregate %u", aggref->aggfnoid);
+	aggform = (Form_pg_aggregate) GETSTRUCT(tuple);
+
+	transtype = aggform->aggtranstype;
+	fmgr_info(aggform->aggtransfn, &agg->transfn);
+	textinitval =
+		SysCacheGetAttr(AGGFNOID, tuple, Anum_pg_aggregate_agginitval, &agg->initval_isnull);
+	if (!agg->initval_isnull)
+	{
+		Oid typinput, typioparam;
+
+		getTypeInputInfo(transtype, &typinput, &typioparam);
+		agg->initval = OidInputFunctionCall(typinput,
+											TextDatumGetCString(textinitval),
+											typioparam,
+											-1);
+	}
+	ReleaseSysCache(tuple);
+
+	get_typlenbyval(transtype, &agg->transtyplen, &agg->transtypbyval);
+
+	agg->kind = AGG_GENERIC;
+	switch (agg->transfn.fn_oid)
+	{
+		case F_INT8INC:
+			if (aggref->args == NIL && !agg->initval_isnull)
+				agg->kind = AGG_COUNT_STAR;
+			break;
+		case F_INT8INC_ANY:
+			if (!agg->initval_isnull)
+				agg->kind = AGG_COUNT;
+			break;
+		case F_INT2_SUM:
+		case F_INT4_SUM:
+			agg->kind = AGG_SUM_INT;
+			break;
+		case F_FLOAT4PL:
+			agg->kind = AGG_SUM_FLOAT4;
+			break;
+		case F_FLOAT8PL:
+			agg->kind = AGG_SUM_FLOAT8;
+			break;
+		case F_INT2_AVG_ACCUM:
+		case F_INT4_AVG_ACCUM:
+		{
+			/* the transition state is the array {count, sum} */
+			ArrayType *array;
+
+			if (agg->initval_isnull)
+				break;
+
+			array = DatumGetArrayTypeP(agg->initval);
+			if (ARR_NDIM(array) == 1 && ARR_DIMS(array)[0] == 2 && !ARR_HASNULL(array) &&
+				ARR_ELEMTYPE(array) == INT8OID)
+				agg->kind = AGG_AVG_INT;
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+/*
+ * The output columns of DecompressChunk in aggregation mode that are not
+ * aggregates are the grouping columns. The planner only groups by segmentby
+ * columns, so all rows of a batch belong to the same group.
+ */
+static void
+initialize_group_columns(DecompressChunkState *state, CustomScan *cscan)
+{
+	ListCell *lc;
+	int i;
+
+	state->group_columns =
+		palloc0(sizeof(DecompressChunkGroupColumn) * list_length(cscan->scan.plan.targetlist));
+
+	foreach (lc, cscan->scan.plan.targetlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		DecompressChunkGroupColumn *group_column;
+		TargetEntry *scan_tle;
+
+		if (!IsA(tle->expr, Var))
+			continue;
+
+		scan_tle = list_nth(cscan->custom_scan_tlist, castNode(Var, tle->expr)->varattno - 1);
+		if (IsA(scan_tle->expr, Aggref))
+			continue;
+
+		group_column = &state->group_columns[state->num_group_columns++];
+		group_column->column = -1;
+		for (i = 0; i < state->num_columns; i++)
+		{
+			if (state->columns[i].attno == scan_tle->resno)
+				group_column->column = i;
+		}
+
+		if (group_column->column < 0 ||
+			state->columns[group_column->column].type != SEGMENTBY_COLUMN)
+			elog(ERROR, "grouping column is not a segmentby column");
+
+		get_typlenbyval(state->columns[group_column->column].typid,
+						&group_column->typlen,
+						&group_column->typbyval);
+	}
+}
+
+static void
+initialize_aggregate_state(DecompressChunkState *state, CustomScan *cscan, EState *estate)
+{
+	List *meta_attnos = lfourth(cscan->custom_private);
+	ListCell *lc_meta = list_head(meta_attnos);
+	ListCell *lc;
+	int i = 0;
+
+	state->num_aggregates = list_length(meta_attnos);
+	state->aggregates = palloc0(sizeof(DecompressChunkAggState) * state->num_aggregates);
+	state->agg_context = AllocSetContextCreate(CurrentMemoryContext,
+											   "DecompressChunk aggregates",
+											   ALLOCSET_DEFAULT_SIZES);
+
+	/* the partial aggregates follow the columns of the chunk in the scan tuple */
+	foreach (lc, cscan->custom_scan_tlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		if (!IsA(tle->expr, Aggref))
+			continue;
+
+		initialize_aggregate(state,
+							 &state->aggregates[i++],
+							 castNode(Aggref, tle->expr),
+							 tle->resno,
+							 lfirst_int(lc_meta));
+		lc_meta = lnext(lc_meta);
+	}
+
+	initialize_group_columns(state, cscan);
+	state->agg_slot =
+		ExecInitExtraTupleSlotCompat(estate,
+									 state->csstate.ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+
+	/* without quals that have to be evaluated per tuple, whole batches are aggregated */
+	state->batch_aggregation = state->vectorized && state->csstate.ss.ps.qual == NULL;
+}
+
+/*
+ * Complete initialization of the supplied CustomScanState.
+ *
+ * Standard fields have been initialized by ExecInitCustomScan,
+ * but any private fields should be initialized here.
+ */
+static void
+decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+	CustomScan *cscan = castNode(CustomScan, node->ss.ps.plan);
+	Plan *compressed_scan = linitial(cscan->custom_plans);
+	Assert(list_length(cscan->custom_plans) == 1);
+
+	if (node->ss.ps.ps_ProjInfo)
+	{
+		/*
+		 * if we are projecting we need to constify tableoid references here
+		 * because decompressed tuple are virtual tuples and don't have
+		 * system columns.
+		 *
+		 * We do the constify in executor because even after plan creation
+		 * our targetlist might still get modified by parent nodes pushing
+		 * down targetlist.
+		 */
+		List *tlist = node->ss.ps.plan->targetlist;
+		PlanState *ps = &node->ss.ps;
+		tlist = constify_tableoid(tlist, cscan->scan.scanrelid, state->chunk_relid);
+
+		ps->ps_ProjInfo =
+			ExecBuildProjectionInfoCompat(tlist,
+										  ps->ps_ExprContext,
+										  ps->ps_ResultTupleSlot,
+										  ps,
+										  node->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	}
+
+	state->hypertable_compression_info = ts_hypertable_compression_get(state->hypertable_id);
+
+	initialize_column_state(state);
+	initialize_lazy_columns(state, cscan);
+
+	state->vectorized = ts_guc_enable_vectorized_decompression;
+	if (state->vectorized)
+		initialize_vectorized_state(state, cscan);
+
+	if (state->aggregate)
+		initialize_aggregate_state(state, cscan, estate);
+
+	node->custom_ps = lappend(node->custom_ps, ExecInitNode(compressed_scan, estate, eflags));
+
+	state->per_batch_context = AllocSetContextCreate(CurrentMemoryContext,
+													 "DecompressChunk per_batch",
+													 ALLOCSET_DEFAULT_SIZES);
+}
+
+/*
+ * Compare all values of a column with the constant of the qual. The loops are
+ * kept free of branches so that the compiler can vectorize them. GE and GT
+ * are expressed as negations so that NaN values compare larger than any
+ * other value, like they do in PostgreSQL.
+ */
+#define VECTOR_QUAL_COMPARE(type, consttype, constvalue)                                           \
+	do                                                                                             \
+	{                                                                                              \
+		const type *restrict values = (const type *) column->values;                               \
+		const consttype c = (consttype)(constvalue);                                               \
+                                                                                                   \
+		switch (qual->op)                                                                          \
+		{                                                                                          \
+			case VECTOR_QUAL_LT:                                                                   \
+				for (i = 0; i < n; i++)                                                            \
+					result[i] &= values[i] < c;                                                    \
+				break;                                                                             \
+			case VECTOR_QUAL_LE:                                                                   \
+				for (i = 0; i < n; i++)                                                            \
+					result[i] &= values[i] <= c;                                                   \
+				break;                                                                             \
+			case VECTOR_QUAL_EQ:                                                                   \
+				for (i = 0; i < n; i++)                                                            \
+					result[i] &= values[i] == c;                                                   \
+				break;                                                                             \
+			case VECTOR_QUAL_NE:                                                                   \
+				for (i = 0; i < n; i++)                                                            \
+					result[i] &= values[i] != c;                                                   \
+				break;                                                                             \
+			case VECTOR_QUAL_GE:                                                                   \
+				for (i = 0; i < n; i++)                                                            \
+					result[i] &= !(values[i] < c);                                                 \
+				break;                                                                             \
+			case VECTOR_QUAL_GT:                                                                   \
+				for (i = 0; i < n; i++)                                                            \
+					result[i] &= !(values[i] <= c);                                                \
+				break;                                                                             \
+		}                                                                                          \
+	} while (0)
+
+static bool
+vector_qual_datum_matches(VectorQual *qual, Datum value)
+{
+	int i;
+
+	for (i = 0; i < qual->num_constants; i++)
+	{
+		FunctionCallInfoData fcinfo;
+		Datum result;
+		bool match;
+
+		InitFunctionCallInfoData(fcinfo, &qual->opfunc, 2, qual->collation, NULL, NULL);
+		fcinfo.arg[0] = value;
+		fcinfo.arg[1] = qual->constants[i];
+		fcinfo.argnull[0] = false;
+		fcinfo.argnull[1] = false;
+
+		result = FunctionCallInvoke(&fcinfo);
+		match = !fcinfo.isnull && DatumGetBool(result);
+
+		if (match == qual->use_or)
+			return match;
+	}
+
+	return !qual->use_or;
+}
+
+static int32
+vector_qual_compare(VectorQual *qual, Datum left, Datum right)
+{
+	return DatumGetInt32(FunctionCall2Coll(qual->cmp_proc, qual->sort_collation, left, right));
+}
+
+/*
+ * Find the first item of a sorted dictionary that is not smaller than the
+ * constant, or the first item that is larger if upper is set.
+ */
+static uint32
+vector_qual_search_dictionary(VectorQual *qual, const DecompressedColumn *column, Datum constant,
+							  bool upper)
+{
+	uint32 low = 0;
+	uint32 high = column->num_distinct;
+
+	while (low < high)
+	{
+		uint32 middle = low + (high - low) / 2;
+		int32 cmp = vector_qual_compare(qual, column->dictionary[middle], constant);
+
+		if (cmp < 0 || (upper && cmp == 0))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+/*
+ * Evaluate a qual on every item of the dictionary of a column. On sorted
+ * dictionaries, the matching items are found with binary searches instead.
+ */
+static void
+vector_qual_match_dictionary(VectorQual *qual, const DecompressedColumn *column, uint8 *matches)
+{
+	const uint32 n = column->num_distinct;
+	uint32 first = 0;
+	uint32 end = n;
+	uint32 i;
+	int c;
+
+	if (!column->dictionary_sorted || !qual->sorted_search)
+	{
+		for (i = 0; i < n; i++)
+			matches[i] = vector_qual_datum_matches(qual, column->dictionary[i]);
+		return;
+	}
+
+	switch (qual->op)
+	{
+		case VECTOR_QUAL_EQ:
+		case VECTOR_QUAL_NE:
+			/* the constants are the items to include for "=" and to exclude for "<>" */
+			memset(matches, qual->op == VECTOR_QUAL_NE, n);
+
+			for (c = 0; c < qual->num_constants; c++)
+			{
+				Datum constant = qual->constants[c];
+				uint32 pos = vector_qual_search_dictionary(qual, column, constant, false);
+				bool found =
+					pos < n && vector_qual_compare(qual, column->dictionary[pos], constant) == 0;
+
+				if (found)
+					matches[pos] = qual->op == VECTOR_QUAL_EQ;
+			}
+			return;
+		case VECTOR_QUAL_LT:
+			end = vector_qual_search_dictionary(qual, column, qual->constants[0], false);
+			break;
+		case VECTOR_QUAL_LE:
+			end = vector_qual_search_dictionary(qual, column, qual->constants[0], true);
+			break;
+		case VECTOR_QUAL_GE:
+			first = vector_qual_search_dictionary(qual, column, qual->constants[0], false);
+			break;
+		case VECTOR_QUAL_GT:
+			first = vector_qual_search_dictionary(qual, column, qual->constants[0], true);
+			break;
+	}
+
+	/* the items of a range comparison are a contiguous range of codes */
+	memset(matches, 0, n);
+	if (first < end)
+		memset(matches + first, 1, end - first);
+}
+
+/*
+ * Evaluate a qual that calls the operator on the Datums of the column. For
+ * dictionary-compressed batches, the qual is only evaluated on the distinct
+ * values and the rows are filtered by their codes, so the values of the rows
+ * are never looked at.
+ */
+static void
+vector_qual_apply_datum(VectorQual *qual, const DecompressedColumn *column, uint8 *restrict result)
+{
+	const uint32 n = column->num_values;
+	uint32 i;
+
+	if (column->has_dictionary)
+	{
+		const uint32 *restrict codes = column->codes;
+		uint8 *restrict matches = palloc(sizeof(uint8) * column->num_distinct);
+
+		vector_qual_match_dictionary(qual, column, matches);
+
+		for (i = 0; i < n; i++)
+			result[i] &= matches[codes[i]];
+
+		pfree(matches);
+		return;
+	}
+
+	/* rows that did not pass the previous quals are skipped */
+	for (i = 0; i < n; i++)
+	{
+		if (!result[i] || (column->num_nulls > 0 && DECOMPRESSED_COLUMN_IS_NULL(column, i)))
+			continue;
+
+		result[i] = vector_qual_datum_matches(qual, decompressed_column_get_datum(column, i));
+	}
+}
+
+static void
+vector_qual_apply(VectorQual *qual, const DecompressedColumn *column, uint8 *restrict result)
+{
+	const uint32 n = column->num_values;
+	uint32 i;
+
+	switch (qual->type)
+	{
+		case VECTOR_QUAL_INT16:
+			VECTOR_QUAL_COMPARE(int16, int16, qual->value.i);
+			break;
+		case VECTOR_QUAL_INT16_AS_INT64:
+			VECTOR_QUAL_COMPARE(int16, int64, qual->value.i);
+			break;
+		case VECTOR_QUAL_INT32:
+			VECTOR_QUAL_COMPARE(int32, int32, qual->value.i);
+			break;
+		case VECTOR_QUAL_INT32_AS_INT64:
+			VECTOR_QUAL_COMPARE(int32, int64, qual->value.i);
+			break;
+		case VECTOR_QUAL_INT64:
+			VECTOR_QUAL_COMPARE(int64, int64, qual->value.i);
+			break;
+		case VECTOR_QUAL_FLOAT4:
+			VECTOR_QUAL_COMPARE(float4, float4, qual->value.f);
+			break;
+		case VECTOR_QUAL_FLOAT4_AS_FLOAT8:
+			VECTOR_QUAL_COMPARE(float4, float8, qual->value.f);
+			break;
+		case VECTOR_QUAL_FLOAT8:
+			VECTOR_QUAL_COMPARE(float8, float8, qual->value.f);
+			break;
+		case VECTOR_QUAL_DATUM:
+			vector_qual_apply_datum(qual, column, result);
+			break;
+	}
+
+	/* comparison operators are strict, so NULL values never pass */
+	if (column->num_nulls > 0)
+	{
+		for (i = 0; i < n; i++)
+			result[i] &= !DECOMPRESSED_COLUMN_IS_NULL(column, i);
+	}
+}
+
+#undef VECTOR_QUAL_COMPARE
+
+/*
+ * Set up the decompression of the value of a compressed column for the
+ * current batch
+ */
+static void
+decompress_column(DecompressChunkState *state, DecompressChunkColumnState *column)
+{
+	CompressedDataHeader *header = NULL;
+	bool keys_only;
+
+	if (!column->compressed.isnull)
+		header = (CompressedDataHeader *) PG_DETOAST_DATUM(column->compressed.batch_value);
+
+	/* decompress only the keys the query uses, unless another algorithm was used */
+	keys_only = header != NULL && column->compressed.num_jsonb_keys > 0 &&
+				header->compression_algorithm == COMPRESSION_ALGORITHM_JSONB;
+
+	column->compressed.decompressed = true;
+	column->compressed.position = 0;
+
+	if (state->vectorized)
+	{
+		if (keys_only)
+			jsonb_decompress_keys(PointerGetDatum(header),
+								  column->compressed.jsonb_keys,
+								  column->compressed.num_jsonb_keys,
+								  &column->compressed.values);
+		else if (header != NULL)
+			decompress_all(PointerGetDatum(header), column->typid, &column->compressed.values);
+
+		if (header != NULL && column->compressed.values.num_values != (uint32) state->counter)
+			elog(ERROR, "compressed column out of sync with batch counter");
+		return;
+	}
+
+	if (keys_only)
+		column->compressed.iterator =
+			jsonb_decompression_iterator_from_datum_keys(PointerGetDatum(header),
+														 !state->reverse,
+														 column->compressed.jsonb_keys,
+														 column->compressed.num_jsonb_keys);
+	else if (header != NULL)
+		column->compressed.iterator =
+			tsl_get_decompression_iterator_init(header->compression_algorithm,
+												state->reverse)(PointerGetDatum(header),
+																column->typid);
+	else
+		column->compressed.iterator = NULL;
+}
+
+static bool
+batch_has_rows(const uint8 *result, uint32 num_rows)
+{
+	uint32 row;
+
+	for (row = 0; row < num_rows; row++)
+	{
+		if (result[row])
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Evaluate the vectorized quals on the batch and build the selection vector
+ * of the rows to return. The columns of the quals are decompressed one qual
+ * at a time, so once no row of the batch is left, the columns of the
+ * remaining quals are skipped. The columns that only the other quals use are
+ * decompressed if any row passed, those that only the projection uses once a
+ * row passed all quals.
+ */
+static void
+initialize_batch_selection(DecompressChunkState *state)
+{
+	uint32 num_rows = state->counter;
+	uint32 num_selected = 0;
+	uint8 *restrict result;
+	uint32 *restrict selection;
+	uint32 row;
+	int i;
+
+	if (num_rows > state->selection_capacity)
+	{
+		state->selection_capacity = num_rows;
+		state->selection = repalloc(state->selection, sizeof(uint32) * num_rows);
+		state->qual_result = repalloc(state->qual_result, sizeof(uint8) * num_rows);
+	}
+
+	result = state->qual_result;
+	selection = state->selection;
+	memset(result, 1, num_rows);
+
+	for (i = 0; i < state->num_vector_quals; i++)
+	{
+		VectorQual *qual = &state->vector_quals[i];
+		DecompressChunkColumnState *column = &state->columns[qual->column];
+
+		if (column->compressed.isnull)
+		{
+			/* the whole column is NULL in this batch */
+			memset(result, 0, num_rows);
+			break;
+		}
+
+		if (!column->compressed.decompressed)
+			decompress_column(state, column);
+
+		vector_qual_apply(qual, &column->compressed.values, result);
+
+		/* the columns of the remaining quals are not decompressed if no row passed */
+		if (!batch_has_rows(result, num_rows))
+			break;
+	}
+
+	if (!state->reverse)
+	{
+		for (row = 0; row < num_rows; row++)
+		{
+			selection[num_selected] = row;
+			num_selected += result[row];
+		}
+	}
+	else
+	{
+		for (row = num_rows; row > 0; row--)
+		{
+			selection[num_selected] = row - 1;
+			num_selected += result[row - 1];
+		}
+	}
+
+	InstrCountFiltered1(state, num_rows - num_selected);
+
+	state->num_selected = num_selected;
+	state->next_selected = 0;
+
+	if (num_selected == 0)
+		return;
+
+	/* the other columns are only needed for the rows that passed */
+	for (i = 0; i < state->num_columns; i++)
+	{
+		DecompressChunkColumnState *column = &state->columns[i];
+
+		if (column->type == COMPRESSED_COLUMN && !column->compressed.lazy &&
+			!column->compressed.decompressed)
+			decompress_column(state, column);
+	}
+}
+
+static void
+initialize_batch(DecompressChunkState *state, TupleTableSlot *slot)
+{
+	Datum value;
+	bool isnull;
+	int i;
+	MemoryContext old_context = MemoryContextSwitchTo(state->per_batch_context);
+	MemoryContextReset(state->per_batch_context);
+
+	for (i = 0; i < state->num_columns; i++)
+	{
+		DecompressChunkColumnState *column = &state->columns[i];
+
+		switch (column->type)
+		{
+			case COMPRESSED_COLUMN:
+				column->compressed.batch_value =
+					slot_getattr(slot, AttrOffsetGetAttrNumber(i), &column->compressed.isnull);
+
+				/*
+				 * lazy columns are decompressed by decompress_chunk_fill_lazy_columns(),
+				 * in vectorized mode the others by initialize_batch_selection()
+				 */
+				column->compressed.decompressed = false;
+				if (!column->compressed.lazy && !state->vectorized)
+					decompress_column(state, column);
+				break;
+			case SEGMENTBY_COLUMN:
+				value = slot_getattr(slot, AttrOffsetGetAttrNumber(i), &isnull);
+				if (!isnull)
+					column->segmentby.value = value;
+				else
+					column->segmentby.value = (Datum) 0;
+
+				column->segmentby.isnull = isnull;
+				break;
+			case COUNT_COLUMN:
+				value = slot_getattr(slot, AttrOffsetGetAttrNumber(i), &isnull);
+				state->counter = DatumGetInt32(value);
+				/* count column should never be NULL */
+				Assert(!isnull);
+				break;
+			case SEQUENCE_NUM_COLUMN:
+				/*
+				 * nothing to do here for sequence number
+				 * we only needed this for sorting in node below
+				 */
+				break;
+			case SEGMENT_META_COLUMN:
+				/* only read when aggregating the batch */
+				break;
+		}
+	}
+
+	if (state->vectorized)
+		initialize_batch_selection(state);
+
+	state->next_batch_row = 0;
+	state->initialized = true;
+	MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * Set the values of the lazy columns for a row that passed the quals. The
+ * columns are decompressed when the first row of the batch passes.
+ */
+static void
+decompress_chunk_fill_lazy_columns(DecompressChunkState *state, TupleTableSlot *slot)
+{
+	uint32 row = state->batch_row;
+	int i;
+
+	for (i = 0; i < state->num_columns; i++)
+	{
+		DecompressChunkColumnState *column = &state->columns[i];
+		AttrNumber attr = AttrNumberGetAttrOffset(column->attno);
+
+		if (column->type != COMPRESSED_COLUMN || !column->compressed.lazy)
+			continue;
+
+		if (!column->compressed.decompressed)
+		{
+			MemoryContext old_context = MemoryContextSwitchTo(state->per_batch_context);
+
+			decompress_column(state, column);
+			MemoryContextSwitchTo(old_context);
+		}
+
+		if (state->vectorized)
+		{
+			DecompressedColumn *values = &column->compressed.values;
+
+			slot->tts_isnull[attr] =
+				column->compressed.isnull || DECOMPRESSED_COLUMN_IS_NULL(values, row);
+			slot->tts_values[attr] =
+				slot->tts_isnull[attr] ? (Datum) 0 : decompressed_column_get_datum(values, row);
+		}
+		else if (column->compressed.iterator != NULL)
+		{
+			DecompressionIterator *iterator = column->compressed.iterator;
+			DecompressResult result;
+
+			/* skip the values of the rows that did not pass the quals */
+			do
+			{
+				result = iterator->try_next(iterator);
+				if (result.is_done)
+					elog(ERROR, "compressed column out of sync with batch counter");
+			} while (column->compressed.position++ < row);
+
+			slot->tts_values[attr] = result.val;
+			slot->tts_isnull[attr] = result.is_null;
+		}
+	}
+}
+
+/*
+ * Reset the transition states to the initial values for aggregating the
+ * chunk
+ */
+static void
+aggregate_reset(DecompressChunkState *state)
+{
+	MemoryContext old_context = MemoryContextSwitchTo(state->agg_context);
+	int i;
+
+	MemoryContextReset(state->agg_context);
+
+	for (i = 0; i < state->num_aggregates; i++)
+	{
+		DecompressChunkAggState *agg = &state->aggregates[i];
+
+		agg->isnull = agg->initval_isnull;
+		agg->no_trans_value = agg->initval_isnull;
+		agg->value = agg->initval_isnull ?
+						 (Datum) 0 :
+						 datumCopy(agg->initval, agg->transtypbyval, agg->transtyplen);
+
+		agg->count = 0;
+		agg->int_sum = 0;
+		agg->float4_sum = 0;
+		agg->float8_sum = 0;
+
+		switch (agg->kind)
+		{
+			case AGG_COUNT_STAR:
+			case AGG_COUNT:
+				agg->count = DatumGetInt64(agg->initval);
+				break;
+			case AGG_SUM_INT:
+				if (!agg->isnull)
+					agg->int_sum = DatumGetInt64(agg->initval);
+				break;
+			case AGG_SUM_FLOAT4:
+				if (!agg->isnull)
+					agg->float4_sum = DatumGetFloat4(agg->initval);
+				break;
+			case AGG_SUM_FLOAT8:
+				if (!agg->isnull)
+					agg->float8_sum = DatumGetFloat8(agg->initval);
+				break;
+			case AGG_AVG_INT:
+			{
+				int64 *transdata = (int64 *) ARR_DATA_PTR(DatumGetArrayTypeP(agg->initval));
+
+				agg->count = transdata[0];
+				agg->int_sum = transdata[1];
+				break;
+			}
+			case AGG_GENERIC:
+				break;
+		}
+	}
+
+	MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * Advance the transition state with the transition function, see
+ * advance_transition_function() in nodeAgg.c. The function is called without
+ * an aggregate context, so it does not modify the state in place.
+ */
+static void
+aggregate_advance_generic(DecompressChunkState *state, DecompressChunkAggState *agg, Datum value,
+						  bool isnull)
+{
+	FunctionCallInfoData fcinfo;
+	Datum result;
+
+	if (agg->transfn.fn_strict)
+	{
+		if (agg->num_args > 1 && isnull)
+			return;
+
+		if (agg->no_trans_value)
+		{
+			/* the first input is the initial transition state */
+			MemoryContext old_context = MemoryContextSwitchTo(state->agg_context);
+
+			agg->value = datumCopy(value, agg->transtypbyval, agg->transtyplen);
+			agg->isnull = false;
+			agg->no_trans_value = false;
+			MemoryContextSwitchTo(old_context);
+			return;
+		}
+
+		/* the transition function returned NULL before, the result stays NULL */
+		if (agg->isnull)
+			return;
+	}
+
+	InitFunctionCallInfoData(fcinfo, &agg->transfn, agg->num_args, agg->collation, NULL, NULL);
+	fcinfo.arg[0] = agg->value;
+	fcinfo.argnull[0] = agg->isnull;
+	fcinfo.arg[1] = value;
+	fcinfo.argnull[1] = isnull;
+
+	result = FunctionCallInvoke(&fcinfo);
+
+	if (!agg->transtypbyval && DatumGetPointer(result) != DatumGetPointer(agg->value))
+	{
+		if (!fcinfo.isnull)
+		{
+			MemoryContext old_context = MemoryContextSwitchTo(state->agg_context);
+
+			result = datumCopy(result, agg->transtypbyval, agg->transtyplen);
+			MemoryContextSwitchTo(old_context);
+		}
+		if (!agg->isnull)
+			pfree(DatumGetPointer(agg->value));
+	}
+
+	agg->value = result;
+	agg->isnull = fcinfo.isnull;
+}
+
+/* float4pl() and float8pl() raise an error if the sum of finite values overflows */
+static inline float4
+float4_add_checked(float4 sum, float4 value)
+{
+	float4 result = sum + value;
+
+	if (isinf(result) && !isinf(sum) && !isinf(value))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("value out of range: overflow")));
+
+	return result;
+}
+
+static inline float8
+float8_add_checked(float8 sum, float8 value)
+{
+	float8 result = sum + value;
+
+	if (isinf(result) && !isinf(sum) && !isinf(value))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("value out of range: overflow")));
+
+	return result;
+}
+
+static inline int64
+datum_get_int(Datum value, Oid typid)
+{
+	return typid == INT2OID ? DatumGetInt16(value) : DatumGetInt32(value);
+}
+
+/* advance the aggregate with a single input value */
+static void
+aggregate_advance(DecompressChunkState *state, DecompressChunkAggState *agg, Oid typid,
+				  Datum value, bool isnull)
+{
+	switch (agg->kind)
+	{
+		case AGG_COUNT_STAR:
+			agg->count++;
+			break;
+		case AGG_COUNT:
+			agg->count += !isnull;
+			break;
+		case AGG_SUM_INT:
+			if (isnull)
+				break;
+			agg->int_sum = agg->isnull ? datum_get_int(value, typid) :
+										 agg->int_sum + datum_get_int(value, typid);
+			agg->isnull = false;
+			break;
+		case AGG_SUM_FLOAT4:
+			if (isnull)
+				break;
+			agg->float4_sum = agg->isnull ? DatumGetFloat4(value) :
+											float4_add_checked(agg->float4_sum,
+															   DatumGetFloat4(value));
+			agg->isnull = false;
+			break;
+		case AGG_SUM_FLOAT8:
+			if (isnull)
+				break;
+			agg->float8_sum = agg->isnull ? DatumGetFloat8(value) :
+											float8_add_checked(agg->float8_sum,
+															   DatumGetFloat8(value));
+			agg->isnull = false;
+			break;
+		case AGG_AVG_INT:
+			if (isnull)
+				break;
+			agg->count++;
+			agg->int_sum += datum_get_int(value, typid);
+			break;
+		case AGG_GENERIC:
+			aggregate_advance_generic(state, agg, value, isnull);
+			break;
+	}
+}
+
+/*
+ * Sum the selected rows of a decompressed int2 or int4 column. The loop
+ * without NULLs has no branches, so the compiler can vectorize it.
+ */
+#define SUM_SELECTED(type)                                                                         \
+	do                                                                                             \
+	{                                                                                              \
+		const type *restrict v = (const type *) values->values;                                    \
+                                                                                                   \
+		if (values->num_nulls == 0)                                                                \
+		{                                                                                          \
+			for (i = 0; i < n; i++)                                                                \
+				sum += v[selection[i]];                                                            \
+			count = n;                                                                             \
+		}                                                                                          \
+		else                                                                                       \
+		{                                                                                          \
+			for (i = 0; i < n; i++)                                                                \
+			{                                                                                      \
+				if (!DECOMPRESSED_COLUMN_IS_NULL(values, selection[i]))                            \
+				{                                                                                  \
+					sum += v[selection[i]];                                                        \
+					count++;                                                                       \
+				}                                                                                  \
+			}                                                                                      \
+		}                                                                                          \
+	} while (0)
+
+/*
+ * Aggregate the selected rows of a compressed column. The column is
+ * decompressed here if no qual used it, so aggregates that take their result
+ * from the segment metadata never decompress it. Sums and counts of columns
+ * stored in their native representation are computed in loops over the
+ * values, the other aggregates call their transition function for every row.
+ */
+static void
+aggregate_batch_column(DecompressChunkState *state, DecompressChunkAggState *agg,
+					   DecompressChunkColumnState *column)
+{
+	DecompressedColumn *values = &column->compressed.values;
+	const uint32 *restrict selection = state->selection;
+	const uint32 n = state->num_selected;
+	uint32 i;
+
+	if (column->compressed.isnull)
+	{
+		/* the whole column is NULL in this batch */
+		if (agg->kind == AGG_GENERIC)
+		{
+			for (i = 0; i < n; i++)
+				aggregate_advance_generic(state, agg, (Datum) 0, true);
+		}
+		return;
+	}
+
+	if (!column->compressed.decompressed)
+		decompress_column(state, column);
+
+	if (agg->kind == AGG_COUNT)
+	{
+		if (values->num_nulls == 0)
+			agg->count += n;
+		else
+		{
+			for (i = 0; i < n; i++)
+				agg->count += !DECOMPRESSED_COLUMN_IS_NULL(values, selection[i]);
+		}
+		return;
+	}
+
+	if (!values->native_values || agg->kind == AGG_GENERIC)
+	{
+		for (i = 0; i < n; i++)
+		{
+			uint32 row = selection[i];
+			bool isnull = DECOMPRESSED_COLUMN_IS_NULL(values, row);
+
+			aggregate_advance(state,
+							  agg,
+							  column->typid,
+							  isnull ? (Datum) 0 : decompressed_column_get_datum(values, row),
+							  isnull);
+		}
+		return;
+	}
+
+	switch (agg->kind)
+	{
+		case AGG_SUM_INT:
+		case AGG_AVG_INT:
+		{
+			int64 sum = 0;
+			int64 count = 0;
+
+			if (column->typid == INT2OID)
+				SUM_SELECTED(int16);
+			else
+				SUM_SELECTED(int32);
+
+			if (agg->kind == AGG_AVG_INT)
+			{
+				agg->count += count;
+				agg->int_sum += sum;
+			}
+			else if (count > 0)
+			{
+				agg->int_sum = agg->isnull ? sum : agg->int_sum + sum;
+				agg->isnull = false;
+			}
+			break;
+		}
+		case AGG_SUM_FLOAT4:
+		{
+			/* floating point sums are computed in the order of the rows like float4pl() does */
+			const float4 *v = (const float4 *) values->values;
+
+			for (i = 0; i < n; i++)
+			{
+				if (DECOMPRESSED_COLUMN_IS_NULL(values, selection[i]))
+					continue;
+
+				agg->float4_sum = agg->isnull ?
+									  v[selection[i]] :
+									  float4_add_checked(agg->float4_sum, v[selection[i]]);
+				agg->isnull = false;
+			}
+			break;
+		}
+		case AGG_SUM_FLOAT8:
+		{
+			const float8 *v = (const float8 *) values->values;
+
+			for (i = 0; i < n; i++)
+			{
+				if (DECOMPRESSED_COLUMN_IS_NULL(values, selection[i]))
+					continue;
+
+				agg->float8_sum = agg->isnull ?
+									  v[selection[i]] :
+									  float8_add_checked(agg->float8_sum, v[selection[i]]);
+				agg->isnull = false;
+			}
+			break;
+		}
+		case AGG_COUNT_STAR:
+		case AGG_COUNT:
+		case AGG_GENERIC:
+			Assert(false);
+			break;
+	}
+}
+
+#undef SUM_SELECTED
+
+/*
+ * Aggregate the rows of the current batch that passed the vectorized quals.
+ * Without quals, min and max of order by and compress_minmax columns are
+ * taken from the segment metadata of the batch.
+ */
+static void
+aggregate_batch(DecompressChunkState *state, TupleTableSlot *compressed_slot)
+{
+	uint32 n = state->num_selected;
+	uint32 i;
+	int j;
+
+	for (j = 0; j < state->num_aggregates; j++)
+	{
+		DecompressChunkAggState *agg = &state->aggregates[j];
+		DecompressChunkColumnState *column;
+
+		if (agg->kind == AGG_COUNT_STAR)
+		{
+			agg->count += n;
+			continue;
+		}
+
+		if (n == 0)
+			continue;
+
+		if (agg->meta_attno > 0)
 		{
-			/* normal column that is also present in uncompressed chunk */
-			Form_pg_attribute attribute =
-				TupleDescAttr(desc, AttrNumberGetAttrOffset(lfirst_int(lc)));
-			FormData_hypertable_compression *ht_info =
-				get_column_compressioninfo(state->hypertable_compression_info,
-										   NameStr(attribute->attname));
+			bool isnull;
+			Datum value = slot_getattr(compressed_slot, agg->meta_attno, &isnull);
 
-			column->typid = attribute->atttypid;
+			aggregate_advance_generic(state, agg, value, isnull);
+			continue;
+		}
 
-			if (ht_info->segmentby_column_index > 0)
-				column->type = SEGMENTBY_COLUMN;
-			else
-				column->type = COMPRESSED_COLUMN;
+		if (agg->column < 0)
+		{
+			for (i = 0; i < n; i++)
+				aggregate_advance(state, agg, InvalidOid, (Datum) 0, true);
+			continue;
 		}
+
+		column = &state->columns[agg->column];
+		if (column->type == COMPRESSED_COLUMN)
+			aggregate_batch_column(state, agg, column);
+		else if (agg->kind == AGG_COUNT)
+			agg->count += column->segmentby.isnull ? 0 : n;
 		else
 		{
-			/* metadata columns */
-			switch (column->attno)
-			{
-				case DECOMPRESS_CHUNK_COUNT_ID:
-					column->type = COUNT_COLUMN;
-					break;
-				case DECOMPRESS_CHUNK_SEQUENCE_NUM_ID:
-					column->type = SEQUENCE_NUM_COLUMN;
-					break;
-				default:
-					elog(ERROR, "Invalid column attno \"%d\"", column->attno);
-					break;
-			}
+			/* the value of a segmentby column is the same for all rows of the batch */
+			for (i = 0; i < n; i++)
+				aggregate_advance(state,
+								  agg,
+								  column->typid,
+								  column->segmentby.value,
+								  column->segmentby.isnull);
 		}
 	}
 }
 
-typedef struct ConstifyTableOidContext
-{
-	Index chunk_index;
-	Oid chunk_relid;
-} ConstifyTableOidContext;
-
-static Node *
-constify_tableoid_walker(Node *node, ConstifyTableOidContext *ctx)
+/* aggregate a decompressed tuple that passed the quals */
+static void
+aggregate_tuple(DecompressChunkState *state, TupleTableSlot *slot)
 {
-	if (node == NULL)
-		return NULL;
+	int i;
 
-	if (IsA(node, Var))
+	for (i = 0; i < state->num_aggregates; i++)
 	{
-		Var *var = castNode(Var, node);
+		DecompressChunkAggState *agg = &state->aggregates[i];
+		DecompressChunkColumnState *column;
+		AttrNumber attr;
 
-		if (var->varno != ctx->chunk_index)
-			return node;
+		if (agg->column < 0)
+		{
+			aggregate_advance(state, agg, InvalidOid, (Datum) 0, true);
+			continue;
+		}
 
-		if (var->varattno == TableOidAttributeNumber)
-			return (
-				Node *) makeConst(OIDOID, -1, InvalidOid, 4, (Datum) ctx->chunk_relid, false, true);
+		column = &state->columns[agg->column];
+		attr = AttrNumberGetAttrOffset(column->attno);
+		aggregate_advance(state,
+						  agg,
+						  column->typid,
+						  slot->tts_values[attr],
+						  slot->tts_isnull[attr]);
+	}
+}
 
-		/*
-		 * we doublecheck system columns here because projection will
-		 * segfault if any system columns get through
-		 */
-		if (var->varattno < 0)
-			elog(ERROR, "transparent decompression only supports tableoid system column");
+/* set the partial aggregate in the scan tuple */
+static void
+aggregate_finish(DecompressChunkAggState *agg, Datum *value, bool *isnull)
+{
+	*isnull = agg->isnull;
 
-		return node;
-	}
+	switch (agg->kind)
+	{
+		case AGG_COUNT_STAR:
+		case AGG_COUNT:
+			*value = Int64GetDatum(agg->count);
+			*isnull = false;
+			break;
+		case AGG_SUM_INT:
+			*value = Int64GetDatum(agg->int_sum);
+			break;
+		case AGG_SUM_FLOAT4:
+			*value = Float4GetDatum(agg->float4_sum);
+			break;
+		case AGG_SUM_FLOAT8:
+			*value = Float8GetDatum(agg->float8_sum);
+			break;
+		case AGG_AVG_INT:
+		{
+			Datum transdata[2] = { Int64GetDatum(agg->count), Int64GetDatum(agg->int_sum) };
 
-	return expression_tree_mutator(node, constify_tableoid_walker, (void *) ctx);
+			*value = PointerGetDatum(
+				construct_array(transdata, 2, INT8OID, sizeof(int64), FLOAT8PASSBYVAL, 'd'));
+			*isnull = false;
+			break;
+		}
+		case AGG_GENERIC:
+			*value = agg->value;
+			break;
+	}
 }
 
-static List *
-constify_tableoid(List *node, Index chunk_index, Oid chunk_relid)
+/* start a group with the values of the grouping columns of the current batch */
+static void
+aggregate_group_start(DecompressChunkState *state)
 {
-	ConstifyTableOidContext ctx = {
-		.chunk_index = chunk_index,
-		.chunk_relid = chunk_relid,
-	};
+	MemoryContext old_context = MemoryContextSwitchTo(state->agg_context);
+	int i;
 
-	return (List *) constify_tableoid_walker((Node *) node, &ctx);
+	for (i = 0; i < state->num_group_columns; i++)
+	{
+		DecompressChunkGroupColumn *group_column = &state->group_columns[i];
+		DecompressChunkColumnState *column = &state->columns[group_column->column];
+
+		group_column->isnull = column->segmentby.isnull;
+		group_column->value =
+			column->segmentby.isnull ?
+				(Datum) 0 :
+				datumCopy(column->segmentby.value, group_column->typbyval, group_column->typlen);
+	}
+
+	MemoryContextSwitchTo(old_context);
 }
 
 /*
- * Complete initialization of the supplied CustomScanState.
- *
- * Standard fields have been initialized by ExecInitCustomScan,
- * but any private fields should be initialized here.
+ * Does the current batch belong to the current group? Values that are equal
+ * but not binary equal start a new group, which is fine since the groups are
+ * combined by the Finalize Aggregate.
  */
-static void
-decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
+static bool
+aggregate_group_matches(DecompressChunkState *state)
 {
-	DecompressChunkState *state = (DecompressChunkState *) node;
-	CustomScan *cscan = castNode(CustomScan, node->ss.ps.plan);
-	Plan *compressed_scan = linitial(cscan->custom_plans);
-	Assert(list_length(cscan->custom_plans) == 1);
+	int i;
 
-	if (node->ss.ps.ps_ProjInfo)
+	for (i = 0; i < state->num_group_columns; i++)
 	{
-		/*
-		 * if we are projecting we need to constify tableoid references here
-		 * because decompressed tuple are virtual tuples and don't have
-		 * system columns.
-		 *
-		 * We do the constify in executor because even after plan creation
-		 * our targetlist might still get modified by parent nodes pushing
-		 * down targetlist.
-		 */
-		List *tlist = node->ss.ps.plan->targetlist;
-		PlanState *ps = &node->ss.ps;
-		tlist = constify_tableoid(tlist, cscan->scan.scanrelid, state->chunk_relid);
+		DecompressChunkGroupColumn *group_column = &state->group_columns[i];
+		DecompressChunkColumnState *column = &state->columns[group_column->column];
 
-		ps->ps_ProjInfo =
-			ExecBuildProjectionInfoCompat(tlist,
-										  ps->ps_ExprContext,
-										  ps->ps_ResultTupleSlot,
-										  ps,
-										  node->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+		if (group_column->isnull != column->segmentby.isnull)
+			return false;
+
+		if (!group_column->isnull && !datumIsEqual(group_column->value,
+												   column->segmentby.value,
+												   group_column->typbyval,
+												   group_column->typlen))
+			return false;
 	}
 
-	state->hypertable_compression_info = ts_hypertable_compression_get(state->hypertable_id);
+	return true;
+}
 
-	initialize_column_state(state);
+/* aggregate a batch, or a decompressed tuple that passed the quals */
+static void
+aggregate_input(DecompressChunkState *state, TupleTableSlot *slot)
+{
+	MemoryContext old_context;
 
-	node->custom_ps = lappend(node->custom_ps, ExecInitNode(compressed_scan, estate, eflags));
+	if (!state->batch_aggregation && state->has_lazy_columns)
+		decompress_chunk_fill_lazy_columns(state, slot);
 
-	state->per_batch_context = AllocSetContextCreate(CurrentMemoryContext,
-													 "DecompressChunk per_batch",
-													 ALLOCSET_DEFAULT_SIZES);
+	old_context = MemoryContextSwitchTo(state->per_batch_context);
+	if (state->batch_aggregation)
+		aggregate_batch(state, slot);
+	else
+		aggregate_tuple(state, slot);
+	MemoryContextSwitchTo(old_context);
 }
 
-static void
-initialize_batch(DecompressChunkState *state, TupleTableSlot *slot)
+/*
+ * Compute the partial aggregates of the chunk and return them as the only
+ * tuple. Without quals that have to be evaluated per tuple, the aggregates
+ * are computed from whole batches, otherwise from the tuples that pass the
+ * quals.
+ *
+ * With grouping columns, a tuple is returned for every run of batches with
+ * the same values of the grouping columns. The batch or tuple that starts
+ * the next run is kept until the next call. Groups without rows are not
+ * returned.
+ */
+static TupleTableSlot *
+decompress_chunk_exec_aggregate(DecompressChunkState *state)
 {
-	Datum value;
-	bool isnull;
+	CustomScanState *node = &state->csstate;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	TupleTableSlot *slot = state->agg_slot;
+	bool grouped = state->num_group_columns > 0;
+	bool has_rows = false;
+	MemoryContext old_context;
 	int i;
-	MemoryContext old_context = MemoryContextSwitchTo(state->per_batch_context);
-	MemoryContextReset(state->per_batch_context);
 
-	for (i = 0; i < state->num_columns; i++)
+	if (state->aggregate_done)
+		return NULL;
+
+	aggregate_reset(state);
+
+	if (state->group_pending != NULL)
 	{
-		DecompressChunkColumnState *column = &state->columns[i];
+		aggregate_group_start(state);
+		aggregate_input(state, state->group_pending);
+		state->group_pending = NULL;
+		has_rows = true;
+	}
 
-		switch (column->type)
+	while (true)
+	{
+		TupleTableSlot *input;
+
+		if (state->batch_aggregation)
 		{
-			case COMPRESSED_COLUMN:
-			{
-				value = slot_getattr(slot, AttrOffsetGetAttrNumber(i), &isnull);
-				if (!isnull)
-				{
-					CompressedDataHeader *header = (CompressedDataHeader *) PG_DETOAST_DATUM(value);
+			input = ExecProcNode(linitial(node->custom_ps));
 
-					column->compressed.iterator =
-						tsl_get_decompression_iterator_init(header->compression_algorithm,
-															state->reverse)(PointerGetDatum(header),
-																			column->typid);
-				}
-				else
-					column->compressed.iterator = NULL;
+			if (TupIsNull(input))
+				break;
+
+			initialize_batch(state, input);
+
+			if (grouped && state->num_selected == 0)
+				continue;
+		}
+		else
+		{
+			input = decompress_chunk_create_tuple(state);
 
+			if (TupIsNull(input))
 				break;
+
+			ResetExprContext(econtext);
+			econtext->ecxt_scantuple = input;
+
+#if PG96
+			if (node->ss.ps.qual && !ExecQual(node->ss.ps.qual, econtext, false))
+#else
+			if (node->ss.ps.qual && !ExecQual(node->ss.ps.qual, econtext))
+#endif
+			{
+				InstrCountFiltered1(node, 1);
+				continue;
 			}
-			case SEGMENTBY_COLUMN:
-				value = slot_getattr(slot, AttrOffsetGetAttrNumber(i), &isnull);
-				if (!isnull)
-					column->segmentby.value = value;
-				else
-					column->segmentby.value = (Datum) 0;
+		}
 
-				column->segmentby.isnull = isnull;
-				break;
-			case COUNT_COLUMN:
-				value = slot_getattr(slot, AttrOffsetGetAttrNumber(i), &isnull);
-				state->counter = DatumGetInt32(value);
-				/* count column should never be NULL */
-				Assert(!isnull);
-				break;
-			case SEQUENCE_NUM_COLUMN:
-				/*
-				 * nothing to do here for sequence number
-				 * we only needed this for sorting in node below
-				 */
+		if (grouped)
+		{
+			if (has_rows && !aggregate_group_matches(state))
+			{
+				state->group_pending = input;
 				break;
+			}
+
+			if (!has_rows)
+				aggregate_group_start(state);
 		}
+
+		aggregate_input(state, input);
+		has_rows = true;
 	}
-	state->initialized = true;
+
+	if (state->group_pending == NULL)
+		state->aggregate_done = true;
+
+	if (grouped && !has_rows)
+		return NULL;
+
+	/*
+	 * the tuple has the partial aggregates after the columns of the chunk, of
+	 * which only the grouping columns are set
+	 */
+	old_context = MemoryContextSwitchTo(state->agg_context);
+	ExecClearTuple(slot);
+	memset(slot->tts_isnull, true, sizeof(bool) * slot->tts_tupleDescriptor->natts);
+	for (i = 0; i < state->num_group_columns; i++)
+	{
+		DecompressChunkGroupColumn *group_column = &state->group_columns[i];
+		AttrNumber attr = AttrNumberGetAttrOffset(state->columns[group_column->column].attno);
+
+		slot->tts_values[attr] = group_column->value;
+		slot->tts_isnull[attr] = group_column->isnull;
+	}
+	for (i = 0; i < state->num_aggregates; i++)
+	{
+		DecompressChunkAggState *agg = &state->aggregates[i];
+
+		aggregate_finish(agg,
+						 &slot->tts_values[AttrNumberGetAttrOffset(agg->resno)],
+						 &slot->tts_isnull[AttrNumberGetAttrOffset(agg->resno)]);
+	}
+	ExecStoreVirtualTuple(slot);
 	MemoryContextSwitchTo(old_context);
+
+	if (!node->ss.ps.ps_ProjInfo)
+		return slot;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_scantuple = slot;
+
+#if PG96
+	return ExecProject(node->ss.ps.ps_ProjInfo, NULL);
+#else
+	return ExecProject(node->ss.ps.ps_ProjInfo);
+#endif
 }
 
 static TupleTableSlot *
@@ -335,6 +2347,9 @@ decompress_chunk_exec(CustomScanState *node)
 	if (node->custom_ps == NIL)
 		return NULL;
 
+	if (state->aggregate)
+		return decompress_chunk_exec_aggregate(state);
+
 #if PG96
 	if (node->ss.ps.ps_TupFromTlist)
 	{
@@ -369,6 +2384,9 @@ decompress_chunk_exec(CustomScanState *node)
 			continue;
 		}
 
+		if (state->has_lazy_columns)
+			decompress_chunk_fill_lazy_columns(state, slot);
+
 		if (!node->ss.ps.ps_ProjInfo)
 			return slot;
 
@@ -390,6 +2408,8 @@ static void
 decompress_chunk_rescan(CustomScanState *node)
 {
 	((DecompressChunkState *) node)->initialized = false;
+	((DecompressChunkState *) node)->aggregate_done = false;
+	((DecompressChunkState *) node)->group_pending = NULL;
 	ExecReScan(linitial(node->custom_ps));
 }
 
@@ -410,6 +2430,9 @@ decompress_chunk_create_tuple(DecompressChunkState *state)
 	bool batch_done = false;
 	int i;
 
+	if (state->vectorized)
+		return decompress_chunk_create_tuple_vectorized(state);
+
 	while (true)
 	{
 		if (!state->initialized)
@@ -445,7 +2468,9 @@ decompress_chunk_create_tuple(DecompressChunkState *state)
 				{
 					AttrNumber attr = AttrNumberGetAttrOffset(column->attno);
 
-					if (column->compressed.iterator != NULL)
+					if (column->compressed.lazy)
+						slot->tts_isnull[attr] = true;
+					else if (column->compressed.iterator != NULL)
 					{
 						DecompressResult result;
 						result = column->compressed.iterator->try_next(column->compressed.iterator);
@@ -487,6 +2512,8 @@ decompress_chunk_create_tuple(DecompressChunkState *state)
 					 * we only needed this for sorting in node below
 					 */
 					break;
+				case SEGMENT_META_COLUMN:
+					break;
 			}
 		}
 
@@ -496,8 +2523,77 @@ decompress_chunk_create_tuple(DecompressChunkState *state)
 			continue;
 		}
 
+		state->batch_row = state->next_batch_row++;
 		ExecStoreVirtualTuple(slot);
 
 		return slot;
 	}
 }
+
+/*
+ * Create the next tuple from the selected rows of the decompressed batch
+ */
+static TupleTableSlot *
+decompress_chunk_create_tuple_vectorized(DecompressChunkState *state)
+{
+	TupleTableSlot *slot = state->csstate.ss.ss_ScanTupleSlot;
+	uint32 row;
+	int i;
+
+	ExecClearTuple(slot);
+
+	while (!state->initialized || state->next_selected >= state->num_selected)
+	{
+		TupleTableSlot *subslot = ExecProcNode(linitial(state->csstate.custom_ps));
+
+		if (TupIsNull(subslot))
+			return NULL;
+
+		initialize_batch(state, subslot);
+	}
+
+	row = state->selection[state->next_selected++];
+	state->batch_row = row;
+
+	for (i = 0; i < state->num_columns; i++)
+	{
+		DecompressChunkColumnState *column = &state->columns[i];
+		AttrNumber attr;
+
+		switch (column->type)
+		{
+			case COMPRESSED_COLUMN:
+			{
+				DecompressedColumn *values = &column->compressed.values;
+
+				attr = AttrNumberGetAttrOffset(column->attno);
+
+				if (column->compressed.lazy || column->compressed.isnull ||
+					DECOMPRESSED_COLUMN_IS_NULL(values, row))
+				{
+					slot->tts_values[attr] = (Datum) 0;
+					slot->tts_isnull[attr] = true;
+				}
+				else
+				{
+					slot->tts_values[attr] = decompressed_column_get_datum(values, row);
+					slot->tts_isnull[attr] = false;
+				}
+				break;
+			}
+			case SEGMENTBY_COLUMN:
+				attr = AttrNumberGetAttrOffset(column->attno);
+				slot->tts_values[attr] = column->segmentby.value;
+				slot->tts_isnull[attr] = column->segmentby.isnull;
+				break;
+			case COUNT_COLUMN:
+			case SEQUENCE_NUM_COLUMN:
+			case SEGMENT_META_COLUMN:
+				break;
+		}
+	}
+
+	ExecStoreVirtualTuple(slot);
+
+	return slot;
+}
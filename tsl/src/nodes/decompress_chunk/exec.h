@@ -16,6 +16,7 @@
 
 #define DECOMPRESS_CHUNK_COUNT_ID -9
 #define DECOMPRESS_CHUNK_SEQUENCE_NUM_ID -10
+#define DECOMPRESS_CHUNK_SEGMENT_META_ID -11
 
 extern Node *decompress_chunk_state_create(CustomScan *cscan);
 
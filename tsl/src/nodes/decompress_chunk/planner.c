@@ -6,6 +6,7 @@
 
 #include <postgres.h>
 #include <access/sysattr.h>
+#include <catalog/pg_aggregate.h>
 #include <catalog/pg_namespace.h>
 #include <catalog/pg_operator.h>
 #include <nodes/bitmapset.h>
@@ -24,9 +25,13 @@
 #include <optimizer/var.h>
 #include <parser/parsetree.h>
 #include <utils/builtins.h>
+#include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
+#include <utils/syscache.h>
 #include <utils/typcache.h>
 
 #include "compat.h"
+#include "compression/compression.h"
 #include "compression/create.h"
 #include "nodes/decompress_chunk/decompress_chunk.h"
 #include "nodes/decompress_chunk/planner.h"
@@ -34,6 +39,7 @@
 #include "planner_import.h"
 #include "guc.h"
 #include "custom_type_cache.h"
+#include "utils.h"
 
 static CustomScanMethods decompress_chunk_plan_methods = {
 	.CustomName = "DecompressChunk",
@@ -110,19 +116,60 @@ make_compressed_scan_targetentry(DecompressChunkPath *path, AttrNumber ht_attno,
 	return makeTargetEntry((Expr *) scan_var, tle_index, NULL, false);
 }
 
+/*
+ * Find the columns of the hypertable that the scan has to produce.
+ *
+ * selectedCols of the hypertable RangeTblEntry contains every column the query
+ * references anywhere, so we use the columns of the chunk that are needed
+ * above the scan or by its quals instead. Compressed columns that are not in
+ * this set are neither fetched from TOAST nor decompressed. The attnos are
+ * translated to the hypertable and offset by FirstLowInvalidHeapAttributeNumber
+ * like in selectedCols.
+ */
+static Bitmapset *
+build_scan_attrs_used(DecompressChunkPath *path, List *tlist, List *quals)
+{
+	Index chunk_relid = path->info->chunk_rel->relid;
+	Bitmapset *chunk_attrs = NULL;
+	Bitmapset *attrs_used = NULL;
+	int bit;
+
+	pull_varattnos((Node *) path->info->chunk_rel->reltarget->exprs, chunk_relid, &chunk_attrs);
+	pull_varattnos((Node *) tlist, chunk_relid, &chunk_attrs);
+	pull_varattnos((Node *) quals, chunk_relid, &chunk_attrs);
+
+	for (bit = bms_next_member(chunk_attrs, -1); bit >= 0; bit = bms_next_member(chunk_attrs, bit))
+	{
+		AttrNumber chunk_attno = bit + FirstLowInvalidHeapAttributeNumber;
+		char *attname;
+
+		/* system columns and whole row references have the same attno in the hypertable */
+		if (chunk_attno <= 0)
+		{
+			attrs_used = bms_add_member(attrs_used, bit);
+			continue;
+		}
+
+		attname = get_attname_compat(path->info->chunk_rte->relid, chunk_attno, false);
+		attrs_used =
+			bms_add_member(attrs_used,
+						   get_attnum(path->info->ht_rte->relid, attname) -
+							   FirstLowInvalidHeapAttributeNumber);
+	}
+
+	return attrs_used;
+}
+
 /*
  * build targetlist for scan on compressed chunk
  *
- * Since we do not adjust selectedCols in RangeTblEntry for chunks
- * we use selectedCols from the hypertable RangeTblEntry to
- * build the target list for the compressed chunk and adjust
- * attno accordingly
+ * The columns are given with hypertable attnos, see build_scan_attrs_used(),
+ * and adjusted to the compressed chunk here
  */
 static List *
-build_scan_tlist(DecompressChunkPath *path)
+build_scan_tlist(DecompressChunkPath *path, Bitmapset *attrs_used)
 {
 	List *scan_tlist = NIL;
-	Bitmapset *attrs_used = path->info->ht_rte->selectedCols;
 	TargetEntry *tle;
 	int bit;
 
@@ -200,6 +247,177 @@ build_scan_tlist(DecompressChunkPath *path)
 	return scan_tlist;
 }
 
+/*
+ * build the scan tuple of DecompressChunk in aggregation mode
+ *
+ * The scan tuple has the columns of the chunk, so the quals can be evaluated
+ * on it, followed by the partial aggregates that the scan computes. Dropped
+ * columns are filled in with a NULL to keep the attnos of the chunk.
+ */
+static List *
+build_aggregate_scan_tlist(DecompressChunkPath *path, List *tlist)
+{
+	RangeTblEntry *chunk_rte = path->info->chunk_rte;
+	Index chunk_relid = path->info->chunk_rel->relid;
+	List *scan_tlist = NIL;
+	AttrNumber chunk_attno = 0;
+	ListCell *lc;
+
+	foreach (lc, chunk_rte->eref->colnames)
+	{
+		char *colname = strVal(lfirst(lc));
+		Expr *expr;
+
+		chunk_attno++;
+
+		/* dropped columns have empty string */
+		if (strlen(colname) > 0)
+		{
+			Oid typid, collid;
+			int32 typmod;
+
+			get_atttypetypmodcoll(chunk_rte->relid, chunk_attno, &typid, &typmod, &collid);
+			expr = (Expr *) makeVar(chunk_relid, chunk_attno, typid, typmod, collid, 0);
+		}
+		else
+		{
+			expr = (Expr *) makeNullConst(INT4OID, -1, InvalidOid);
+			colname = NULL;
+		}
+
+		scan_tlist = lappend(scan_tlist, makeTargetEntry(expr, chunk_attno, colname, false));
+	}
+
+	/* the grouping columns are taken from the columns of the chunk */
+	foreach (lc, tlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		if (!IsA(tle->expr, Aggref))
+			continue;
+
+		scan_tlist = lappend(scan_tlist,
+							 makeTargetEntry(copyObject(tle->expr),
+											 list_length(scan_tlist) + 1,
+											 NULL,
+											 false));
+	}
+
+	return scan_tlist;
+}
+
+/*
+ * Find the segment metadata column that has the result of a min or max
+ * aggregate for every batch, i.e., min() or max() of an order by or
+ * compress_minmax column with the collation of the column.
+ */
+static char *
+aggregate_segment_meta_name(DecompressChunkPath *path, Aggref *aggref)
+{
+	FormData_hypertable_compression *info;
+	TypeCacheEntry *tce;
+	HeapTuple tuple;
+	Oid sortop;
+	Var *var;
+
+	if (aggref->args == NIL)
+		return NULL;
+
+	var = castNode(Var, castNode(TargetEntry, linitial(aggref->args))->expr);
+	if (aggref->inputcollid != var->varcollid)
+		return NULL;
+
+	info = get_column_compressioninfo(path->info->hypertable_compression_info,
+									  get_attname_compat(path->info->chunk_rte->relid,
+														 var->varattno,
+														 false));
+	if (info->orderby_column_index <= 0 && info->minmax_column_index <= 0)
+		return NULL;
+
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for aggregate %u", aggref->aggfnoid);
+	sortop = ((Form_pg_aggregate) GETSTRUCT(tuple))->aggsortop;
+	ReleaseSysCache(tuple);
+
+	if (!OidIsValid(sortop))
+		return NULL;
+
+	tce = lookup_type_cache(var->vartype, TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+	if (sortop == tce->lt_opr)
+		return compression_column_segment_min_name(info);
+	if (sortop == tce->gt_opr)
+		return compression_column_segment_max_name(info);
+
+	return NULL;
+}
+
+static TargetEntry *
+make_compressed_scan_segment_meta_targetentry(DecompressChunkPath *path, char *column_name,
+											  Var *var, int tle_index)
+{
+	Var *scan_var;
+	AttrNumber compressed_attno = get_attnum(path->info->compressed_rte->relid, column_name);
+	if (compressed_attno == InvalidAttrNumber)
+		elog(ERROR, "lookup failed for column \"%s\"", column_name);
+
+	/* segment metadata has the type of the column */
+	scan_var = makeVar(path->info->compressed_rel->relid,
+					   compressed_attno,
+					   var->vartype,
+					   var->vartypmod,
+					   var->varcollid,
+					   0);
+	path->varattno_map = lappend_int(path->varattno_map, DECOMPRESS_CHUNK_SEGMENT_META_ID);
+
+	return makeTargetEntry((Expr *) scan_var, tle_index, NULL, false);
+}
+
+/*
+ * Add the segment metadata that DecompressChunk computes min and max
+ * aggregates from to the target list of the compressed scan. Returns the
+ * attno in the compressed scan tuple for every aggregate, or 0 if the
+ * aggregate is computed from the decompressed values.
+ *
+ * The metadata covers all rows of a batch, so it can only be used if all rows
+ * of the batches are aggregated.
+ */
+static List *
+build_aggregate_segment_meta(DecompressChunkPath *path, List *tlist, bool use_meta,
+							 List **scan_tlist)
+{
+	List *meta_attnos = NIL;
+	ListCell *lc;
+
+	foreach (lc, tlist)
+	{
+		Expr *expr = lfirst_node(TargetEntry, lc)->expr;
+		char *meta_name;
+		TargetEntry *tle;
+		Var *var;
+
+		if (!IsA(expr, Aggref))
+			continue;
+
+		meta_name = use_meta ? aggregate_segment_meta_name(path, castNode(Aggref, expr)) : NULL;
+		if (meta_name == NULL)
+		{
+			meta_attnos = lappend_int(meta_attnos, 0);
+			continue;
+		}
+
+		var = castNode(Var, castNode(TargetEntry, linitial(castNode(Aggref, expr)->args))->expr);
+		tle = make_compressed_scan_segment_meta_targetentry(path,
+															meta_name,
+															var,
+															list_length(*scan_tlist) + 1);
+		*scan_tlist = lappend(*scan_tlist, tle);
+		meta_attnos = lappend_int(meta_attnos, tle->resno);
+	}
+
+	return meta_attnos;
+}
+
 /* replace vars that reference the compressed table with ones that reference the
  * uncompressed one. Based on replace_nestloop_params
  */
@@ -314,6 +532,158 @@ clause_has_compressed_attrs(Node *node, void *context)
 	return expression_tree_walker(node, clause_has_compressed_attrs, context);
 }
 
+typedef struct JsonbKeysContext
+{
+	Index ht_relid;
+	int sublevels_up;
+	bool whole_row;
+	/* hypertable attnos of the columns that are used other than by accessing a key */
+	Bitmapset *whole_columns;
+	/* the keys accessed of every column as Lists of String, indexed by hypertable attno */
+	List **keys;
+} JsonbKeysContext;
+
+/*
+ * Record an access of a constant key of a hypertable column, i.e., `col -> 'key'`,
+ * `col ->> 'key'` or `col ? 'key'`. Returns false if the function and
+ * arguments are not such an access.
+ */
+static bool
+jsonb_keys_add_access(JsonbKeysContext *context, Oid funcid, List *args)
+{
+	Var *var;
+	Const *key;
+	char *key_str;
+	ListCell *lc;
+
+	if (funcid != F_JSONB_OBJECT_FIELD && funcid != F_JSONB_OBJECT_FIELD_TEXT &&
+		funcid != F_JSONB_EXISTS)
+		return false;
+
+	if (list_length(args) != 2 || !IsA(linitial(args), Var) || !IsA(lsecond(args), Const))
+		return false;
+
+	var = (Var *) linitial(args);
+	key = (Const *) lsecond(args);
+	if (var->varno != context->ht_relid || var->varlevelsup != context->sublevels_up ||
+		var->varattno <= 0 || key->constisnull || key->consttype != TEXTOID)
+		return false;
+
+	key_str = TextDatumGetCString(key->constvalue);
+	foreach (lc, context->keys[var->varattno])
+	{
+		if (strcmp(strVal(lfirst(lc)), key_str) == 0)
+			return true;
+	}
+
+	context->keys[var->varattno] = lappend(context->keys[var->varattno], makeString(key_str));
+	return true;
+}
+
+static bool
+jsonb_keys_walker(Node *node, JsonbKeysContext *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Var))
+	{
+		Var *var = castNode(Var, node);
+
+		if (var->varno == context->ht_relid && var->varlevelsup == context->sublevels_up)
+		{
+			if (var->varattno == 0)
+				context->whole_row = true;
+			else if (var->varattno > 0)
+				context->whole_columns = bms_add_member(context->whole_columns, var->varattno);
+		}
+		return false;
+	}
+
+	if (IsA(node, OpExpr))
+	{
+		OpExpr *op = castNode(OpExpr, node);
+
+		set_opfuncid(op);
+		if (jsonb_keys_add_access(context, op->opfuncid, op->args))
+			return false;
+	}
+
+	if (IsA(node, FuncExpr))
+	{
+		FuncExpr *func = castNode(FuncExpr, node);
+
+		if (jsonb_keys_add_access(context, func->funcid, func->args))
+			return false;
+	}
+
+	if (IsA(node, Query))
+	{
+		bool result;
+
+		context->sublevels_up++;
+		result = query_tree_walker((Query *) node, jsonb_keys_walker, context, 0);
+		context->sublevels_up--;
+		return result;
+	}
+
+	return expression_tree_walker(node, jsonb_keys_walker, context);
+}
+
+/*
+ * Find the jsonb compressed columns that the query only uses to access
+ * constant keys, e.g., with `payload->>'temp'`. They are decompressed with
+ * only these keys, which skips the streams of all other keys. Returns a List
+ * with a List per column of the chunk attno followed by the keys.
+ */
+static List *
+build_jsonb_keys(PlannerInfo *root, CompressionInfo *info)
+{
+	JsonbKeysContext context = { 0 };
+	List *jsonb_keys = NIL;
+	bool has_jsonb_columns = false;
+	ListCell *lc;
+
+	foreach (lc, info->hypertable_compression_info)
+	{
+		FormData_hypertable_compression *fd = lfirst(lc);
+		has_jsonb_columns |= fd->algo_id == COMPRESSION_ALGORITHM_JSONB;
+	}
+
+	if (!has_jsonb_columns || root->parse->commandType != CMD_SELECT)
+		return NIL;
+
+	context.ht_relid = ts_get_appendrelinfo(root, info->chunk_rel->relid, false)->parent_relid;
+	context.keys = palloc0(sizeof(List *) * (list_length(info->ht_rte->eref->colnames) + 1));
+
+	query_tree_walker(root->parse, jsonb_keys_walker, &context, 0);
+	/* the hypertable can be a member of a flattened UNION ALL */
+	jsonb_keys_walker((Node *) root->append_rel_list, &context);
+
+	if (context.whole_row)
+		return NIL;
+
+	foreach (lc, info->hypertable_compression_info)
+	{
+		FormData_hypertable_compression *fd = lfirst(lc);
+		AttrNumber ht_attno;
+
+		if (fd->algo_id != COMPRESSION_ALGORITHM_JSONB)
+			continue;
+
+		ht_attno = get_attnum(info->ht_rte->relid, NameStr(fd->attname));
+		if (context.keys[ht_attno] == NIL || bms_is_member(ht_attno, context.whole_columns))
+			continue;
+
+		jsonb_keys =
+			lappend(jsonb_keys,
+					lcons(makeInteger(get_attnum(info->chunk_rte->relid, NameStr(fd->attname))),
+						  context.keys[ht_attno]));
+	}
+
+	return jsonb_keys;
+}
+
 Plan *
 decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path, List *tlist,
 							 List *clauses, List *custom_plans)
@@ -323,6 +693,7 @@ decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *pat
 	Scan *compressed_scan = linitial(custom_plans);
 	Path *compressed_path = linitial(path->custom_paths);
 	List *settings;
+	List *aggregate_meta = NIL;
 
 	Assert(list_length(custom_plans) == 1);
 	Assert(list_length(path->custom_paths) == 1);
@@ -406,7 +777,21 @@ decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *pat
 	cscan->scan.plan.qual =
 		(List *) replace_compressed_vars((Node *) cscan->scan.plan.qual, dcpath->info);
 
-	compressed_scan->plan.targetlist = build_scan_tlist(dcpath);
+	compressed_scan->plan.targetlist =
+		build_scan_tlist(dcpath, build_scan_attrs_used(dcpath, tlist, cscan->scan.plan.qual));
+
+	if (dcpath->aggregate)
+	{
+		/* min and max can be taken from the segment metadata if no rows are filtered */
+		bool use_meta = cscan->scan.plan.qual == NIL && !IsA(compressed_scan, IndexOnlyScan);
+
+		cscan->custom_scan_tlist = build_aggregate_scan_tlist(dcpath, tlist);
+		aggregate_meta = build_aggregate_segment_meta(dcpath,
+													  tlist,
+													  use_meta,
+													  &compressed_scan->plan.targetlist);
+	}
+
 	if (!pathkeys_contained_in(dcpath->compressed_pathkeys, compressed_path->pathkeys))
 	{
 		List *compressed_pks = dcpath->compressed_pathkeys;
@@ -422,10 +807,14 @@ decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *pat
 
 	Assert(list_length(custom_plans) == 1);
 
-	settings = list_make3_int(dcpath->info->hypertable_id,
+	settings = list_make4_int(dcpath->info->hypertable_id,
 							  dcpath->info->chunk_rte->relid,
-							  dcpath->reverse);
-	cscan->custom_private = list_make2(settings, dcpath->varattno_map);
+							  dcpath->reverse,
+							  dcpath->aggregate);
+	cscan->custom_private = list_make4(settings,
+									   dcpath->varattno_map,
+									   build_jsonb_keys(root, dcpath->info),
+									   aggregate_meta);
 
 	return &cscan->scan.plan;
 }
@@ -5,6 +5,7 @@
  */
 
 #include <postgres.h>
+#include <access/hash.h>
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
 #include <nodes/relation.h>
@@ -16,9 +17,11 @@
 #include <parser/parsetree.h>
 #include <parser/parse_func.h>
 #include <utils/builtins.h>
+#include <utils/lsyscache.h>
 #include <utils/typcache.h>
 
 #include "compat.h"
+#include "extension_constants.h"
 #include "nodes/decompress_chunk/decompress_chunk.h"
 #include "nodes/decompress_chunk/qual_pushdown.h"
 #include "hypertable_compression.h"
@@ -180,8 +183,9 @@ get_compression_info_for_column_with_segment_meta(QualPushdownContext *context,
 	v = (Var *) expr;
 
 	compression_info = get_compression_info_from_var(context, v);
-	/* Only order by vars have segment meta */
-	if (compression_info == NULL || compression_info->orderby_column_index <= 0)
+	/* Only order by and compress_minmax vars have segment meta */
+	if (compression_info == NULL ||
+		(compression_info->orderby_column_index <= 0 && compression_info->minmax_column_index <= 0))
 		return NULL;
 
 	return compression_info;
@@ -328,6 +332,238 @@ pushdown_op_to_segment_meta_min_max(QualPushdownContext *context, List *expr_arg
 	}
 }
 
+static inline FormData_hypertable_compression *
+get_compression_info_for_column_with_bloom(QualPushdownContext *context, Expr *expr)
+{
+	FormData_hypertable_compression *compression_info;
+
+	if (!IsA(expr, Var))
+		return NULL;
+
+	compression_info = get_compression_info_from_var(context, (Var *) expr);
+	if (compression_info == NULL || compression_info->bloom_column_index <= 0)
+		return NULL;
+
+	return compression_info;
+}
+
+/*
+ * Check that op is an equality whose operands hash the same as values of the
+ * bloom column, so that the bloom filter can be probed with the other operand.
+ */
+static bool
+is_bloom_equality_op(Var *var, Oid op_oid, Oid op_collation, Oid other_type)
+{
+	TypeCacheEntry *tce;
+
+	if (!OidIsValid(op_oid) || !op_strict(op_oid))
+		return false;
+
+	/* same reasoning as for the min/max collation */
+	if (var->varcollid != op_collation)
+		return false;
+
+	tce = lookup_type_cache(var->vartype, TYPECACHE_HASH_OPFAMILY | TYPECACHE_HASH_PROC);
+	if (!OidIsValid(tce->hash_opf) ||
+		get_op_opfamily_strategy(op_oid, tce->hash_opf) != HTEqualStrategyNumber)
+		return false;
+
+	return lookup_type_cache(other_type, TYPECACHE_HASH_PROC)->hash_proc == tce->hash_proc;
+}
+
+static Expr *
+make_segment_meta_bloom_funcexpr(QualPushdownContext *context,
+								 FormData_hypertable_compression *compression_info, Var *var,
+								 const char *funcname, Oid argtype, Expr *probe)
+{
+	Oid argtypes[] = { BYTEAOID, argtype };
+	Oid funcoid;
+	AttrNumber bloom_attno = get_attnum(context->compressed_rte->relid,
+										compression_column_segment_bloom_name(compression_info));
+
+	if (bloom_attno == InvalidAttrNumber)
+		elog(ERROR, "could not find meta column");
+
+	funcoid = LookupFuncName(list_make2(makeString(INTERNAL_SCHEMA_NAME), makeString(funcname)),
+							 lengthof(argtypes),
+							 argtypes,
+							 false);
+
+	return (Expr *) makeFuncExpr(funcoid,
+								 BOOLOID,
+								 list_make2(makeVar(context->compressed_rel->relid,
+													bloom_attno,
+													BYTEAOID,
+													-1,
+													InvalidOid,
+													0),
+											copyObject(probe)),
+								 InvalidOid,
+								 var->varcollid,
+								 COERCE_EXPLICIT_CALL);
+}
+
+/*
+ * Push down var = expr on a compress_bloom column to a probe of the bloom
+ * filter: segments whose filter does not contain expr cannot match.
+ */
+static Expr *
+pushdown_op_to_segment_meta_bloom(QualPushdownContext *context, List *expr_args, Oid op_oid,
+								  Oid op_collation)
+{
+	Expr *leftop, *rightop, *expr;
+	Var *var;
+	FormData_hypertable_compression *compression_info;
+
+	if (list_length(expr_args) != 2)
+		return NULL;
+
+	leftop = linitial(expr_args);
+	rightop = lsecond(expr_args);
+
+	if (IsA(leftop, RelabelType))
+		leftop = ((RelabelType *) leftop)->arg;
+	if (IsA(rightop, RelabelType))
+		rightop = ((RelabelType *) rightop)->arg;
+
+	if ((compression_info = get_compression_info_for_column_with_bloom(context, leftop)) != NULL)
+	{
+		var = (Var *) leftop;
+		expr = rightop;
+	}
+	else if ((compression_info = get_compression_info_for_column_with_bloom(context, rightop)) !=
+			 NULL)
+	{
+		var = (Var *) rightop;
+		expr = leftop;
+	}
+	else
+		return NULL;
+
+	if (!is_bloom_equality_op(var, op_oid, op_collation, exprType((Node *) expr)))
+		return NULL;
+
+	expr = get_pushdownsafe_expr(context, expr);
+	if (expr == NULL)
+		return NULL;
+
+	return make_segment_meta_bloom_funcexpr(context,
+											compression_info,
+											var,
+											"segment_meta_bloom_contains",
+											ANYELEMENTOID,
+											expr);
+}
+
+/* Push down var = ANY(array) on a compress_bloom column to a bloom filter probe */
+static Expr *
+pushdown_saop_to_segment_meta_bloom(QualPushdownContext *context, ScalarArrayOpExpr *saop)
+{
+	Expr *leftop, *array;
+	Oid element_type;
+	FormData_hypertable_compression *compression_info;
+
+	if (!saop->useOr || list_length(saop->args) != 2)
+		return NULL;
+
+	leftop = linitial(saop->args);
+	array = lsecond(saop->args);
+
+	if (IsA(leftop, RelabelType))
+		leftop = ((RelabelType *) leftop)->arg;
+
+	compression_info = get_compression_info_for_column_with_bloom(context, leftop);
+	if (compression_info == NULL)
+		return NULL;
+
+	element_type = get_element_type(exprType((Node *) array));
+	if (!OidIsValid(element_type) ||
+		!is_bloom_equality_op((Var *) leftop, saop->opno, saop->inputcollid, element_type))
+		return NULL;
+
+	array = get_pushdownsafe_expr(context, array);
+	if (array == NULL)
+		return NULL;
+
+	return make_segment_meta_bloom_funcexpr(context,
+											compression_info,
+											(Var *) leftop,
+											"segment_meta_bloom_contains_any",
+											ANYARRAYOID,
+											array);
+}
+
+/*
+ * Push down IS [NOT] NULL on a compress_minmax column to its NULL count:
+ * a batch can only contain NULLs if its NULL count is greater than zero, and
+ * non-NULL values if its NULL count is less than its row count.
+ */
+static Expr *
+pushdown_nulltest_to_segment_meta_null_count(QualPushdownContext *context, NullTest *nulltest)
+{
+	FormData_hypertable_compression *compression_info;
+	TypeCacheEntry *tce;
+	Var *null_count_var;
+	Expr *compare_to;
+	AttrNumber null_count_attno;
+	Oid opno;
+
+	if (nulltest->argisrow)
+		return NULL;
+
+	compression_info = get_compression_info_for_column_with_segment_meta(context, nulltest->arg);
+
+	/* order by columns do not have a NULL count */
+	if (compression_info == NULL || compression_info->minmax_column_index <= 0)
+		return NULL;
+
+	null_count_attno = get_attnum(context->compressed_rte->relid,
+								  compression_column_segment_null_count_name(compression_info));
+	if (null_count_attno == InvalidAttrNumber)
+		elog(ERROR, "could not find meta column");
+
+	null_count_var =
+		makeVar(context->compressed_rel->relid, null_count_attno, INT4OID, -1, InvalidOid, 0);
+	tce = lookup_type_cache(INT4OID, TYPECACHE_BTREE_OPFAMILY);
+
+	if (nulltest->nulltesttype == IS_NULL)
+	{
+		/* var IS NULL implies null_count > 0 */
+		opno = get_opfamily_member(tce->btree_opf, INT4OID, INT4OID, BTGreaterStrategyNumber);
+		compare_to = (Expr *) makeConst(INT4OID,
+										-1,
+										InvalidOid,
+										sizeof(int32),
+										Int32GetDatum(0),
+										false,
+										true);
+	}
+	else
+	{
+		/* var IS NOT NULL implies null_count < count */
+		AttrNumber count_attno =
+			get_attnum(context->compressed_rte->relid, COMPRESSION_COLUMN_METADATA_COUNT_NAME);
+
+		if (count_attno == InvalidAttrNumber)
+			elog(ERROR, "could not find meta column");
+
+		opno = get_opfamily_member(tce->btree_opf, INT4OID, INT4OID, BTLessStrategyNumber);
+		compare_to = (Expr *)
+			makeVar(context->compressed_rel->relid, count_attno, INT4OID, -1, InvalidOid, 0);
+	}
+
+	if (!OidIsValid(opno))
+		return NULL;
+
+	return make_opclause(opno,
+						 BOOLOID,
+						 false,
+						 (Expr *) null_count_var,
+						 compare_to,
+						 InvalidOid,
+						 InvalidOid);
+}
+
 static Node *
 modify_expression(Node *node, QualPushdownContext *context)
 {
@@ -345,6 +581,22 @@ modify_expression(Node *node, QualPushdownContext *context)
 															   opexpr->args,
 															   opexpr->opno,
 															   opexpr->inputcollid);
+				Expr *bloom_pd = pushdown_op_to_segment_meta_bloom(context,
+																   opexpr->args,
+																   opexpr->opno,
+																   opexpr->inputcollid);
+
+				/* check both the min/max and the bloom filter if a column has both */
+				if (pd != NULL && bloom_pd != NULL)
+				{
+					if (and_clause((Node *) pd))
+						pd = make_andclause(lappend(((BoolExpr *) pd)->args, bloom_pd));
+					else
+						pd = make_andclause(list_make2(pd, bloom_pd));
+				}
+				else if (bloom_pd != NULL)
+					pd = bloom_pd;
+
 				if (pd != NULL)
 				{
 					context->needs_recheck = true;
@@ -355,10 +607,34 @@ modify_expression(Node *node, QualPushdownContext *context)
 			/* opexpr will still be checked for segment by columns */
 			break;
 		}
+		case T_NullTest:
+		{
+			Expr *pd = pushdown_nulltest_to_segment_meta_null_count(context, (NullTest *) node);
+
+			if (pd != NULL)
+			{
+				context->needs_recheck = true;
+				/* pd is on the compressed table so do not mutate further */
+				return (Node *) pd;
+			}
+			/* the null test will still be checked for segment by columns */
+			break;
+		}
 		case T_ScalarArrayOpExpr:
+		{
+			Expr *pd = pushdown_saop_to_segment_meta_bloom(context, (ScalarArrayOpExpr *) node);
+
+			if (pd != NULL)
+			{
+				context->needs_recheck = true;
+				/* pd is on the compressed table so do not mutate further */
+				return (Node *) pd;
+			}
+			/* the array op will still be checked for segment by columns */
+			break;
+		}
 		case T_List:
 		case T_Const:
-		case T_NullTest:
 		case T_Param:
 			break;
 		case T_Var:
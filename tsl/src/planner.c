@@ -21,7 +21,11 @@ tsl_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage, RelOptIn
 							RelOptInfo *output_rel)
 {
 	if (UPPERREL_GROUP_AGG == stage)
+	{
+		if (ts_guc_enable_transparent_decompression && ts_guc_enable_compressed_aggregation)
+			ts_decompress_chunk_generate_agg_paths(root, input_rel, output_rel);
 		plan_add_gapfill(root, output_rel);
+	}
 	if (UPPERREL_WINDOW == stage)
 	{
 		if (IsA(linitial(input_rel->pathlist), CustomPath))
@@ -37,9 +41,9 @@ tsl_set_rel_pathlist_query(PlannerInfo *root, RelOptInfo *rel, Index rti, RangeT
 		rel->reloptkind == RELOPT_OTHER_MEMBER_REL && TS_HYPERTABLE_HAS_COMPRESSION(ht) &&
 		rel->fdw_private != NULL && ((TimescaleDBPrivate *) rel->fdw_private)->compressed)
 	{
-		Chunk *chunk = ts_chunk_get_by_relid(rte->relid, 0, true);
+		Chunk *chunk = ts_planner_chunk_fetch(root, rel);
 
-		if (chunk->fd.compressed_chunk_id > 0)
+		if (chunk != NULL && chunk->fd.compressed_chunk_id > 0)
 			ts_decompress_chunk_generate_paths(root, rel, ht, chunk);
 	}
 }
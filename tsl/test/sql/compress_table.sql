@@ -18,7 +18,7 @@ CREATE OR REPLACE FUNCTION ts_decompress_table(in_table REGCLASS, out_table REGC
 CREATE FUNCTION ord(TEXT, INT, INT, BOOL = true, BOOL = false)
     RETURNS _timescaledb_catalog.hypertable_compression
     AS $$
-        SELECT (1, $1, $2::SMALLINT, 0, $3::SMALLINT+1, $4, $5)::_timescaledb_catalog.hypertable_compression
+        SELECT (1, $1, $2::SMALLINT, 0, $3::SMALLINT+1, $4, $5, 0, 0)::_timescaledb_catalog.hypertable_compression
     $$ LANGUAGE SQL IMMUTABLE PARALLEL SAFE;
 
 -- column name, idx, asc, nulls_first
@@ -26,7 +26,7 @@ CREATE FUNCTION ord(TEXT, INT, INT, BOOL = true, BOOL = false)
 CREATE FUNCTION seg(TEXT, INT, BOOL = true, BOOL = false)
     RETURNS _timescaledb_catalog.hypertable_compression
     AS $$
-        SELECT (1, $1, 0, $2::SMALLINT+1, 0, $3, $4)::_timescaledb_catalog.hypertable_compression
+        SELECT (1, $1, 0, $2::SMALLINT+1, 0, $3, $4, 0, 0)::_timescaledb_catalog.hypertable_compression
     $$ LANGUAGE SQL IMMUTABLE PARALLEL SAFE;
 
 -- column name, algorithm
@@ -34,7 +34,7 @@ CREATE FUNCTION seg(TEXT, INT, BOOL = true, BOOL = false)
 CREATE FUNCTION com(TEXT, INT)
     RETURNS _timescaledb_catalog.hypertable_compression
     AS $$
-        SELECT (1, $1, $2::SMALLINT, 0, 0, true, false)::_timescaledb_catalog.hypertable_compression
+        SELECT (1, $1, $2::SMALLINT, 0, 0, true, false, 0, 0)::_timescaledb_catalog.hypertable_compression
     $$ LANGUAGE SQL IMMUTABLE PARALLEL SAFE;
 
 SELECT * FROM ord('time', 4, 0);
@@ -2,6 +2,13 @@
 -- Please see the included NOTICE for copyright information and
 -- LICENSE-TIMESCALE for a copy of the license.
 
+\c :TEST_DBNAME :ROLE_SUPERUSER
+CREATE OR REPLACE FUNCTION ts_test_compression_parallel_stats(OUT chunks BIGINT, OUT workers BIGINT)
+AS :TSL_MODULE_PATHNAME LANGUAGE C VOLATILE;
+CREATE OR REPLACE FUNCTION ts_test_compression_sorted_rows_stats(OUT index_scans BIGINT, OUT sorts BIGINT)
+AS :TSL_MODULE_PATHNAME LANGUAGE C VOLATILE;
+\c :TEST_DBNAME :ROLE_DEFAULT_PERM_USER
+
 SET timescaledb.enable_transparent_decompression to OFF;
 
 \ir include/rand_generator.sql
@@ -261,3 +268,575 @@ EXPLAIN (costs off) SELECT * FROM test_collation WHERE val_2 < 'a' COLLATE "POSI
 --cannot pushdown when op collation does not match column's collation since min/max used different collation than what op needs
 EXPLAIN (costs off) SELECT * FROM test_collation WHERE val_1 < 'a' COLLATE "POSIX";
 EXPLAIN (costs off) SELECT * FROM test_collation WHERE val_2 < 'a' COLLATE "C";
+
+--min/max and NULL count metadata for columns that are not order by columns
+CREATE TABLE test_minmax(time timestamptz NOT NULL, device_id int, temp float8, note text);
+select table_name from create_hypertable('test_minmax', 'time', chunk_time_interval=> '1 year'::interval);
+\set ON_ERROR_STOP 0
+alter table test_minmax set (timescaledb.compress, timescaledb.compress_minmax = 'temp, nonexistent');
+alter table test_minmax set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_minmax = 'device_id');
+\set ON_ERROR_STOP 1
+--time is an order by column, so it already has min/max metadata and is skipped
+alter table test_minmax set (timescaledb.compress, timescaledb.compress_minmax = 'temp, note, time');
+
+select hc.attname, hc.orderby_column_index, hc.minmax_column_index
+from _timescaledb_catalog.hypertable_compression hc, _timescaledb_catalog.hypertable ht
+where ht.id = hc.hypertable_id and ht.table_name like 'test_minmax'
+ORDER BY hc.attname;
+
+select attname, atttypid::regtype from pg_attribute
+where attrelid = '_timescaledb_internal._compressed_hypertable_12'::regclass and attnum > 0
+order by attnum;
+
+insert into test_minmax
+select '2018-01-01'::timestamptz + i * interval '1 hour', 1,
+       CASE WHEN i = 24 THEN NULL ELSE i END,
+       CASE WHEN i % 2 = 0 THEN NULL ELSE 'note ' || i END
+from generate_series(1, 24) i;
+
+SELECT compress_chunk(ch1.schema_name|| '.' || ch1.table_name)
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht where ch1.hypertable_id = ht.id
+and ht.table_name like 'test_minmax' ORDER BY ch1.id;
+
+select _ts_meta_count, _ts_meta_col_min_1, _ts_meta_col_max_1, _ts_meta_col_null_count_1, _ts_meta_col_null_count_2
+from _timescaledb_internal.compress_hyper_12_32_chunk;
+
+--predicates on compress_minmax columns are pushed down to the metadata
+EXPLAIN (costs off) SELECT * FROM test_minmax WHERE temp > 20;
+EXPLAIN (costs off) SELECT * FROM test_minmax WHERE temp = 12;
+EXPLAIN (costs off) SELECT * FROM test_minmax WHERE note IS NULL;
+EXPLAIN (costs off) SELECT * FROM test_minmax WHERE note IS NOT NULL;
+--no metadata for device_id
+EXPLAIN (costs off) SELECT * FROM test_minmax WHERE device_id > 1;
+
+SELECT count(*) FROM test_minmax WHERE temp > 20;
+SELECT count(*) FROM test_minmax WHERE temp = 12;
+SELECT count(*) FROM test_minmax WHERE temp > 100;
+SELECT count(*) FROM test_minmax WHERE temp IS NULL;
+SELECT count(*) FROM test_minmax WHERE note IS NULL;
+SELECT count(*) FROM test_minmax WHERE note IS NOT NULL;
+
+--bloom filter metadata for equality lookups
+CREATE TABLE test_bloom(time timestamptz NOT NULL, device_id int, trace_id text, val int);
+select table_name from create_hypertable('test_bloom', 'time', chunk_time_interval=> '1 year'::interval);
+\set ON_ERROR_STOP 0
+alter table test_bloom set (timescaledb.compress, timescaledb.compress_bloom = 'trace_id, nonexistent');
+alter table test_bloom set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_bloom = 'device_id');
+\set ON_ERROR_STOP 1
+alter table test_bloom set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_bloom = 'trace_id, val');
+
+select hc.attname, hc.segmentby_column_index, hc.bloom_column_index
+from _timescaledb_catalog.hypertable_compression hc, _timescaledb_catalog.hypertable ht
+where ht.id = hc.hypertable_id and ht.table_name like 'test_bloom'
+ORDER BY hc.attname;
+
+insert into test_bloom
+select '2018-01-01'::timestamptz + i * interval '1 minute', i % 3, 'trace-' || i, i
+from generate_series(1, 600) i;
+CREATE TABLE test_bloom_rows AS SELECT * FROM test_bloom;
+
+SELECT compress_chunk(ch1.schema_name|| '.' || ch1.table_name)
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht where ch1.hypertable_id = ht.id
+and ht.table_name like 'test_bloom' ORDER BY ch1.id;
+
+--the filters are sized by the number of distinct values
+select device_id, _ts_meta_count, length(_ts_meta_bloom_1), length(_ts_meta_bloom_2)
+from _timescaledb_internal.compress_hyper_14_34_chunk ORDER BY device_id;
+
+--no false negatives, and few false positives
+SELECT count(*) FROM test_bloom_rows r, _timescaledb_internal.compress_hyper_14_34_chunk c
+WHERE r.device_id = c.device_id
+AND NOT (_timescaledb_internal.segment_meta_bloom_contains(c._ts_meta_bloom_1, r.trace_id)
+         AND _timescaledb_internal.segment_meta_bloom_contains(c._ts_meta_bloom_2, r.val));
+SELECT count(*) < 150 FROM generate_series(1, 1000) i, _timescaledb_internal.compress_hyper_14_34_chunk c
+WHERE _timescaledb_internal.segment_meta_bloom_contains(c._ts_meta_bloom_1, 'absent-' || i);
+
+--equality and = ANY on compress_bloom columns are pushed down to the filter
+EXPLAIN (costs off) SELECT * FROM test_bloom WHERE trace_id = 'trace-42';
+EXPLAIN (costs off) SELECT * FROM test_bloom WHERE val = 42;
+EXPLAIN (costs off) SELECT * FROM test_bloom WHERE trace_id = ANY(ARRAY['trace-1', 'trace-2']);
+--a bloom filter cannot answer range queries
+EXPLAIN (costs off) SELECT * FROM test_bloom WHERE val > 42;
+
+SELECT count(*) FROM test_bloom WHERE trace_id = 'trace-42';
+SELECT count(*) FROM test_bloom WHERE trace_id = 'nonexistent';
+SELECT count(*) FROM test_bloom WHERE val = 42;
+SELECT count(*) FROM test_bloom WHERE trace_id = ANY(ARRAY['trace-1', 'trace-2', NULL, 'nonexistent']);
+SELECT count(*) FROM test_bloom WHERE val = ANY(ARRAY[1, 2, 3]);
+
+--configurable and adaptive batch size
+CREATE TABLE test_batch(time timestamptz NOT NULL, device_id int, note text);
+select table_name from create_hypertable('test_batch', 'time', chunk_time_interval=> '1 year'::interval);
+\set ON_ERROR_STOP 0
+alter table test_batch set (timescaledb.compress, timescaledb.compress_batch_size = '0');
+alter table test_batch set (timescaledb.compress, timescaledb.compress_batch_size = '100001');
+alter table test_batch set (timescaledb.compress, timescaledb.compress_batch_size = 'large');
+\set ON_ERROR_STOP 1
+alter table test_batch set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_batch_size = '700');
+select s.batch_size from _timescaledb_catalog.hypertable_compression_settings s, _timescaledb_catalog.hypertable ht
+where ht.id = s.hypertable_id and ht.table_name like 'test_batch';
+\set ON_ERROR_STOP 0
+alter table test_batch set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time DESC');
+alter table test_batch set (timescaledb.compress = false, timescaledb.compress_batch_size = '100');
+\set ON_ERROR_STOP 1
+
+--the notes are random so that they do not shrink further when toasted
+insert into test_batch
+select '2018-01-01'::timestamptz + i * interval '1 minute', i % 2,
+  md5(i::text) || md5('a' || i) || md5('b' || i)
+from generate_series(1, 6000) i;
+
+SELECT compress_chunk(ch1.schema_name|| '.' || ch1.table_name)
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht where ch1.hypertable_id = ht.id
+and ht.table_name like 'test_batch' ORDER BY ch1.id;
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_batch' \gset
+SELECT device_id, count(*), min(_ts_meta_count), max(_ts_meta_count)
+FROM :COMPRESSED_CHUNK GROUP BY device_id ORDER BY device_id;
+SELECT count(*) FROM test_batch;
+
+SELECT decompress_chunk(ch1.schema_name|| '.' || ch1.table_name)
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht where ch1.hypertable_id = ht.id
+and ht.table_name like 'test_batch' ORDER BY ch1.id;
+alter table test_batch set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time DESC', timescaledb.compress_batch_size = 'adaptive');
+select s.batch_size from _timescaledb_catalog.hypertable_compression_settings s, _timescaledb_catalog.hypertable ht
+where ht.id = s.hypertable_id and ht.table_name like 'test_batch';
+
+SELECT compress_chunk(ch1.schema_name|| '.' || ch1.table_name)
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht where ch1.hypertable_id = ht.id
+and ht.table_name like 'test_batch' ORDER BY ch1.id;
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_batch' \gset
+--only the first batch of the chunk has the default size, the later ones are
+--sized to fill about 16 TOAST chunks with the widest column
+SELECT device_id, count(*) > 2 AS several_batches, bool_or(_ts_meta_count = 1000) AS default_size,
+  bool_and(_ts_meta_count < 400 AND pg_column_size(note) <= 16 * 1996)
+    FILTER (WHERE _ts_meta_count <> 1000) AS later_batches_fit
+FROM :COMPRESSED_CHUNK GROUP BY device_id ORDER BY device_id;
+SELECT count(*) FROM test_batch;
+
+--the settings are removed together with the hypertable
+DROP TABLE test_batch;
+select count(*) from _timescaledb_catalog.hypertable_compression_settings;
+
+--parallel compression partitions the segments across parallel workers
+CREATE TABLE test_parallel(time timestamptz NOT NULL, device_id int, val float);
+select table_name from create_hypertable('test_parallel', 'time', chunk_time_interval=> '1 year'::interval);
+alter table test_parallel set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id');
+insert into test_parallel
+select '2018-01-01'::timestamptz + i * interval '1 minute', nullif(i % 7, 6), i
+from generate_series(1, 20000) i;
+CREATE TABLE test_parallel_expected AS SELECT * FROM test_parallel;
+
+--parallel compression is disabled by default
+SHOW timescaledb.max_parallel_compression_workers;
+SELECT * FROM ts_test_compression_parallel_stats();
+SET min_parallel_table_scan_size = 0;
+SET timescaledb.max_parallel_compression_workers = 3;
+SELECT compress_chunk(ch1.schema_name|| '.' || ch1.table_name)
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht where ch1.hypertable_id = ht.id
+and ht.table_name like 'test_parallel' ORDER BY ch1.id;
+RESET timescaledb.max_parallel_compression_workers;
+RESET min_parallel_table_scan_size;
+--the chunk was compressed by the parallel workers
+SELECT chunks, workers BETWEEN 1 AND 3 AS workers_launched FROM ts_test_compression_parallel_stats();
+
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_parallel' \gset
+SELECT device_id, count(*), sum(_ts_meta_count)
+FROM :COMPRESSED_CHUNK GROUP BY device_id ORDER BY device_id;
+--the sequence numbers are unique within each segment
+SELECT count(*) FROM (SELECT device_id, _ts_meta_sequence_num FROM :COMPRESSED_CHUNK
+  GROUP BY device_id, _ts_meta_sequence_num HAVING count(*) > 1) duplicates;
+(SELECT * FROM test_parallel EXCEPT ALL SELECT * FROM test_parallel_expected)
+UNION ALL
+(SELECT * FROM test_parallel_expected EXCEPT ALL SELECT * FROM test_parallel);
+
+DROP TABLE test_parallel;
+DROP TABLE test_parallel_expected;
+
+--chunks reordered by an index that matches the compression order are
+--compressed in the order of the index instead of being sorted
+CREATE TABLE test_reorder(time timestamptz NOT NULL, device_id int, val float);
+select table_name from create_hypertable('test_reorder', 'time', chunk_time_interval=> '1 year'::interval);
+CREATE INDEX test_reorder_device_time_idx ON test_reorder(device_id, time DESC);
+alter table test_reorder set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time DESC');
+insert into test_reorder
+select '2018-01-01'::timestamptz + (i * 7919 % 20000) * interval '1 minute', nullif(i % 5, 4), i
+from generate_series(1, 20000) i;
+CREATE TABLE test_reorder_expected AS SELECT * FROM test_reorder;
+
+SELECT format('%I.%I', ch1.schema_name, ch1.table_name) AS "CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ht.table_name like 'test_reorder' \gset
+SELECT reorder_chunk(:'CHUNK', 'test_reorder_device_time_idx');
+--the chunk is large enough for parallel compression, but it is disabled by default
+SET min_parallel_table_scan_size = 0;
+SELECT index_scans AS "INDEX_SCANS", sorts AS "SORTS" FROM ts_test_compression_sorted_rows_stats() \gset
+SELECT compress_chunk(:'CHUNK');
+RESET min_parallel_table_scan_size;
+SELECT chunks FROM ts_test_compression_parallel_stats();
+--the rows were read through the index instead of being sorted
+SELECT index_scans - :INDEX_SCANS AS index_scans, sorts - :SORTS AS sorts
+FROM ts_test_compression_sorted_rows_stats();
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_reorder' \gset
+SELECT device_id, count(*), sum(_ts_meta_count)
+FROM :COMPRESSED_CHUNK GROUP BY device_id ORDER BY device_id;
+--the batches of every segment are in time order
+SELECT count(*) FROM (SELECT _ts_meta_min_1 < lead(_ts_meta_max_1) OVER
+  (PARTITION BY device_id ORDER BY _ts_meta_sequence_num) AS out_of_order
+  FROM :COMPRESSED_CHUNK) batches WHERE out_of_order;
+(SELECT * FROM test_reorder EXCEPT ALL SELECT * FROM test_reorder_expected)
+UNION ALL
+(SELECT * FROM test_reorder_expected EXCEPT ALL SELECT * FROM test_reorder);
+
+--an index that does not match the compression order is not used
+SELECT decompress_chunk(:'CHUNK');
+SELECT reorder_chunk(:'CHUNK', 'test_reorder_time_idx');
+SELECT index_scans AS "INDEX_SCANS", sorts AS "SORTS" FROM ts_test_compression_sorted_rows_stats() \gset
+SELECT compress_chunk(:'CHUNK');
+SELECT index_scans - :INDEX_SCANS AS index_scans, sorts - :SORTS AS sorts
+FROM ts_test_compression_sorted_rows_stats();
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_reorder' \gset
+SELECT device_id, count(*), sum(_ts_meta_count)
+FROM :COMPRESSED_CHUNK GROUP BY device_id ORDER BY device_id;
+SELECT count(*) FROM (SELECT _ts_meta_min_1 < lead(_ts_meta_max_1) OVER
+  (PARTITION BY device_id ORDER BY _ts_meta_sequence_num) AS out_of_order
+  FROM :COMPRESSED_CHUNK) batches WHERE out_of_order;
+(SELECT * FROM test_reorder EXCEPT ALL SELECT * FROM test_reorder_expected)
+UNION ALL
+(SELECT * FROM test_reorder_expected EXCEPT ALL SELECT * FROM test_reorder);
+
+DROP TABLE test_reorder;
+DROP TABLE test_reorder_expected;
+
+--adaptive algorithms choose the algorithm of every compressed value by trial
+--encoding
+CREATE TABLE test_adaptive(time timestamptz NOT NULL, device_id int, code int, val float);
+select table_name from create_hypertable('test_adaptive', 'time', chunk_time_interval=> '1 year'::interval);
+\set ON_ERROR_STOP 0
+alter table test_adaptive set (timescaledb.compress, timescaledb.compress_adaptive_algorithms = 'maybe');
+\set ON_ERROR_STOP 1
+alter table test_adaptive set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_adaptive_algorithms);
+select s.batch_size, s.adaptive_algorithms from _timescaledb_catalog.hypertable_compression_settings s, _timescaledb_catalog.hypertable ht
+where ht.id = s.hypertable_id and ht.table_name like 'test_adaptive';
+\set ON_ERROR_STOP 0
+alter table test_adaptive set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time DESC');
+alter table test_adaptive set (timescaledb.compress = false, timescaledb.compress_adaptive_algorithms = false);
+\set ON_ERROR_STOP 1
+
+--the codes are a few integers far apart and the values repeat within each
+--segment, so both compress better with a dictionary than with the default
+insert into test_adaptive
+select '2018-01-01'::timestamptz + i * interval '1 minute', i % 2, (i % 3) * 1000000, (i % 4) * 1.5
+from generate_series(1, 4000) i;
+CREATE TABLE test_adaptive_expected AS SELECT * FROM test_adaptive;
+
+SELECT format('%I.%I', ch1.schema_name, ch1.table_name) AS "CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ht.table_name like 'test_adaptive' \gset
+SELECT compress_chunk(:'CHUNK');
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_adaptive' \gset
+--the first byte of a compressed value is the id of its algorithm
+SELECT a1.description AS time_algorithm, a2.description AS code_algorithm, a3.description AS val_algorithm, count(*)
+FROM :COMPRESSED_CHUNK c, _timescaledb_catalog.compression_algorithm a1,
+  _timescaledb_catalog.compression_algorithm a2, _timescaledb_catalog.compression_algorithm a3
+WHERE a1.id = get_byte(decode(c.time::text, 'base64'), 0) AND a2.id = get_byte(decode(c.code::text, 'base64'), 0)
+  AND a3.id = get_byte(decode(c.val::text, 'base64'), 0)
+GROUP BY 1, 2, 3 ORDER BY 1, 2, 3;
+(SELECT * FROM test_adaptive EXCEPT ALL SELECT * FROM test_adaptive_expected)
+UNION ALL
+(SELECT * FROM test_adaptive_expected EXCEPT ALL SELECT * FROM test_adaptive);
+
+--without the option, the configured algorithms are used
+SELECT decompress_chunk(:'CHUNK');
+alter table test_adaptive set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_adaptive_algorithms = false);
+select count(*) from _timescaledb_catalog.hypertable_compression_settings;
+SELECT compress_chunk(:'CHUNK');
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_adaptive' \gset
+SELECT a1.description AS time_algorithm, a2.description AS code_algorithm, a3.description AS val_algorithm, count(*)
+FROM :COMPRESSED_CHUNK c, _timescaledb_catalog.compression_algorithm a1,
+  _timescaledb_catalog.compression_algorithm a2, _timescaledb_catalog.compression_algorithm a3
+WHERE a1.id = get_byte(decode(c.time::text, 'base64'), 0) AND a2.id = get_byte(decode(c.code::text, 'base64'), 0)
+  AND a3.id = get_byte(decode(c.val::text, 'base64'), 0)
+GROUP BY 1, 2, 3 ORDER BY 1, 2, 3;
+(SELECT * FROM test_adaptive EXCEPT ALL SELECT * FROM test_adaptive_expected)
+UNION ALL
+(SELECT * FROM test_adaptive_expected EXCEPT ALL SELECT * FROM test_adaptive);
+
+DROP TABLE test_adaptive;
+DROP TABLE test_adaptive_expected;
+
+--quals on dictionary-compressed columns are evaluated once per distinct value
+--and the rows are filtered by their dictionary codes
+CREATE TABLE test_dict_quals(time timestamptz NOT NULL, device text, status text);
+select table_name from create_hypertable('test_dict_quals', 'time', chunk_time_interval=> '1 year'::interval);
+insert into test_dict_quals
+select '2020-01-01'::timestamptz + i * interval '1 minute', 'device_' || (i % 4),
+  CASE WHEN i % 5 = 0 THEN NULL ELSE 's' || (i % 3) END
+from generate_series(1, 1000) i;
+alter table test_dict_quals set (timescaledb.compress);
+CREATE VIEW test_dict_quals_counts AS SELECT
+  (SELECT count(*) FROM test_dict_quals WHERE device = 'device_1') AS eq,
+  (SELECT count(*) FROM test_dict_quals WHERE device <> 'device_1') AS ne,
+  (SELECT count(*) FROM test_dict_quals WHERE device IN ('device_0', 'device_3', 'device_9')) AS in_list,
+  (SELECT count(*) FROM test_dict_quals WHERE device NOT IN ('device_0', 'device_3')) AS not_in,
+  (SELECT count(*) FROM test_dict_quals WHERE device < 'device_2') AS lt,
+  (SELECT count(*) FROM test_dict_quals WHERE 'device_2' <= device) AS ge,
+  (SELECT count(*) FROM test_dict_quals WHERE device LIKE '%3') AS "like",
+  (SELECT count(*) FROM test_dict_quals WHERE status = 's1') AS status_eq,
+  (SELECT count(*) FROM test_dict_quals WHERE status <> 's1') AS status_ne,
+  (SELECT count(*) FROM test_dict_quals WHERE status <= 's1') AS status_le,
+  (SELECT count(*) FROM test_dict_quals
+   WHERE device = 'device_1' AND status = 's2' AND time > '2020-01-01 08:00'::timestamptz) AS combined;
+SELECT * FROM test_dict_quals_counts;
+SELECT count(compress_chunk(ch)) FROM show_chunks('test_dict_quals') ch;
+SELECT * FROM test_dict_quals_counts;
+SET timescaledb.enable_vectorized_decompression TO false;
+SELECT * FROM test_dict_quals_counts;
+RESET timescaledb.enable_vectorized_decompression;
+DROP VIEW test_dict_quals_counts;
+DROP TABLE test_dict_quals;
+
+--array_lz4 and array_zstd compress the values of a column with a block codec
+--instead of TOAST compression
+CREATE TABLE test_block_codec(time timestamptz NOT NULL, device_id int, payload jsonb, note text, label text);
+select table_name from create_hypertable('test_block_codec', 'time', chunk_time_interval=> '1 year'::interval);
+\set ON_ERROR_STOP 0
+alter table test_block_codec set (timescaledb.compress, timescaledb.compress_lz4 = 'payload, nonexistent');
+alter table test_block_codec set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_lz4 = 'device_id');
+alter table test_block_codec set (timescaledb.compress, timescaledb.compress_lz4 = 'payload', timescaledb.compress_zstd = 'note, payload');
+\set ON_ERROR_STOP 1
+alter table test_block_codec set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_lz4 = 'payload', timescaledb.compress_zstd = 'note');
+select attname, al.name
+from _timescaledb_catalog.hypertable_compression hc, _timescaledb_catalog.hypertable ht,
+  _timescaledb_catalog.compression_algorithm al
+where ht.id = hc.hypertable_id and ht.table_name like 'test_block_codec' and al.id = hc.compression_algorithm_id
+ORDER BY attname;
+--the block codecs already compress the data, so TOAST must not compress it again
+select at.attname, at.attstorage
+from pg_attribute at, _timescaledb_catalog.hypertable ht, _timescaledb_catalog.hypertable cht
+where ht.table_name like 'test_block_codec' and cht.id = ht.compressed_hypertable_id
+  and at.attrelid = format('%I.%I', cht.schema_name, cht.table_name)::regclass
+  and at.attname in ('payload', 'note', 'label')
+ORDER BY at.attnum;
+\set ON_ERROR_STOP 0
+alter table test_block_codec set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time DESC', timescaledb.compress_lz4 = 'payload');
+\set ON_ERROR_STOP 1
+
+insert into test_block_codec
+select '2020-01-01'::timestamptz + i * interval '1 minute', i % 2,
+  jsonb_build_object('sensor', 'sensor_' || (i % 10), 'reading', i, 'tags', jsonb_build_array('a', 'b', i % 7)),
+  CASE WHEN i % 9 = 0 THEN NULL ELSE repeat('note ' || (i % 13) || ' ', 20) END,
+  'label_' || (i % 3)
+from generate_series(1, 2000) i;
+CREATE TABLE test_block_codec_expected AS SELECT * FROM test_block_codec;
+
+SELECT format('%I.%I', ch1.schema_name, ch1.table_name) AS "CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ht.table_name like 'test_block_codec' \gset
+SELECT compress_chunk(:'CHUNK');
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_block_codec' \gset
+--the first byte of a compressed value is the id of its algorithm
+SELECT a1.description AS payload_algorithm, a2.description AS note_algorithm, a3.description AS label_algorithm, count(*)
+FROM :COMPRESSED_CHUNK c, _timescaledb_catalog.compression_algorithm a1,
+  _timescaledb_catalog.compression_algorithm a2, _timescaledb_catalog.compression_algorithm a3
+WHERE a1.id = get_byte(decode(c.payload::text, 'base64'), 0) AND a2.id = get_byte(decode(c.note::text, 'base64'), 0)
+  AND a3.id = get_byte(decode(c.label::text, 'base64'), 0)
+GROUP BY 1, 2, 3 ORDER BY 1, 2, 3;
+(SELECT * FROM test_block_codec EXCEPT ALL SELECT * FROM test_block_codec_expected)
+UNION ALL
+(SELECT * FROM test_block_codec_expected EXCEPT ALL SELECT * FROM test_block_codec);
+SELECT count(*) FROM test_block_codec WHERE payload->>'sensor' = 'sensor_3';
+SELECT count(*) FROM test_block_codec WHERE note LIKE 'note 5 %';
+SELECT decompress_chunk(:'CHUNK');
+(SELECT * FROM test_block_codec EXCEPT ALL SELECT * FROM test_block_codec_expected)
+UNION ALL
+(SELECT * FROM test_block_codec_expected EXCEPT ALL SELECT * FROM test_block_codec);
+
+DROP TABLE test_block_codec;
+DROP TABLE test_block_codec_expected;
+
+--jsonb compression shreds the frequent keys of jsonb objects into streams
+CREATE TABLE test_jsonb(time timestamptz NOT NULL, device_id int, payload jsonb, note text);
+select table_name from create_hypertable('test_jsonb', 'time', chunk_time_interval=> '1 year'::interval);
+\set ON_ERROR_STOP 0
+alter table test_jsonb set (timescaledb.compress, timescaledb.compress_jsonb = 'note');
+alter table test_jsonb set (timescaledb.compress, timescaledb.compress_segmentby = 'payload', timescaledb.compress_jsonb = 'payload');
+alter table test_jsonb set (timescaledb.compress, timescaledb.compress_lz4 = 'payload', timescaledb.compress_jsonb = 'payload');
+\set ON_ERROR_STOP 1
+alter table test_jsonb set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_jsonb = 'payload');
+select attname, al.name
+from _timescaledb_catalog.hypertable_compression hc, _timescaledb_catalog.hypertable ht,
+  _timescaledb_catalog.compression_algorithm al
+where ht.id = hc.hypertable_id and ht.table_name like 'test_jsonb' and al.id = hc.compression_algorithm_id
+ORDER BY attname;
+\set ON_ERROR_STOP 0
+alter table test_jsonb set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time DESC');
+\set ON_ERROR_STOP 1
+
+insert into test_jsonb
+select '2020-01-01'::timestamptz + i * interval '1 minute', i % 2,
+  CASE WHEN i % 17 = 0 THEN NULL WHEN i % 23 = 0 THEN '[1, 2]'::jsonb
+  ELSE jsonb_build_object('temp', (i % 100) / 4.0, 'seq', i, 'site', 'site_' || (i % 5), 'ok', i % 2 = 0,
+    'nested', jsonb_build_object('a', i % 7))
+    || CASE WHEN i % 50 = 0 THEN jsonb_build_object('x', i) ELSE '{}' END
+  END,
+  'note_' || (i % 3)
+from generate_series(1, 2000) i;
+CREATE TABLE test_jsonb_expected AS SELECT * FROM test_jsonb;
+
+SELECT format('%I.%I', ch1.schema_name, ch1.table_name) AS "CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ht.table_name like 'test_jsonb' \gset
+SELECT compress_chunk(:'CHUNK');
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_jsonb' \gset
+SELECT a.description AS payload_algorithm, count(*)
+FROM :COMPRESSED_CHUNK c, _timescaledb_catalog.compression_algorithm a
+WHERE a.id = get_byte(decode(c.payload::text, 'base64'), 0)
+GROUP BY 1 ORDER BY 1;
+(SELECT * FROM test_jsonb EXCEPT ALL SELECT * FROM test_jsonb_expected)
+UNION ALL
+(SELECT * FROM test_jsonb_expected EXCEPT ALL SELECT * FROM test_jsonb);
+--queries that only use constant keys of the column decompress only these keys
+(SELECT time, payload->>'site' AS site, payload->'nested' AS nested, payload ? 'x' AS has_x FROM test_jsonb
+ EXCEPT ALL SELECT time, payload->>'site', payload->'nested', payload ? 'x' FROM test_jsonb_expected)
+UNION ALL
+(SELECT time, payload->>'site', payload->'nested', payload ? 'x' FROM test_jsonb_expected
+ EXCEPT ALL SELECT time, payload->>'site', payload->'nested', payload ? 'x' FROM test_jsonb);
+SELECT count(*) FROM test_jsonb WHERE payload->>'site' = 'site_3';
+SELECT count(*) FROM test_jsonb WHERE payload ? 'x';
+SELECT count(*) FROM test_jsonb WHERE (payload->'nested'->>'a')::int = 3;
+SELECT count(*) FROM test_jsonb t WHERE t.payload->>'site' = 'site_3' AND EXISTS (SELECT 1 WHERE t.payload->>'seq' IS NOT NULL);
+SELECT decompress_chunk(:'CHUNK');
+(SELECT * FROM test_jsonb EXCEPT ALL SELECT * FROM test_jsonb_expected)
+UNION ALL
+(SELECT * FROM test_jsonb_expected EXCEPT ALL SELECT * FROM test_jsonb);
+
+DROP TABLE test_jsonb;
+DROP TABLE test_jsonb_expected;
+
+--columns that the quals do not use are only decompressed for batches with matching rows
+CREATE TABLE test_lazy(time timestamptz NOT NULL, device_id int, v int, note text);
+select table_name from create_hypertable('test_lazy', 'time', chunk_time_interval=> '1 year'::interval);
+alter table test_lazy set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id');
+insert into test_lazy
+select '2020-01-01'::timestamptz + i * interval '1 minute', i / 1000, i, 'note_' || i
+from generate_series(1, 3000) i;
+CREATE TABLE test_lazy_expected AS SELECT * FROM test_lazy;
+CREATE VIEW test_lazy_diff AS
+(SELECT time, device_id, note FROM test_lazy WHERE v % 7 = 3 AND v > 1500
+ EXCEPT ALL SELECT time, device_id, note FROM test_lazy_expected WHERE v % 7 = 3 AND v > 1500)
+UNION ALL
+(SELECT time, device_id, note FROM test_lazy_expected WHERE v % 7 = 3 AND v > 1500
+ EXCEPT ALL SELECT time, device_id, note FROM test_lazy WHERE v % 7 = 3 AND v > 1500);
+SELECT count(compress_chunk(ch)) FROM show_chunks('test_lazy') ch;
+SELECT * FROM test_lazy_diff;
+SELECT v, note FROM test_lazy WHERE v % 7 = 3 ORDER BY time LIMIT 3;
+SELECT v, note FROM test_lazy WHERE v % 7 = 3 ORDER BY time DESC LIMIT 3;
+SELECT count(*), min(note) FROM test_lazy WHERE v > 2500 AND note LIKE '%7';
+SET timescaledb.enable_vectorized_decompression TO false;
+SELECT * FROM test_lazy_diff;
+SELECT v, note FROM test_lazy WHERE v % 7 = 3 ORDER BY time LIMIT 3;
+SELECT v, note FROM test_lazy WHERE v % 7 = 3 ORDER BY time DESC LIMIT 3;
+SELECT count(*), min(note) FROM test_lazy WHERE v > 2500 AND note LIKE '%7';
+RESET timescaledb.enable_vectorized_decompression;
+
+DROP VIEW test_lazy_diff;
+DROP TABLE test_lazy;
+DROP TABLE test_lazy_expected;
+
+--aggregates are computed on the compressed batches
+CREATE TABLE test_agg(time timestamptz NOT NULL, device_id int, v int, s smallint, f float8, r real, note text);
+select table_name from create_hypertable('test_agg', 'time', chunk_time_interval=> '1 year'::interval);
+alter table test_agg set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time', timescaledb.compress_minmax = 'v');
+insert into test_agg
+select CASE WHEN i <= 6000 THEN '2020-06-01'::timestamptz ELSE '2021-06-01'::timestamptz END + i * interval '1 minute',
+  i % 3, CASE WHEN i % 10 <> 0 THEN i END, i % 100, i * 0.5, (i % 7) * 0.25, 'note_' || i
+from generate_series(1, 7000) i;
+CREATE TABLE test_agg_expected AS SELECT * FROM test_agg;
+CREATE VIEW test_agg_diff AS
+(SELECT count(*), count(v), sum(v), sum(s), avg(v), avg(s), sum(f), sum(r), min(v), max(v), min(time), max(time), min(note), max(note) FROM test_agg
+ EXCEPT ALL SELECT count(*), count(v), sum(v), sum(s), avg(v), avg(s), sum(f), sum(r), min(v), max(v), min(time), max(time), min(note), max(note) FROM test_agg_expected)
+UNION ALL
+(SELECT count(*), count(v), sum(v), sum(s), avg(v), avg(s), sum(f), sum(r), min(v), max(v), min(time), max(time), min(note), max(note) FROM test_agg_expected
+ EXCEPT ALL SELECT count(*), count(v), sum(v), sum(s), avg(v), avg(s), sum(f), sum(r), min(v), max(v), min(time), max(time), min(note), max(note) FROM test_agg);
+SELECT count(compress_chunk(ch)) FROM show_chunks('test_agg', older_than => '2021-01-01'::timestamptz) ch;
+SELECT * FROM test_agg_diff;
+--DecompressChunk computes the partial aggregates of the compressed chunk, min
+--and max of the compress_minmax column are read from the batch metadata
+EXPLAIN (VERBOSE, COSTS OFF) SELECT count(*), count(v), sum(v), sum(s), min(v), max(v), min(note), max(note) FROM test_agg;
+SELECT count(*), count(v), sum(v), sum(s), min(v), max(v), min(note), max(note) FROM test_agg;
+--with quals, the metadata cannot be used since it covers all rows of a batch
+EXPLAIN (VERBOSE, COSTS OFF) SELECT count(*), sum(v), sum(s), max(v) FROM test_agg WHERE v > 100;
+SELECT count(*), sum(v), sum(s), max(v) FROM test_agg WHERE v > 100;
+SELECT count(*), sum(f), sum(r), max(note) FROM test_agg WHERE note LIKE '%1';
+--with GROUP BY segmentby columns, a partial aggregate is computed for every group
+EXPLAIN (VERBOSE, COSTS OFF) SELECT device_id, count(*), count(v), sum(v), sum(s), min(v), max(v), min(note), max(note) FROM test_agg GROUP BY device_id ORDER BY device_id;
+SELECT device_id, count(*), count(v), sum(v), sum(s), min(v), max(v), min(note), max(note) FROM test_agg GROUP BY device_id ORDER BY device_id;
+SELECT device_id, count(*), sum(v), sum(s) FROM test_agg WHERE v > 100 GROUP BY device_id ORDER BY device_id;
+SELECT device_id, count(*), sum(f), max(note) FROM test_agg WHERE note LIKE '%1' GROUP BY device_id ORDER BY device_id;
+SET timescaledb.enable_vectorized_decompression TO false;
+SELECT * FROM test_agg_diff;
+SELECT count(*), sum(v), sum(s), max(v) FROM test_agg WHERE v > 100;
+SELECT device_id, count(*), sum(v), sum(s) FROM test_agg WHERE v > 100 GROUP BY device_id ORDER BY device_id;
+RESET timescaledb.enable_vectorized_decompression;
+SET timescaledb.enable_compressed_aggregation TO false;
+SELECT * FROM test_agg_diff;
+SELECT device_id, count(*), count(v), sum(v), sum(s), min(v), max(v), min(note), max(note) FROM test_agg GROUP BY device_id ORDER BY device_id;
+RESET timescaledb.enable_compressed_aggregation;
+
+DROP VIEW test_agg_diff;
+DROP TABLE test_agg;
+DROP TABLE test_agg_expected;
+
+--the metadata of a batch whose values are all NULL is NULL, which min and max
+--skip like NULL values
+CREATE TABLE test_agg_null(time timestamptz NOT NULL, device_id int, v int);
+select table_name from create_hypertable('test_agg_null', 'time', chunk_time_interval=> '1 year'::interval);
+alter table test_agg_null set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time', timescaledb.compress_minmax = 'v');
+insert into test_agg_null
+select '2020-06-01'::timestamptz + i * interval '1 minute', i % 2, CASE WHEN i % 2 = 0 THEN i END
+from generate_series(1, 2000) i;
+SELECT count(compress_chunk(ch)) FROM show_chunks('test_agg_null') ch;
+SELECT format('%I.%I', ch2.schema_name, ch2.table_name) AS "COMPRESSED_CHUNK"
+FROM _timescaledb_catalog.chunk ch1, _timescaledb_catalog.chunk ch2, _timescaledb_catalog.hypertable ht
+WHERE ch1.hypertable_id = ht.id AND ch1.compressed_chunk_id = ch2.id AND ht.table_name like 'test_agg_null' \gset
+SELECT device_id, bool_and(_ts_meta_col_min_1 IS NULL AND _ts_meta_col_max_1 IS NULL) AS null_meta
+FROM :COMPRESSED_CHUNK GROUP BY device_id ORDER BY device_id;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT device_id, min(v), max(v), count(v) FROM test_agg_null GROUP BY device_id ORDER BY device_id;
+SELECT device_id, min(v), max(v), count(v), count(*) FROM test_agg_null GROUP BY device_id ORDER BY device_id;
+SELECT min(v), max(v), count(v), count(*) FROM test_agg_null;
+
+DROP TABLE test_agg_null;
+
+--NULL segmentby values form their own group, which has to be emitted where the
+--ordering of the groups puts NULLs
+CREATE TABLE test_agg_group_null(time timestamptz NOT NULL, device_id int, v int);
+select table_name from create_hypertable('test_agg_group_null', 'time', chunk_time_interval=> '1 year'::interval);
+alter table test_agg_group_null set (timescaledb.compress, timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'time');
+insert into test_agg_group_null
+select '2020-06-01'::timestamptz + i * interval '1 minute', NULLIF(i % 3, 0), i
+from generate_series(1, 4500) i;
+SELECT count(compress_chunk(ch)) FROM show_chunks('test_agg_group_null') ch;
+EXPLAIN (COSTS OFF) SELECT device_id, count(*), sum(v), min(v), max(v) FROM test_agg_group_null GROUP BY device_id ORDER BY device_id NULLS FIRST;
+SELECT device_id, count(*), sum(v), min(v), max(v) FROM test_agg_group_null GROUP BY device_id ORDER BY device_id;
+SELECT device_id, count(*), sum(v), min(v), max(v) FROM test_agg_group_null GROUP BY device_id ORDER BY device_id DESC;
+SELECT device_id, count(*), sum(v), min(v), max(v) FROM test_agg_group_null GROUP BY device_id ORDER BY device_id NULLS FIRST;
+
+DROP TABLE test_agg_group_null;
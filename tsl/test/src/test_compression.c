@@ -6,6 +6,8 @@
 
 #include <postgres.h>
 
+#include <math.h>
+#include <access/hash.h>
 #include <access/heapam.h>
 #include <access/htup_details.h>
 #include <catalog/pg_type.h>
@@ -14,21 +16,36 @@
 #include <lib/stringinfo.h>
 #include <utils/array.h>
 #include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/fmgroids.h>
+#include <utils/jsonb.h>
 #include <utils/lsyscache.h>
+#include <utils/memutils.h>
 #include <utils/rel.h>
 #include <utils/syscache.h>
+#include <utils/timestamp.h>
 #include <utils/typcache.h>
 #include <fmgr.h>
+#include <funcapi.h>
+#include <portability/instr_time.h>
 
 #include <catalog.h>
 #include <export.h>
+#include <utils.h>
+#include "config.h"
 
+#include "compression/alp.h"
 #include "compression/array.h"
+#include "compression/array_lz.h"
 #include "compression/dictionary.h"
 #include "compression/gorilla.h"
 #include "compression/deltadelta.h"
+#include "compression/jsonb.h"
+#include "compression/pfor.h"
 #include "compression/utils.h"
 #include "compression/segment_meta.h"
+#include "compression/simple8b_rle.h"
+#include "compression/simple8b_rle_decode.h"
 
 #define VEC_PREFIX compression_info
 #define VEC_ELEMENT_TYPE Form_hypertable_compression
@@ -38,8 +55,11 @@
 #include <adts/vec.h>
 
 TS_FUNCTION_INFO_V1(ts_test_compression);
+TS_FUNCTION_INFO_V1(ts_test_compression_benchmark);
 TS_FUNCTION_INFO_V1(ts_compress_table);
 TS_FUNCTION_INFO_V1(ts_decompress_table);
+TS_FUNCTION_INFO_V1(ts_test_compression_sorted_rows_stats);
+TS_FUNCTION_INFO_V1(ts_test_compression_parallel_stats);
 
 #define AssertInt64Eq(a, b)                                                                        \
 	do                                                                                             \
@@ -459,6 +479,1178 @@ test_delta2()
 	AssertInt64Eq(i, 1015);
 }
 
+/* deterministic pseudo-random numbers for the test data */
+static uint32
+test_random(uint32 *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return (*state >> 16) & 0x7FFF;
+}
+
+typedef enum TestDataKind
+{
+	TEST_DATA_TIMESTAMPS,
+	TEST_DATA_METRICS,
+	TEST_DATA_DEVICES,
+	TEST_DATA_INTEGERS,
+	_TEST_DATA_MAX,
+} TestDataKind;
+
+static const char *const test_data_names[_TEST_DATA_MAX] = {
+	[TEST_DATA_TIMESTAMPS] = "deltadelta",
+	[TEST_DATA_METRICS] = "gorilla",
+	[TEST_DATA_DEVICES] = "dictionary",
+	[TEST_DATA_INTEGERS] = "array",
+};
+
+static const Oid test_data_types[_TEST_DATA_MAX] = {
+	[TEST_DATA_TIMESTAMPS] = TIMESTAMPTZOID,
+	[TEST_DATA_METRICS] = FLOAT8OID,
+	[TEST_DATA_DEVICES] = TEXTOID,
+	[TEST_DATA_INTEGERS] = INT4OID,
+};
+
+static Compressor *
+test_data_compressor(TestDataKind kind)
+{
+	switch (kind)
+	{
+		case TEST_DATA_TIMESTAMPS:
+			return delta_delta_compressor_for_type(TIMESTAMPTZOID);
+		case TEST_DATA_METRICS:
+			return gorilla_compressor_for_type(FLOAT8OID);
+		case TEST_DATA_DEVICES:
+			return dictionary_compressor_for_type(TEXTOID);
+		default:
+			return array_compressor_for_type(INT4OID);
+	}
+}
+
+/*
+ * Compress a segment of data resembling a column of a typical time-series
+ * table: timestamps with a fixed interval and some jitter, a metric doing a
+ * random walk, a device name out of a few, and random integers. Every
+ * null_interval-th value is NULL if null_interval is positive.
+ */
+static Datum
+test_data_compress(Compressor *compressor, TestDataKind kind, int num_rows, int null_interval)
+{
+	uint32 state = 42;
+	int64 timestamp = 0;
+	double metric = 100.0;
+	text *devices[10];
+	int i;
+
+	for (i = 0; i < 10; i++)
+		devices[i] = cstring_to_text(psprintf("device_%d", i));
+
+	for (i = 0; i < num_rows; i++)
+	{
+		if (null_interval > 0 && i % null_interval == 0)
+		{
+			compressor->append_null(compressor);
+			continue;
+		}
+
+		switch (kind)
+		{
+			case TEST_DATA_TIMESTAMPS:
+				timestamp += 10 * USECS_PER_SEC + (test_random(&state) % 3 == 0 ? 1000 : 0);
+				compressor->append_val(compressor, TimestampTzGetDatum(timestamp));
+				break;
+			case TEST_DATA_METRICS:
+				metric += (test_random(&state) % 200 - 100) / 100.0;
+				compressor->append_val(compressor, Float8GetDatum(metric));
+				break;
+			case TEST_DATA_DEVICES:
+				compressor->append_val(compressor,
+									   PointerGetDatum(devices[test_random(&state) % 10]));
+				break;
+			default:
+				compressor->append_val(compressor, Int32GetDatum(test_random(&state)));
+				break;
+		}
+	}
+
+	return PointerGetDatum(compressor->finish(compressor));
+}
+
+static Datum
+compress_test_data(TestDataKind kind, int num_rows, int null_interval)
+{
+	return test_data_compress(test_data_compressor(kind), kind, num_rows, null_interval);
+}
+
+/* Check that bulk decompression returns the same values as the iterator */
+static void
+check_decompress_all(Datum compressed, Oid element_type, DecompressedColumn *column)
+{
+	CompressedDataHeader *header = (CompressedDataHeader *) DatumGetPointer(compressed);
+	DecompressionIterator *iter =
+		tsl_get_decompression_iterator_init(header->compression_algorithm,
+											false)(compressed, element_type);
+	int16 typlen;
+	bool typbyval;
+	uint32 row = 0;
+
+	get_typlenbyval(element_type, &typlen, &typbyval);
+	decompress_all(compressed, element_type, column);
+
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		if (row >= column->num_values)
+			elog(ERROR, "bulk decompression returned too few values @ line %d", __LINE__);
+
+		if (r.is_null != DECOMPRESSED_COLUMN_IS_NULL(column, row))
+			elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+
+		if (!r.is_null &&
+			!datumIsEqual(r.val, decompressed_column_get_datum(column, row), typbyval, typlen))
+			elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+
+		row++;
+	}
+
+	AssertInt64Eq(row, column->num_values);
+}
+
+static void
+test_decompress_all()
+{
+	/* reuse the column between segments, like the executor would */
+	DecompressedColumn column = { 0 };
+	int null_intervals[] = { 0, 1, 2, 7 };
+	int row_counts[] = { 1, 63, 64, 65, 1000 };
+	int kind;
+	int i;
+	int j;
+
+	for (kind = 0; kind < _TEST_DATA_MAX; kind++)
+	{
+		for (i = 0; i < lengthof(null_intervals); i++)
+		{
+			for (j = 0; j < lengthof(row_counts); j++)
+			{
+				Datum compressed = compress_test_data(kind, row_counts[j], null_intervals[i]);
+
+				if (DatumGetPointer(compressed) == NULL)
+					continue;
+
+				check_decompress_all(compressed, test_data_types[kind], &column);
+			}
+		}
+	}
+
+	/* RLE blocks longer than the output padding must be clamped */
+	{
+		DeltaDeltaCompressor *compressor = delta_delta_compressor_alloc();
+		Datum compressed;
+
+		for (i = 0; i < 100000; i++)
+			delta_delta_compressor_append_value(compressor, i);
+
+		compressed =
+			DirectFunctionCall1(tsl_deltadelta_compressor_finish, PointerGetDatum(compressor));
+		check_decompress_all(compressed, INT8OID, &column);
+		AssertInt64Eq(column.num_values, 100000);
+		AssertInt64Eq(((int64 *) column.values)[99999], 99999);
+	}
+
+	/* deltas that overflow, for every position within a vector of four values */
+	for (j = 1; j <= 9; j++)
+	{
+		DeltaDeltaCompressor *compressor = delta_delta_compressor_alloc();
+		Datum compressed;
+
+		for (i = 0; i < j; i++)
+			delta_delta_compressor_append_value(compressor,
+												i % 3 == 0 ? PG_INT64_MIN + i :
+															 (i % 3 == 1 ? PG_INT64_MAX - i : -i));
+
+		compressed =
+			DirectFunctionCall1(tsl_deltadelta_compressor_finish, PointerGetDatum(compressor));
+		check_decompress_all(compressed, INT8OID, &column);
+		AssertInt64Eq(column.num_values, j);
+	}
+}
+
+/* dictionaries are sorted, and bulk decompression keeps the code of every row */
+static void
+test_sorted_dictionary()
+{
+	char *strings[5] = { "foo", "a", "gobble gobble gobble", "baz", "bar" };
+	char *sorted[5] = { "a", "bar", "baz", "foo", "gobble gobble gobble" };
+	DictionaryCompressor *compressor = dictionary_compressor_alloc(TEXTOID);
+	ArrayCompressor *array_compressor = array_compressor_alloc(TEXTOID);
+	DecompressedColumn column = { 0 };
+	Datum compressed;
+	StringInfoData buf;
+	bytea *sent;
+	StringInfoData transmition;
+	Datum compressed_recv;
+	uint32 row;
+	int i;
+
+	for (i = 0; i < 1000; i++)
+	{
+		if (i % 7 == 3)
+			dictionary_compressor_append_null(compressor);
+		else
+			dictionary_compressor_append(compressor, CStringGetTextDatum(strings[i % 5]));
+	}
+
+	compressed = PointerGetDatum(dictionary_compressor_finish(compressor));
+	AssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+				  COMPRESSION_ALGORITHM_DICTIONARY);
+	check_decompress_all(compressed, TEXTOID, &column);
+	AssertInt64Eq(column.has_dictionary, true);
+	AssertInt64Eq(column.dictionary_sorted, true);
+	AssertInt64Eq(column.num_distinct, 5);
+
+	for (i = 0; i < 5; i++)
+	{
+		if (strcmp(TextDatumGetCString(column.dictionary[i]), sorted[i]) != 0)
+			elog(ERROR, "dictionary item %d is not \"%s\" @ line %d", i, sorted[i], __LINE__);
+	}
+
+	for (row = 0; row < column.num_values; row++)
+	{
+		if (DECOMPRESSED_COLUMN_IS_NULL(&column, row))
+			continue;
+
+		if (strcmp(sorted[column.codes[row]], strings[row % 5]) != 0)
+			elog(ERROR, "wrong code for row %u @ line %d", row, __LINE__);
+	}
+
+	/* the binary format does not include the flag, so recv checks the order of the items */
+	pq_begintypsend(&buf);
+	dictionary_compressed_send((CompressedDataHeader *) DatumGetPointer(compressed), &buf);
+	sent = pq_endtypsend(&buf);
+
+	transmition = (StringInfoData){
+		.data = VARDATA(sent),
+		.len = VARSIZE(sent),
+		.maxlen = VARSIZE(sent),
+	};
+
+	compressed_recv = dictionary_compressed_recv(&transmition);
+	check_decompress_all(compressed_recv, TEXTOID, &column);
+	AssertInt64Eq(column.dictionary_sorted, true);
+
+	/* a column that was decompressed from a dictionary can be reused for other algorithms */
+	for (i = 0; i < 100; i++)
+		array_compressor_append(array_compressor, CStringGetTextDatum(strings[i % 5]));
+
+	check_decompress_all(PointerGetDatum(array_compressor_finish(array_compressor)),
+						 TEXTOID,
+						 &column);
+	AssertInt64Eq(column.has_dictionary, false);
+
+	/* types without a btree operator class are not sorted */
+	compressor = dictionary_compressor_alloc(XIDOID);
+	for (i = 0; i < 1000; i++)
+		dictionary_compressor_append(compressor, TransactionIdGetDatum(100 - i % 10));
+
+	compressed = PointerGetDatum(dictionary_compressor_finish(compressor));
+	check_decompress_all(compressed, XIDOID, &column);
+	AssertInt64Eq(column.has_dictionary, true);
+	AssertInt64Eq(column.dictionary_sorted, false);
+	AssertInt64Eq(column.num_distinct, 10);
+}
+
+typedef enum Simple8bTestData
+{
+	SIMPLE8B_TEST_TIMESTAMPS,
+	SIMPLE8B_TEST_NULLS,
+	SIMPLE8B_TEST_DICTIONARY,
+	SIMPLE8B_TEST_COUNTERS,
+	SIMPLE8B_TEST_MIXED,
+	_SIMPLE8B_TEST_MAX,
+} Simple8bTestData;
+
+static const char *const simple8b_test_data_names[_SIMPLE8B_TEST_MAX] = {
+	[SIMPLE8B_TEST_TIMESTAMPS] = "timestamps",
+	[SIMPLE8B_TEST_NULLS] = "nulls",
+	[SIMPLE8B_TEST_DICTIONARY] = "dictionary",
+	[SIMPLE8B_TEST_COUNTERS] = "counters",
+	[SIMPLE8B_TEST_MIXED] = "mixed",
+};
+
+/*
+ * Generate a value of a simple8b stream resembling the streams produced by the
+ * compression algorithms: zig-zag encoded delta-of-deltas of timestamps with
+ * some jitter, NULL flags, dictionary indexes, wide counter values, and values
+ * of random widths that use every selector.
+ */
+static uint64
+simple8b_test_value(Simple8bTestData kind, uint32 *state)
+{
+	switch (kind)
+	{
+		case SIMPLE8B_TEST_TIMESTAMPS:
+			return test_random(state) % 10 == 0 ? test_random(state) % 2000 : 0;
+		case SIMPLE8B_TEST_NULLS:
+			return test_random(state) % 50 == 0;
+		case SIMPLE8B_TEST_DICTIONARY:
+			return test_random(state) % 10;
+		case SIMPLE8B_TEST_COUNTERS:
+			return ((uint64) test_random(state) << 15) | test_random(state);
+		case SIMPLE8B_TEST_MIXED:
+		{
+			uint32 bits = test_random(state) % 65;
+			uint64 random = ((uint64) test_random(state) << 49) ^
+							((uint64) test_random(state) << 34) ^
+							((uint64) test_random(state) << 19) ^
+							((uint64) test_random(state) << 4) ^ test_random(state);
+
+			return bits == 64 ? random : random & ((UINT64CONST(1) << bits) - 1);
+		}
+		case _SIMPLE8B_TEST_MAX:
+			break;
+	}
+
+	return 0;
+}
+
+static Simple8bRleSerialized *
+simple8b_test_data(Simple8bTestData kind, int num_values)
+{
+	Simple8bRleCompressor compressor;
+	uint32 state = 42;
+	int i;
+
+	simple8brle_compressor_init(&compressor);
+
+	for (i = 0; i < num_values; i++)
+		simple8brle_compressor_append(&compressor, simple8b_test_value(kind, &state));
+
+	return simple8brle_compressor_finish(&compressor);
+}
+
+/* both block decoders must produce the same values as the iterator */
+static void
+test_simple8b_decode()
+{
+	int num_values[] = { 1, 63, 64, 65, 1000, 10000 };
+	int kind;
+	int i;
+
+	for (kind = 0; kind < _SIMPLE8B_TEST_MAX; kind++)
+	{
+		for (i = 0; i < lengthof(num_values); i++)
+		{
+			Simple8bRleSerialized *compressed = simple8b_test_data(kind, num_values[i]);
+			uint32 num_slots =
+				simple8brle_num_selector_slots_for_num_blocks(compressed->num_blocks);
+			uint32 buffer_size = simple8brle_decompress_all_buffer_size(compressed->num_elements);
+			uint64 *scalar = palloc(sizeof(uint64) * buffer_size);
+			uint64 *dispatched = palloc(sizeof(uint64) * buffer_size);
+			Simple8bRleDecompressionIterator iter;
+			uint32 num_scalar;
+			uint32 num_dispatched;
+			uint32 j = 0;
+
+			num_scalar = simple8brle_decode_blocks_scalar(compressed->slots,
+														  compressed->slots + num_slots,
+														  compressed->num_blocks,
+														  compressed->num_elements,
+														  scalar);
+			num_dispatched = simple8brle_decompress_all_forward(compressed, dispatched);
+			AssertInt64Eq(num_scalar, num_values[i]);
+			AssertInt64Eq(num_dispatched, num_values[i]);
+
+			simple8brle_decompression_iterator_init_forward(&iter, compressed);
+			for (Simple8bRleDecompressResult r =
+					 simple8brle_decompression_iterator_try_next_forward(&iter);
+				 !r.is_done;
+				 r = simple8brle_decompression_iterator_try_next_forward(&iter))
+			{
+				AssertInt64Eq(scalar[j], r.val);
+				AssertInt64Eq(dispatched[j], r.val);
+				j++;
+			}
+			AssertInt64Eq(j, num_values[i]);
+		}
+	}
+}
+
+typedef enum GorillaTestData
+{
+	GORILLA_TEST_TEMPERATURE,
+	GORILLA_TEST_HUMIDITY,
+	GORILLA_TEST_POWER,
+	GORILLA_TEST_ENERGY,
+	_GORILLA_TEST_MAX,
+} GorillaTestData;
+
+static const char *const gorilla_test_data_names[_GORILLA_TEST_MAX] = {
+	[GORILLA_TEST_TEMPERATURE] = "temperature",
+	[GORILLA_TEST_HUMIDITY] = "humidity",
+	[GORILLA_TEST_POWER] = "power",
+	[GORILLA_TEST_ENERGY] = "energy",
+};
+
+/*
+ * Compress a series of float readings resembling the output of a sensor:
+ * temperatures with a resolution of 0.01 degrees doing a random walk,
+ * humidity in whole percent that rarely changes, power readings with full
+ * precision noise, and a monotonic energy counter in whole watt-hours. Every
+ * null_interval-th value is NULL if null_interval is positive.
+ */
+static Datum
+float_test_data(Compressor *compressor, GorillaTestData kind, Oid element_type, int num_rows,
+				int null_interval)
+{
+	uint32 state = 42;
+	double temperature = 21.5;
+	double humidity = 45;
+	double energy = 1000000;
+	int i;
+
+	for (i = 0; i < num_rows; i++)
+	{
+		double value = 0;
+
+		if (null_interval > 0 && i % null_interval == 0)
+		{
+			compressor->append_null(compressor);
+			continue;
+		}
+
+		switch (kind)
+		{
+			case GORILLA_TEST_TEMPERATURE:
+				temperature += (test_random(&state) % 21 - 10) / 100.0;
+				value = rint(temperature * 100) / 100;
+				break;
+			case GORILLA_TEST_HUMIDITY:
+				if (test_random(&state) % 20 == 0)
+					humidity += test_random(&state) % 3 - 1.0;
+				value = humidity;
+				break;
+			case GORILLA_TEST_POWER:
+				value = 1500 + test_random(&state) / 327.68;
+				break;
+			case GORILLA_TEST_ENERGY:
+				energy += test_random(&state) % 5;
+				value = energy;
+				break;
+			case _GORILLA_TEST_MAX:
+				break;
+		}
+
+		if (element_type == FLOAT4OID)
+			compressor->append_val(compressor, Float4GetDatum((float4) value));
+		else
+			compressor->append_val(compressor, Float8GetDatum(value));
+	}
+
+	return PointerGetDatum(compressor->finish(compressor));
+}
+
+static Datum
+gorilla_test_data(GorillaTestData kind, Oid element_type, int num_rows, int null_interval)
+{
+	return float_test_data(gorilla_compressor_for_type(element_type),
+						   kind,
+						   element_type,
+						   num_rows,
+						   null_interval);
+}
+
+static Datum
+alp_test_data(GorillaTestData kind, Oid element_type, int num_rows, int null_interval)
+{
+	return float_test_data(alp_compressor_for_type(element_type),
+						   kind,
+						   element_type,
+						   num_rows,
+						   null_interval);
+}
+
+/* bulk decompression of sensor series, with the values of both float types */
+static void
+test_gorilla_decompress_all()
+{
+	DecompressedColumn float4_column = { 0 };
+	DecompressedColumn float8_column = { 0 };
+	int null_intervals[] = { 0, 1, 3 };
+	int row_counts[] = { 1, 64, 1000 };
+	int kind;
+	int i;
+	int j;
+
+	for (kind = 0; kind < _GORILLA_TEST_MAX; kind++)
+	{
+		for (i = 0; i < lengthof(null_intervals); i++)
+		{
+			for (j = 0; j < lengthof(row_counts); j++)
+			{
+				Datum compressed;
+
+				compressed = gorilla_test_data(kind, FLOAT8OID, row_counts[j], null_intervals[i]);
+				if (DatumGetPointer(compressed) != NULL)
+					check_decompress_all(compressed, FLOAT8OID, &float8_column);
+
+				compressed = gorilla_test_data(kind, FLOAT4OID, row_counts[j], null_intervals[i]);
+				if (DatumGetPointer(compressed) != NULL)
+					check_decompress_all(compressed, FLOAT4OID, &float4_column);
+			}
+		}
+	}
+
+	/* a first value of zero has an empty xor */
+	{
+		GorillaCompressor *compressor = gorilla_compressor_alloc();
+
+		gorilla_compressor_append_value(compressor, double_get_bits(0.0));
+		gorilla_compressor_append_value(compressor, double_get_bits(-1.5));
+		check_decompress_all(PointerGetDatum(gorilla_compressor_finish(compressor)),
+							 FLOAT8OID,
+							 &float8_column);
+		AssertInt64Eq(float8_column.num_values, 2);
+	}
+}
+
+/*
+ * Compress a series of integers resembling status codes: values from a narrow
+ * range, with an outlier far outside the range every exception_interval-th
+ * value if exception_interval is positive. Every null_interval-th value is
+ * NULL if null_interval is positive.
+ */
+static Datum
+pfor_test_data(Oid element_type, int num_rows, int null_interval, int exception_interval)
+{
+	Compressor *compressor = pfor_compressor_for_type(element_type);
+	uint32 state = 42;
+	int i;
+
+	for (i = 0; i < num_rows; i++)
+	{
+		int64 value;
+
+		if (null_interval > 0 && i % null_interval == 0)
+		{
+			compressor->append_null(compressor);
+			continue;
+		}
+
+		value = 1000 + test_random(&state) % 64;
+		if (exception_interval > 0 && i % exception_interval == 0)
+			value += element_type == INT2OID ? 30000 : (int64) test_random(&state) << 16;
+
+		switch (element_type)
+		{
+			case INT2OID:
+				compressor->append_val(compressor, Int16GetDatum(value));
+				break;
+			case INT4OID:
+				compressor->append_val(compressor, Int32GetDatum(value));
+				break;
+			default:
+				compressor->append_val(compressor, Int64GetDatum(value));
+				break;
+		}
+	}
+
+	return PointerGetDatum(compressor->finish(compressor));
+}
+
+typedef void (*DecompressAllFunc)(Datum compressed, Oid element_type,
+								  DecompressedColumn *column);
+
+/*
+ * Check that the portable bulk decompression, if given, and the reverse
+ * iterator return the same values as the dispatched bulk decompression into
+ * column. Values are compared as datums, so this only works for by-value types.
+ */
+static void
+check_decompress_all_variants(Datum compressed, Oid element_type, DecompressedColumn *column,
+							  DecompressAllFunc decompress_all_scalar)
+{
+	CompressedDataHeader *header = (CompressedDataHeader *) DatumGetPointer(compressed);
+	DecompressionIterator *iter;
+	uint32 row;
+
+	check_decompress_all(compressed, element_type, column);
+
+	if (decompress_all_scalar != NULL)
+	{
+		DecompressedColumn scalar = { 0 };
+
+		decompress_all_scalar(compressed, element_type, &scalar);
+		AssertInt64Eq(scalar.num_values, column->num_values);
+		for (row = 0; row < column->num_values; row++)
+		{
+			if (DECOMPRESSED_COLUMN_IS_NULL(&scalar, row) !=
+				DECOMPRESSED_COLUMN_IS_NULL(column, row))
+				elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+			AssertInt64Eq(DatumGetInt64(decompressed_column_get_datum(&scalar, row)),
+						  DatumGetInt64(decompressed_column_get_datum(column, row)));
+		}
+	}
+
+	iter = tsl_get_decompression_iterator_init(header->compression_algorithm,
+											   true)(compressed, element_type);
+	row = column->num_values;
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		if (row == 0)
+			elog(ERROR, "reverse iterator returned too many values @ line %d", __LINE__);
+		row--;
+
+		if (r.is_null != DECOMPRESSED_COLUMN_IS_NULL(column, row))
+			elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+		if (!r.is_null)
+			AssertInt64Eq(DatumGetInt64(r.val),
+						  DatumGetInt64(decompressed_column_get_datum(column, row)));
+	}
+	AssertInt64Eq(row, 0);
+}
+
+static void
+test_pfor()
+{
+	DecompressedColumn column = { 0 };
+	Oid types[] = { INT2OID, INT4OID, INT8OID };
+	int null_intervals[] = { 0, 1, 3 };
+	int row_counts[] = { 1, 127, 128, 129, 1000 };
+	int exception_intervals[] = { 0, 50 };
+	Datum compressed;
+	int t;
+	int i;
+	int j;
+	int k;
+
+	for (t = 0; t < lengthof(types); t++)
+	{
+		for (i = 0; i < lengthof(null_intervals); i++)
+		{
+			for (j = 0; j < lengthof(row_counts); j++)
+			{
+				for (k = 0; k < lengthof(exception_intervals); k++)
+				{
+					compressed = pfor_test_data(types[t],
+												row_counts[j],
+												null_intervals[i],
+												exception_intervals[k]);
+					if (DatumGetPointer(compressed) != NULL)
+						check_decompress_all_variants(compressed,
+													  types[t],
+													  &column,
+													  pfor_decompress_all_scalar);
+				}
+			}
+		}
+	}
+
+	/* the codes need six bits each, plus a reference and a width per block */
+	compressed = pfor_test_data(INT4OID, 1000, 0, 0);
+	if (VARSIZE(DatumGetPointer(compressed)) > 1000)
+		elog(ERROR, "pfor compressed size %u too large @ line %d",
+			 VARSIZE(DatumGetPointer(compressed)),
+			 __LINE__);
+
+	/* offsets that need all 64 bits, for every position within a vector of four values */
+	for (j = 1; j <= 9; j++)
+	{
+		PforCompressor *compressor = pfor_compressor_alloc();
+
+		for (i = 0; i < j; i++)
+			pfor_compressor_append_value(compressor,
+										 i % 3 == 0 ? PG_INT64_MIN + i :
+													  (i % 3 == 1 ? PG_INT64_MAX - i : -i));
+
+		compressed = PointerGetDatum(pfor_compressor_finish(compressor));
+		check_decompress_all_variants(compressed, INT8OID, &column, pfor_decompress_all_scalar);
+		AssertInt64Eq(column.num_values, j);
+		AssertInt64Eq(((int64 *) column.values)[0], PG_INT64_MIN);
+	}
+
+	/* round trip through the binary format, with NULLs and exceptions */
+	{
+		StringInfoData buf;
+		bytea *sent;
+		StringInfoData transmition;
+		Datum compressed_recv;
+		DecompressedColumn column_recv = { 0 };
+		uint32 row;
+
+		compressed = pfor_test_data(INT8OID, 1000, 3, 50);
+		check_decompress_all_variants(compressed, INT8OID, &column, pfor_decompress_all_scalar);
+
+		pq_begintypsend(&buf);
+		pfor_compressed_send((CompressedDataHeader *) DatumGetPointer(compressed), &buf);
+		sent = pq_endtypsend(&buf);
+
+		transmition = (StringInfoData){
+			.data = VARDATA(sent),
+			.len = VARSIZE(sent),
+			.maxlen = VARSIZE(sent),
+		};
+
+		compressed_recv = pfor_compressed_recv(&transmition);
+		AssertInt64Eq(VARSIZE(DatumGetPointer(compressed_recv)),
+					  VARSIZE(DatumGetPointer(compressed)));
+		check_decompress_all_variants(compressed_recv,
+									  INT8OID,
+									  &column_recv,
+									  pfor_decompress_all_scalar);
+		for (row = 0; row < column.num_values; row++)
+			AssertInt64Eq(((int64 *) column_recv.values)[row], ((int64 *) column.values)[row]);
+	}
+}
+
+static void
+test_alp()
+{
+	DecompressedColumn column = { 0 };
+	Oid types[] = { FLOAT4OID, FLOAT8OID };
+	int null_intervals[] = { 0, 1, 3 };
+	int row_counts[] = { 1, 3, 4, 5, 1000 };
+	CompressedDataHeader *header;
+	Datum compressed;
+	Datum gorilla;
+	int kind;
+	int t;
+	int i;
+	int j;
+
+	for (kind = 0; kind < _GORILLA_TEST_MAX; kind++)
+	{
+		for (t = 0; t < lengthof(types); t++)
+		{
+			for (i = 0; i < lengthof(null_intervals); i++)
+			{
+				for (j = 0; j < lengthof(row_counts); j++)
+				{
+					compressed = alp_test_data(kind, types[t], row_counts[j], null_intervals[i]);
+					if (DatumGetPointer(compressed) == NULL)
+						continue;
+
+					/* series that are not decimal are compressed with gorilla */
+					header = (CompressedDataHeader *) DatumGetPointer(compressed);
+					check_decompress_all_variants(compressed,
+												  types[t],
+												  &column,
+												  header->compression_algorithm ==
+														  COMPRESSION_ALGORITHM_ALP ?
+													  alp_decompress_all_scalar :
+													  NULL);
+				}
+			}
+		}
+	}
+
+	/* readings with two decimals are smaller than with gorilla */
+	compressed = alp_test_data(GORILLA_TEST_TEMPERATURE, FLOAT8OID, 1000, 0);
+	gorilla = gorilla_test_data(GORILLA_TEST_TEMPERATURE, FLOAT8OID, 1000, 0);
+	AssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+				  COMPRESSION_ALGORITHM_ALP);
+	if (VARSIZE(DatumGetPointer(compressed)) >= VARSIZE(DatumGetPointer(gorilla)))
+		elog(ERROR,
+			 "alp compressed size %u not smaller than gorilla %u @ line %d",
+			 VARSIZE(DatumGetPointer(compressed)),
+			 VARSIZE(DatumGetPointer(gorilla)),
+			 __LINE__);
+
+	/* readings with full precision are not decimal numbers */
+	compressed = alp_test_data(GORILLA_TEST_POWER, FLOAT8OID, 1000, 0);
+	AssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+				  COMPRESSION_ALGORITHM_GORILLA);
+
+	/* values that cannot be scaled to integers are stored as exceptions */
+	{
+		double specials[] = { NAN, INFINITY, -INFINITY, -0.0, 1e300, 0.1 + 0.2, 1e-5 };
+		AlpCompressor *compressor = alp_compressor_alloc(FLOAT8OID);
+		StringInfoData buf;
+		bytea *sent;
+		StringInfoData transmition;
+		Datum compressed_recv;
+		DecompressedColumn column_recv = { 0 };
+		uint32 row;
+
+		for (i = 0; i < 100; i++)
+		{
+			if (i % 10 == 1)
+				alp_compressor_append_value(compressor, specials[(i / 10) % lengthof(specials)]);
+			else if (i % 10 == 5)
+				alp_compressor_append_null(compressor);
+			else
+				alp_compressor_append_value(compressor, (i - 50) / 100.0);
+		}
+
+		compressed = PointerGetDatum(alp_compressor_finish(compressor));
+		AssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))
+						  ->compression_algorithm,
+					  COMPRESSION_ALGORITHM_ALP);
+		check_decompress_all_variants(compressed, FLOAT8OID, &column, alp_decompress_all_scalar);
+		AssertInt64Eq(column.num_values, 100);
+		AssertInt64Eq(column.num_nulls, 10);
+		AssertInt64Eq(double_get_bits(((float8 *) column.values)[31]), double_get_bits(-0.0));
+		AssertInt64Eq(double_get_bits(((float8 *) column.values)[99]), double_get_bits(0.49));
+
+		pq_begintypsend(&buf);
+		alp_compressed_send((CompressedDataHeader *) DatumGetPointer(compressed), &buf);
+		sent = pq_endtypsend(&buf);
+
+		transmition = (StringInfoData){
+			.data = VARDATA(sent),
+			.len = VARSIZE(sent),
+			.maxlen = VARSIZE(sent),
+		};
+
+		compressed_recv = alp_compressed_recv(&transmition);
+		AssertInt64Eq(VARSIZE(DatumGetPointer(compressed_recv)),
+					  VARSIZE(DatumGetPointer(compressed)));
+		check_decompress_all_variants(compressed_recv,
+									  FLOAT8OID,
+									  &column_recv,
+									  alp_decompress_all_scalar);
+		for (row = 0; row < column.num_values; row++)
+			AssertInt64Eq(((int64 *) column_recv.values)[row], ((int64 *) column.values)[row]);
+	}
+}
+
+/*
+ * The block codecs store JSON-like texts in less space than the plain array,
+ * return the same values, and keep the plain array for data they cannot
+ * compress.
+ */
+static void
+test_array_lz()
+{
+	Compressor *(*compressor_for_type[])(Oid) = {
+		array_lz4_compressor_for_type,
+		array_zstd_compressor_for_type,
+	};
+	Datum (*compressed_recv[])(StringInfo) = {
+		array_lz4_compressed_recv,
+		array_zstd_compressed_recv,
+	};
+	CompressionAlgorithms algorithms[] = {
+		COMPRESSION_ALGORITHM_ARRAY_LZ4,
+		COMPRESSION_ALGORITHM_ARRAY_ZSTD,
+	};
+	/* without a codec library the data is compressed with pglz */
+	const char *codecs[] = {
+#ifdef TS_USE_LZ4
+		"lz4",
+#else
+		"pglz",
+#endif
+#ifdef TS_USE_ZSTD
+		"zstd",
+#else
+		"pglz",
+#endif
+	};
+	DecompressedColumn column = { 0 };
+	DecompressedColumn column_recv = { 0 };
+	int a;
+	int i;
+
+	for (a = 0; a < lengthof(algorithms); a++)
+	{
+		Compressor *compressor = compressor_for_type[a](TEXTOID);
+		Compressor *array = array_compressor_for_type(TEXTOID);
+		CompressedDataHeader *header;
+		Datum compressed;
+		Datum plain;
+		DecompressionIterator *iter;
+		StringInfoData buf;
+		bytea *sent;
+		StringInfoData transmition;
+		Datum compressed_recv_datum;
+		uint32 row;
+
+		for (i = 0; i < 1000; i++)
+		{
+			if (i % 7 == 3)
+			{
+				compressor->append_null(compressor);
+				array->append_null(array);
+			}
+			else
+			{
+				Datum val = CStringGetTextDatum(
+					psprintf("{\"sensor\": \"sensor_%d\", \"reading\": %d}", i % 10, i));
+				compressor->append_val(compressor, val);
+				array->append_val(array, val);
+			}
+		}
+
+		compressed = PointerGetDatum(compressor->finish(compressor));
+		plain = PointerGetDatum(array->finish(array));
+		header = (CompressedDataHeader *) DatumGetPointer(compressed);
+		AssertInt64Eq(header->compression_algorithm, algorithms[a]);
+		if (strcmp(array_lz_codec_name(header), codecs[a]) != 0)
+			elog(ERROR,
+				 "codec \"%s\" != \"%s\" @ line %d",
+				 array_lz_codec_name(header),
+				 codecs[a],
+				 __LINE__);
+		if (VARSIZE(header) >= VARSIZE(DatumGetPointer(plain)))
+			elog(ERROR,
+				 "%s compressed size %u not smaller than array %u @ line %d",
+				 codecs[a],
+				 VARSIZE(header),
+				 VARSIZE(DatumGetPointer(plain)),
+				 __LINE__);
+
+		check_decompress_all(compressed, TEXTOID, &column);
+		AssertInt64Eq(column.num_values, 1000);
+		for (row = 0; row < column.num_values; row++)
+		{
+			char *expected;
+
+			if (row % 7 == 3)
+			{
+				if (!DECOMPRESSED_COLUMN_IS_NULL(&column, row))
+					elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+				continue;
+			}
+
+			expected = psprintf("{\"sensor\": \"sensor_%u\", \"reading\": %u}", row % 10, row);
+			if (strcmp(TextDatumGetCString(decompressed_column_get_datum(&column, row)),
+					   expected) != 0)
+				elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+		}
+
+		iter = tsl_get_decompression_iterator_init(algorithms[a], true)(compressed, TEXTOID);
+		row = column.num_values;
+		for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+		{
+			row--;
+			if (r.is_null != DECOMPRESSED_COLUMN_IS_NULL(&column, row))
+				elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+			if (!r.is_null &&
+				strcmp(TextDatumGetCString(r.val),
+					   TextDatumGetCString(decompressed_column_get_datum(&column, row))) != 0)
+				elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+		}
+		AssertInt64Eq(row, 0);
+
+		/* the binary format is that of the array, compressed again on receipt */
+		pq_begintypsend(&buf);
+		array_lz_compressed_send(header, &buf);
+		sent = pq_endtypsend(&buf);
+
+		transmition = (StringInfoData){
+			.data = VARDATA(sent),
+			.len = VARSIZE(sent),
+			.maxlen = VARSIZE(sent),
+		};
+
+		compressed_recv_datum = compressed_recv[a](&transmition);
+		AssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed_recv_datum))
+						  ->compression_algorithm,
+					  algorithms[a]);
+		AssertInt64Eq(VARSIZE(DatumGetPointer(compressed_recv_datum)), VARSIZE(header));
+		check_decompress_all(compressed_recv_datum, TEXTOID, &column_recv);
+		AssertInt64Eq(column_recv.num_values, column.num_values);
+		for (row = 0; row < column.num_values; row++)
+		{
+			if (DECOMPRESSED_COLUMN_IS_NULL(&column_recv, row) !=
+				DECOMPRESSED_COLUMN_IS_NULL(&column, row))
+				elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+			if (!DECOMPRESSED_COLUMN_IS_NULL(&column, row) &&
+				!datumIsEqual(decompressed_column_get_datum(&column_recv, row),
+							  decompressed_column_get_datum(&column, row),
+							  false,
+							  -1))
+				elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+		}
+	}
+
+	/* random integers do not compress, so the plain array is kept */
+	for (a = 0; a < lengthof(algorithms); a++)
+	{
+		Compressor *compressor = compressor_for_type[a](INT8OID);
+		uint32 state = 7;
+		Datum compressed;
+
+		for (i = 0; i < 1000; i++)
+		{
+			uint64 value = 0;
+			int j;
+
+			for (j = 0; j < 5; j++)
+				value = (value << 15) ^ test_random(&state);
+			compressor->append_val(compressor, Int64GetDatum((int64) value));
+		}
+
+		compressed = PointerGetDatum(compressor->finish(compressor));
+		AssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_ARRAY);
+		check_decompress_all(compressed, INT8OID, &column);
+		AssertInt64Eq(column.num_values, 1000);
+	}
+}
+
+static Datum
+test_jsonb_value(int i)
+{
+	char *value;
+
+	if (i % 13 == 7)
+		value = i % 2 == 0 ? "[1, 2]" : "\"scalar\"";
+	else
+		value = psprintf("{\"time\": %d, \"temp\": %d.%d, \"name\": \"dev_%d\", \"ok\": %s, "
+						 "\"mixed\": %s, \"nested\": {\"a\": %d}%s}",
+						 i * 10,
+						 i / 4,
+						 i % 4 * 25,
+						 i % 5,
+						 i % 2 == 0 ? "true" : "false",
+						 i % 3 == 0 ? "\"three\"" : psprintf("%d", i),
+						 i,
+						 i % 50 == 0 ? psprintf(", \"rare\": %d", i) : "");
+	return OidFunctionCall1(F_JSONB_IN, CStringGetDatum(value));
+}
+
+static bool
+test_jsonb_eq(Datum a, Datum b)
+{
+	return DatumGetBool(OidFunctionCall2(F_JSONB_EQ, a, b));
+}
+
+/* the value of a top level key as jsonb, or NULL if it is missing */
+static Jsonb *
+test_jsonb_field(Datum value, const char *key)
+{
+	Jsonb *jsonb = (Jsonb *) PG_DETOAST_DATUM(value);
+	JsonbValue key_value = {
+		.type = jbvString,
+		.val.string = { .len = strlen(key), .val = (char *) key },
+	};
+	JsonbValue *field;
+
+	if (!JB_ROOT_IS_OBJECT(jsonb))
+		return NULL;
+	field = findJsonbValueFromContainer(&jsonb->root, JB_FOBJECT, &key_value);
+	return field == NULL ? NULL : JsonbValueToJsonb(field);
+}
+
+static void
+test_jsonb()
+{
+	/* shredded keys, a key partly in the residual, a rare key and a nested object */
+	char *keys[] = { "temp", "mixed", "rare", "nested" };
+	Compressor *compressor = jsonb_compressor_for_type(JSONBOID);
+	DecompressedColumn column = { 0 };
+	DecompressedColumn projected = { 0 };
+	DecompressedColumn column_recv = { 0 };
+	CompressedDataHeader *header;
+	Datum compressed;
+	DecompressionIterator *iter;
+	StringInfoData buf;
+	bytea *sent;
+	StringInfoData transmition;
+	Datum compressed_recv_datum;
+	uint32 row;
+	int i;
+	int k;
+
+	for (i = 0; i < 1000; i++)
+	{
+		if (i % 11 == 5)
+			compressor->append_null(compressor);
+		else
+			compressor->append_val(compressor, test_jsonb_value(i));
+	}
+
+	compressed = PointerGetDatum(compressor->finish(compressor));
+	header = (CompressedDataHeader *) DatumGetPointer(compressed);
+	AssertInt64Eq(header->compression_algorithm, COMPRESSION_ALGORITHM_JSONB);
+
+	check_decompress_all(compressed, JSONBOID, &column);
+	AssertInt64Eq(column.num_values, 1000);
+	for (row = 0; row < column.num_values; row++)
+	{
+		if (DECOMPRESSED_COLUMN_IS_NULL(&column, row) != (row % 11 == 5))
+			elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+		if (!DECOMPRESSED_COLUMN_IS_NULL(&column, row) &&
+			!test_jsonb_eq(decompressed_column_get_datum(&column, row), test_jsonb_value(row)))
+			elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+	}
+
+	iter = tsl_get_decompression_iterator_init(COMPRESSION_ALGORITHM_JSONB, true)(compressed,
+																				  JSONBOID);
+	row = column.num_values;
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		row--;
+		if (r.is_null != DECOMPRESSED_COLUMN_IS_NULL(&column, row))
+			elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+		if (!r.is_null && !test_jsonb_eq(r.val, decompressed_column_get_datum(&column, row)))
+			elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+	}
+	AssertInt64Eq(row, 0);
+
+	/* decompressing with only some keys gives the same values for these keys */
+	for (k = 0; k < lengthof(keys); k++)
+	{
+		jsonb_decompress_keys(compressed, &keys[k], 1, &projected);
+		AssertInt64Eq(projected.num_values, column.num_values);
+		iter = jsonb_decompression_iterator_from_datum_keys(compressed, true, &keys[k], 1);
+		row = 0;
+		for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+		{
+			Jsonb *expected;
+			Jsonb *actual;
+
+			if (r.is_null != DECOMPRESSED_COLUMN_IS_NULL(&column, row) ||
+				r.is_null != DECOMPRESSED_COLUMN_IS_NULL(&projected, row))
+				elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+			if (r.is_null)
+			{
+				row++;
+				continue;
+			}
+
+			if (!test_jsonb_eq(r.val, decompressed_column_get_datum(&projected, row)))
+				elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+
+			expected = test_jsonb_field(decompressed_column_get_datum(&column, row), keys[k]);
+			actual = test_jsonb_field(r.val, keys[k]);
+			if ((expected == NULL) != (actual == NULL) ||
+				(expected != NULL &&
+				 !test_jsonb_eq(PointerGetDatum(expected), PointerGetDatum(actual))))
+				elog(ERROR, "key \"%s\" mismatch for row %u @ line %d", keys[k], row, __LINE__);
+			row++;
+		}
+		AssertInt64Eq(row, column.num_values);
+	}
+
+	pq_begintypsend(&buf);
+	jsonb_compressed_send(header, &buf);
+	sent = pq_endtypsend(&buf);
+
+	transmition = (StringInfoData){
+		.data = VARDATA(sent),
+		.len = VARSIZE(sent),
+		.maxlen = VARSIZE(sent),
+	};
+
+	compressed_recv_datum = jsonb_compressed_recv(&transmition);
+	AssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed_recv_datum))
+					  ->compression_algorithm,
+				  COMPRESSION_ALGORITHM_JSONB);
+	check_decompress_all(compressed_recv_datum, JSONBOID, &column_recv);
+	AssertInt64Eq(column_recv.num_values, column.num_values);
+	for (row = 0; row < column.num_values; row++)
+	{
+		if (DECOMPRESSED_COLUMN_IS_NULL(&column_recv, row) !=
+			DECOMPRESSED_COLUMN_IS_NULL(&column, row))
+			elog(ERROR, "NULL mismatch for row %u @ line %d", row, __LINE__);
+		if (!DECOMPRESSED_COLUMN_IS_NULL(&column, row) &&
+			!test_jsonb_eq(decompressed_column_get_datum(&column_recv, row),
+						   decompressed_column_get_datum(&column, row)))
+			elog(ERROR, "value mismatch for row %u @ line %d", row, __LINE__);
+	}
+}
+
 Datum
 ts_test_compression(PG_FUNCTION_ARGS)
 {
@@ -471,9 +1663,568 @@ ts_test_compression(PG_FUNCTION_ARGS)
 	test_gorilla_double();
 	test_delta();
 	test_delta2();
+	test_decompress_all();
+	test_sorted_dictionary();
+	test_simple8b_decode();
+	test_gorilla_decompress_all();
+	test_pfor();
+	test_alp();
+	test_array_lz();
+	test_jsonb();
 	PG_RETURN_VOID();
 }
 
+/*
+ * Decompression benchmarks.
+ *
+ * All benchmarks run through the same harness: a benchmark segment is a
+ * sequence of compressed batches together with a checksum of the values they
+ * were compressed from, and every method decodes all batches of a segment and
+ * folds the decoded values into a checksum. Each method runs once untimed,
+ * which checks its checksum, and then the given number of times timed. A
+ * regression run with zero iterations therefore checks the results of every
+ * method without depending on the timings.
+ */
+
+/* fold a value into a checksum that depends on the order of the values */
+static inline uint64
+checksum_add(uint64 checksum, uint64 bits)
+{
+	return (checksum ^ bits) * UINT64CONST(0x100000001b3);
+}
+
+static uint64
+checksum_add_datum(uint64 checksum, Datum value, bool is_null, int16 typlen, bool typbyval)
+{
+	char *ptr;
+
+	if (is_null)
+		return checksum_add(checksum, UINT64CONST(0x9e3779b97f4a7c15));
+
+	if (typbyval)
+		return checksum_add(checksum, (uint64) value);
+
+	ptr = DatumGetPointer(value);
+
+	if (typlen > 0)
+		return checksum_add(checksum, DatumGetUInt32(hash_any((unsigned char *) ptr, typlen)));
+
+	return checksum_add(checksum,
+						DatumGetUInt32(
+							hash_any((unsigned char *) VARDATA_ANY(ptr), VARSIZE_ANY_EXHDR(ptr))));
+}
+
+/* a compressor that keeps a checksum of the values it passes on */
+typedef struct ChecksumCompressor
+{
+	Compressor base;
+	Compressor *compressor;
+	int16 typlen;
+	bool typbyval;
+	uint32 num_values;
+	uint64 checksum;
+} ChecksumCompressor;
+
+static void
+checksum_compressor_append_null(Compressor *compressor)
+{
+	ChecksumCompressor *checksum = (ChecksumCompressor *) compressor;
+
+	checksum->checksum =
+		checksum_add_datum(checksum->checksum, 0, true, checksum->typlen, checksum->typbyval);
+	checksum->num_values++;
+	checksum->compressor->append_null(checksum->compressor);
+}
+
+static void
+checksum_compressor_append_val(Compressor *compressor, Datum val)
+{
+	ChecksumCompressor *checksum = (ChecksumCompressor *) compressor;
+
+	checksum->checksum =
+		checksum_add_datum(checksum->checksum, val, false, checksum->typlen, checksum->typbyval);
+	checksum->num_values++;
+	checksum->compressor->append_val(checksum->compressor, val);
+}
+
+static void *
+checksum_compressor_finish(Compressor *compressor)
+{
+	ChecksumCompressor *checksum = (ChecksumCompressor *) compressor;
+
+	return checksum->compressor->finish(checksum->compressor);
+}
+
+static void
+checksum_compressor_init(ChecksumCompressor *checksum, Compressor *compressor, Oid element_type)
+{
+	*checksum = (ChecksumCompressor){
+		.base = {
+			.append_null = checksum_compressor_append_null,
+			.append_val = checksum_compressor_append_val,
+			.finish = checksum_compressor_finish,
+		},
+		.compressor = compressor,
+	};
+	get_typlenbyval(element_type, &checksum->typlen, &checksum->typbyval);
+}
+
+typedef struct BenchmarkSegment
+{
+	const char *benchmark;
+	const char *series;
+	const char *variant; /* NULL if the benchmark has no variants */
+	Oid element_type;
+	int16 typlen;
+	bool typbyval;
+	int num_batches;
+	Datum *batches;
+	uint32 num_values;
+	uint64 checksum;
+	Size compressed_size;
+	const struct BenchmarkMethod *methods;
+	int num_methods;
+} BenchmarkSegment;
+
+/* decode all batches of a segment, returning the checksum of the values */
+typedef uint64 (*BenchmarkDecodeFunc)(const BenchmarkSegment *segment, DecompressedColumn *column,
+									  uint32 *num_values);
+
+typedef struct BenchmarkMethod
+{
+	const char *name;
+	BenchmarkDecodeFunc decode;
+	/* the name of the kernel chosen for the CPU, if the method dispatches on it */
+	const char *(*implementation)(void);
+} BenchmarkMethod;
+
+static uint64
+benchmark_decode_iterator(const BenchmarkSegment *segment, DecompressedColumn *column,
+						  uint32 *num_values)
+{
+	uint64 checksum = 0;
+	int batch;
+
+	*num_values = 0;
+
+	for (batch = 0; batch < segment->num_batches; batch++)
+	{
+		CompressedDataHeader *header =
+			(CompressedDataHeader *) DatumGetPointer(segment->batches[batch]);
+		DecompressionIterator *iter =
+			tsl_get_decompression_iterator_init(header->compression_algorithm,
+												false)(segment->batches[batch],
+													   segment->element_type);
+
+		for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+		{
+			checksum =
+				checksum_add_datum(checksum, r.val, r.is_null, segment->typlen, segment->typbyval);
+			(*num_values)++;
+		}
+	}
+
+	return checksum;
+}
+
+static uint64
+benchmark_decode_bulk(const BenchmarkSegment *segment, DecompressedColumn *column,
+					  uint32 *num_values)
+{
+	uint64 checksum = 0;
+	int batch;
+
+	*num_values = 0;
+
+	for (batch = 0; batch < segment->num_batches; batch++)
+	{
+		uint32 row;
+
+		decompress_all(segment->batches[batch], segment->element_type, column);
+
+		for (row = 0; row < column->num_values; row++)
+		{
+			bool is_null = DECOMPRESSED_COLUMN_IS_NULL(column, row);
+
+			checksum = checksum_add_datum(checksum,
+										  is_null ? 0 : decompressed_column_get_datum(column, row),
+										  is_null,
+										  segment->typlen,
+										  segment->typbyval);
+		}
+
+		*num_values += column->num_values;
+	}
+
+	return checksum;
+}
+
+/* the batch of a simple8b segment is a stream rather than a compressed datum */
+static uint64
+benchmark_decode_simple8b_iterator(const BenchmarkSegment *segment, DecompressedColumn *column,
+								   uint32 *num_values)
+{
+	Simple8bRleSerialized *compressed =
+		(Simple8bRleSerialized *) DatumGetPointer(segment->batches[0]);
+	Simple8bRleDecompressionIterator iter;
+	uint64 checksum = 0;
+
+	*num_values = 0;
+
+	simple8brle_decompression_iterator_init_forward(&iter, compressed);
+	for (Simple8bRleDecompressResult r = simple8brle_decompression_iterator_try_next_forward(&iter);
+		 !r.is_done;
+		 r = simple8brle_decompression_iterator_try_next_forward(&iter))
+	{
+		checksum = checksum_add(checksum, r.val);
+		(*num_values)++;
+	}
+
+	return checksum;
+}
+
+static uint64
+simple8b_checksum(const uint64 *values, uint32 num_values)
+{
+	uint64 checksum = 0;
+	uint32 i;
+
+	for (i = 0; i < num_values; i++)
+		checksum = checksum_add(checksum, values[i]);
+
+	return checksum;
+}
+
+static uint64
+benchmark_decode_simple8b_scalar(const BenchmarkSegment *segment, DecompressedColumn *column,
+								 uint32 *num_values)
+{
+	Simple8bRleSerialized *compressed =
+		(Simple8bRleSerialized *) DatumGetPointer(segment->batches[0]);
+	uint32 num_slots = simple8brle_num_selector_slots_for_num_blocks(compressed->num_blocks);
+	uint64 *out =
+		palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(compressed->num_elements));
+
+	*num_values = simple8brle_decode_blocks_scalar(compressed->slots,
+												   compressed->slots + num_slots,
+												   compressed->num_blocks,
+												   compressed->num_elements,
+												   out);
+
+	return simple8b_checksum(out, *num_values);
+}
+
+static uint64
+benchmark_decode_simple8b_dispatched(const BenchmarkSegment *segment, DecompressedColumn *column,
+									 uint32 *num_values)
+{
+	Simple8bRleSerialized *compressed =
+		(Simple8bRleSerialized *) DatumGetPointer(segment->batches[0]);
+	uint64 *out =
+		palloc(sizeof(uint64) * simple8brle_decompress_all_buffer_size(compressed->num_elements));
+
+	*num_values = simple8brle_decompress_all_forward(compressed, out);
+
+	return simple8b_checksum(out, *num_values);
+}
+
+static const BenchmarkMethod benchmark_datum_methods[] = {
+	{ .name = "iterator", .decode = benchmark_decode_iterator },
+	{ .name = "bulk", .decode = benchmark_decode_bulk },
+};
+
+static const BenchmarkMethod benchmark_simple8b_methods[] = {
+	{ .name = "iterator", .decode = benchmark_decode_simple8b_iterator },
+	{ .name = "scalar", .decode = benchmark_decode_simple8b_scalar },
+	{
+		.name = "dispatched",
+		.decode = benchmark_decode_simple8b_dispatched,
+		.implementation = simple8brle_decode_blocks_implementation,
+	},
+};
+
+static BenchmarkSegment *
+benchmark_segment_create(const char *benchmark, const char *series, const char *variant,
+						 Oid element_type, int num_batches, const BenchmarkMethod *methods,
+						 int num_methods)
+{
+	BenchmarkSegment *segment = palloc0(sizeof(BenchmarkSegment));
+
+	segment->benchmark = benchmark;
+	segment->series = series;
+	segment->variant = variant;
+	segment->element_type = element_type;
+	segment->num_batches = num_batches;
+	segment->batches = palloc0(sizeof(Datum) * num_batches);
+	segment->methods = methods;
+	segment->num_methods = num_methods;
+
+	if (OidIsValid(element_type))
+		get_typlenbyval(element_type, &segment->typlen, &segment->typbyval);
+
+	return segment;
+}
+
+/* add a compressed batch and the checksum of its values to a segment */
+static void
+benchmark_segment_add_batch(BenchmarkSegment *segment, int batch, Datum compressed,
+							ChecksumCompressor *checksum)
+{
+	segment->batches[batch] = compressed;
+	segment->compressed_size += VARSIZE_ANY(DatumGetPointer(compressed));
+	segment->num_values += checksum->num_values;
+	/* the checksum of the segment continues over its batches */
+	segment->checksum = checksum->checksum;
+}
+
+static const int batch_size_benchmark_sizes[] = { 100, 1000, 10000 };
+
+#define BATCH_SIZE_BENCHMARK_ROWS 10000
+#define FLOAT_BENCHMARK_ROWS 1000
+#define SIMPLE8B_BENCHMARK_VALUES 1000
+
+static const char *const float_benchmark_algorithms[] = { "gorilla", "alp" };
+
+/*
+ * The segments of the benchmarks:
+ *
+ * segment: the columns of a typical time-series table compressed with the
+ * default algorithm of their type, in batches of different sizes, to compare
+ * the compression ratio and the speed of bulk decompression with the iterator
+ * for every batch size.
+ *
+ * float: sensor series compressed with gorilla and ALP.
+ *
+ * simple8b: streams like the ones the algorithms produce, decoded with the
+ * iterator, the portable block decoder and the block decoder chosen for the
+ * CPU.
+ */
+static List *
+benchmark_segments(void)
+{
+	List *segments = NIL;
+	int kind;
+	int size;
+	int algorithm;
+
+	for (kind = 0; kind < _TEST_DATA_MAX; kind++)
+	{
+		for (size = 0; size < lengthof(batch_size_benchmark_sizes); size++)
+		{
+			int batch_size = batch_size_benchmark_sizes[size];
+			int num_batches = BATCH_SIZE_BENCHMARK_ROWS / batch_size;
+			BenchmarkSegment *segment =
+				benchmark_segment_create("segment",
+										 test_data_names[kind],
+										 psprintf("%d", batch_size),
+										 test_data_types[kind],
+										 num_batches,
+										 benchmark_datum_methods,
+										 lengthof(benchmark_datum_methods));
+			int batch;
+
+			for (batch = 0; batch < num_batches; batch++)
+			{
+				ChecksumCompressor checksum;
+
+				checksum_compressor_init(&checksum,
+										 test_data_compressor(kind),
+										 test_data_types[kind]);
+				checksum.checksum = segment->checksum;
+				benchmark_segment_add_batch(segment,
+											batch,
+											test_data_compress(&checksum.base, kind, batch_size, 0),
+											&checksum);
+			}
+
+			segments = lappend(segments, segment);
+		}
+	}
+
+	for (kind = 0; kind < _GORILLA_TEST_MAX; kind++)
+	{
+		for (algorithm = 0; algorithm < lengthof(float_benchmark_algorithms); algorithm++)
+		{
+			BenchmarkSegment *segment =
+				benchmark_segment_create("float",
+										 gorilla_test_data_names[kind],
+										 float_benchmark_algorithms[algorithm],
+										 FLOAT8OID,
+										 1,
+										 benchmark_datum_methods,
+										 lengthof(benchmark_datum_methods));
+			ChecksumCompressor checksum;
+
+			checksum_compressor_init(&checksum,
+									 algorithm == 0 ? gorilla_compressor_for_type(FLOAT8OID) :
+													  alp_compressor_for_type(FLOAT8OID),
+									 FLOAT8OID);
+			benchmark_segment_add_batch(segment,
+										0,
+										float_test_data(&checksum.base,
+														kind,
+														FLOAT8OID,
+														FLOAT_BENCHMARK_ROWS,
+														0),
+										&checksum);
+			segments = lappend(segments, segment);
+		}
+	}
+
+	for (kind = 0; kind < _SIMPLE8B_TEST_MAX; kind++)
+	{
+		BenchmarkSegment *segment =
+			benchmark_segment_create("simple8b",
+									 simple8b_test_data_names[kind],
+									 NULL,
+									 InvalidOid,
+									 1,
+									 benchmark_simple8b_methods,
+									 lengthof(benchmark_simple8b_methods));
+		Simple8bRleSerialized *compressed = simple8b_test_data(kind, SIMPLE8B_BENCHMARK_VALUES);
+		uint32 state = 42;
+		int i;
+
+		segment->batches[0] = PointerGetDatum(compressed);
+		segment->compressed_size = simple8brle_serialized_total_size(compressed);
+		segment->num_values = SIMPLE8B_BENCHMARK_VALUES;
+
+		for (i = 0; i < SIMPLE8B_BENCHMARK_VALUES; i++)
+			segment->checksum = checksum_add(segment->checksum, simple8b_test_value(kind, &state));
+
+		segments = lappend(segments, segment);
+	}
+
+	return segments;
+}
+
+typedef struct BenchmarkResult
+{
+	const BenchmarkSegment *segment;
+	const BenchmarkMethod *method;
+	bool correct;
+	double ms;
+} BenchmarkResult;
+
+/*
+ * Run the decompression benchmarks. Returns one row per benchmark segment and
+ * method with the number of values, the compressed size in bytes per value,
+ * whether the method decoded the values the segment was compressed from, and
+ * the total time in milliseconds taken by the method over the given number of
+ * iterations.
+ */
+Datum
+ts_test_compression_benchmark(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	BenchmarkResult *results;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		int32 iterations = PG_GETARG_INT32(0);
+		MemoryContext oldcontext;
+		MemoryContext iteration_mcxt;
+		TupleDesc tupdesc;
+		List *segments;
+		ListCell *lc;
+		int num_results = 0;
+		int r = 0;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR,
+				 "function returning record called in context that cannot accept type record");
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		segments = benchmark_segments();
+
+		foreach (lc, segments)
+			num_results += ((BenchmarkSegment *) lfirst(lc))->num_methods;
+
+		results = palloc0(sizeof(BenchmarkResult) * num_results);
+		funcctx->user_fctx = results;
+		funcctx->max_calls = num_results;
+		MemoryContextSwitchTo(oldcontext);
+
+		/* per-iteration allocations are released by resetting this context */
+		iteration_mcxt =
+			AllocSetContextCreate(CurrentMemoryContext, "benchmark", ALLOCSET_DEFAULT_SIZES);
+
+		foreach (lc, segments)
+		{
+			BenchmarkSegment *segment = lfirst(lc);
+			int m;
+
+			for (m = 0; m < segment->num_methods; m++)
+			{
+				const BenchmarkMethod *method = &segment->methods[m];
+				/* the column arrays are allocated by the untimed run */
+				DecompressedColumn column = { 0 };
+				BenchmarkResult *result = &results[r++];
+				instr_time start;
+				instr_time duration;
+				uint32 num_values;
+				uint64 checksum;
+				int i;
+
+				checksum = method->decode(segment, &column, &num_values);
+				result->segment = segment;
+				result->method = method;
+				result->correct =
+					checksum == segment->checksum && num_values == segment->num_values;
+
+				INSTR_TIME_SET_CURRENT(start);
+				for (i = 0; i < iterations; i++)
+				{
+					oldcontext = MemoryContextSwitchTo(iteration_mcxt);
+					method->decode(segment, &column, &num_values);
+					MemoryContextSwitchTo(oldcontext);
+					MemoryContextReset(iteration_mcxt);
+				}
+				INSTR_TIME_SET_CURRENT(duration);
+				INSTR_TIME_SUBTRACT(duration, start);
+				result->ms = INSTR_TIME_GET_MILLISEC(duration);
+			}
+		}
+
+		MemoryContextDelete(iteration_mcxt);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	results = funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		BenchmarkResult *result = &results[funcctx->call_cntr];
+		const BenchmarkSegment *segment = result->segment;
+		Datum values[9];
+		bool nulls[9] = { false };
+
+		values[0] = CStringGetTextDatum(segment->benchmark);
+		values[1] = CStringGetTextDatum(segment->series);
+		if (segment->variant != NULL)
+			values[2] = CStringGetTextDatum(segment->variant);
+		else
+			nulls[2] = true;
+		values[3] = CStringGetTextDatum(result->method->name);
+		if (result->method->implementation != NULL)
+			values[4] = CStringGetTextDatum(result->method->implementation());
+		else
+			nulls[4] = true;
+		values[5] = Int32GetDatum(segment->num_values);
+		values[6] = Float8GetDatum((double) segment->compressed_size / segment->num_values);
+		values[7] = BoolGetDatum(result->correct);
+		values[8] = Float8GetDatum(result->ms);
+
+		SRF_RETURN_NEXT(funcctx,
+						HeapTupleGetDatum(heap_form_tuple(funcctx->tuple_desc, values, nulls)));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
 static compression_info_vec *
 compression_info_from_array(ArrayType *compression_info_arr, Oid form_oid)
 {
@@ -529,7 +2280,9 @@ ts_compress_table(PG_FUNCTION_ARGS)
 	compress_chunk(in_table,
 				   out_table,
 				   (const ColumnCompressionInfo **) compression_info->data,
-				   compression_info->num_elements);
+				   compression_info->num_elements,
+				   DEFAULT_ROWS_PER_COMPRESSION,
+				   false);
 
 	PG_RETURN_VOID();
 }
@@ -545,6 +2298,54 @@ ts_decompress_table(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/*
+ * Return the number of times this backend read the rows to compress through an
+ * ordered index and the number of times it sorted them.
+ */
+Datum
+ts_test_compression_sorted_rows_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	Datum values[2];
+	bool nulls[2] = { false };
+	int64 index_scans;
+	int64 sorts;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "function returning record called in context that cannot accept type record");
+
+	compress_chunk_sorted_rows_stats(&index_scans, &sorts);
+
+	values[0] = Int64GetDatum(index_scans);
+	values[1] = Int64GetDatum(sorts);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc), values, nulls)));
+}
+
+/*
+ * Return the number of chunks this backend compressed in parallel and the
+ * number of parallel workers launched for them.
+ */
+Datum
+ts_test_compression_parallel_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	Datum values[2];
+	bool nulls[2] = { false };
+	int64 chunks;
+	int64 workers;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "function returning record called in context that cannot accept type record");
+
+	compress_chunk_parallel_stats(&chunks, &workers);
+
+	values[0] = Int64GetDatum(chunks);
+	values[1] = Int64GetDatum(workers);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc), values, nulls)));
+}
+
 TS_FUNCTION_INFO_V1(ts_segment_meta_min_max_append);
 
 Datum